@@ -25,6 +25,8 @@ GmtSession::GmtSession(boost::asio::io_service& io_service, const boost::asio::i
 {
 	_remote_endpoint = endpoint;
 	_ip_address = endpoint.address().to_string();
+
+	SetQueueLimits("GmtSession"); //发送队列水位
 }
 	
 void GmtSession::OnConnected()
@@ -40,6 +42,8 @@ void GmtSession::OnConnected()
 
 bool GmtSession::OnInnerProcess(const Asset::InnerMeta& meta)
 {
+	TrafficScope traffic(TRAFFIC_CLASS_GMT, meta.type_t(), meta.stuff().size()); //流量统计，协议类型为INNER_TYPE
+
 	std::lock_guard<std::mutex> lock(_gmt_lock);
 	_session_id = meta.session_id();
 
@@ -110,6 +114,16 @@ bool GmtSession::OnInnerProcess(const Asset::InnerMeta& meta)
 		}
 		break;
 
+		case Asset::INNER_TYPE_QUERY_TRAFFIC: //流量统计
+		{
+			Asset::QueryTraffic message;
+			auto result = message.ParseFromString(meta.stuff());
+			if (!result) return false;
+
+			OnQueryTraffic(message);
+		}
+		break;
+
 		default:
 		{
 			WARN("接收GMT指令:{} 尚未含有处理回调，协议数据:{}", meta.type_t(), meta.ShortDebugString());
@@ -125,6 +139,18 @@ Asset::COMMAND_ERROR_CODE GmtSession::OnActivityControl(const Asset::ActivityCon
 	RETURN(ret)
 }
 
+Asset::COMMAND_ERROR_CODE GmtSession::OnQueryTraffic(Asset::QueryTraffic& command)
+{
+	auto top = command.top() > 0 ? command.top() : ConfigInstance.GetInt("TrafficReportTop", 20);
+
+	auto report = WorldSessionInstance.TrafficReport(top);
+	TrafficStats::Dump(ConfigInstance.GetString("TrafficStatsFile", ""), report); //同时输出到本地文件
+
+	command.set_server_id(ConfigInstance.GetInt("ServerID", 1)); //多个中心服务器分别返回
+	command.set_report(report);
+	RETURN(Asset::COMMAND_ERROR_CODE_SUCCESS);
+}
+
 Asset::COMMAND_ERROR_CODE GmtSession::OnSendMail(const Asset::SendMail& command)
 {
 	const auto player_id = command.player_id(); 
@@ -301,23 +327,17 @@ void GmtSession::SendProtocol(pb::Message& message)
 	int type_t = field->default_value_enum()->number();
 	if (!Asset::INNER_TYPE_IsValid(type_t)) return;	//如果不合法，不检查会宕线
 	
-	auto inner_meta_string = message.SerializeAsString();
-
-	Asset::InnerMeta meta;
-	meta.set_type_t((Asset::INNER_TYPE)type_t);
-	meta.set_session_id(_session_id);
-	meta.set_stuff(inner_meta_string);
-	
-	std::string content = meta.SerializeAsString();
-
-	if (content.empty()) 
+	auto frame = FrameBuffer::BuildInnerMeta(message, type_t, _session_id); //直接序列化到发送缓存
+	if (!frame) 
 	{
-		ERROR("server:{} send nothing, message:{}", _ip_address, meta.ShortDebugString());
+		ERROR("server:{} send failed, type_t:{} message:{}", _ip_address, type_t, message.ShortDebugString());
 		return;
 	}
 
-	DEBUG("发送协议数据到GMT服务器:{} 协议数据:{} 内容:{}", _ip_address, meta.ShortDebugString(), message.ShortDebugString());
-	AsyncSendMessage(content);
+	DEBUG("发送协议数据到GMT服务器:{} 协议类型:{} 内容:{}", _ip_address, type_t, message.ShortDebugString());
+
+	TrafficStatsInstance.Record(TRAFFIC_CLASS_GMT, TRAFFIC_DIRECTION_OUT, type_t, frame->BodySize());
+	EnterQueue(std::move(frame));
 }
 
 bool GmtSession::StartSend()
@@ -381,25 +401,23 @@ void GmtSession::OnReadSome(const boost::system::error_code& error, std::size_t
 		return;
 	}
 	
-	Asset::InnerMeta meta;
-	auto result = meta.ParseFromArray(_buffer.data(), bytes_transferred);
-	if (!result)
-	{
-		LOG(ERROR, "Receive message error from server:{} cannot parse from data.", _ip_address);
-		return;
-	}
+	_codec.Commit(bytes_transferred);
 
-	_receive_list.push_back(meta);
+	auto handler = [this](const Asset::InnerMeta& meta) {
+		OnInnerProcess(meta);
+		return !IsClosed(); //处理过程中可能关闭连接
+	};
 
-	std::deque<Asset::InnerMeta> received_messages;
-	received_messages.swap(_receive_list);
+	//GMT服务器收到握手后才发送带包头的数据，未握手时按原有格式(每次接收整体解析)
+	auto result = IsHandshakeEnabled() ? _codec.Decode<Asset::InnerMeta>(handler) : _codec.DecodeUnframed<Asset::InnerMeta>(handler);
 
-	//数据处理
-	while (!IsClosed() && !received_messages.empty())
+	if (FRAME_DECODE_PARSE_ERROR == result)
 	{
-		const auto& message = received_messages.front();
-		OnInnerProcess(message);
-		received_messages.pop_front();
+		LOG(ERROR, "Receive message error from server:{} cannot parse from data.", _ip_address);
+	}
+	else if (FRAME_DECODE_STOPPED == result)
+	{
+		return;
 	}
 	
 	AsynyReadSome(); //继续下一次数据接收
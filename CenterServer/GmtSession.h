@@ -10,6 +10,7 @@
 #include <boost/asio.hpp>
 
 #include "ClientSocket.h"
+#include "TrafficStats.h"
 #include "P_Header.h"
 
 namespace Adoter
@@ -30,6 +31,7 @@ public:
 
 	Asset::COMMAND_ERROR_CODE OnCommandProcess(const Asset::Command& command);
 	Asset::COMMAND_ERROR_CODE OnSendMail(const Asset::SendMail& command);
+	Asset::COMMAND_ERROR_CODE OnQueryTraffic(Asset::QueryTraffic& command); //服务器流量统计
 	Asset::COMMAND_ERROR_CODE OnSystemBroadcast(const Asset::SystemBroadcast& command);
 	Asset::COMMAND_ERROR_CODE OnActivityControl(const Asset::ActivityControl& command);
     
@@ -52,7 +54,6 @@ public:
 	virtual bool Update() override;
 private:
 	std::deque<std::string> _send_list;
-	std::deque<Asset::InnerMeta> _receive_list;
 	boost::asio::ip::tcp::endpoint _remote_endpoint;
 	std::string _ip_address;
 	std::mutex _gmt_lock; 
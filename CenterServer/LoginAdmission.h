@@ -0,0 +1,262 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+
+#include "RateLimiter.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 登录排队(服务器重启后大量玩家同时重连)
+ *
+ * 1.登录需要同步访问数据库，同时处理的登录数量(LoginConcurrency)和每秒登录数量(LoginAdmissionRate)均有上限;
+ *
+ * 2.超出上限的连接按顺序排队，暂停接收该连接的数据，轮到时在连接所在线程继续处理登录;
+ *
+ * 3.排队的连接定期收到当前位置和预计等待时长，排队人数超过LoginQueueMax时拒绝登录;
+ *
+ * 4.已经登录的连接不受影响.
+ *
+ * */
+
+//
+//排队的连接
+//
+class LoginWaiter
+{
+public:
+	virtual ~LoginWaiter() { }
+
+	virtual bool IsWaiting() const = 0; //连接关闭后不再等待
+
+	virtual void OnLoginAdmitted() = 0; //轮到登录，可能在任意线程调用
+
+	virtual void OnLoginQueue(std::size_t position, int64_t wait_seconds) = 0; //当前位置(从1开始)
+};
+
+enum LOGIN_ADMISSION_RESULT
+{
+	LOGIN_ADMISSION_RESULT_ADMITTED = 0, //直接登录
+	LOGIN_ADMISSION_RESULT_QUEUED = 1, //排队
+	LOGIN_ADMISSION_RESULT_REJECTED = 2, //排队人数已满
+};
+
+class LoginAdmission
+{
+public:
+	static const int32_t MAX_TYPE_COUNT = 2048; //协议类型上限
+
+	static LoginAdmission& Instance()
+	{
+		static LoginAdmission _instance;
+		return _instance;
+	}
+
+	//default_concurrency：同时处理的登录数量；default_types：未配置LoginAdmissionTypes时排队的协议类型
+	void Load(int32_t default_concurrency, const std::vector<int32_t>& default_types)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_enabled = ConfigInstance.GetBool("LoginAdmission", true);
+		_concurrency = std::max(1, ConfigInstance.GetInt("LoginConcurrency", default_concurrency));
+		_queue_max = ConfigInstance.GetInt("LoginQueueMax", 20000);
+		_notify_interval = std::max(1, ConfigInstance.GetInt("LoginQueueNotifyInterval", 3)); //秒
+
+		double rate = ConfigInstance.GetInt("LoginAdmissionRate", 200); //小于等于0不限制
+		_rule.rate = rate;
+		_rule.burst = std::max(1.0, rate / 4);
+
+		std::vector<int32_t> types;
+
+		std::stringstream stream(ConfigInstance.GetString("LoginAdmissionTypes", ""));
+		for (std::string type; std::getline(stream, type, ','); )
+		{
+			if (!type.empty()) types.push_back(std::atoi(type.c_str()));
+		}
+
+		for (auto& login : _types) login = false;
+
+		for (auto type_t : types.empty() ? default_types : types)
+		{
+			if (type_t > 0 && type_t < MAX_TYPE_COUNT) _types[type_t] = true;
+		}
+	}
+
+	bool IsLogin(int32_t type_t) const { return _enabled && type_t > 0 && type_t < MAX_TYPE_COUNT && _types[type_t]; }
+
+	//
+	//申请登录名额，排队时由OnLoginAdmitted通知
+	//
+	LOGIN_ADMISSION_RESULT Acquire(std::shared_ptr<LoginWaiter> waiter)
+	{
+		std::size_t position = 0;
+		int64_t wait_seconds = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if (_waiters.empty() && _in_flight < _concurrency && TakeToken())
+			{
+				++_in_flight;
+				++_admitted_count;
+				return LOGIN_ADMISSION_RESULT_ADMITTED;
+			}
+
+			if (_queue_max > 0 && int32_t(_waiters.size()) >= _queue_max)
+			{
+				++_rejected_count;
+				return LOGIN_ADMISSION_RESULT_REJECTED;
+			}
+
+			_waiters.push_back(waiter);
+			++_queued_count;
+
+			position = _waiters.size();
+			wait_seconds = GetWaitSeconds(position);
+		}
+
+		waiter->OnLoginQueue(position, wait_seconds);
+		return LOGIN_ADMISSION_RESULT_QUEUED;
+	}
+
+	//
+	//登录处理结束(包括排队轮到后连接已经关闭)，名额交给下一个排队的连接
+	//
+	void Release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_in_flight > 0) --_in_flight;
+		}
+
+		Admit();
+	}
+
+	//
+	//世界线程定期调用：令牌恢复后继续放行，定期通知排队位置
+	//
+	void Update()
+	{
+		Admit();
+
+		auto now = std::chrono::steady_clock::now();
+		if (now < _notify_time) return;
+
+		_notify_time = now + std::chrono::seconds(_notify_interval);
+
+		std::vector<std::shared_ptr<LoginWaiter>> waiters;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			std::deque<std::weak_ptr<LoginWaiter>> remain;
+
+			for (auto& weak : _waiters)
+			{
+				auto waiter = weak.lock();
+				if (!waiter || !waiter->IsWaiting()) continue; //连接已经关闭
+
+				remain.push_back(weak);
+				waiters.push_back(waiter);
+			}
+
+			_waiters.swap(remain);
+		}
+
+		for (std::size_t i = 0; i < waiters.size(); ++i)
+		{
+			waiters[i]->OnLoginQueue(i + 1, GetWaitSeconds(i + 1)); //通知期间新加入的排在后面，位置不受影响
+		}
+	}
+
+	std::size_t GetQueueSize()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _waiters.size();
+	}
+
+	void Report()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_admitted_count + _queued_count + _rejected_count == 0) return;
+
+		LOG(INFO, "登录排队统计，登录数量:{} 排队数量:{} 拒绝数量:{} 当前排队:{} 正在登录:{}",
+				_admitted_count, _queued_count, _rejected_count, _waiters.size(), _in_flight);
+
+		_admitted_count = _queued_count = _rejected_count = 0;
+	}
+
+private:
+	//按顺序放行排队的连接，直到名额或者令牌用完
+	void Admit()
+	{
+		std::vector<std::shared_ptr<LoginWaiter>> admitted;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			while (!_waiters.empty() && _in_flight < _concurrency)
+			{
+				auto waiter = _waiters.front().lock();
+				if (!waiter || !waiter->IsWaiting())
+				{
+					_waiters.pop_front(); //连接已经关闭
+					continue;
+				}
+
+				if (!TakeToken()) break;
+
+				_waiters.pop_front();
+
+				++_in_flight;
+				++_admitted_count;
+
+				admitted.push_back(waiter);
+			}
+		}
+
+		for (auto& waiter : admitted) waiter->OnLoginAdmitted(); //不持有锁回调
+	}
+
+	bool TakeToken()
+	{
+		int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		return _bucket.Consume(_rule, now) == 0;
+	}
+
+	int64_t GetWaitSeconds(std::size_t position) const
+	{
+		if (_rule.rate <= 0) return 0;
+		return int64_t(position / _rule.rate) + 1;
+	}
+
+private:
+	std::mutex _mutex;
+	bool _enabled = true;
+	int32_t _concurrency = 1; //同时处理的登录数量
+	int32_t _in_flight = 0; //正在处理的登录数量
+	int32_t _queue_max = 20000;
+	int32_t _notify_interval = 3;
+	RateLimitRule _rule;
+	TokenBucket _bucket;
+	std::deque<std::weak_ptr<LoginWaiter>> _waiters;
+	std::chrono::steady_clock::time_point _notify_time;
+	bool _types[MAX_TYPE_COUNT] = {};
+	int64_t _admitted_count = 0;
+	int64_t _queued_count = 0;
+	int64_t _rejected_count = 0;
+};
+
+#define LoginAdmissionInstance LoginAdmission::Instance()
+
+}
@@ -14,6 +14,7 @@
 #include "WorldSession.h"
 #include "GmtSession.h"
 #include "RedisManager.h"
+#include "IoServicePool.h"
 
 const int const_world_sleep = 50;
 
@@ -24,8 +25,7 @@ const int const_world_sleep = 50;
 
 using namespace Adoter;
 
-boost::asio::io_service _io_service;
-std::shared_ptr<boost::asio::io_service::work> _io_service_work;
+IoServicePool _io_pool; //主线程池：监听、服务器之间的连接
 
 void SignalHandler(const boost::system::error_code& error, int)
 {    
@@ -60,11 +60,9 @@ void WorldUpdateLoop()
 	}
 }
 
-void ShutdownThreadPool(std::vector<std::shared_ptr<std::thread>>& threads)
+void ShutdownThreadPool()
 {
-	_io_service.stop();
-
-	for (auto& thread : threads) thread->join();
+	_io_pool.Stop();
 }
 
 /*
@@ -100,18 +98,11 @@ int main(int argc, const char* argv[])
 		if (!WorldInstance.Load()) return 1;
 	
 		//网络初始化
-		_io_service_work = std::make_shared<boost::asio::io_service::work>(_io_service);
-
-		int _thread_nums = 5;
-		std::vector<std::shared_ptr<std::thread>> _threads;	
-		for (int i = 0; i < _thread_nums; ++i)
-		{
-			std::shared_ptr<std::thread> pthread(new std::thread(boost::bind(&boost::asio::io_service::run, &_io_service)));	//IO <-> Multi Threads
-			_threads.push_back(pthread);
-		}
+		_io_pool.Load(5); //IoServiceMode：shared为多线程共用一个io_service，per_thread为每个线程一个
+		_io_pool.Start();
 
 		/*
-		boost::asio::signal_set signals(_io_service, SIGINT, SIGTERM);
+		boost::asio::signal_set signals(_io_pool.GetIoService(0), SIGINT, SIGTERM);
 		signals.async_wait(SignalHandler);
 		*/
 
@@ -127,7 +118,7 @@ int main(int argc, const char* argv[])
 		int32_t redis_work_count = ConfigInstance.GetInt("Redis_WorkCount", 5);
 		tacopie::get_default_io_service()->set_nb_workers(redis_work_count);
 
-		WorldSessionInstance.StartNetwork(_io_service, server_ip, server_port, thread_count);
+		WorldSessionInstance.StartNetwork(_io_pool.GetIoService(), server_ip, server_port, thread_count);
 
 		//
 		//连接GMT服务器
@@ -135,13 +126,13 @@ int main(int argc, const char* argv[])
 		std::string gmt_server_address = ConfigInstance.GetString("GMT_ServerIP", "0.0.0.0");
 		int32_t gmt_server_port = ConfigInstance.GetInt("GMT_ServerPort", 50003); 
 		boost::asio::ip::tcp::endpoint gmt_endpoint(boost::asio::ip::address::from_string(gmt_server_address), gmt_server_port);
-		g_gmt_client = std::make_shared<GmtSession>(_io_service, gmt_endpoint);
+		g_gmt_client = std::make_shared<GmtSession>(_io_pool.GetIoService(), gmt_endpoint);
 		g_gmt_client->AsyncConnect();
 
 		//世界循环
 		WorldUpdateLoop();
 
-		ShutdownThreadPool(_threads);
+		ShutdownThreadPool();
 	}
 	catch (std::exception& e)
 	{
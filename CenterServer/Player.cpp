@@ -429,19 +429,14 @@ void Player::SyncCommonProperty(Asset::SyncCommonProperty_SYNC_REASON_TYPE reaso
 	SendProtocol(common_prop);
 }
 
-void Player::SendProtocol(const pb::Message* message)
-{
-	SendProtocol(*message);
-}
-
-void Player::SendProtocol(const pb::Message& message)
+void Player::SendProtocol(const pb::Message& message, int32_t type_t)
 {
 	//if (!Connected()) return;
 
 	auto session = WorldSessionInstance.GetPlayerSession(_player_id);
-	if (!session || !session->IsConnect()) return;
+	if (!session || !session->IsConnectOrResumable()) return;
 
-	session->SendProtocol(message);
+	session->SendProtocol(message, type_t, 0, false);
 
 	//调试
 	//const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
@@ -454,6 +449,14 @@ void Player::SendProtocol(const pb::Message& message)
 	//DEBUG("send protocol to player_id:{} protocol_name:{} content:{}", _player_id, enum_value->name().c_str(), debug_string);
 }
 	
+void Player::SendBroadcast(BroadcastFrame& broadcast)
+{
+	auto session = WorldSessionInstance.GetPlayerSession(_player_id);
+	if (!session || !session->IsConnectOrResumable()) return;
+
+	session->SendBroadcast(broadcast, false);
+}
+	
 void Player::SendMeta(const Asset::Meta& meta)
 {
 	/*
@@ -465,14 +468,14 @@ void Player::SendMeta(const Asset::Meta& meta)
 	*/
 	
 	auto session = WorldSessionInstance.GetPlayerSession(_player_id);
-	if (!session || !session->IsConnect()) return;
+	if (!session || !session->IsConnectOrResumable()) return;
 	
 	//DEBUG("玩家:{}发送协议:{}到游戏逻辑服务器", _player_id, meta.ShortDebugString());
 
 	session->SendMeta(meta);
 }
 	
-bool Player::SendProtocol2GameServer(const pb::Message& message)
+bool Player::SendProtocol2GameServer(const pb::Message& message, int32_t type_t)
 {
 	auto _gs_session = WorldSessionInstance.GetServerSession(GetLocalServer());
 	if (!_gs_session) 
@@ -492,47 +495,13 @@ bool Player::SendProtocol2GameServer(const pb::Message& message)
 		return false;
 	}
 
-	const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
-	if (!field) return false;
-	
-	int type_t = field->default_value_enum()->number();
-	if (!Asset::META_TYPE_IsValid(type_t)) return false;	//如果不合法，不检查会宕线
-
-	Asset::Meta meta;
-	meta.set_type_t((Asset::META_TYPE)type_t);
-	meta.set_stuff(message.SerializeAsString());
-	meta.set_player_id(_player_id); 
-
 	DEBUG("玩家:{}发送到游戏逻辑服务器:{}，内容:{}", _player_id, _stuff.server_id(), debug_string);
 
-	_gs_session->SendMeta(meta); 
-
-	return true;
+	return _gs_session->SendProtocol(message, type_t, _player_id, false); //直接序列化，不再生成中间Meta
 }
 
-bool Player::SendProtocol2GameServer(const pb::Message* message)
+void Player::SendGmtProtocol(const pb::Message& message, int32_t type_t, int64_t session_id)
 {
-	if (!message) return false;
-
-	//auto _gs_session = WorldSessionInstance.GetServerSession(GetLocalServer());
-	//if (!_gs_session || !message) return false;
-
-	SendProtocol2GameServer(*message); 
-	
-	return true;
-}
-
-void Player::SendGmtProtocol(const pb::Message* message, int64_t session_id)
-{
-	SendGmtProtocol(*message, session_id);
-}
-
-void Player::SendGmtProtocol(const pb::Message& message, int64_t session_id)
-{
-	const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
-	if (!field) return;
-	
-	int type_t = field->default_value_enum()->number();
 	if (!Asset::INNER_TYPE_IsValid(type_t)) return;	//如果不合法，不检查会宕线
 	
 	auto stuff = message.SerializeAsString(); //复制，防止析构
@@ -1231,14 +1200,19 @@ void PlayerManager::Remove(std::shared_ptr<Player> player)
 	Remove(player->GetID());
 }
 	
-void PlayerManager::BroadCast(const pb::Message& message)
+void PlayerManager::BroadCast(const pb::Message& message, int64_t except_player_id)
 {
+	auto type_t = ProtocolType(message);
+	if (!Asset::META_TYPE_IsValid(type_t)) return;
+
+	BroadcastFrame broadcast(message, type_t); //所有玩家共用同一个数据包
+
 	for (auto it = _players.begin(); it != _players.end(); ++it)
 	{
-		auto player = it->second;
-		if (!player) continue;
+		const auto& player = it->second;
+		if (!player || it->first == except_player_id) continue;
 
-		player->SendProtocol(message); //发送给Client
+		player->SendBroadcast(broadcast); //发送给Client
 	}
 }
 	
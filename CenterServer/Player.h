@@ -8,6 +8,7 @@
 #include <functional>
 
 #include "P_Header.h"
+#include "ProtocolTraits.h"
 #include "Asset.h"
 #include "WorldSession.h"
 
@@ -97,15 +98,23 @@ public:
 	virtual int32_t GetGender() { return _stuff.common_prop().gender(); }
 	//协议处理(Protocol Buffer)
 	virtual bool HandleProtocol(int32_t type_t, pb::Message* message);
-	virtual void SendProtocol(const pb::Message& message);
-	virtual void SendProtocol(const pb::Message* message);
+	virtual void SendProtocol(const pb::Message& message, int32_t type_t); //协议类型已知
+	virtual void SendBroadcast(BroadcastFrame& broadcast); //广播，见BroadcastFrame
 	virtual void SendMeta(const Asset::Meta& meta);
 	
-	virtual bool SendProtocol2GameServer(const pb::Message& message);
-	virtual bool SendProtocol2GameServer(const pb::Message* message);
+	virtual bool SendProtocol2GameServer(const pb::Message& message, int32_t type_t);
 
-	virtual void SendGmtProtocol(const pb::Message* message, int64_t session_id);
-	virtual void SendGmtProtocol(const pb::Message& message, int64_t session_id);
+	virtual void SendGmtProtocol(const pb::Message& message, int32_t type_t, int64_t session_id);
+
+	//具体协议在编译期确定协议类型，见ProtocolTraits
+	template <typename T> EnableIfProtocol<T> SendProtocol(const T& message) { SendProtocol(message, ProtocolType(message)); }
+	template <typename T> EnableIfProtocol<T> SendProtocol(const T* message) { if (message) SendProtocol(*message); }
+
+	template <typename T> EnableIfProtocol<T, bool> SendProtocol2GameServer(const T& message) { return SendProtocol2GameServer(message, ProtocolType(message)); }
+	template <typename T> EnableIfProtocol<T, bool> SendProtocol2GameServer(const T* message) { return message && SendProtocol2GameServer(*message); }
+
+	template <typename T> EnableIfProtocol<T> SendGmtProtocol(const T& message, int64_t session_id) { SendGmtProtocol(message, ProtocolType(message), session_id); }
+	template <typename T> EnableIfProtocol<T> SendGmtProtocol(const T* message, int64_t session_id) { if (message) SendGmtProtocol(*message, session_id); }
 
 	Asset::ERROR_CODE CommonCheck(int32_t type_t);
 	//玩家登出
@@ -243,7 +252,7 @@ public:
 	std::shared_ptr<Player> Get(int64_t player_id);
 	int32_t GetOnlinePlayerCount(); //获取在线玩家数量//带缓存
 	
-	virtual void BroadCast(const pb::Message& message);
+	virtual void BroadCast(const pb::Message& message, int64_t except_player_id = 0); //except_player_id不发送
 };
 
 #define PlayerInstance PlayerManager::Instance()
@@ -4,6 +4,7 @@
 #include "MXLog.h"
 #include "Activity.h"
 #include "WhiteBlackManager.h"
+#include "WorldSession.h"
 
 namespace Adoter
 {
@@ -68,6 +69,8 @@ bool World::Load()
 //
 void World::Update(int32_t diff)
 {
+	OutboxScope outbox; //本次刷新期间发给玩家的数据包在刷新结束后一起发送
+
 	++_heart_count;
 
 	if (_heart_count % 60 == 0) ActivityInstance.Update(diff);
@@ -75,6 +78,20 @@ void World::Update(int32_t diff)
 	PlayerInstance.Update(diff);
 
 	g_gmt_client->Update();
+
+	if (_heart_count % 1200 == 0) CompressPolicyInstance.Report(); //每分钟输出压缩统计
+
+	if (_heart_count % 1200 == 0) WorldSessionInstance.DumpTraffic(); //每分钟输出流量统计
+
+	if (_heart_count % 1200 == 0) OutboxPolicyInstance.Report(); //每分钟输出发件箱合并统计
+
+	if (_heart_count % 1200 == 0) RateLimitPolicyInstance.Report(); //每分钟输出客户端限流统计
+
+	LoginAdmissionInstance.Update(); //登录排队放行及位置通知
+	if (_heart_count % 1200 == 0) LoginAdmissionInstance.Report();
+
+	SessionResumeRegistryInstance.Update(); //断开超时未续传的玩家踢下线
+	if (_heart_count % 1200 == 0) SessionResumeRegistryInstance.Report();
 }
 	
 }
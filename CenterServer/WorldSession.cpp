@@ -24,12 +24,22 @@ WorldSession::~WorldSession()
 	Close(); //关闭网络
 }
 
-WorldSession::WorldSession(boost::asio::ip::tcp::socket&& socket) : Socket(std::move(socket))
+WorldSession::WorldSession(boost::asio::ip::tcp::socket&& socket) : Socket(std::move(socket)), _rate_timer(_socket.get_executor()), _heart_timer(_socket.get_executor())
 {
 	_remote_endpoint = _socket.remote_endpoint();
 	_ip_address = _remote_endpoint.address().to_string();
 			
 	_hi_time = CommonTimerInstance.GetTime(); 
+	SetQueueLimits("WorldSession"); //发送队列水位
+	EnableOutbox(ConfigInstance.GetBool("PlayerOutbox", true)); //同一次处理中发给玩家的数据包一起发送
+	EnableSendLanes(SendPriorityPolicyInstance.IsEnabled()); //对局数据包优先于战绩、回放、广播发送
+
+	if (SessionResumeRegistryInstance.IsEnabled()) //断线续传
+	{
+		_codec.SetLocalCapabilities(_codec.GetLocalCapabilities() | FRAME_CAPABILITY_RESUME);
+		_codec.SetResumeHandler(std::bind(&WorldSession::OnSessionResume, this, std::placeholders::_1, std::placeholders::_2));
+	}
+
 	DEBUG("地址:{} 端口:{} 连接成功", _ip_address, _remote_endpoint.port());
 }
 
@@ -44,37 +54,172 @@ void WorldSession::InitializeHandler(const boost::system::error_code error, cons
 			Close();
 			return;
 		}
-		else
+
+		_codec.Commit(bytes_transferred);
+		_receive_time = GetMicroseconds(); //同一次接收的数据包按同一时间限流
+
+		if (!DecodeMessages()) return; //连接关闭或者限流延迟，暂停接收
+	}
+	catch (std::exception& e)
+	{
+		ERROR("地址:{} 端口:{} 玩家:{}断开连接，错误码:{}", _ip_address, _remote_endpoint.port(), _player ? _player->GetID() : 0, e.what());
+		Close();
+
+		KickOutPlayer(Asset::KICK_OUT_REASON_DISCONNECT);
+		return;
+	}
+
+	AsyncReceiveWithCallback(&WorldSession::InitializeHandler); //递归持续接收	
+}
+			
+//
+//解析已经接收的数据包，返回false表示停止接收
+//
+bool WorldSession::DecodeMessages()
+{
+	OutboxScope outbox; //本次接收处理期间发给玩家的数据包在处理结束后一起发送
+
+	auto result = _codec.Decode<Asset::Meta>([this](const Asset::Meta& meta) {
+		return OnReceiveMessage(meta);
+	});
+
+	if (FRAME_DECODE_PARSE_ERROR == result)
+	{
+		LOG(ERROR, "会话类型:{} 会话全局ID:{} 来自地址:{} 端口:{} 玩家:{} 转换Protobuff数据失败.", _role_type, _global_id, _ip_address, _remote_endpoint.port(), _player ? _player->GetID() : 0);
+	}
+
+	return FRAME_DECODE_STOPPED != result;
+}
+
+//
+//限流检查(解析协议内容之前)，返回是否继续解析
+//
+bool WorldSession::OnReceiveMessage(const Asset::Meta& meta)
+{
+	if (_role_type != Asset::ROLE_TYPE_GAME_SERVER) //服务器之间不限流
+	{
+		int64_t wait = 0;
+		auto action = _rate_limiter.Check(meta.type_t(), _receive_time, wait);
+
+		if (RATE_LIMIT_ACTION_DROP == action)
 		{
-			for (size_t index = 0; index < bytes_transferred;)
-			{
-				unsigned short body_size = _buffer[index] * 256 + _buffer[1 + index];
-					
-				if (body_size > MAX_DATA_SIZE)
-				{
-					LOG(ERROR, "接收来自地址:{} 端口:{} 玩家:{} 太大的包长:{} 丢弃.", _ip_address, _remote_endpoint.port(), _player ? _player->GetID() : 0, body_size)
-					AsyncReceiveWithCallback(&WorldSession::InitializeHandler); //递归持续接收	
-					return;
-				}
+			DEBUG("地址:{} 玩家:{} 协议类型:{} 超出限制，丢弃", _ip_address, _global_id, meta.type_t());
+			return true;
+		}
+		else if (RATE_LIMIT_ACTION_DELAY == action)
+		{
+			_delayed_meta.CopyFrom(meta); //令牌恢复后处理，期间不再接收
+
+			_rate_timer.expires_from_now(boost::posix_time::microseconds(wait));
+			_rate_timer.async_wait(std::bind(&WorldSession::OnRateLimitTimer, shared_from_this(), std::placeholders::_1));
+			return false;
+		}
+		else if (RATE_LIMIT_ACTION_DISCONNECT == action)
+		{
+			LOG(ERROR, "地址:{} 玩家:{} 协议类型:{} 超出限制，断开连接", _ip_address, _global_id, meta.type_t());
+			Close();
+			return false;
+		}
+	}
+
+	return OnAdmitMessage(meta);
+}
 
-				char buffer[MAX_DATA_SIZE] = {0}; //数据缓存  
-				for (size_t i = 0; i < body_size; ++i) buffer[i] = _buffer[i + index + 2];  
+//
+//登录排队检查，返回是否继续解析
+//
+bool WorldSession::OnAdmitMessage(const Asset::Meta& meta)
+{
+	bool login = _login_admitted || (_role_type != Asset::ROLE_TYPE_GAME_SERVER && LoginAdmissionInstance.IsLogin(meta.type_t()));
 
-				Asset::Meta meta;
-				bool result = meta.ParseFromArray(buffer, body_size);
+	if (login && !_login_admitted)
+	{
+		_delayed_meta.CopyFrom(meta); //排队时轮到后处理，期间不再接收
+		_login_waiting = true;
 
-				if (!result) 
-				{
-					LOG(ERROR, "会话类型:{} 会话全局ID:{} 来自地址:{} 端口:{} 玩家:{} 转换Protobuff数据失败.", _role_type, _global_id, _ip_address, _remote_endpoint.port(), _player ? _player->GetID() : 0);
-					AsyncReceiveWithCallback(&WorldSession::InitializeHandler); //递归持续接收	
-					return; //非法协议
-				}
+		auto result = LoginAdmissionInstance.Acquire(shared_from_this());
+		if (LOGIN_ADMISSION_RESULT_QUEUED == result) return false;
 
-				OnProcessMessage(meta);
+		_login_waiting = false;
+		_delayed_meta.Clear();
 
-				index += (body_size + 2); //下个包的起始位置
-			}
+		if (LOGIN_ADMISSION_RESULT_REJECTED == result)
+		{
+			AlertMessage(Asset::ERROR_ONLINE_PLAYERS_LIMIT, Asset::ERROR_TYPE_NORMAL, Asset::ERROR_SHOW_TYPE_MESSAGE_BOX); 
+			LOG(ERROR, "登录排队人数已满，地址:{} 不能继续登陆", _ip_address);
+
+			Close(); //关闭网络
+			return false;
+		}
+	}
+
+	_login_admitted = false;
+
+	defer {
+		if (login) LoginAdmissionInstance.Release(); //登录名额交给下一个排队的连接
+	};
+
+	OnProcessMessage(meta);
+	return !_closed; //处理过程中可能关闭连接
+}
+
+//
+//轮到登录，在连接所在线程继续处理
+//
+void WorldSession::OnLoginAdmitted()
+{
+	auto self = shared_from_this();
+
+	boost::asio::post(_socket.get_executor(), [self]() {
+		self->_login_waiting = false;
+
+		if (self->_closed) 
+		{
+			LoginAdmissionInstance.Release(); //排队期间连接已经关闭
+			return;
+		}
+
+		self->_login_admitted = true;
+		self->ResumeReceive(&WorldSession::OnAdmitMessage);
+	});
+}
+
+void WorldSession::OnLoginQueue(std::size_t position, int64_t wait_seconds)
+{
+	Touch(); //排队期间不接收数据，防止空闲断开
+
+	Asset::SystemBroadcasting message;
+	message.set_broad_cast_type(Asset::SYSTEM_BROADCAST_TYPE_SCROLL);
+	message.set_content(fmt::format(ConfigInstance.GetString("LoginQueueNotice", "服务器登录排队中，当前第{}位，预计等待{}秒"), position, wait_seconds));
+
+	SendProtocol(message);
+}
+
+void WorldSession::OnRateLimitTimer(const boost::system::error_code& error)
+{
+	if (error || _closed) return;
+
+	ResumeReceive(&WorldSession::OnReceiveMessage);
+}
+
+//
+//处理暂停接收时保存的数据包，然后继续处理已经接收的数据并恢复接收
+//
+void WorldSession::ResumeReceive(bool (WorldSession::*handler)(const Asset::Meta&))
+{
+	try
+	{
+		Asset::Meta meta;
+		meta.Swap(&_delayed_meta);
+
+		_receive_time = GetMicroseconds();
+
+		{
+			OutboxScope outbox;
+			if (!(this->*handler)(meta)) return; //再次延迟、排队或者连接关闭
 		}
+
+		if (!DecodeMessages()) return; //继续处理已经接收的数据
 	}
 	catch (std::exception& e)
 	{
@@ -85,11 +230,14 @@ void WorldSession::InitializeHandler(const boost::system::error_code error, cons
 		return;
 	}
 
-	AsyncReceiveWithCallback(&WorldSession::InitializeHandler); //递归持续接收	
+	AsyncReceiveWithCallback(&WorldSession::InitializeHandler); //恢复接收
 }
-			
+
 void WorldSession::OnProcessMessage(const Asset::Meta& meta)
 {
+	TrafficScope traffic(GetTrafficClass(), meta.type_t(), meta.stuff().size()); //流量统计，处理结束时记录
+	_traffic.Add(TRAFFIC_DIRECTION_IN, meta.stuff().size());
+
 	if (meta.type_t() == Asset::META_TYPE_SHARE_BEGIN) return;
 
 	pb::Message* msg = ProtocolInstance.GetMessage(meta.type_t());	
@@ -570,6 +718,7 @@ void WorldSession::OnProcessMessage(const Asset::Meta& meta)
 		else if (Asset::META_TYPE_SHARE_SAY_HI == meta.type_t() && _role_type == Asset::ROLE_TYPE_GAME_SERVER) //心跳
 		{
 			SendProtocol(message);
+			ReportBatchStatistics("逻辑服务器:" + std::to_string(_global_id));
 		}
 		else
 		{
@@ -606,6 +755,7 @@ void WorldSession::KickOutPlayer(Asset::KICK_OUT_REASON reason)
 			return;
 		}
 
+		StopSessionResume(); //已经下线，不再续传
 		_player->OnKickOut(reason); //玩家退出登陆
 	}
 }
@@ -614,6 +764,7 @@ void WorldSession::OnLogout()
 {
 	if (!_player) return;
 	
+	StopSessionResume();
 	_player->Logout(nullptr);
 	//_online = false;
 }
@@ -642,21 +793,40 @@ int32_t WorldSession::OnWechatLogin(const pb::Message* message)
 void WorldSession::Start()
 {
 	AsyncReceiveWithCallback(&WorldSession::InitializeHandler);
+
+	_heart_timer.expires_from_now(boost::posix_time::seconds(1));
+	_heart_timer.async_wait(std::bind(&WorldSession::OnHeartBeatTimer, shared_from_this(), std::placeholders::_1));
 }
-	
+
 //
-//周期10MS
+//心跳定时器：每秒由网络线程调用，和空闲检查无关，连接一直有收发时也定期执行
 //
-bool WorldSession::Update() 
-{ 
+void WorldSession::OnHeartBeatTimer(const boost::system::error_code& error)
+{
+	if (error || _closed) return;
+
 	++_heart_count;
 
-	if (!Socket::Update()) return false;
+	OnHeartBeat1s();
+	if (_heart_count % 60 == 0) OnHeartBeat1m();
 
-	if (_heart_count % 60 == 0) OnHeartBeat1s();
-	if (_heart_count % 3600 == 0) OnHeartBeat1m();
+	if (_closed) return;
 
-	return true;
+	_heart_timer.expires_from_now(boost::posix_time::seconds(1));
+	_heart_timer.async_wait(std::bind(&WorldSession::OnHeartBeatTimer, shared_from_this(), std::placeholders::_1));
+}
+	
+//
+//连接空闲时由网络线程调用(时间轮到期)：最近一次收到数据后IdleTimeout(默认30秒)首次调用，之后每IdleTimeout调用一次
+//
+//只处理空闲过期，过期时间由心跳设置；比每分钟的心跳检查更早关闭过期的连接
+//
+void WorldSession::OnIdle() 
+{ 
+	if (!IsExpire()) return;
+
+	WARN("角色类型:{} 全局ID:{} 地址:{} 空闲过期关闭网络连接", _role_type, _global_id, _ip_address);
+	Close(); //关闭网络连接
 }
 
 void WorldSession::OnHeartBeat1s()
@@ -665,7 +835,7 @@ void WorldSession::OnHeartBeat1s()
 
 	if (duration_pass > 30 && _expire_time == 0) 
 	{
-		_expire_time = TimerInstance.GetTime() + 60 * 3; //3mins之内没有上线(进行网络收发)，则删除
+		_expire_time = _hi_time + 30 + 60 * 3; //空闲30秒后3mins之内没有上线(进行网络收发)，则删除；按最近收发时间计算，不受检查周期影响
 	}
 }
 
@@ -690,6 +860,12 @@ bool WorldSession::IsExpire()
 void WorldSession::OnClose()
 {
 	Socket::OnClose();
+
+	if (_role_type == Asset::ROLE_TYPE_PLAYER && ParkSessionResume()) //等待客户端续传，超时未续传时踢下线
+	{
+		DEBUG("玩家:{} 地址:{} 断开连接，等待续传", _global_id, _ip_address);
+		return;
+	}
 				
 	KickOutPlayer(Asset::KICK_OUT_REASON_DISCONNECT);
 	
@@ -700,35 +876,143 @@ void WorldSession::OnClose()
 	DEBUG("角色类型:{} 全局ID:{} 关闭网络连接", _role_type, _global_id);
 }
 
-void WorldSession::SendProtocol(const pb::Message* message)
+//
+//断开后超时未续传，在世界线程调用
+//
+void WorldSession::OnResumeExpired()
 {
-	SendProtocol(*message);
+	DEBUG("玩家:{} 地址:{} 超时未续传", _global_id, _ip_address);
+
+	KickOutPlayer(Asset::KICK_OUT_REASON_DISCONNECT);
 }
 
-void WorldSession::SendProtocol(const pb::Message& message)
+//
+//断线续传时新连接接管的会话数据，在所属连接生成
+//
+struct WorldResumeState : public ResumeState
 {
-	const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
-	if (!field) return;
-	
-	int type_t = field->default_value_enum()->number();
-	if (!Asset::META_TYPE_IsValid(type_t)) return;	//如果不合法，不检查会宕线
+	std::weak_ptr<Player> player;
+	Asset::Account account;
+	Asset::User user;
+	std::unordered_set<int64_t> player_list;
+};
 
-	Asset::Meta meta;
-	meta.set_type_t((Asset::META_TYPE)type_t);
-	meta.set_stuff(message.SerializeAsString());
-	
-	std::string content = meta.SerializeAsString();
-	if (content.empty()) return;
+//
+//玩家进入游戏：对端支持时分配续传标识，同一玩家重复进入时保留之前的记录(只更新会话数据)
+//
+void WorldSession::EnableSessionResume()
+{
+	if (!_player || !(_capabilities & FRAME_CAPABILITY_RESUME)) return;
+
+	auto state = std::make_shared<WorldResumeState>();
+	state->player = _player;
+	state->account.CopyFrom(_account);
+	state->user.CopyFrom(_user);
+	state->player_list = _player_list;
+
+	auto resume = GetSessionResume();
+
+	if (resume && resume->GetPlayerID() == _player->GetID()) 
+	{
+		resume->SetState(state);
+		return;
+	}
+
+	if (resume) SessionResumeRegistryInstance.Remove(resume); //切换角色
 
-	EnterQueue(std::move(content));
+	resume = SessionResumeRegistryInstance.Create(_player->GetID(), _account.username(), _capabilities, shared_from_this()); //续传标识只对该账号的该角色有效
+	if (!resume) return;
+
+	resume->SetState(state); //可以被查找到之前已经设置
+	AttachSessionResume(resume);
+}
+
+//
+//客户端重连后续传：玩家仍然在线并且记录中有需要的数据包时，直接接管之前的连接，不再加载数据和全量同步
+//
+//会话数据取自续传记录中的快照，不读取旧连接(可能仍在其他网络线程处理)
+//
+void WorldSession::OnSessionResume(const ResumeToken& token, uint64_t next_sequence)
+{
+	auto resume = _role_type == Asset::ROLE_TYPE_NULL ? SessionResumeRegistryInstance.Find(token) : nullptr; //标识不存在和密钥错误相同处理
+	auto state = resume ? std::dynamic_pointer_cast<const WorldResumeState>(resume->GetState()) : nullptr;
+	auto player = state ? state->player.lock() : nullptr;
+
+	if (!player || player != PlayerInstance.Get(resume->GetPlayerID()) || state->account.username() != resume->GetAccount()) resume = nullptr; //已经下线，或者不属于该账号
+
+	if (!ResumeSession(resume, next_sequence))
+	{
+		SessionResumeRegistryInstance.OnResumed(false);
+
+		LOG(INFO, "地址:{} 续传标识:{} 序号:{} 续传失败，重新登录", _ip_address, token.id, next_sequence);
+		return;
+	}
+
+	SessionResumeRegistryInstance.OnResumed(true);
+
+	_player = player;
+	_account.CopyFrom(state->account);
+	_user.CopyFrom(state->user);
+	_player_list = state->player_list;
+
+	SetRoleType(Asset::ROLE_TYPE_PLAYER, _player->GetID());
+	WorldSessionInstance.AddPlayer(_player->GetID(), shared_from_this()); //之后的数据包直接发往当前连接
+
+	LOG(INFO, "玩家:{} 地址:{} 续传成功，序号:{}", _player->GetID(), _ip_address, next_sequence);
+}
+
+bool WorldSession::SendProtocol(const pb::Message& message, int32_t type_t, int64_t player_id, bool droppable)
+{
+	if (!Asset::META_TYPE_IsValid(type_t)) return false;	//如果不合法，不检查会宕线
+
+	auto frame = FrameBuffer::BuildMeta(message, type_t, player_id); //直接序列化到发送缓存
+	if (!frame) 
+	{
+		ERROR("协议超过最大限制，协议类型:{} 玩家:{}", type_t, player_id);
+		return false;
+	}
+
+	frame = CompressFrame(frame, type_t); //大数据包按协议类型压缩
+
+	TrafficStatsInstance.Record(GetTrafficClass(), TRAFFIC_DIRECTION_OUT, type_t, frame->BodySize());
+	_traffic.Add(TRAFFIC_DIRECTION_OUT, frame->BodySize());
+
+	EnterOutbox(std::move(frame), type_t, droppable ? type_t : 0); //可丢弃的数据包按协议类型合并
+	return true;
+}
+
+bool WorldSession::SendBroadcast(BroadcastFrame& broadcast, bool droppable)
+{
+	auto frame = CompressFrame(broadcast); //所有接收者共用，只序列化、压缩一次
+	if (!frame) return false;
+
+	auto type_t = broadcast.GetType();
+
+	TrafficStatsInstance.Record(GetTrafficClass(), TRAFFIC_DIRECTION_OUT, type_t, frame->BodySize());
+	_traffic.Add(TRAFFIC_DIRECTION_OUT, frame->BodySize());
+
+	EnterOutbox(std::move(frame), type_t, droppable ? type_t : 0);
+	return true;
+}
+
+void WorldSession::OnBackpressure(ENQUEUE_RESULT result)
+{
+	if (ENQUEUE_RESULT_OVERFLOW == result) WARN("角色类型:{} 全局ID:{} 地址:{} 接收过慢，发送队列超过上限", _role_type, _global_id, _ip_address);
+
+	Socket::OnBackpressure(result);
 }
 
 void WorldSession::SendMeta(const Asset::Meta& meta)
 {
-	std::string content = meta.SerializeAsString();
-	if (content.empty()) return;
+	auto frame = FrameBuffer::Build(meta);
+	if (!frame || frame->BodySize() == 0) return;
 
-	EnterQueue(std::move(content));
+	frame = CompressFrame(frame, meta.type_t()); //游戏逻辑服务器转发的结算等数据包在此压缩
+
+	TrafficStatsInstance.Record(GetTrafficClass(), TRAFFIC_DIRECTION_OUT, meta.type_t(), frame->BodySize());
+	_traffic.Add(TRAFFIC_DIRECTION_OUT, frame->BodySize());
+
+	EnterOutbox(std::move(frame), meta.type_t());
 }
 
 void WorldSession::AlertMessage(Asset::ERROR_CODE error_code, Asset::ERROR_TYPE error_type/*= Asset::ERROR_TYPE_NORMAL*/, Asset::ERROR_SHOW_TYPE error_show_type/* = Asset::ERROR_SHOW_TYPE_NORMAL*/)
@@ -749,30 +1033,100 @@ void WorldSessionManager::BroadCast2GameServer(const pb::Message* message)
 
 void WorldSessionManager::BroadCast2GameServer(const pb::Message& message)
 {
+	auto type_t = ProtocolType(message);
+	if (!Asset::META_TYPE_IsValid(type_t)) return;
+
+	BroadcastFrame broadcast(message, type_t); //锁外序列化
+	if (!broadcast.Get())
+	{
+		ERROR("协议超过最大限制，协议类型:{}", type_t);
+		return;
+	}
+
 	std::lock_guard<std::mutex> lock(_server_mutex);
 
-	for (auto session : _server_list)
+	for (const auto& session : _server_list)
 	{
 		if (!session.second) continue;
-		session.second->SendProtocol(message);
+		session.second->SendBroadcast(broadcast, false);
 	}
 }
 	
-void WorldSessionManager::BroadCast(const pb::Message& message)
+void WorldSessionManager::BroadCast(const pb::Message& message, int64_t except_player_id)
 {
+	auto type_t = ProtocolType(message);
+	if (!Asset::META_TYPE_IsValid(type_t)) return;
+
+	BroadcastFrame broadcast(message, type_t); //锁外序列化，所有玩家共用同一个数据包
+	if (!broadcast.Get())
+	{
+		ERROR("协议超过最大限制，协议类型:{}", type_t);
+		return;
+	}
+
 	std::lock_guard<std::mutex> lock(_client_mutex);
 
-	for (auto session : _client_list)
+	for (const auto& session : _client_list)
 	{
-		if (!session.second) continue;
-		session.second->SendProtocol(message);
+		if (!session.second || session.first == except_player_id) continue;
+		session.second->SendBroadcast(broadcast, true); //广播数据，接收过慢的连接可以丢弃
 	}
 }
 
-void WorldSessionManager::BroadCast(const pb::Message* message)
+void WorldSessionManager::BroadCast(const pb::Message* message, int64_t except_player_id)
 {
 	if (!message) return;
-	BroadCast(*message);
+	BroadCast(*message, except_player_id);
+}
+
+std::string WorldSessionManager::TrafficReport(std::size_t top)
+{
+	std::string report = TrafficStatsInstance.Report(top);
+
+	//流量最大的连接：玩家和游戏逻辑服务器
+	auto report_sessions = [&report, top](std::mutex& mutex, const std::unordered_map<int64_t, std::shared_ptr<WorldSession>>& sessions) {
+		std::vector<std::shared_ptr<WorldSession>> session_list;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			for (const auto& session : sessions)
+			{
+				if (session.second) session_list.push_back(session.second);
+			}
+		}
+
+		auto count = top > 0 ? std::min(top, session_list.size()) : session_list.size();
+
+		std::partial_sort(session_list.begin(), session_list.begin() + count, session_list.end(),
+				[](const std::shared_ptr<WorldSession>& left, const std::shared_ptr<WorldSession>& right) {
+			return left->GetTraffic().GetBytes() > right->GetTraffic().GetBytes();
+		});
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const auto& session = session_list[i];
+			const auto& traffic = session->GetTraffic();
+
+			report += fmt::format("连接类型:{} 全局ID:{} 地址:{} 接收数量:{} 接收字节:{} 发送数量:{} 发送字节:{}\n",
+					TrafficStats::GetClassName(session->GetTrafficClass()), session->GetID(), session->GetRemoteAddress(),
+					traffic.messages[TRAFFIC_DIRECTION_IN].load(), traffic.bytes[TRAFFIC_DIRECTION_IN].load(),
+					traffic.messages[TRAFFIC_DIRECTION_OUT].load(), traffic.bytes[TRAFFIC_DIRECTION_OUT].load());
+		}
+	};
+
+	report_sessions(_server_mutex, _server_list);
+	report_sessions(_client_mutex, _client_list);
+
+	return report;
+}
+
+void WorldSessionManager::DumpTraffic()
+{
+	auto file_name = ConfigInstance.GetString("TrafficStatsFile", "");
+	if (file_name.empty()) return;
+
+	TrafficStats::Dump(file_name, TrafficReport(ConfigInstance.GetInt("TrafficReportTop", 20)));
 }
 
 int64_t WorldSessionManager::RandomServer()
@@ -782,21 +1136,25 @@ int64_t WorldSessionManager::RandomServer()
 	if (_server_list.size() == 0) return 0;
 
 	std::vector<int32_t> server_list;
+	std::vector<int32_t> degraded_list; //连接降级的服务器，没有正常服务器时才选择
 
 	for (auto it = _server_list.begin(); it != _server_list.end(); ) 
 	{
 		if (it->first == 0 || !it->second)
 		{
 			it = _server_list.erase(it);
+			continue;
 		}
-		else
-		{
-			server_list.push_back(it->first);
 
-			++it;
-		}
+		auto link_state = it->second->GetLinkState();
+
+		if (LINK_STATE_UP == link_state) server_list.push_back(it->first);
+		else if (LINK_STATE_DEGRADED == link_state) degraded_list.push_back(it->first);
+
+		++it;
 	}
 	
+	if (server_list.size() == 0) server_list.swap(degraded_list); //连接断开的服务器不再分配新房间
 	if (server_list.size() == 0) return 0;
 
 	std::random_shuffle(server_list.begin(), server_list.end()); //随机
@@ -817,9 +1175,34 @@ void WorldSessionManager::OnSocketAccept(tcp::socket&& socket, int32_t thread_in
 bool WorldSessionManager::StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, int thread_count)
 {
 	if (!SuperSocketManager::StartNetwork(io_service, bind_ip, port, thread_count)) return false;
-	_acceptor->SetSocketFactory(std::bind(&SuperSocketManager::GetSocketForAccept, this));    
-	_acceptor->AsyncAcceptWithCallback<&OnSocketAccept>();    
-	return true;
+
+	TrafficStatsInstance.Load();
+	OutboxPolicyInstance.Load({ Asset::META_TYPE_SHARE_SAY_HI }); //心跳回复不等待
+
+	//默认限流：每个连接每秒100个数据包(超出延迟处理)；登录每秒1次(超出断开)，战绩、回放每秒2次(超出丢弃)
+	//默认登录排队：同时处理登录的网络线程不超过一半，其他线程继续处理已经登录的玩家
+	LoginAdmissionInstance.Load(std::max(1, GetNetworkThreadCount() / 2), { Asset::META_TYPE_C2S_LOGIN, Asset::META_TYPE_C2S_WECHAT_LOGIN, 
+			Asset::META_TYPE_SHARE_GUEST_LOGIN, Asset::META_TYPE_C2S_RECONNECT });
+
+	RateLimitPolicyInstance.Load("100:200:delay", fmt::format("{}:1:3:disconnect,{}:1:3:disconnect,{}:1:3:disconnect,{}:2:5:drop,{}:2:5:drop", 
+				int32_t(Asset::META_TYPE_C2S_LOGIN), int32_t(Asset::META_TYPE_SHARE_GUEST_LOGIN), int32_t(Asset::META_TYPE_C2S_WECHAT_LOGIN),
+				int32_t(Asset::META_TYPE_SHARE_ROOM_HISTORY), int32_t(Asset::META_TYPE_SHARE_PLAY_BACK)));
+
+	//默认压缩的协议：结算、回放、战绩、玩家列表
+	CompressPolicyInstance.Load({ Asset::META_TYPE_S2C_ROOM_CALCULATE, Asset::META_TYPE_S2C_GAME_CALCULATE, Asset::META_TYPE_SHARE_PLAY_BACK, 
+			Asset::META_TYPE_SHARE_ROOM_HISTORY, Asset::META_TYPE_S2C_PLAYERS });
+
+	SessionResumeRegistryInstance.Load(); //玩家连接断线续传
+
+	//默认发送优先级：对局内的协议为实时(相互之间保持顺序)，战绩、回放、系统广播为批量，其他为普通
+	SendPriorityPolicyInstance.Load({ Asset::META_TYPE_SHARE_CREATE_ROOM, Asset::META_TYPE_SHARE_PAI_OPERATION, Asset::META_TYPE_SHARE_GAME_OPERATION, 
+			Asset::META_TYPE_SHARE_ENTER_ROOM, Asset::META_TYPE_SHARE_RANDOM_SAIZI, Asset::META_TYPE_SHARE_SAY_HI, Asset::META_TYPE_S2C_LIUJU, 
+			Asset::META_TYPE_S2C_PAI_NOTIFY, Asset::META_TYPE_S2C_PAI_OPERATION_ALERT, Asset::META_TYPE_S2C_ROOM_INFO, Asset::META_TYPE_S2C_GAME_CALCULATE, 
+			Asset::META_TYPE_S2C_GAME_INFO, Asset::META_TYPE_S2C_PAI_PUSH_DOWN, Asset::META_TYPE_S2C_GAME_START, Asset::META_TYPE_S2C_ROOM_CALCULATE, 
+			Asset::META_TYPE_S2C_ROOM_DISMISS, Asset::META_TYPE_S2C_ROOM_STATE }, 
+			{ Asset::META_TYPE_SHARE_ROOM_HISTORY, Asset::META_TYPE_SHARE_PLAY_BACK, Asset::META_TYPE_S2C_ROOM_HISTORY, Asset::META_TYPE_S2C_SYSTEM_BROADCAST });
+
+	return StartAccept<&OnSocketAccept>();
 }
 	
 void WorldSessionManager::AddPlayer(int64_t player_id, std::shared_ptr<WorldSession> session) 
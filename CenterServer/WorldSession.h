@@ -11,7 +11,11 @@
 #include <boost/asio.hpp>
 
 #include "Socket.h"
+#include "TrafficStats.h"
+#include "RateLimiter.h"
+#include "LoginAdmission.h"
 #include "P_Header.h"
+#include "ProtocolTraits.h"
 
 namespace Adoter
 {
@@ -21,7 +25,7 @@ namespace pb = google::protobuf;
 
 class Player;
 
-class WorldSession : public Socket<WorldSession>
+class WorldSession : public Socket<WorldSession>, public LoginWaiter
 {
 	typedef Socket<WorldSession> SuperSocket;
 public:
@@ -33,14 +37,47 @@ public:
 	WorldSession& operator = (WorldSession const& right) = delete;
 	
 	virtual void Start() override;
-	virtual bool Update() override; 
+	virtual void OnIdle() override; 
 	virtual void OnClose() override;
+	virtual void OnBackpressure(ENQUEUE_RESULT result) override;
+	virtual void OnResumeExpired() override;
+	bool IsConnectOrResumable() { return IsConnect() || IsResumable(); } //发给玩家的数据包：断开等待续传期间继续记录
 
 	void InitializeHandler(const boost::system::error_code error, const std::size_t bytes_transferred);
+	bool DecodeMessages();
+	bool OnReceiveMessage(const Asset::Meta& meta);
+	bool OnAdmitMessage(const Asset::Meta& meta);
+	void OnRateLimitTimer(const boost::system::error_code& error);
+	void OnHeartBeatTimer(const boost::system::error_code& error);
+	void ResumeReceive(bool (WorldSession::*handler)(const Asset::Meta&));
+
+	virtual bool IsWaiting() const override { return _login_waiting && !_closed; }
+	virtual void OnLoginAdmitted() override;
+	virtual void OnLoginQueue(std::size_t position, int64_t wait_seconds) override;
+
+	void EnableSessionResume();
+	void OnSessionResume(const ResumeToken& token, uint64_t next_sequence);
 
 	void SendMeta(const Asset::Meta& meta);
-	void SendProtocol(const pb::Message& message);
-	void SendProtocol(const pb::Message* message);
+	bool SendProtocol(const pb::Message& message, int32_t type_t, int64_t player_id, bool droppable); //协议类型已知
+	bool SendBroadcast(BroadcastFrame& broadcast, bool droppable); //广播，所有接收者共用同一个数据包
+
+	//具体协议在编译期确定协议类型，见ProtocolTraits
+	template <typename T> EnableIfProtocol<T, bool> SendProtocol(const T& message)
+	{
+		return SendProtocol(message, ProtocolType(message), 0, false);
+	}
+
+	template <typename T> EnableIfProtocol<T> SendProtocol(const T* message)
+	{
+		if (message) SendProtocol(*message);
+	}
+
+	//携带玩家ID；droppable：发送队列拥塞时可以丢弃
+	template <typename T> EnableIfProtocol<T, bool> SendPlayerProtocol(const T& message, int64_t player_id, bool droppable)
+	{
+		return SendProtocol(message, ProtocolType(message), player_id, droppable);
+	}
 
 	void KickOutPlayer(Asset::KICK_OUT_REASON reason);
 	void OnLogout();
@@ -52,15 +89,33 @@ public:
 	std::string GetRemoteAddress() {return _remote_endpoint.address().to_string(); }
 	int32_t GetRemotePort() { return _remote_endpoint.port(); }
 
+	static int64_t GetMicroseconds() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
 	bool OnInnerProcess(const Asset::Meta& meta);
 	void OnProcessMessage(const Asset::Meta& meta);
 
+	const TrafficCounter& GetTraffic() const { return _traffic; }
+	TRAFFIC_CLASS GetTrafficClass() const { return _role_type == Asset::ROLE_TYPE_GAME_SERVER ? TRAFFIC_CLASS_GAME_SERVER : TRAFFIC_CLASS_CLIENT; }
+
 	int64_t GetID() { return _global_id; }
 	void SetID(int64_t global_id) { _global_id = global_id; }
 
 	void SetRoleType(Asset::ROLE_TYPE role_type, int64_t global_id) { 
 		_role_type = role_type; 
 		_global_id = global_id;
+
+		if (role_type == Asset::ROLE_TYPE_GAME_SERVER) 
+		{
+			SetQueueLimits("GameServer", QueueLimits::ServerLink()); //逻辑服务器连接使用服务器水位
+			EnableBatch(); //玩家数据包批量发送
+			EnableOutbox(false); //服务器之间按批量发送合并
+			EnableSendLanes(false); //服务器之间按入队顺序发送
+			EnableServerReceive(); //允许接收超过64K的数据包
+		}
+		else if (role_type == Asset::ROLE_TYPE_PLAYER) 
+		{
+			EnableSessionResume(); //断线后可以续传
+		}
 	}
 
 	int32_t OnWechatLogin(const pb::Message* message);
@@ -86,9 +141,19 @@ private:
 	std::shared_ptr<Player> _player = nullptr; //全局玩家定义，唯一的一个Player对象
 	bool _online = true;
 	
+	TrafficCounter _traffic; //连接流量统计
+
+	RateLimiter _rate_limiter; //客户端限流
+	boost::asio::deadline_timer _rate_timer;
+	Asset::Meta _delayed_meta; //延迟处理的数据包
+	int64_t _receive_time = 0; //最近接收时间(微秒)
+	std::atomic<bool> _login_waiting{false}; //登录排队中
+	bool _login_admitted = false; //排队轮到，已经占用登录名额
+	
+	boost::asio::deadline_timer _heart_timer; //心跳定时器
+	int64_t _heart_count = 0; //心跳次数
 	std::time_t _hi_time = 0;
 	int32_t _pings_count = 0;
-	int64_t _heart_count = 0; //心跳次数
 	int64_t _expire_time = 0;
 };
 
@@ -135,8 +200,11 @@ public:
 	void BroadCast2GameServer(const pb::Message& message); //游戏逻辑服务器
 	void BroadCast2GameServer(const pb::Message* message); 
 	
-	void BroadCast(const pb::Message& message); //玩家
-	void BroadCast(const pb::Message* message); 
+	void BroadCast(const pb::Message& message, int64_t except_player_id = 0); //玩家，except_player_id不发送
+	void BroadCast(const pb::Message* message, int64_t except_player_id = 0); 
+
+	std::string TrafficReport(std::size_t top); //流量统计：协议类型及流量最大的连接
+	void DumpTraffic(); //流量统计输出到本地文件
 	
 	bool StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, int thread_count = 1) override;
 protected:        
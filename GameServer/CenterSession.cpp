@@ -16,6 +16,11 @@ CenterSession::CenterSession(boost::asio::io_service& io_service, const boost::a
 {
 	_remote_endpoint = endpoint;
 	_ip_address = endpoint.address().to_string();
+
+	SetQueueLimits("CenterSession"); //发送队列水位
+	EnableBatch(); //玩家数据包批量发送
+
+	_heartbeat_interval = ConfigInstance.GetInt("HeartbeatInterval", 60) * 1000;
 }
 	
 void CenterSession::OnConnected()
@@ -31,6 +36,8 @@ void CenterSession::OnConnected()
 
 bool CenterSession::OnMessageProcess(const Asset::Meta& meta)
 {
+	TrafficScope traffic(TRAFFIC_CLASS_CENTER_SERVER, meta.type_t(), meta.stuff().size()); //流量统计，处理结束时记录
+
 	DEBUG("接收来自中心服务器:{} {}的数据:{}", _ip_address, _remote_endpoint.port(), meta.ShortDebugString());
 		
 	if (meta.type_t() == Asset::META_TYPE_S2S_REGISTER) //注册服务器成功
@@ -105,41 +112,40 @@ bool CenterSession::OnMessageProcess(const Asset::Meta& meta)
 	return true;
 }
 	
-void CenterSession::SendProtocol(pb::Message* message)
-{
-	SendProtocol(*message);
-}
-
-void CenterSession::SendProtocol(pb::Message& message)
+void CenterSession::SendProtocol(const pb::Message& message, int32_t type_t)
 {
-	const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
-	if (!field) return;
-	
-	int type_t = field->default_value_enum()->number();
 	if (!Asset::META_TYPE_IsValid(type_t)) 
 	{
 		DEBUG_ASSERT(false);
 		return;	//如果不合法，不检查会宕线
 	}
-	
-	auto message_string = message.SerializeAsString();
 
-	Asset::Meta meta;
-	meta.set_type_t((Asset::META_TYPE)type_t);
-	meta.set_stuff(message_string);
-
-	auto meta_string = meta.ShortDebugString();
-
-	std::string content = meta.SerializeAsString();
+	DEBUG("游戏逻辑服务器发送协议到中心服务器[{} {}], 协议类型:{} 协议数据:{}", _ip_address, _remote_endpoint.port(), type_t, message.ShortDebugString());
+	SendProtocol(message, type_t, 0);
+}
 
-	if (content.empty()) 
+void CenterSession::SendProtocol(const pb::Message& message, int32_t type_t, int64_t player_id)
+{
+	auto frame = FrameBuffer::BuildMeta(message, type_t, player_id); //直接序列化到发送缓存
+	if (!frame) 
 	{
-		ERROR("server:{} send nothing, message:{}", _ip_address, meta_string);
+		ERROR("server:{} send failed, type_t:{} player_id:{}", _ip_address, type_t, player_id);
 		return;
 	}
 
-	DEBUG("游戏逻辑服务器发送协议到中心服务器[{} {}], 协议数据:{}", _ip_address, _remote_endpoint.port(), meta_string);
-	AsyncSendMessage(content);
+	TrafficStatsInstance.Record(TRAFFIC_CLASS_CENTER_SERVER, TRAFFIC_DIRECTION_OUT, type_t, frame->BodySize());
+
+	EnterQueue(std::move(frame));
+}
+
+void CenterSession::SendBroadcast(BroadcastFrame& broadcast, int64_t player_id)
+{
+	auto frame = broadcast.Get(player_id); //复制已经序列化的包体，追加玩家ID
+	if (!frame) return;
+
+	TrafficStatsInstance.Record(TRAFFIC_CLASS_CENTER_SERVER, TRAFFIC_DIRECTION_OUT, broadcast.GetType(), frame->BodySize());
+
+	EnterQueue(std::move(frame));
 }
 
 bool CenterSession::StartSend()
@@ -196,44 +202,20 @@ void CenterSession::OnReadSome(const boost::system::error_code& error, std::size
 		return;
 	}
 	
-	//std::lock_guard<std::mutex> lock(_mutex);
-
-	for (size_t index = 0; index < bytes_transferred;)
-	{
-		unsigned short body_size = _buffer[index] * 256 + _buffer[1 + index];
-			
-		if (body_size > MAX_DATA_SIZE)
-		{
-			LOG(ERROR, "接收来自地址:{} 端口:{} 太大的包长:{} 丢弃.", _ip_address, _remote_endpoint.port(), body_size)
-			return;
-		}
-
-		char buffer[MAX_DATA_SIZE] = {0}; //数据缓存  
-		for (size_t i = 0; i < body_size; ++i) buffer[i] = _buffer[i + index + 2]; //字节复制
-
-		Asset::Meta meta;
-		bool result = meta.ParseFromArray(buffer, body_size);
+	_codec.Commit(bytes_transferred);
 
-		if (!result)
-		{
-			LOG(ERROR, "Receive message error from server:{} {} cannot parse from data.", _ip_address, _remote_endpoint.port());
-			return;
-		}
-		
-		_receive_list.push_back(meta);
+	auto result = _codec.Decode<Asset::Meta>([this](const Asset::Meta& meta) {
+		OnMessageProcess(meta);
+		return !IsClosed(); //处理过程中可能关闭连接
+	});
 
-		index += (body_size + 2); //下个包的起始位置
+	if (FRAME_DECODE_PARSE_ERROR == result)
+	{
+		LOG(ERROR, "Receive message error from server:{} {} cannot parse from data.", _ip_address, _remote_endpoint.port());
 	}
-
-	std::deque<Asset::Meta> received_messages;
-	received_messages.swap(_receive_list);
-
-	//数据处理
-	while (!IsClosed() && !received_messages.empty())
+	else if (FRAME_DECODE_STOPPED == result)
 	{
-		const auto& message = received_messages.front();
-		OnMessageProcess(message);
-		received_messages.pop_front();
+		return;
 	}
 	
 	AsynyReadSome(); //继续下一次数据接收
@@ -273,7 +255,9 @@ bool CenterSession::Update()
 		}
 	}
 
-	if (_heart_count % 1200 == 0) SayHi(); //心跳(60s)
+	if (IsConnected() && GetSendIdleTime() >= _heartbeat_interval) SayHi(); //链路空闲(默认60s内没有其他数据发送)时才发送心跳
+
+	if (_heart_count % 1200 == 0) ReportBatchStatistics("中心服务器");
 	
 	if (_heart_count % 36000 == 0) //30mins
 	{
@@ -11,7 +11,10 @@
 #include <boost/asio.hpp>
 
 #include "ClientSocket.h"
+#include "TrafficStats.h"
+#include "BroadcastFrame.h"
 #include "P_Header.h"
+#include "ProtocolTraits.h"
 
 namespace Adoter
 {
@@ -35,8 +38,11 @@ public:
 	virtual void OnConnected(); //连接上服务器
 	bool OnMessageProcess(const Asset::Meta& meta); //内部协议处理
 	
-	void SendProtocol(pb::Message& message);
-	void SendProtocol(pb::Message* message);
+	template <typename T> EnableIfProtocol<T> SendProtocol(const T& message) { SendProtocol(message, ProtocolType(message)); } //具体协议在编译期确定协议类型
+	template <typename T> EnableIfProtocol<T> SendProtocol(const T* message) { if (message) SendProtocol(*message); }
+	void SendProtocol(const pb::Message& message, int32_t type_t);
+	void SendBroadcast(BroadcastFrame& broadcast, int64_t player_id); //房间、全服广播，协议只序列化一次
+	void SendProtocol(const pb::Message& message, int32_t type_t, int64_t player_id); //玩家协议，携带玩家ID
 
     virtual bool StartReceive();
     virtual bool StartSend();
@@ -56,13 +62,13 @@ public:
 	int32_t ServerID() { return _server_id; }
 private:
 	std::deque<std::string> _send_list;
-	std::deque<Asset::Meta> _receive_list;
 	boost::asio::ip::tcp::endpoint _remote_endpoint;
 	std::string _ip_address;
 	std::unordered_map<int64_t, std::shared_ptr<Player>> _players; //实体为智能指针，不要传入引用
 	std::mutex _player_lock;
 	
 	int64_t _heart_count = 0; //心跳次数
+	int64_t _heartbeat_interval = 60000; //链路空闲时的心跳间隔(毫秒)
 	int32_t _server_id = 0;
 };
 
@@ -19,6 +19,7 @@
 #include "MXLog.h"
 #include "Config.h"
 #include "CenterSession.h"
+#include "IoServicePool.h"
 #include "MessageDispatcher.h"
 
 const int const_world_sleep = 50;
@@ -30,8 +31,7 @@ const int const_world_sleep = 50;
 
 using namespace Adoter;
 
-boost::asio::io_service _io_service;
-std::shared_ptr<boost::asio::io_service::work> _io_service_work = nullptr;
+IoServicePool _io_pool; //主线程池：监听、服务器之间的连接
 
 void SignalHandler(const boost::system::error_code& error, int)
 {    
@@ -66,11 +66,9 @@ void WorldUpdateLoop()
 	}
 }
 
-void ShutdownThreadPool(std::vector<std::shared_ptr<std::thread>>& threads)
-{    
-	_io_service.stop();    
-	
-	for (auto& thread : threads) thread->join();    
+void ShutdownThreadPool()
+{
+	_io_pool.Stop();
 }
 
 /*
@@ -108,17 +106,10 @@ int main(int argc, const char* argv[])
 		if (!WorldInstance.Load()) return 1;
 
 		//网络初始化
-		_io_service_work = std::make_shared<boost::asio::io_service::work>(_io_service);
-
-		int _thread_nums = 5;
-		std::vector<std::shared_ptr<std::thread>> _threads;	
-		for (int i = 0; i < _thread_nums; ++i)
-		{
-			std::shared_ptr<std::thread> pthread(new std::thread(boost::bind(&boost::asio::io_service::run, &_io_service)));	//IO <-> Multi Threads
-			_threads.push_back(pthread);
-		}
+		_io_pool.Load(5); //IoServiceMode：shared为多线程共用一个io_service，per_thread为每个线程一个
+		_io_pool.Start();
 
-		//boost::asio::signal_set signals(_io_service, SIGINT, SIGTERM);
+		//boost::asio::signal_set signals(_io_pool.GetIoService(0), SIGINT, SIGTERM);
 		//signals.async_wait(SignalHandler);
 		//
 
@@ -141,7 +132,7 @@ int main(int argc, const char* argv[])
 		/*
 		int32_t center_server_port = ConfigInstance.GetInt("Center_ServerPort", 50000); 
 		boost::asio::ip::tcp::endpoint center_endpoint(boost::asio::ip::address::from_string(center_server_address), center_server_port);
-		g_center_session = std::make_shared<CenterSession>(_io_service, center_endpoint);
+		g_center_session = std::make_shared<CenterSession>(_io_pool.GetIoService(), center_endpoint);
 		g_center_session->AsyncConnect();
 		*/
 
@@ -151,11 +142,11 @@ int main(int argc, const char* argv[])
 		boost::asio::ip::tcp::endpoint center_endpoint1(boost::asio::ip::address::from_string(center_server_address), center_server_port1);
 		boost::asio::ip::tcp::endpoint center_endpoint2(boost::asio::ip::address::from_string(center_server_address), center_server_port2);
 
-		auto session1 = std::make_shared<CenterSession>(_io_service, center_endpoint1);
+		auto session1 = std::make_shared<CenterSession>(_io_pool.GetIoService(), center_endpoint1);
 		session1->AsyncConnect();
 		WorldInstance.EmplaceSession(session1);
 		
-		auto session2 = std::make_shared<CenterSession>(_io_service, center_endpoint2);
+		auto session2 = std::make_shared<CenterSession>(_io_pool.GetIoService(), center_endpoint2);
 		session2->AsyncConnect();
 		WorldInstance.EmplaceSession(session2);
 		
@@ -164,7 +155,7 @@ int main(int argc, const char* argv[])
 		//世界循环
 		WorldUpdateLoop();
 	
-		ShutdownThreadPool(_threads);
+		ShutdownThreadPool();
 	}
 	catch (const std::exception& e)
 	{
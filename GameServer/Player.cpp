@@ -1146,18 +1146,8 @@ void Player::SendMessage(const Asset::MsgItem& item)
 	DispatcherInstance.SendMessage(item);
 }	
 	
-void Player::SendMessage(int64_t receiver, const pb::Message* message)
+void Player::SendMessage(int64_t receiver, const pb::Message& message, int32_t type_t)
 {
-	if (!message) return;
-	SendMessage(receiver, *message);
-}
-	
-void Player::SendMessage(int64_t receiver, const pb::Message& message)
-{
-	const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
-	if (!field) return;
-	
-	int type_t = field->default_value_enum()->number();
 	if (!Asset::META_TYPE_IsValid(type_t)) return;	//如果不合法，不检查会宕线
 	
 	Asset::MsgItem msg;
@@ -1168,13 +1158,7 @@ void Player::SendMessage(int64_t receiver, const pb::Message& message)
 	SendMessage(msg);
 }
 
-void Player::SendProtocol(const pb::Message* message)
-{
-	if (!message) return;
-	SendProtocol(*message);
-}
-
-void Player::SendProtocol(const pb::Message& message)
+void Player::SendProtocol(const pb::Message& message, int32_t type_t)
 {
 	/*
 	if (!g_center_session) 
@@ -1186,26 +1170,21 @@ void Player::SendProtocol(const pb::Message& message)
 
 	if (!Connected()) return; //尚未建立网络连接
 
-	const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
-	if (!field) return;
-	
-	int type_t = field->default_value_enum()->number();
 	if (!Asset::META_TYPE_IsValid(type_t)) return;	//如果不合法，不检查会宕线
 	
-	Asset::Meta meta;
-	meta.set_type_t((Asset::META_TYPE)type_t);
-	meta.set_stuff(message.SerializeAsString());
-	meta.set_player_id(_player_id);
-
-	std::string content = meta.SerializeAsString();
-	if (content.empty()) return;
-
 	//g_center_session->AsyncSendMessage(content);
-	_session->AsyncSendMessage(content);
+	_session->SendProtocol(message, type_t, _player_id); //直接序列化到发送缓存
 
 	//DEBUG("玩家:{} 发送协议，类型:{} 内容:{}", _player_id, type_t,  message.ShortDebugString());
 }
 
+void Player::SendBroadcast(BroadcastFrame& broadcast)
+{
+	if (!Connected()) return; //尚未建立网络连接
+
+	_session->SendBroadcast(broadcast, _player_id);
+}
+
 void Player::Send2Roomers(pb::Message& message, int64_t exclude_player_id) 
 {
 	if (!_room) return;
@@ -2421,16 +2400,22 @@ void PlayerManager::Remove(std::shared_ptr<Player> player)
 	Remove(player->GetID());
 }
 	
-void PlayerManager::BroadCast(const pb::Message& message)
+void PlayerManager::BroadCast(const pb::Message& message, int64_t except_player_id)
 {
+	auto type_t = ProtocolType(message);
+	if (!Asset::META_TYPE_IsValid(type_t)) return;
+
+	BroadcastFrame broadcast(message, type_t);
+	if (!broadcast.Get()) return; //锁外序列化
+
 	std::lock_guard<std::mutex> lock(_player_lock);
 
 	for (auto it = _players.begin(); it != _players.end(); ++it)
 	{
-		auto player = it->second;
-		if (!player) continue;
+		const auto& player = it->second;
+		if (!player || it->first == except_player_id) continue;
 
-		player->SendProtocol(message);
+		player->SendBroadcast(broadcast);
 	}
 }
 
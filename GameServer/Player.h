@@ -9,6 +9,8 @@
 #include <unordered_set>
 
 #include "P_Header.h"
+#include "ProtocolTraits.h"
+#include "BroadcastFrame.h"
 #include "Item.h"
 #include "Asset.h"
 #include "MessageDispatcher.h"
@@ -73,7 +75,7 @@ public:
 
 	const std::shared_ptr<CenterSession> GetSession() { return _session; }
 	void SetSession(std::shared_ptr<CenterSession> session) { _session = session; }
-	bool Connected() { if (!_session) return false; return _session->IsConnected(); }
+	bool Connected() { if (!_session) return false; return _session->IsLinkAvailable(); } //短暂断开时数据包缓存，重连后重发
 
 	int32_t DefaultMethod(pb::Message*); //协议处理默认调用函数
 	
@@ -124,13 +126,19 @@ public:
 	//消息处理
 	virtual bool HandleMessage(const Asset::MsgItem& item); 
 	virtual void SendMessage(const Asset::MsgItem& item);
-	virtual void SendMessage(int64_t receiver, const pb::Message& message);
-	virtual void SendMessage(int64_t receiver, const pb::Message* message);
+	virtual void SendMessage(int64_t receiver, const pb::Message& message, int32_t type_t);
 	virtual void BroadCastCommonProp(Asset::MSG_TYPE type); //向房间里的玩家发送公共数据       
 	//协议处理(Protocol Buffer)
 	virtual bool HandleProtocol(int32_t type_t, pb::Message* message);
-	virtual void SendProtocol(const pb::Message& message);
-	virtual void SendProtocol(const pb::Message* message);
+	virtual void SendProtocol(const pb::Message& message, int32_t type_t); //协议类型已知
+	virtual void SendBroadcast(BroadcastFrame& broadcast); //广播，见BroadcastFrame
+
+	//具体协议在编译期确定协议类型，见ProtocolTraits
+	template <typename T> EnableIfProtocol<T> SendProtocol(const T& message) { SendProtocol(message, ProtocolType(message)); }
+	template <typename T> EnableIfProtocol<T> SendProtocol(const T* message) { if (message) SendProtocol(*message); }
+
+	template <typename T> EnableIfProtocol<T> SendMessage(int64_t receiver, const T& message) { SendMessage(receiver, message, ProtocolType(message)); }
+	template <typename T> EnableIfProtocol<T> SendMessage(int64_t receiver, const T* message) { if (message) SendMessage(receiver, *message); }
 	virtual void Send2Roomers(pb::Message& message, int64_t exclude_player_id = 0); //向房间里玩家发送协议数据，发送到Client
 	virtual void Send2Roomers(pb::Message* message, int64_t exclude_player_id = 0); //向房间里玩家发送协议数据，发送到Client
 	virtual void BroadCast(Asset::MsgItem& item);
@@ -540,7 +548,7 @@ public:
 	std::shared_ptr<Player> GetPlayer(int64_t player_id);
 	std::shared_ptr<Player> Get(int64_t player_id);
 	
-	virtual void BroadCast(const pb::Message& message);
+	virtual void BroadCast(const pb::Message& message, int64_t except_player_id = 0); //except_player_id不发送
 };
 
 #define PlayerInstance PlayerManager::Instance()
@@ -727,14 +727,19 @@ void Room::AddGameRecord(const Asset::GameRecord& record)
 void Room::BroadCast(pb::Message* message, int64_t exclude_player_id)
 {
 	if (!message) return;
+
+	auto type_t = ProtocolType(*message);
+	if (!Asset::META_TYPE_IsValid(type_t)) return;
+
+	BroadcastFrame broadcast(*message, type_t); //协议只序列化一次，每个玩家追加玩家ID
 			
-	for (auto player : _players)
+	for (const auto& player : _players)
 	{
 		if (!player) continue; //可能已经释放//或者退出房间
 
 		if (exclude_player_id == player->GetID()) continue;
 
-		player->SendProtocol(message);
+		player->SendBroadcast(broadcast);
 	}
 }
 	
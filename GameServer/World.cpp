@@ -66,6 +66,8 @@ bool World::Load()
 		return false;
 	}
 
+	TrafficStatsInstance.Load();
+
 	return true;
 }
 
@@ -86,6 +88,12 @@ void World::Update(int32_t diff)
 	
 	//g_center_session->Update();
 	for (auto session : _sessions) session->Update();
+
+	if (_heart_count % 1200 == 0) //每分钟输出流量统计，没有配置输出文件时不生成
+	{
+		auto file_name = ConfigInstance.GetString("TrafficStatsFile", "");
+		if (!file_name.empty()) TrafficStats::Dump(file_name, TrafficStatsInstance.Report(ConfigInstance.GetInt("TrafficReportTop", 20)));
+	}
 }
 	
 
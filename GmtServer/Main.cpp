@@ -12,6 +12,7 @@
 #include "Asset.h"
 #include "MXLog.h"
 #include "ServerSession.h"
+#include "IoServicePool.h"
 
 const int const_world_sleep = 50;
 
@@ -22,19 +23,16 @@ const int const_world_sleep = 50;
 
 using namespace Adoter;
 
-boost::asio::io_service _io_service;
-std::shared_ptr<boost::asio::io_service::work> _io_service_work;
+IoServicePool _io_pool; //主线程池：监听、服务器之间的连接
 
 void SignalHandler(const boost::system::error_code& error, int)
 {    
 	//if (!error) World::StopNow(SHUTDOWN_EXIT_CODE);
 }
 
-void ShutdownThreadPool(std::vector<std::shared_ptr<std::thread>>& threads)
+void ShutdownThreadPool()
 {
-	_io_service.stop();
-
-	for (auto& thread : threads) thread->join();
+	_io_pool.Stop();
 }
 
 /*
@@ -66,18 +64,11 @@ int main(int argc, const char* argv[])
 		}
 	
 		//网络初始化
-		_io_service_work = std::make_shared<boost::asio::io_service::work>(_io_service);
-
-		int _thread_nums = 5;
-		std::vector<std::shared_ptr<std::thread>> _threads;	
-		for (int i = 0; i < _thread_nums; ++i)
-		{
-			std::shared_ptr<std::thread> pthread(new std::thread(boost::bind(&boost::asio::io_service::run, &_io_service)));	//IO <-> Multi Threads
-			_threads.push_back(pthread);
-		}
+		_io_pool.Load(5); //IoServiceMode：shared为多线程共用一个io_service，per_thread为每个线程一个
+		_io_pool.Start();
 
 		/*
-		boost::asio::signal_set signals(_io_service, SIGINT, SIGTERM);
+		boost::asio::signal_set signals(_io_pool.GetIoService(0), SIGINT, SIGTERM);
 		signals.async_wait(SignalHandler);
 		*/
 
@@ -93,13 +84,13 @@ int main(int argc, const char* argv[])
 		int32_t redis_work_count = ConfigInstance.GetInt("Redis_WorkCount", 5);
 		tacopie::get_default_io_service()->set_nb_workers(redis_work_count);
 
-		ServerSessionInstance.StartNetwork(_io_service, server_ip, server_port, thread_count);
+		ServerSessionInstance.StartNetwork(_io_pool.GetIoService(), server_ip, server_port, thread_count);
 
-		_io_service.run();
+		_io_pool.Wait(); //直到主线程池停止
 
 		std::cout << "Service stop..." << std::endl;
 
-		ShutdownThreadPool(_threads);
+		ShutdownThreadPool();
 	}
 	catch (std::exception& e)
 	{
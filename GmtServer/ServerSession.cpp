@@ -23,6 +23,10 @@ ServerSession::ServerSession(boost::asio::ip::tcp::socket&& socket) : Socket(std
 	_remote_endpoint = _socket.remote_endpoint();
 	_ip_address = _remote_endpoint.address().to_string();
 
+	SetQueueLimits("ServerSession", QueueLimits::ServerLink()); //发送队列水位
+	EnableServerReceive(); //只接收服务器和GMT工具的连接
+	EnableLinkReplay();
+
 	DEBUG("接收连接，地址:{}，端口:{}", _ip_address, _remote_endpoint.port());
 }
 
@@ -39,31 +43,21 @@ void ServerSession::InitializeHandler(const boost::system::error_code error, con
 			Close();
 			return;
 		}
-		else
-		{
-			for (size_t index = 0; index < bytes_transferred;)
-			{
-				unsigned short body_size = _buffer[index] * 256 + _buffer[1 + index];
-					
-				if (body_size > MAX_DATA_SIZE)
-				{
-					LOG(ERROR, "接收来自地址:{} 端口:{} 太大的包长:{} 丢弃.", _ip_address, _remote_endpoint.port(), body_size)
-					return;
-				}
-
-				char buffer[MAX_DATA_SIZE] = { 0 }; //数据缓存  
-				for (size_t i = 0; i < body_size; ++i) buffer[i] = _buffer[i + index + 2];  
 
-				Asset::InnerMeta meta;
-				if (_session_id) meta.set_session_id(_session_id);
+		_codec.Commit(bytes_transferred);
 
-				auto result = meta.ParseFromArray(buffer, body_size);
-				if (!result) return;
-				
-				OnInnerProcess(meta);
+		auto result = _codec.Decode<Asset::InnerMeta>([this](const Asset::InnerMeta& meta) {
+			OnInnerProcess(meta);
+			return !_closed; //处理过程中可能关闭连接
+		});
 
-				index += (body_size + 2); //下个包的起始位置
-			}
+		if (FRAME_DECODE_PARSE_ERROR == result)
+		{
+			LOG(ERROR, "接收来自地址:{} 端口:{} 的数据转换Protobuff失败.", _ip_address, _remote_endpoint.port());
+		}
+		else if (FRAME_DECODE_STOPPED == result)
+		{
+			return;
 		}
 	}
 	catch (std::exception& e)
@@ -258,6 +252,31 @@ bool ServerSession::OnInnerProcess(const Asset::InnerMeta& meta)
 		}
 		break;
 
+		case Asset::INNER_TYPE_QUERY_TRAFFIC: //服务器流量统计：转发到中心服务器，返回结果发给相应的GMT会话
+		{
+			Asset::QueryTraffic message;
+			auto result = message.ParseFromString(meta.stuff());
+			if (!result) return false;
+
+			if (IsGmtServer())
+			{
+				Asset::InnerMeta inner_meta;
+				inner_meta.set_type_t(message.type_t());
+				inner_meta.set_session_id(_session_id);
+				inner_meta.set_stuff(message.SerializeAsString());
+
+				ServerSessionInstance.BroadCastInnerMeta(inner_meta);
+			}
+			else
+			{
+				auto gmt_server = ServerSessionInstance.GetGmtServer(meta.session_id());
+				if (!gmt_server) return false;
+
+				gmt_server->SendProtocol(message);
+			}
+		}
+		break;
+
 		default:
 		{
 			WARN("接收GMT指令:{} 尚未含有处理回调，协议数据:{}", meta.type_t(), meta.ShortDebugString());
@@ -575,6 +594,14 @@ void ServerSession::SendProtocol(const pb::Message& message)
 	
 	int type_t = field->default_value_enum()->number();
 	if (!Asset::INNER_TYPE_IsValid(type_t)) return;	//如果不合法，不检查会宕线
+
+	if (IsCenterServer() && IsHandshaked()) 
+	{
+		DEBUG("GMT服务器向服务器ID:{} 地址:{} 发送协议类型:{} 具体内容:{}", _server_id, _ip_address, type_t, message.ShortDebugString());
+
+		EnterQueue(FrameBuffer::BuildInnerMeta(message, type_t, _session_id)); //直接序列化到发送缓存
+		return;
+	}
 	
 	Asset::InnerMeta meta;
 	meta.set_type_t((Asset::INNER_TYPE)type_t);
@@ -585,7 +612,7 @@ void ServerSession::SendProtocol(const pb::Message& message)
 	if (content.empty()) return;
 
 	DEBUG("GMT服务器向服务器ID:{} 地址:{} 发送协议数据:{} 具体内容:{}", _server_id, _ip_address, meta.ShortDebugString(), message.ShortDebugString());
-	AsyncSend(content);
+	SendContent(std::move(content));
 }
 	
 void ServerSession::SendInnerMeta(const pb::Message& meta)
@@ -594,7 +621,23 @@ void ServerSession::SendInnerMeta(const pb::Message& meta)
 	if (content.empty()) return;
 
 	DEBUG("GMT服务器向服务器:{} 地址:{} 发送协议数据:{}", _server_id, _ip_address, meta.ShortDebugString());
-	AsyncSend(content);
+	SendContent(std::move(content));
+}
+
+void ServerSession::SendContent(std::string&& content)
+{
+	if (IsCenterServer() && IsHandshaked()) 
+	{
+		EnterQueue(std::move(content)); //已升级的中心服务器(发起过握手)：包头+包体，接收方按包解析
+	}
+	else if (IsCenterServer())
+	{
+		EnterQueue(FrameBuffer::CreateUnframed(content.data(), content.size())); //未握手的中心服务器：保持原有数据格式，经发送队列保证顺序
+	}
+	else
+	{
+		AsyncSend(content); //GMT工具：保持原有数据格式
+	}
 }
 	
 void ServerSessionManager::BroadCastProtocol(const pb::Message* message)
@@ -678,9 +721,7 @@ void ServerSessionManager::OnSocketAccept(tcp::socket&& socket, int32_t thread_i
 bool ServerSessionManager::StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, int thread_count)
 {
 	if (!SuperSocketManager::StartNetwork(io_service, bind_ip, port, thread_count)) return false;
-	_acceptor->SetSocketFactory(std::bind(&SuperSocketManager::GetSocketForAccept, this));    
-	_acceptor->AsyncAcceptWithCallback<&OnSocketAccept>();    
-	return true;
+	return StartAccept<&OnSocketAccept>();
 }
 
 #undef RETURN
@@ -52,6 +52,7 @@ public:
 	void SendProtocol(const pb::Message* message);
 	
 	void SendInnerMeta(const pb::Message& message);
+	void SendContent(std::string&& content);
 
 	const std::string GetRemoteAddress() { return _remote_endpoint.address().to_string(); }
 	const boost::asio::ip::tcp::endpoint GetRemotePoint() { return _remote_endpoint; }
@@ -63,11 +64,12 @@ public:
 
 	void SetSession(int64_t session_id) { _session_id = session_id; }
 	bool IsGmtServer() { return Asset::SERVER_TYPE_GMT == _server_type; }
+	bool IsCenterServer() { return Asset::SERVER_TYPE_CENTER == _server_type; }
 private:
 	boost::asio::ip::tcp::endpoint _remote_endpoint;
 	std::string _ip_address;
 	int64_t _server_id = 0;
-	Asset::SERVER_TYPE _server_type;
+	Asset::SERVER_TYPE _server_type = Asset::SERVER_TYPE_BEGIN;
 	int64_t _session_id = 0;
 };
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include <google/protobuf/message.h>
+
+namespace Adoter
+{
+
+namespace pb = google::protobuf;
+
+/*
+ * 协议类型
+ *
+ * 1.所有协议的第一个变量type_t的默认值即协议类型，protoc为每个协议生成的默认实例已经带有该值;
+ *
+ * 2.发送接口按协议类型模板化：具体协议在编译期选择ProtocolTraits<T>，直接读取默认实例的type_t，不再每次发送时通过描述符和反射查找字段;
+ *
+ * 3.只有运行时才知道具体协议的pb::Message(转发、回调参数)按描述符查找，没有type_t变量的协议返回0(不合法).
+ *
+ * */
+template <typename T, typename = void>
+struct ProtocolTraits
+{
+	static int32_t Type(const pb::Message& message)
+	{
+		const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
+		if (!field || !field->enum_type()) return 0;
+
+		return field->default_value_enum()->number();
+	}
+};
+
+template <typename T>
+struct ProtocolTraits<T, typename std::enable_if<!std::is_same<decltype(T::default_instance().type_t()), void>::value>::type>
+{
+	static int32_t Type(const T&) { return Type(); }
+	static int32_t Type() { return static_cast<int32_t>(T::default_instance().type_t()); }
+};
+
+template <typename T>
+inline int32_t ProtocolType(const T& message)
+{
+	static_assert(std::is_base_of<pb::Message, T>::value, "ProtocolType requires a protobuf message");
+	return ProtocolTraits<T>::Type(message);
+}
+
+//发送接口的模板参数限定为协议
+template <typename T, typename R = void>
+using EnableIfProtocol = typename std::enable_if<std::is_base_of<pb::Message, T>::value, R>::type;
+
+}
@@ -20,9 +20,37 @@ public:
 	{
 	}
 
+	//
+	//多个监听共用同一端口(SO_REUSEPORT)，由内核将新连接分配到各个监听
+	//
+	//每个网络线程一个监听，连接直接在网络线程接收，不经过主线程
+	//
+	AsyncAcceptor(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, bool reuse_port) :
+		_acceptor(io_service), _socket(io_service), _closed(false), _socket_factory(std::bind(&AsyncAcceptor::DefeaultSocketFactory, this))
+	{
+		tcp::endpoint endpoint(boost::asio::ip::address::from_string(bind_ip), port);
+
+		_acceptor.open(endpoint.protocol());
+		_acceptor.set_option(tcp::acceptor::reuse_address(true));
+
+		if (reuse_port) 
+		{
+#ifdef SO_REUSEPORT
+			_acceptor.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#else
+			throw boost::system::system_error(boost::asio::error::operation_not_supported, "SO_REUSEPORT");
+#endif
+		}
+
+		_acceptor.bind(endpoint);
+		_acceptor.listen(tcp::acceptor::max_connections);
+	}
+
 	template<class T> void AsyncAccept();
 
-	template<AcceptCallback accept_callback> void AsyncAcceptWithCallback();
+	template<AcceptCallback accept_callback> void AsyncAcceptWithCallback() { AsyncAcceptWithCallback(accept_callback); }
+
+	void AsyncAcceptWithCallback(AcceptCallback accept_callback);
 
 	void Close()
 	{
@@ -89,13 +117,12 @@ void AsyncAcceptor::AsyncAccept()
     	});
 }
 
-template<AsyncAcceptor::AcceptCallback accept_callback> 
-void AsyncAcceptor::AsyncAcceptWithCallback()
+inline void AsyncAcceptor::AsyncAcceptWithCallback(AcceptCallback accept_callback)
 {
 	tcp::socket* socket;
 	int32_t thread_index;
 	std::tie(socket, thread_index) = _socket_factory();
-	_acceptor.async_accept(*socket, [this, socket, thread_index](boost::system::error_code error)
+	_acceptor.async_accept(*socket, [this, socket, thread_index, accept_callback](boost::system::error_code error)
 	{
 		if (!error)
 		{
@@ -117,7 +144,7 @@ void AsyncAcceptor::AsyncAcceptWithCallback()
 			//return;
 		}
 
-		if (!_closed) this->AsyncAcceptWithCallback<accept_callback>();
+		if (!_closed) this->AsyncAcceptWithCallback(accept_callback);
 	});
 }
 
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+
+#include "FrameBuffer.h"
+#include "FrameCompressor.h"
+#include "SendPriority.h"
+
+namespace Adoter
+{
+
+/*
+ * 广播数据包
+ *
+ * 1.广播协议只序列化一次，所有接收者的发送队列引用同一个数据包，入队后数据包内容不再修改;
+ *
+ * 2.需要携带玩家ID时(游戏逻辑服务器发往中心服务器)，player_id是Meta的最后一个字段，复制已经序列化的包体后追加，不重新序列化协议;
+ *
+ * 3.每个数据包单独压缩，压缩结果对所有支持压缩的连接相同，只压缩一次;
+ *
+ * 4.创建时按协议类型设置发送优先级，入队时不再写入共用的数据包.
+ *
+ * 只在发起广播的线程内使用，数据包在首次获取时生成.
+ *
+ * */
+class BroadcastFrame
+{
+public:
+	BroadcastFrame(const pb::Message& message, int32_t type_t) : _message(message), _type_t(type_t)
+	{
+	}
+
+	BroadcastFrame(const BroadcastFrame&) = delete;
+	BroadcastFrame& operator = (const BroadcastFrame&) = delete;
+
+	int32_t GetType() const { return _type_t; }
+
+	//
+	//不携带玩家ID的数据包，所有接收者共用
+	//
+	const FramePtr& Get()
+	{
+		if (_built) return _frame;
+		_built = true;
+
+		_frame = FrameBuffer::BuildMeta(_message, _type_t);
+		if (_frame) _frame->SetPriority(SendPriorityPolicyInstance.GetPriority(_type_t));
+
+		return _frame;
+	}
+
+	//
+	//携带玩家ID的数据包，每个接收者一个
+	//
+	FramePtr Get(int64_t player_id)
+	{
+		if (player_id == 0) return Get();
+
+		const auto& frame = Get();
+		if (!frame) return frame;
+
+		auto patched = FrameBuffer::AppendPlayerID(frame, player_id);
+		if (patched) return patched;
+
+		return FrameBuffer::BuildMeta(_message, _type_t, player_id); //扩展数据包重新序列化
+	}
+
+	//
+	//压缩后的共用数据包，compressor为首个支持压缩的连接的压缩上下文
+	//
+	const FramePtr& GetCompressed(FrameCompressor& compressor)
+	{
+		if (_compressed) return _compressed;
+
+		_compressed = compressor.Compress(Get(), _type_t); //没有变小时为原数据包，可能已经入队
+
+		auto priority = SendPriorityPolicyInstance.GetPriority(_type_t);
+		if (_compressed && _compressed->GetPriority() != priority) _compressed->SetPriority(priority);
+
+		return _compressed;
+	}
+
+private:
+	const pb::Message& _message;
+	const int32_t _type_t = 0;
+	bool _built = false;
+	FramePtr _frame;
+	FramePtr _compressed;
+};
+
+}
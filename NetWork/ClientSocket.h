@@ -8,10 +8,17 @@
 #include <queue>
 #include <unordered_map>
 #include <sstream>
+#include <random>
+#include <chrono>
+#include <algorithm>
 
 #include <boost/asio.hpp>
 #include <spdlog/spdlog.h>
 
+#include "FrameCodec.h"
+#include "WriteQueue.h"
+#include "SendRing.h"
+#include "ShmTransport.h"
 #include "MXLog.h"
 
 namespace Adoter 
@@ -24,23 +31,68 @@ enum CONNECTION_STATUS {
 	CONNECTION_STATUS_CONNECTED = 3
 };
 
+/*
+ * 服务器之间的连接(发起端)
+ *
+ * 1.断开或者连接失败后按指数退避重连(随机抖动)，避免多个服务器同时重连;
+ *
+ * 2.连接健康状态：首次连接中、正常、降级(拥塞或者刚断开)、断开，状态变化时回调OnLinkStateChanged;
+ *
+ * 3.对端支持时，入队的数据包保留到对端确认，重连后按顺序重发，对端跳过已经处理的数据包(见LinkReplay);
+ *
+ * 4.主动关闭(DelayedClose)发送完积压数据后关闭，不再重连，期间断开也不再重连;
+ *
+ * 5.握手(扩展包头、批量、重发)默认关闭：未升级的对端无法识别握手数据包(丢弃同一次接收的数据或者停止接收)，所有服务器升级后开启.
+ *
+ * 配置项：FrameHandshake(默认关闭) ExtendedFrame MetaBatch LinkReplay(握手开启后生效)
+ *
+ * */
 class ClientSocket : public std::enable_shared_from_this<ClientSocket>
 {
 public:
 	ClientSocket(boost::asio::io_service& io_service, const boost::asio::ip::tcp::endpoint& endpoint) : 
-		_timer(io_service), _remote_endpoint(endpoint), _closed(false), _closing(false)
+		_timer(io_service), _remote_endpoint(endpoint), _closed(false), _closing(false), _batch_timer(io_service), 
+		_send_ring(ConfigInstance.GetInt("SendRingSize", SendRing::DEFAULT_CAPACITY))
 	{
 		_io_service = &io_service;
 		_ip_address = _remote_endpoint.address().to_string();
 		_port = _remote_endpoint.port();
+
+		_write_queue.SetBatchBytes(ConfigInstance.GetInt("SendBatchBytes", WriteQueue::DEFAULT_BATCH_BYTES)); //单次合并发送上限
+		_write_queue.SetLimits(QueueLimits::Load("ServerLink", QueueLimits::ServerLink())); //发送队列水位，此类连接均为服务器之间的连接
+
+		uint32_t capabilities = 0; //连接成功后发起握手，为0时不发送握手数据包(原有格式)
+		if (ConfigInstance.GetBool("FrameHandshake", false))
+		{
+			if (ConfigInstance.GetBool("ExtendedFrame", true)) capabilities |= FRAME_CAPABILITY_EXTENDED;
+			if (ConfigInstance.GetBool("MetaBatch", true)) capabilities |= FRAME_CAPABILITY_BATCH;
+			if (ConfigInstance.GetBool("LinkReplay", true)) capabilities |= FRAME_CAPABILITY_REPLAY;
+		}
+		_codec.SetLocalCapabilities(capabilities);
+
+		_batcher.SetBatchBytes(ConfigInstance.GetInt("BatchBytes", FrameBatcher::DEFAULT_BATCH_BYTES));
+		_batcher.SetBatchDelay(ConfigInstance.GetInt("BatchDelay", FrameBatcher::DEFAULT_BATCH_DELAY));
+		_codec.SetHandshakeHandler(std::bind(&ClientSocket::OnHandshake, this, std::placeholders::_1));
+		_codec.SetAckHandler(std::bind(&ClientSocket::OnAck, this, std::placeholders::_1));
+
+		_replay.SetMaxBytes(ConfigInstance.GetInt("ReplayBytes", ReplayBuffer::DEFAULT_MAX_BYTES)); //重发缓存上限
+		_reconnect_delay_min = std::max(ConfigInstance.GetInt("ReconnectDelayMin", 200), 1); //重连间隔(毫秒)
+		_reconnect_delay_max = std::max<int64_t>(ConfigInstance.GetInt("ReconnectDelayMax", 10000), _reconnect_delay_min);
+		_link_down_after = ConfigInstance.GetInt("LinkDownAfter", 5000); //断开超过此时长(毫秒)视为断开，期间发送的数据包重连后重发
+
+		std::random_device random_device;
+		_random.seed(random_device());
+		_link_id = (uint64_t(_random()) << 32) | _random(); //连接标识，对端按此识别重连
 	}
 	
 	virtual bool Update() 
 	{
+		UpdateLinkState();
+
 		if (_closed) return false;
 		std::lock_guard<std::mutex> lock(_send_lock);
 
-		if (_is_writing_async || (_write_queue.empty() && !_closing)) return true; //发送可以放到消息队列里面处理
+		if (_is_writing_async || (_write_queue.Empty() && !_closing)) return true; //发送可以放到消息队列里面处理
 
 		for (; HandleQueue(); ) {}
 
@@ -49,90 +101,531 @@ public:
 
     virtual void AsyncConnect()
     {
+		_closing = false; //主动关闭后可以重新发起连接
+		_disconnect_time = GetTickCount();
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+			_close_scheduled = false;
+		}
+
+		SetLinkState(LINK_STATE_CONNECTING);
+
+		Connect();
+    }
+
+	//
+	//发起一次连接，超时未成功则关闭，之后按退避间隔重连
+	//
+	void Connect()
+	{
+		uint64_t sequence = ++_connect_sequence; //之前连接的回调不再处理
+
+		_closed = false;
 		_conn_status = CONNECTION_STATUS_CONNECTING;
-		_socket.reset(new boost::asio::ip::tcp::socket(*_io_service));
-        _socket->async_connect(_remote_endpoint, std::bind(&ClientSocket::OnConnect, shared_from_this(), std::placeholders::_1));
+
+		std::shared_ptr<boost::asio::ip::tcp::socket> socket(new boost::asio::ip::tcp::socket(*_io_service));
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock); //发送线程在锁内读取套接字
+
+			_socket = socket;
+
+			if (_shm) _shm->Close();
+			_shm.reset();
+
+			if (ConfigInstance.GetBool("ShmTransport", false)) //本机服务器使用共享内存传输，失败时使用TCP
+			{
+				_shm = ShmStream::Connect(*_io_service, *_socket, _remote_endpoint, ConfigInstance.GetInt("ShmRingSize", ShmStream::DEFAULT_RING_SIZE));
+			}
+		}
+
+		auto self = shared_from_this();
+		socket->async_connect(_remote_endpoint, [self, sequence](const boost::system::error_code& error) {
+			if (sequence == self->_connect_sequence) self->OnConnect(error);
+		});
 
         if (_connect_timeout > 0) 
         {
             _timer.expires_from_now(boost::posix_time::seconds(_connect_timeout));
-            _timer.async_wait(std::bind(&ClientSocket::OnConnectTimeOut, shared_from_this(), std::placeholders::_1));
+            _timer.async_wait([self, sequence](const boost::system::error_code& error) {
+				if (sequence == self->_connect_sequence) self->OnConnectTimeOut(error);
+			});
         }
-    }
+	}
     
 	virtual void OnConnectTimeOut(const boost::system::error_code& error) 
     {
-		//DEBUG("超时检查...连接服务器:{}，端口:{} 状态:{}", _ip_address, _port, _conn_status);
-
         if (error == boost::asio::error::operation_aborted) return;
 		if (error) ERROR("服务器内部连接超时失败，必须处理解决，错误码:{}", error.message());
+
+		if (CONNECTION_STATUS_CONNECTING != _conn_status) return;
             
-        if (_connect_timeout > 0) 
-        {
-			_timer.expires_from_now(boost::posix_time::seconds(_connect_timeout));
-			_timer.async_wait(std::bind(&ClientSocket::OnConnectTimeOut, shared_from_this(), std::placeholders::_1));
-		}
+		Close("连接超时");
+    }
 
-		if (CONNECTION_STATUS_CONNECTED != _conn_status) 
-		{
-			WARN("网络正在连接...连接服务器:{}，端口:{} 状态:{}", _ip_address, _port, _conn_status);
+	//
+	//断开后重连：间隔从ReconnectDelayMin开始每次翻倍，不超过ReconnectDelayMax，取其中随机值
+	//
+	void ScheduleReconnect()
+	{
+		int64_t delay = _reconnect_delay_min;
+		for (int32_t i = 0; i < _reconnect_attempts && delay < _reconnect_delay_max; ++i) delay *= 2;
+		delay = std::min(delay, _reconnect_delay_max);
 
-			_conn_status = CONNECTION_STATUS_CONNECTING;
-			_socket.reset(new boost::asio::ip::tcp::socket(*_io_service));
-			_socket->async_connect(_remote_endpoint, std::bind(&ClientSocket::OnConnect, shared_from_this(), std::placeholders::_1));
-		}
-    }
+		std::uniform_int_distribution<int64_t> distribution(delay / 2, delay);
+		delay = distribution(_random);
+
+		++_reconnect_attempts;
+
+		WARN("网络正在连接...连接服务器:{}，端口:{} 第{}次重连，等待(毫秒):{} 待重发数据包:{}", _ip_address, _port, _reconnect_attempts, delay, _replay.Size());
+
+		auto self = shared_from_this();
+		uint64_t sequence = _connect_sequence;
+
+		_timer.expires_from_now(boost::posix_time::milliseconds(delay));
+		_timer.async_wait([self, sequence](const boost::system::error_code& error) {
+			if (error == boost::asio::error::operation_aborted || sequence != self->_connect_sequence) return;
+			self->Connect();
+		});
+	}
     
+	//
+	//连接断开：重连期间数据包继续缓存
+	//
     void Close(const std::string& reason)
     {
+		if (_closing) //主动关闭过程中断开，不再重连
+		{
+			Shutdown(reason);
+			return;
+		}
+
 		if (_closed.exchange(true)) return;
 
 		boost::system::error_code error;
-		_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-		_socket->close(error);
-		_socket.reset();
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock); //发送线程在锁内读取套接字
+
+			if (_socket)
+			{
+				_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+				_socket->close(error);
+				_socket.reset();
+			}
+
+			if (_shm) _shm->Close();
+		}
 
 		ERROR("服务器关闭网络连接，错误码:{} 原因:{}", error.message(), reason);
 
+		if (CONNECTION_STATUS_CONNECTED == _conn_status) 
+		{
+			_disconnect_time = GetTickCount();
+			SetLinkState(LINK_STATE_DEGRADED); //重连期间数据包继续缓存
+		}
+
 		OnClose();
+		ScheduleReconnect();
     }
 
+	//
+	//主动关闭：取消等待中的重连，之后不再重连，网络线程调用
+	//
+	void Shutdown(const std::string& reason)
+	{
+		_closing = true;
+		++_connect_sequence; //之前连接及重连的回调不再处理
+
+		boost::system::error_code error;
+		_timer.cancel(error);
+
+		SetLinkState(LINK_STATE_DOWN);
+
+		if (_closed.exchange(true)) return; //已经断开，正在等待重连
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock); //发送线程在锁内读取套接字
+
+			if (_socket)
+			{
+				_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+				_socket->close(error);
+				_socket.reset();
+			}
+
+			if (_shm) _shm->Close();
+		}
+
+		LOG(INFO, "服务器主动关闭网络连接，服务器:{} 端口:{} 原因:{}", _ip_address, _port, reason);
+
+		OnClose();
+	}
+
+	//
+	//连接健康状态，由逻辑线程定期调用
+	//
+	void UpdateLinkState()
+	{
+		if (CONNECTION_STATUS_CONNECTED == _conn_status && !_closed)
+		{
+			bool congested = false;
+
+			{
+				std::lock_guard<std::mutex> lock(_send_lock);
+				congested = _write_queue.IsCongested();
+			}
+
+			SetLinkState(congested ? LINK_STATE_DEGRADED : LINK_STATE_UP);
+		}
+		else if (LINK_STATE_DOWN != _link_state && GetTickCount() - _disconnect_time >= _link_down_after)
+		{
+			SetLinkState(LINK_STATE_DOWN);
+		}
+	}
+
+	void SetLinkState(LINK_STATE state)
+	{
+		LINK_STATE prev_state = _link_state.exchange(state);
+		if (prev_state == state) return;
+
+		LOG(INFO, "服务器:{} 端口:{} 连接状态变化:{}->{}", _ip_address, _port, prev_state, state);
+
+		OnLinkStateChanged(prev_state, state);
+	}
+
+	LINK_STATE GetLinkState() const { return _link_state; }
+
+	//是否发起握手(FrameHandshake)，对端据此判断本端已经升级
+	bool IsHandshakeEnabled() const { return _codec.GetLocalCapabilities() != 0; }
+
+	//
+	//连接正常或者断开后正在重连(重连后重发)，此时发送的数据包不会丢失
+	//
+	bool IsLinkAvailable() { return IsConnected() || (_replay_enabled && LINK_STATE_DEGRADED == _link_state); }
+
+	//连接健康状态变化，在发送锁之外调用
+	virtual void OnLinkStateChanged(LINK_STATE prev_state, LINK_STATE state) { }
+
     void AsynyReadSome()
     {
-        _socket->async_read_some(boost::asio::buffer(_buffer), std::bind(&ClientSocket::OnReadSome, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+		std::shared_ptr<boost::asio::ip::tcp::socket> socket;
+		std::shared_ptr<ShmStream> shm;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock); //关闭和重连在锁内替换套接字
+			socket = _socket;
+			shm = _shm;
+		}
+
+		if (shm)
+		{
+			shm->AsyncReadSome(_codec.PrepareBuffer(), std::bind(&ClientSocket::OnReadSome, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+			return;
+		}
+
+		if (!socket) return; //已经断开，重连后重新接收
+
+        socket->async_read_some(_codec.PrepareBuffer(), std::bind(&ClientSocket::OnReadSome, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
     }
 
+	//
+	//发送锁之外使用套接字时在锁内复制，关闭和重连在锁内释放或者替换套接字
+	//
+	std::shared_ptr<boost::asio::ip::tcp::socket> GetSocket()
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+		return _socket;
+	}
+
+	//
+	//已经序列化好的数据，复制一次到数据包缓存
+	//
 	void EnterQueue(std::string&& meta)
+	{
+		auto frame = FrameBuffer::Create(meta.data(), meta.size());
+		if (!frame) 
+		{
+			LOG(ERROR, "协议已经超过最大限制，包长:{}", meta.size());
+			return;
+		}
+
+		EnterQueue(std::move(frame));
+	}
+
+	//
+	//数据包直接入队，不再复制
+	//
+	//tag：非关键数据包的合并标识(一般为协议类型)，发送队列拥塞时可以丢弃或者合并，0表示必须发送
+	//
+	//逻辑线程调用：写入发送环形队列(不加发送锁)，由网络线程转入发送队列
+	//
+	//环形队列已满说明网络线程积压：可以丢弃的数据包按拥塞丢弃，必须发送的数据包写入溢出队列
+	//
+	void EnterQueue(FramePtr frame, uint32_t tag = 0)
+	{
+		if (!frame) return;
+
+		if (!_send_ring.Push(frame, tag))
+		{
+			if (tag != 0)
+			{
+				_write_queue.RecordDropped();
+				OnBackpressure(ENQUEUE_RESULT_DROPPED);
+				return;
+			}
+
+			_send_ring.Spill(frame, tag);
+		}
+
+		if (_send_ring.MarkPending()) _io_service->post(std::bind(&ClientSocket::OnSendRing, shared_from_this()));
+	}
+
+	//
+	//网络线程：发送环形队列中的数据包转入发送队列，断开期间同样转入(重连后发送)
+	//
+	void OnSendRing()
+	{
+		_send_ring.ClearPending(); //之后写入的数据包重新投递
+
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+			result = TransferSendRing();
+		}
+
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
+
+	//发送锁内调用，返回最严重的入队结果
+	ENQUEUE_RESULT TransferSendRing()
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+		_send_ring.Drain([this, &result](const FramePtr& frame, uint32_t tag) {
+			result = std::max(result, PushChecked(frame, tag));
+		});
+
+		return result;
+	}
+
+	//发送锁内调用：对端不支持扩展包头时丢弃超过64K的数据包
+	ENQUEUE_RESULT PushChecked(const FramePtr& frame, uint32_t tag)
+	{
+		if (frame->IsExtended() && !(_capabilities & FRAME_CAPABILITY_EXTENDED))
+		{
+			LOG(ERROR, "协议已经超过最大限制，对端不支持扩展包头，包长:{}", frame->BodySize());
+			return ENQUEUE_RESULT_SUCCESS;
+		}
+
+		return PushFrame(frame, tag);
+	}
+
+	//
+	//开启批量发送，握手协商后生效
+	//
+	void EnableBatch(bool enabled = true)
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+
+			_batcher.SetEnabled(enabled);
+			if (!enabled) result = FlushBatch();
+		}
+
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
+
+	void ReportBatchStatistics(const std::string& link) { _batcher.Report(link); }
+
+	//
+	//发送队列拥塞处理，在发送锁之外调用
+	//
+	//默认：丢弃和合并只做统计，超过上限断开连接(之后由连接超时检查重连)
+	//
+	virtual void OnBackpressure(ENQUEUE_RESULT result)
+	{
+		if (ENQUEUE_RESULT_OVERFLOW != result) return;
+
+		auto status = GetQueueStatus();
+		ERROR("服务器:{} 端口:{} 发送队列超过上限，待发送数据包:{} 字节数:{} 丢弃:{}", _ip_address, _port, status.messages, status.bytes, status.dropped);
+
+		_io_service->post(std::bind(&ClientSocket::Close, shared_from_this(), std::string("发送队列超过上限")));
+	}
+
+	//
+	//按连接类型读取发送队列水位，未配置的使用当前值
+	//
+	void SetQueueLimits(const std::string& name)
 	{
 		std::lock_guard<std::mutex> lock(_send_lock);
+		_write_queue.SetLimits(QueueLimits::Load(name, _write_queue.GetLimits()));
+	}
+
+	QueueStatus GetQueueStatus()
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+		return _write_queue.GetStatus();
+	}
+
+	//
+	//收到服务器握手回复
+	//
+	void OnHandshake(uint32_t capabilities)
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+		_capabilities = capabilities;
 
-		auto content = std::move(meta);
-		//
-		//数据包头
-		//
-		unsigned short body_size = content.size();
-		if (body_size >= MAX_DATA_SIZE) 
+		if (!(capabilities & FRAME_CAPABILITY_REPLAY)) //对端不支持重发
 		{
-			LOG(ERROR, "协议已经超过最大限制，包长:{}", body_size);
+			_replay_enabled = false;
+			_replay.Clear();
 			return;
 		}
 
-		unsigned char header[2] = { 0 };
+		if (!_resume_sent) //首次协商，之后入队的数据包开始计数
+		{
+			_write_queue.Push(FrameBuffer::BuildResume(_link_id, _replay.GetNextSequence()));
+			_resume_sent = true;
+
+			ScheduleFlush();
+		}
+
+		_replay_enabled = true;
+	}
+
+	//
+	//对端确认已经处理的数据包，不再重发
+	//
+	void OnAck(uint64_t sequence)
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+		_replay.Acknowledge(sequence);
+	}
+
+	//
+	//发送锁内调用：已入队的数据包保留到对端确认
+	//
+	void RecordReplay(const FramePtr& frame)
+	{
+		if (!_replay_enabled) return;
+
+		int64_t dropped_count = _replay.GetDroppedCount();
+		_replay.Record(frame);
+
+		if (_replay.GetDroppedCount() > dropped_count && !_replay_dropping) 
+		{
+			_replay_dropping = true; //每次断开只输出一次
+			ERROR("服务器:{} 端口:{} 重发缓存超过上限:{}，丢弃最早的数据包", _ip_address, _port, _replay.Bytes());
+		}
+	}
+
+	//
+	//发送锁内调用：可以合并的数据包加入当前批次，其他数据包直接入队
+	//
+	ENQUEUE_RESULT PushFrame(const FramePtr& frame, uint32_t tag)
+	{
+		if (_replay_enabled) tag = 0; //重发按数据包计数，数据包不能丢弃或者合并
+
+		if ((_capabilities & FRAME_CAPABILITY_BATCH) && tag == 0 && _batcher.CanBatch(frame))
+		{
+			if (_batcher.Append(frame)) return FlushBatch(); //达到字节上限
+
+			ScheduleBatch();
+			return ENQUEUE_RESULT_SUCCESS;
+		}
+
+		ENQUEUE_RESULT result = FlushBatch(); //之前合并的数据包先入队，保证发送顺序
+		if (ENQUEUE_RESULT_OVERFLOW == result) return result;
+
+		_batcher.OnUnbatched();
+
+		result = _write_queue.Push(frame, tag);
+		if (ENQUEUE_RESULT_SUCCESS != result) return result;
+
+		RecordReplay(frame);
+		ScheduleFlush();
+
+		return result;
+	}
+
+	//当前批次入队
+	ENQUEUE_RESULT FlushBatch()
+	{
+		auto batch = _batcher.Take();
+		if (!batch) return ENQUEUE_RESULT_SUCCESS;
+
+		ENQUEUE_RESULT result = _write_queue.Push(batch);
+		if (ENQUEUE_RESULT_SUCCESS != result) return result;
+
+		RecordReplay(batch);
+		ScheduleFlush();
+
+		return result;
+	}
+
+	//等待时间到达后发送当前批次，同一时刻最多一个定时器
+	void ScheduleBatch()
+	{
+		if (_batch_scheduled) return;
+		_batch_scheduled = true;
+
+		_batch_timer.expires_from_now(boost::posix_time::microseconds(_batcher.GetBatchDelay()));
+		_batch_timer.async_wait(std::bind(&ClientSocket::OnBatchTimer, shared_from_this(), std::placeholders::_1));
+	}
+
+	void OnBatchTimer(const boost::system::error_code& error)
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+
+			_batch_scheduled = false;
+			result = FlushBatch(); //未连接时留在发送队列，连接成功后发送
+		}
+
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
 
-		header[0] = (body_size >> 8) & 0xff;
-		header[1] = body_size & 0xff;
+	//
+	//投递发送任务，同一时刻最多投递一次，期间入队的数据一起发送
+	//
+	void ScheduleFlush()
+	{
+		if (_flush_scheduled || _is_writing_async) return;
+		_flush_scheduled = true;
 
-		//
-		//包数据体
-		//
-		auto body = content.c_str(); 
+		_io_service->post(std::bind(&ClientSocket::FlushQueue, shared_from_this()));
+	}
 
-		//数据整理发送
-		char buffer[MAX_DATA_SIZE] = { 0 }; //发送数据缓存
-		for (int i = 0; i < 2; ++i) buffer[i] = header[i];
-		for (int i = 0; i < body_size; ++i) buffer[i + 2] = body[i];
+	//
+	//发送锁内发现发送队列已经发送完毕(关闭会在锁内释放套接字)，投递到网络线程执行
+	//
+	void ScheduleClose()
+	{
+		if (_close_scheduled) return;
+		_close_scheduled = true;
 
-		_write_queue.push(std::string(buffer, body_size + 2));
+		auto self = shared_from_this();
+
+		_io_service->post([self]() {
+			if (self->_closing) self->Shutdown("关闭"); //期间重新发起连接则不再关闭
+		});
+	}
+
+	void FlushQueue()
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+
+		_flush_scheduled = false;
+		if (!IsConnected() || _is_writing_async) return; //连接成功后继续发送
+
+		for (; HandleQueue(); ) {}
 	}
 	
 	void AsyncSendMessage(std::string meta)
@@ -151,10 +644,31 @@ public:
 		if (_is_writing_async) return false;
 		_is_writing_async = true;
 
-		_socket->async_write_some(boost::asio::null_buffers(), std::bind(&ClientSocket::OnWriteSome, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+		if (_shm) //共享内存队列有空间时继续发送
+		{
+			_shm->AsyncWaitWrite(std::bind(&ClientSocket::WriteHandlerWrapper, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+			return false;
+		}
+
+		_socket->async_write_some(boost::asio::null_buffers(), std::bind(&ClientSocket::WriteHandlerWrapper, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
 		return false;
 	}
 
+	void WriteHandlerWrapper(const boost::system::error_code& error, std::size_t bytes_transferred)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+
+			_is_writing_async = false;
+			if (!error) for (; HandleQueue(); ) {} //可写时继续发送
+		}
+
+		OnWriteSome(error, bytes_transferred);
+	}
+
+	//
+	//合并队列中的数据包进行发送，返回true表示需要继续发送
+	//
 	bool HandleQueue()
 	{
 		if (!IsConnected()) 
@@ -162,49 +676,60 @@ public:
 			ERROR("网络已断开连接.");
 			return false;
 		}
-		if (_write_queue.empty()) return false;
 
-		std::string& meta = _write_queue.front();  //其实是META数据
+		if (_write_queue.Empty()) 
+		{
+			if (_closing) ScheduleClose();
+			return false;
+		}
 
-		std::size_t bytes_to_send = meta.size();
+		const auto& buffers = _write_queue.Gather(); 
+		std::size_t bytes_to_send = _write_queue.GatheredBytes();
 
 		boost::system::error_code error;
-		std::size_t bytes_sent = _socket->write_some(boost::asio::buffer(meta.c_str(), bytes_to_send), error);
+		std::size_t bytes_sent = _shm ? _shm->WriteSome(buffers, error) : _socket->write_some(buffers, error);
 
 		if (error == boost::asio::error::would_block || error == boost::asio::error::try_again)
 		{
-			ERROR("待发送数据长度:{} 实际发送数据长度:{}", bytes_to_send, bytes_sent);
-			return AsyncProcessQueue();
-
-			_write_queue.pop();
-			if (_closing && _write_queue.empty()) Close("关闭");
-
-			return false;
+			return AsyncProcessQueue(); //发送缓冲区已满，可写时继续发送
 		}
 		else if (bytes_sent == 0)
 		{
 			ERROR("待发送数据长度:{} 实际发送数据长度:{} 错误码:{}", bytes_to_send, bytes_sent, error.message());
 
-			_write_queue.pop();
-			if (_closing && _write_queue.empty()) Close("关闭");
+			_write_queue.PopFront();
+			if (_closing && _write_queue.Empty()) ScheduleClose();
 
 			return false;
 		}
-		else if (bytes_sent < bytes_to_send) //一般不会出现这个情况，重新发送，记个ERROR
-		{
-			ERROR("待发送数据长度:{} 实际发送数据长度:{}", bytes_to_send, bytes_sent);
-			return AsyncProcessQueue();
-		}
 
-		//DEBUG("待发送数据长度:{} 实际发送数据长度:{} 错误码:{}", bytes_to_send, bytes_sent, error.message());
-		_write_queue.pop();
+		auto messages = _write_queue.Consume(bytes_sent);
+		_write_queue.OnFlushed(bytes_sent, messages);
+
+		_send_time = GetTickCount();
 
-		if (_closing && _write_queue.empty()) Close("关闭");
-		return !_write_queue.empty();
+		if (bytes_sent < bytes_to_send) return AsyncProcessQueue(); //部分发送，剩余数据等待可写时继续发送
+
+		if (_closing && _write_queue.Empty()) ScheduleClose();
+
+		return !_write_queue.Empty();
 	}
 
-	virtual void DelayedClose() { _closing = true; } //发送队列为空时再进行关闭
-	virtual bool IsConnected() { return _socket && _socket->is_open(); }
+	const FlushStatistics& GetFlushStatistics() const { return _write_queue.GetStatistics(); }
+
+	int64_t GetSendIdleTime() const { return GetTickCount() - _send_time; } //距离最近一次发送的时长(毫秒)，链路空闲时才需要心跳
+
+	virtual void DelayedClose() //发送队列为空时再进行关闭
+	{ 
+		_closing = true; 
+
+		std::lock_guard<std::mutex> lock(_send_lock);
+		TransferSendRing();
+
+		if (!IsConnected() || _write_queue.Empty()) ScheduleClose(); //未连接时积压数据不再发送
+		else ScheduleFlush();
+	}
+	virtual bool IsConnected() { return CONNECTION_STATUS_CONNECTED == _conn_status && _socket && _socket->is_open(); } //连接中的套接字不发送，连接成功后握手数据包最先发送
 	virtual bool IsOpen() const { return !_closed && !_closing; }
 	virtual bool IsClosed() const { return _closed || _closing; }
 
@@ -212,8 +737,42 @@ public:
 		_conn_status = CONNECTION_STATUS_NIL;
 	}
     virtual void OnConnected() { 
-		_closed = _closing = false;
-		_conn_status = CONNECTION_STATUS_CONNECTED;
+		_closed = false; //主动关闭的标记保留，发送完毕后关闭
+		_codec.Reset(); //丢弃上次连接残留的半包
+		_reconnect_attempts = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+
+			_capabilities = 0;
+			_replay_dropping = false;
+
+			if (_replay_enabled) //上次连接协商了重发：从最早未确认的数据包开始按顺序重发，发送队列中的数据包均在其中
+			{
+				_write_queue.Clear();
+				_write_queue.Push(FrameBuffer::BuildHandshake(_codec.GetLocalCapabilities()));
+				_write_queue.Push(FrameBuffer::BuildResume(_link_id, _replay.GetFirstSequence()));
+
+				for (const auto& entry : _replay.GetFrames()) _write_queue.Push(entry.second);
+
+				_resume_sent = true;
+
+				LOG(INFO, "服务器:{} 端口:{} 重连成功，重发数据包:{} 字节数:{}", _ip_address, _port, _replay.Size(), _replay.Bytes());
+			}
+			else
+			{
+				_resume_sent = false;
+
+				if (_write_queue.IsOverflow()) _write_queue.Clear(); //超过上限断开的连接，丢弃积压数据
+
+				if (_codec.GetLocalCapabilities()) _write_queue.PushFront(FrameBuffer::BuildHandshake(_codec.GetLocalCapabilities())); //握手数据包最先发送
+			}
+
+			_conn_status = CONNECTION_STATUS_CONNECTED; //发送队列准备好之后再允许发送
+			ScheduleFlush();
+		}
+
+		SetLinkState(LINK_STATE_UP);
 	}
 
     virtual void OnReadSome(const boost::system::error_code& error, std::size_t bytes_transferred) { }
@@ -234,12 +793,12 @@ protected:
     volatile int64_t _last_rw_ticks = 0;
     int64_t _connect_timeout = 5;
 	
-	//接收缓存
-	std::array<unsigned char, MAX_DATA_SIZE> _buffer;
+	//接收缓存，处理粘包和半包
+	FrameCodec _codec;
     
 	virtual void OnConnect(const boost::system::error_code& error)
     {
-		DEBUG("网络连接中，当前状态:{}，错误信息:{}...", _conn_status, error.message());
+		DEBUG("网络连接中，当前状态:{}，错误信息:{}...", _conn_status.load(), error.message());
 
 		if (_conn_status != CONNECTION_STATUS_CONNECTING) return;
 
@@ -249,8 +808,11 @@ protected:
             return;
         }
 
+        auto socket = GetSocket();
+        if (!socket) return; //期间已经关闭
+
         boost::system::error_code ec;
-        _socket->set_option(boost::asio::ip::tcp::no_delay(true), ec);
+        socket->set_option(boost::asio::ip::tcp::no_delay(true), ec);
 
         if (ec)
         {
@@ -258,7 +820,7 @@ protected:
             return;
         }
 
-        _local_endpoint = _socket->local_endpoint(ec);
+        _local_endpoint = socket->local_endpoint(ec);
 
         if (ec)
         {
@@ -266,20 +828,69 @@ protected:
             return;
         }
 
+		_timer.cancel(ec); //连接超时检查
+
 		OnConnected(); //连接成功
 
+		if (_shm) WatchStream();
+
         StartReceive(); //开始接收数据
         StartSend(); //开始发送数据
     }
     
 	virtual bool StartSend() { return true; }
 	virtual bool StartReceive() { return true; }
+
+	//
+	//共享内存传输时TCP连接不再收发数据，可读即为对端断开
+	//
+	void WatchStream()
+	{
+		auto socket = GetSocket();
+		if (!socket) return;
+
+		auto self = shared_from_this();
+		uint64_t sequence = _connect_sequence;
+
+		socket->async_wait(boost::asio::socket_base::wait_read, [self, sequence](const boost::system::error_code& error) {
+			if (error == boost::asio::error::operation_aborted || sequence != self->_connect_sequence) return;
+			self->Close("对端断开共享内存连接");
+		});
+	}
 private:
 	std::atomic<bool> _closed;    
 	std::atomic<bool> _closing;
 	bool _is_writing_async = false;
-	std::queue<std::string> _write_queue;
-	CONNECTION_STATUS _conn_status = CONNECTION_STATUS_NIL;
+	bool _flush_scheduled = false; //已经投递发送任务
+	bool _close_scheduled = false; //已经投递关闭任务
+	FrameBatcher _batcher; //批量发送
+	boost::asio::deadline_timer _batch_timer;
+	bool _batch_scheduled = false;
+	uint32_t _capabilities = 0; //握手协商结果，决定发送格式
+	WriteQueue _write_queue;
+	SendRing _send_ring; //逻辑线程写入，网络线程转入发送队列
+	std::shared_ptr<ShmStream> _shm; //本机服务器之间的共享内存传输，为空时使用TCP
+	std::atomic<CONNECTION_STATUS> _conn_status{CONNECTION_STATUS_NIL}; //发送线程读取
+
+	//断线重连
+	std::atomic<LINK_STATE> _link_state{LINK_STATE_CONNECTING};
+	std::atomic<int64_t> _disconnect_time{0}; //断开时间(毫秒)
+	std::atomic<int64_t> _send_time{0}; //最近一次发送时间(毫秒)
+	std::atomic<uint64_t> _connect_sequence{0}; //连接序号
+	int32_t _reconnect_attempts = 0; //连续重连次数
+	int64_t _reconnect_delay_min = 200;
+	int64_t _reconnect_delay_max = 10000;
+	int64_t _link_down_after = 5000;
+	std::mt19937 _random;
+
+	//断线重发
+	ReplayBuffer _replay;
+	uint64_t _link_id = 0;
+	std::atomic<bool> _replay_enabled{false}; //对端支持重发
+	bool _resume_sent = false; //本次连接已经发送续传数据包
+	bool _replay_dropping = false;
+
+	static int64_t GetTickCount() { return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
 };	
 
 }
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "FrameBuffer.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 服务器之间数据包批量发送
+ *
+ * 1.逻辑服务器和中心服务器之间一条连接承载所有玩家的数据包，小数据包先合并，达到字节上限或者等待时间后作为一个数据包发送;
+ *
+ * 2.批量包体格式同MetaBatch{ repeated bytes metas = 1; }的序列化结果：依次为 0x0A + 长度(varint) + 原包体;
+ *
+ * 3.批量数据包使用扩展包头，包长次高位为批量标识，仅发送给握手时声明支持批量的对端;
+ *
+ * 4.接收端按顺序解开后逐个处理(见FrameCodec)，上层收到的仍是单个数据包.
+ *
+ * */
+
+//批量发送统计
+struct BatchStatistics
+{
+	std::atomic<int64_t> message_count; //发送的数据包数量(合并前)
+	std::atomic<int64_t> frame_count; //实际入队的数据包数量(合并后)
+
+	BatchStatistics() : message_count(0), frame_count(0) { }
+};
+
+class FrameBatcher
+{
+public:
+	static const uint8_t BATCH_ENTRY_TAG = 0x0A; //字段1，长度分隔
+	static const std::size_t DEFAULT_BATCH_BYTES = 16384; //单个批量数据包字节上限
+	static const int32_t DEFAULT_BATCH_DELAY = 1000; //最长等待时间(微秒)
+
+	void SetEnabled(bool enabled) { _enabled = enabled; }
+	bool IsEnabled() const { return _enabled; }
+
+	//批量数据包不超过普通包头上限
+	void SetBatchBytes(std::size_t batch_bytes) 
+	{ 
+		if (batch_bytes == 0) batch_bytes = DEFAULT_BATCH_BYTES;
+		_batch_bytes = std::min(batch_bytes, FrameBuffer::MAX_FRAME_BODY_SIZE / 2); 
+	}
+	std::size_t GetBatchBytes() const { return _batch_bytes; }
+
+	void SetBatchDelay(int32_t delay) { _batch_delay = delay > 0 ? delay : DEFAULT_BATCH_DELAY; }
+	int32_t GetBatchDelay() const { return _batch_delay; }
+
+	//只合并较小的普通数据包
+	bool CanBatch(const FramePtr& frame) const
+	{
+		return _enabled && !frame->Next() && !frame->GetFlags() && frame->BodySize() < _batch_bytes;
+	}
+
+	//
+	//加入当前批次，返回是否达到字节上限
+	//
+	bool Append(const FramePtr& frame)
+	{
+		if (_message_count == 0) _first = frame; //只有一个数据包时原样发送
+		if (_message_count == 0) _priority = frame->GetPriority();
+
+		_statistics.message_count += 1;
+
+		std::size_t body_size = frame->BodySize();
+		const uint8_t* body = frame->Data() + frame->HeaderSize();
+
+		uint8_t length[5];
+		uint8_t* length_end = pb::io::CodedOutputStream::WriteVarint32ToArray(body_size, length);
+
+		_buffer.push_back(uint8_t(BATCH_ENTRY_TAG));
+		_buffer.insert(_buffer.end(), length, length_end);
+		_buffer.insert(_buffer.end(), body, body + body_size);
+
+		++_message_count;
+		return _buffer.size() >= _batch_bytes;
+	}
+
+	bool Empty() const { return _message_count == 0; }
+	SEND_PRIORITY GetPriority() const { return _priority; } //第一个数据包的发送优先级
+
+	//
+	//取出当前批次
+	//
+	FramePtr Take()
+	{
+		if (_message_count == 0) return nullptr;
+
+		FramePtr frame = _message_count == 1 ? _first : FrameBuffer::CreateWithFlags(_buffer.data(), _buffer.size(), FrameBuffer::BATCHED_FLAG);
+		if (frame && _message_count > 1) frame->SetPriority(_priority);
+
+		_statistics.frame_count += 1;
+
+		Clear();
+		return frame;
+	}
+
+	void Clear()
+	{
+		_buffer.clear();
+		_first.reset();
+		_message_count = 0;
+	}
+
+	//未合并直接入队的数据包
+	void OnUnbatched()
+	{
+		_statistics.message_count += 1;
+		_statistics.frame_count += 1;
+	}
+
+	const BatchStatistics& GetStatistics() const { return _statistics; }
+
+	//
+	//输出距上次输出以来的发送速率，由同一个线程定期调用
+	//
+	void Report(const std::string& link)
+	{
+		auto curr_time = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(curr_time - _report_time).count();
+		if (seconds <= 0) return;
+
+		int64_t messages = _statistics.message_count - _report_messages;
+		int64_t frames = _statistics.frame_count - _report_frames;
+
+		LOG(INFO, "连接:{} 发送速率，每秒数据包:{} 每秒实际发送数据包:{} 平均合并数量:{}", link, int64_t(messages / seconds), 
+				int64_t(frames / seconds), frames ? double(messages) / frames : 0);
+
+		_report_time = curr_time;
+		_report_messages += messages;
+		_report_frames += frames;
+	}
+
+private:
+	bool _enabled = false;
+	std::size_t _batch_bytes = DEFAULT_BATCH_BYTES;
+	int32_t _batch_delay = DEFAULT_BATCH_DELAY;
+	std::vector<uint8_t> _buffer; //当前批次包体
+	FramePtr _first;
+	SEND_PRIORITY _priority = SEND_PRIORITY_NORMAL;
+	std::size_t _message_count = 0;
+	BatchStatistics _statistics;
+	std::chrono::steady_clock::time_point _report_time = std::chrono::steady_clock::now();
+	int64_t _report_messages = 0;
+	int64_t _report_frames = 0;
+};
+
+}
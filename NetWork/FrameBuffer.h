@@ -0,0 +1,662 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <boost/intrusive_ptr.hpp>
+
+#include <google/protobuf/message.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#if GOOGLE_PROTOBUF_VERSION < 3007000
+#include <google/protobuf/wire_format_lite_inl.h> //低版本ToArray系列函数在此定义
+#endif
+
+namespace Adoter
+{
+
+namespace pb = google::protobuf;
+
+/*
+ * 发送数据包缓存
+ *
+ * 1.数据包缓存从内存池中获取，发送完成后归还，发送时不再分配内存;
+ *
+ * 2.数据包头预留在缓存头部，协议直接序列化到包头之后，不经过中间字符串;
+ *
+ * 3.引用计数，同一个数据包可以同时放入多个连接的发送队列.
+ *
+ * 数据包头格式：
+ *
+ * 1.普通包头：2字节包长(网络字节序)，包体不超过0xFFFE;
+ *
+ * 2.扩展包头：0xFFFF + 4字节包长(网络字节序)，仅发送给握手时声明支持的对端，包体分成多个固定大小的分块依次发送;
+ *
+ * 3.压缩数据包：扩展包头，包长最高位为压缩标识，仅发送给握手时声明支持压缩的对端(见FrameCompressor);
+ *
+ * 4.批量数据包：扩展包头，包长次高位为批量标识，仅发送给握手时声明支持批量的对端(见FrameBatcher).
+ *
+ * */
+
+//连接能力，握手时双方取交集
+enum FRAME_CAPABILITY
+{
+	FRAME_CAPABILITY_EXTENDED = 1 << 0, //扩展包头(超过64K的数据包)
+	FRAME_CAPABILITY_COMPRESS = 1 << 1, //压缩数据包
+	FRAME_CAPABILITY_BATCH = 1 << 2, //批量数据包
+	FRAME_CAPABILITY_REPLAY = 1 << 3, //断线重发(见LinkReplay)
+	FRAME_CAPABILITY_RESUME = 1 << 4, //玩家连接断线续传(见SessionResume)
+};
+
+//发送优先级，按协议类型配置(见SendPriorityPolicy)
+enum SEND_PRIORITY
+{
+	SEND_PRIORITY_REALTIME = 0, //对局实时数据包及控制数据包
+	SEND_PRIORITY_NORMAL = 1,
+	SEND_PRIORITY_BULK = 2, //战绩、回放、全服广播等
+	SEND_PRIORITY_COUNT = 3,
+};
+
+//玩家连接续传标识(共128位)：查找标识 + 密钥，均由系统安全随机数生成(见SessionResume)，全0表示拒绝续传
+struct ResumeToken
+{
+	uint64_t id = 0;
+	uint64_t secret = 0;
+};
+
+class FrameBuffer;
+typedef boost::intrusive_ptr<FrameBuffer> FramePtr;
+
+void intrusive_ptr_add_ref(FrameBuffer* frame);
+void intrusive_ptr_release(FrameBuffer* frame);
+
+class FrameBuffer
+{
+public:
+	static const std::size_t FRAME_HEADER_SIZE = 2; //普通包头长度
+	static const std::size_t EXTENDED_HEADER_SIZE = 6; //扩展包头长度
+	static const std::size_t EXTENDED_HEADER_MARK = 0xFFFF; //扩展包头标识
+	static const std::size_t MAX_FRAME_BODY_SIZE = 0xFFFE; //普通包头最大包体长度
+	static const std::size_t MAX_EXTENDED_BODY_SIZE = 16 * 1024 * 1024; //扩展包头最大包体长度
+	static const std::size_t CHUNK_SIZE = 16384; //扩展数据包分块大小
+	static const uint32_t COMPRESSED_FLAG = 0x80000000; //扩展包头中的压缩标识
+	static const uint32_t BATCHED_FLAG = 0x40000000; //扩展包头中的批量标识
+	static const uint32_t FLAGS_MASK = COMPRESSED_FLAG | BATCHED_FLAG;
+	static const std::size_t COMPRESS_HEADER_SIZE = 4; //压缩包体头部：原始包体长度
+
+	//控制数据包：0x07(字段序号为0，任何协议都无法解析) + "MX" + 类型 + 内容
+	//
+	//握手：4字节能力；续传：8字节连接标识 + 8字节下一个数据包序号(玩家连接另加8字节续传密钥)；确认：8字节已处理序号
+	static const uint8_t CONTROL_FRAME_MARK = 0x07;
+	static const uint8_t CONTROL_FRAME_VERSION = 1; //握手
+	static const uint8_t CONTROL_FRAME_RESUME = 2; //续传
+	static const uint8_t CONTROL_FRAME_ACK = 3; //确认
+	static const std::size_t CONTROL_FRAME_SIZE = 8;
+	static const std::size_t RESUME_FRAME_SIZE = 20;
+	static const std::size_t SESSION_RESUME_FRAME_SIZE = 28;
+	static const std::size_t ACK_FRAME_SIZE = 12;
+
+	explicit FrameBuffer(std::size_t capacity) : _ref_count(0), _capacity(capacity)
+	{
+		_data = new uint8_t[capacity];
+	}
+
+	~FrameBuffer() { delete[] _data; }
+
+	FrameBuffer(const FrameBuffer&) = delete;
+	FrameBuffer& operator = (const FrameBuffer&) = delete;
+
+	//当前分块待发送的数据(包头+包体)
+	const uint8_t* Data() const { return _data + _offset; }
+	std::size_t Size() const { return _size; }
+	std::size_t Capacity() const { return _capacity; }
+
+	uint8_t* Body() { return _data + EXTENDED_HEADER_SIZE; }
+	std::size_t BodySize() const { return _body_size; } //整个数据包的包体长度，包括后续分块
+
+	bool IsExtended() const { return _body_size > MAX_FRAME_BODY_SIZE; }
+	uint32_t GetFlags() const { return _flags; }
+	bool IsCompressed() const { return _flags & COMPRESSED_FLAG; }
+	bool IsBatched() const { return _flags & BATCHED_FLAG; }
+	std::size_t HeaderSize() const { return _offset == 0 ? EXTENDED_HEADER_SIZE : FRAME_HEADER_SIZE; } //第一个分块中的包头长度
+	const FramePtr& Next() const { return _next; } //后续分块
+
+	SEND_PRIORITY GetPriority() const { return SEND_PRIORITY(_priority); }
+	void SetPriority(SEND_PRIORITY priority) { _priority = priority; } //放入发送队列之前设置
+
+	//
+	//创建数据包：包体大小为body_size，包体内容由调用者写入
+	//
+	//超过普通包头限制的数据包只分配第一个分块，后续分块在写入时分配
+	//
+	static FramePtr Create(std::size_t body_size);
+
+	//
+	//已经序列化好的数据作为包体
+	//
+	static FramePtr Create(const void* body, std::size_t body_size)
+	{
+		auto frame = Create(body_size);
+		if (!frame) return frame;
+
+		if (!frame->IsExtended())
+		{
+			memcpy(frame->Body(), body, body_size);
+		}
+		else
+		{
+			ChunkOutputStream stream(frame.get());
+			CodedOutputStream output(&stream);
+			output.WriteRaw(body, body_size);
+		}
+		return frame;
+	}
+
+	//
+	//不带包头的数据(原有格式)，发给未握手的旧版本对端，由对端按每次接收的数据整体解析
+	//
+	static FramePtr CreateUnframed(const void* body, std::size_t body_size)
+	{
+		if (body_size > MAX_FRAME_BODY_SIZE) return nullptr;
+
+		auto frame = Create(body, body_size);
+		if (!frame) return frame;
+
+		frame->_offset = EXTENDED_HEADER_SIZE; //跳过预留的包头
+		frame->_size = body_size;
+
+		return frame;
+	}
+
+	//
+	//带标识的包体(压缩或者批量)，统一使用扩展包头，标识写入包长高位
+	//
+	static FramePtr CreateWithFlags(const void* body, std::size_t body_size, uint32_t flags)
+	{
+		auto frame = Create(body, body_size);
+		if (!frame || !flags) return frame;
+
+		if (!frame->IsExtended()) //普通包头改为扩展包头，包头空间已经预留
+		{
+			frame->_offset = 0;
+			frame->_size += EXTENDED_HEADER_SIZE - FRAME_HEADER_SIZE;
+		}
+
+		uint32_t length = body_size | flags;
+
+		frame->_data[0] = frame->_data[1] = 0xff;
+		for (int i = 0; i < 4; ++i) frame->_data[2 + i] = (length >> (24 - i * 8)) & 0xff;
+
+		frame->_flags = flags;
+		return frame;
+	}
+
+	//
+	//协议整体作为包体，比如已经组装好的Meta
+	//
+	static FramePtr Build(const pb::Message& message)
+	{
+		std::size_t body_size = MessageSize(message);
+
+		auto frame = Create(body_size);
+		if (!frame) return frame;
+
+		if (!frame->IsExtended())
+		{
+			message.SerializeWithCachedSizesToArray(frame->Body());
+		}
+		else
+		{
+			ChunkOutputStream stream(frame.get());
+			CodedOutputStream output(&stream);
+			message.SerializeWithCachedSizes(&output);
+		}
+		return frame;
+	}
+
+	//
+	//直接序列化Meta协议到数据包，不生成中间的Meta对象和stuff字符串
+	//
+	//Meta格式：type_t = 1; stuff = 2; player_id = 3;
+	//
+	static FramePtr BuildMeta(const pb::Message& message, int32_t type_t, int64_t player_id = 0)
+	{
+		return BuildEnvelope(message, type_t, 2, 3, player_id);
+	}
+
+	//
+	//复制不携带玩家ID的Meta数据包并追加玩家ID，player_id是最后一个字段，不重新序列化协议
+	//
+	//只处理普通包头的数据包，否则返回空
+	//
+	static FramePtr AppendPlayerID(const FramePtr& meta, int64_t player_id)
+	{
+		if (!meta || meta->IsExtended() || meta->GetFlags()) return nullptr;
+
+		std::size_t body_size = meta->BodySize() + 1 + WireFormatLite::Int64Size(player_id);
+		if (body_size > MAX_FRAME_BODY_SIZE) return nullptr;
+
+		auto frame = Create(body_size);
+		if (!frame) return frame;
+
+		memcpy(frame->Body(), meta->Body(), meta->BodySize());
+		WireFormatLite::WriteInt64ToArray(3, player_id, frame->Body() + meta->BodySize());
+
+		frame->_priority = meta->_priority;
+		return frame;
+	}
+
+	//
+	//InnerMeta格式：type_t = 1; session_id = 2; stuff = 3;
+	//
+	static FramePtr BuildInnerMeta(const pb::Message& message, int32_t type_t, int64_t session_id = 0)
+	{
+		return BuildEnvelope(message, type_t, 3, 2, session_id);
+	}
+
+	//
+	//握手数据包
+	//
+	static FramePtr BuildHandshake(uint32_t capabilities)
+	{
+		auto frame = BuildControl(CONTROL_FRAME_VERSION, CONTROL_FRAME_SIZE);
+		for (int i = 0; i < 4; ++i) frame->Body()[4 + i] = (capabilities >> (24 - i * 8)) & 0xff;
+
+		return frame;
+	}
+
+	//
+	//续传数据包：之后的数据包从next_sequence开始计数
+	//
+	static FramePtr BuildResume(uint64_t link_id, uint64_t next_sequence)
+	{
+		auto frame = BuildControl(CONTROL_FRAME_RESUME, RESUME_FRAME_SIZE);
+		WriteUint64(frame->Body() + 4, link_id);
+		WriteUint64(frame->Body() + 12, next_sequence);
+
+		return frame;
+	}
+
+	//
+	//玩家连接续传数据包：续传标识 + 下一个数据包序号 + 续传密钥
+	//
+	static FramePtr BuildResume(const ResumeToken& token, uint64_t next_sequence)
+	{
+		auto frame = BuildControl(CONTROL_FRAME_RESUME, SESSION_RESUME_FRAME_SIZE);
+		WriteUint64(frame->Body() + 4, token.id);
+		WriteUint64(frame->Body() + 12, next_sequence);
+		WriteUint64(frame->Body() + 20, token.secret);
+
+		return frame;
+	}
+
+	//
+	//确认数据包：已经处理到sequence
+	//
+	static FramePtr BuildAck(uint64_t sequence)
+	{
+		auto frame = BuildControl(CONTROL_FRAME_ACK, ACK_FRAME_SIZE);
+		WriteUint64(frame->Body() + 4, sequence);
+
+		return frame;
+	}
+
+	static bool IsControlFrame(const uint8_t* body, std::size_t body_size)
+	{
+		return body_size >= CONTROL_FRAME_SIZE && body[0] == CONTROL_FRAME_MARK && body[1] == 'M' && body[2] == 'X';
+	}
+
+	static uint8_t GetControlType(const uint8_t* body) { return body[3]; }
+
+	static uint32_t ParseHandshake(const uint8_t* body)
+	{
+		return (uint32_t(body[4]) << 24) | (body[5] << 16) | (body[6] << 8) | body[7];
+	}
+
+	static uint64_t ReadUint64(const uint8_t* data)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < 8; ++i) value = (value << 8) | data[i];
+		return value;
+	}
+
+private:
+	static FramePtr BuildControl(uint8_t type, std::size_t body_size)
+	{
+		auto frame = Create(body_size);
+
+		uint8_t* body = frame->Body();
+		body[0] = CONTROL_FRAME_MARK;
+		body[1] = 'M';
+		body[2] = 'X';
+		body[3] = type;
+
+		frame->_priority = SEND_PRIORITY_REALTIME; //握手回复需要先于压缩、扩展数据包到达
+
+		return frame;
+	}
+
+	static void WriteUint64(uint8_t* data, uint64_t value)
+	{
+		for (int i = 0; i < 8; ++i) data[i] = (value >> (56 - i * 8)) & 0xff;
+	}
+
+	//
+	//计算并缓存协议大小：ByteSizeLong从3.1开始提供，之后的版本中ByteSize已经废弃(返回int)
+	//
+	static std::size_t MessageSize(const pb::Message& message)
+	{
+#if GOOGLE_PROTOBUF_VERSION >= 3001000
+		return message.ByteSizeLong();
+#else
+		return message.ByteSize();
+#endif
+	}
+
+	typedef pb::internal::WireFormatLite WireFormatLite;
+	typedef pb::io::CodedOutputStream CodedOutputStream;
+
+	//
+	//扩展数据包写入：写满一个分块后从内存池获取下一个分块，不分配连续的大块内存
+	//
+	class ChunkOutputStream : public pb::io::ZeroCopyOutputStream
+	{
+	public:
+		explicit ChunkOutputStream(FrameBuffer* head) : _tail(head) { }
+
+		virtual bool Next(void** data, int* size) override
+		{
+			if (_tail->_offset + _tail->_size == _tail->_capacity)
+			{
+				FramePtr chunk = Allocate(CHUNK_SIZE);
+				_tail->_next = chunk;
+				_tail = chunk.get();
+			}
+
+			*data = _tail->_data + _tail->_offset + _tail->_size;
+			*size = _tail->_capacity - _tail->_offset - _tail->_size;
+
+			_tail->_size += *size;
+			_byte_count += *size;
+			return true;
+		}
+
+		virtual void BackUp(int count) override
+		{
+			_tail->_size -= count;
+			_byte_count -= count;
+		}
+
+		virtual pb::int64 ByteCount() const override { return _byte_count; }
+
+	private:
+		FrameBuffer* _tail = nullptr;
+		pb::int64 _byte_count = 0;
+	};
+
+	//
+	//外层协议：枚举类型(字段1) + 协议数据(stuff_field) + 64位整数ID(id_field，为0时不写入)
+	//
+	//按字段序号顺序写入，和Protobuff序列化结果一致
+	//
+	static FramePtr BuildEnvelope(const pb::Message& message, int32_t type_t, int stuff_field, int id_field, int64_t id)
+	{
+		uint32_t stuff_size = MessageSize(message); //同时缓存各字段大小
+
+		std::size_t stuff_length = 1 + CodedOutputStream::VarintSize32(stuff_size) + stuff_size;
+		std::size_t id_length = id ? 1 + WireFormatLite::Int64Size(id) : 0;
+		std::size_t body_size = 1 + WireFormatLite::EnumSize(type_t) + stuff_length + id_length;
+
+		auto frame = Create(body_size);
+		if (!frame) return frame;
+
+		if (!frame->IsExtended())
+		{
+			uint8_t* target = frame->Body();
+			target = WireFormatLite::WriteEnumToArray(1, type_t, target);
+
+			if (stuff_field < id_field)
+			{
+				target = WriteStuff(message, stuff_field, stuff_size, target);
+				if (id) target = WireFormatLite::WriteInt64ToArray(id_field, id, target);
+			}
+			else
+			{
+				if (id) target = WireFormatLite::WriteInt64ToArray(id_field, id, target);
+				target = WriteStuff(message, stuff_field, stuff_size, target);
+			}
+		}
+		else
+		{
+			ChunkOutputStream stream(frame.get());
+			CodedOutputStream output(&stream);
+
+			WireFormatLite::WriteEnum(1, type_t, &output);
+
+			if (stuff_field < id_field)
+			{
+				WriteStuff(message, stuff_field, stuff_size, &output);
+				if (id) WireFormatLite::WriteInt64(id_field, id, &output);
+			}
+			else
+			{
+				if (id) WireFormatLite::WriteInt64(id_field, id, &output);
+				WriteStuff(message, stuff_field, stuff_size, &output);
+			}
+		}
+
+		return frame;
+	}
+
+	static uint8_t* WriteStuff(const pb::Message& message, int stuff_field, uint32_t stuff_size, uint8_t* target)
+	{
+		target = WireFormatLite::WriteTagToArray(stuff_field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, target);
+		target = CodedOutputStream::WriteVarint32ToArray(stuff_size, target);
+		return message.SerializeWithCachedSizesToArray(target);
+	}
+
+	static void WriteStuff(const pb::Message& message, int stuff_field, uint32_t stuff_size, CodedOutputStream* output)
+	{
+		WireFormatLite::WriteTag(stuff_field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, output);
+		output->WriteVarint32(stuff_size);
+		message.SerializeWithCachedSizes(output);
+	}
+
+	static FramePtr Allocate(std::size_t capacity);
+
+	//包头写入缓存头部，普通包头前面留空
+	void SetBodySize(std::size_t body_size)
+	{
+		_body_size = body_size;
+
+		if (body_size <= MAX_FRAME_BODY_SIZE)
+		{
+			_offset = EXTENDED_HEADER_SIZE - FRAME_HEADER_SIZE;
+			_size = FRAME_HEADER_SIZE + body_size;
+
+			_data[_offset] = (body_size >> 8) & 0xff;
+			_data[_offset + 1] = body_size & 0xff;
+		}
+		else
+		{
+			_offset = 0;
+			_size = EXTENDED_HEADER_SIZE; //包体由分块写入
+
+			_data[0] = _data[1] = 0xff;
+			for (int i = 0; i < 4; ++i) _data[2 + i] = (body_size >> (24 - i * 8)) & 0xff;
+		}
+	}
+
+private:
+	friend class FramePool;
+	friend void intrusive_ptr_add_ref(FrameBuffer* frame);
+	friend void intrusive_ptr_release(FrameBuffer* frame);
+
+	std::atomic<int32_t> _ref_count;
+	uint8_t* _data = nullptr;
+	std::size_t _capacity = 0;
+	std::size_t _offset = 0; //待发送数据在缓存中的起始位置
+	std::size_t _size = 0;
+	std::size_t _body_size = 0;
+	uint32_t _flags = 0; //压缩、批量标识
+	uint8_t _priority = SEND_PRIORITY_NORMAL; //发送优先级
+	FramePtr _next;
+};
+
+/*
+ * 数据包内存池
+ *
+ * 按容量分级缓存，每个线程优先使用本线程缓存，不足或者超出时和全局缓存交换.
+ *
+ * */
+class FramePool
+{
+public:
+	static const std::size_t CLASS_COUNT = 5;
+	static const std::size_t MAX_THREAD_CACHED = 64; //每个线程每级最多缓存数量
+	static const std::size_t MAX_GLOBAL_CACHED = 4096; //全局每级最多缓存数量
+
+	static FramePool& Instance()
+	{
+		static FramePool _instance;
+		return _instance;
+	}
+
+	~FramePool()
+	{
+		for (auto& frames : _frames)
+			for (auto frame : frames) delete frame;
+	}
+
+	FrameBuffer* Acquire(std::size_t capacity)
+	{
+		int32_t index = GetClassIndex(capacity);
+		if (index < 0) return new FrameBuffer(capacity); //超大数据包不缓存
+
+		auto& local = GetThreadCache().frames[index];
+		if (local.empty())
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			auto& global = _frames[index];
+			std::size_t count = std::min(global.size(), MAX_THREAD_CACHED / 2); //批量获取，减少加锁次数
+
+			local.insert(local.end(), global.end() - count, global.end());
+			global.resize(global.size() - count);
+		}
+
+		if (local.empty()) return new FrameBuffer(GetClassCapacity(index));
+
+		auto frame = local.back();
+		local.pop_back();
+		return frame;
+	}
+
+	void Release(FrameBuffer* frame)
+	{
+		frame->_offset = frame->_size = frame->_body_size = 0;
+		frame->_flags = 0;
+		frame->_priority = SEND_PRIORITY_NORMAL;
+
+		int32_t index = GetClassIndex(frame->Capacity());
+		if (index < 0 || GetClassCapacity(index) != frame->Capacity())
+		{
+			delete frame;
+			return;
+		}
+
+		auto& local = GetThreadCache().frames[index];
+		local.push_back(frame);
+
+		if (local.size() >= MAX_THREAD_CACHED) Flush(index, local, MAX_THREAD_CACHED / 2);
+	}
+
+private:
+	struct ThreadCache
+	{
+		std::vector<FrameBuffer*> frames[CLASS_COUNT];
+
+		~ThreadCache() //线程退出归还全局
+		{
+			for (std::size_t i = 0; i < CLASS_COUNT; ++i) FramePool::Instance().Flush(i, frames[i], frames[i].size());
+		}
+	};
+
+	static ThreadCache& GetThreadCache()
+	{
+		static thread_local ThreadCache _cache;
+		return _cache;
+	}
+
+	static std::size_t GetClassCapacity(std::size_t index)
+	{
+		static const std::size_t capacities[CLASS_COUNT] = { 256, 1024, 4096,
+			FrameBuffer::EXTENDED_HEADER_SIZE + FrameBuffer::CHUNK_SIZE, FrameBuffer::EXTENDED_HEADER_SIZE + FrameBuffer::MAX_FRAME_BODY_SIZE };
+		return capacities[index];
+	}
+
+	static int32_t GetClassIndex(std::size_t capacity)
+	{
+		for (std::size_t i = 0; i < CLASS_COUNT; ++i)
+			if (capacity <= GetClassCapacity(i)) return i;
+		return -1;
+	}
+
+	void Flush(std::size_t index, std::vector<FrameBuffer*>& local, std::size_t count)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto& global = _frames[index];
+		for (std::size_t i = 0; i < count && !local.empty(); ++i)
+		{
+			if (global.size() < MAX_GLOBAL_CACHED) global.push_back(local.back());
+			else delete local.back();
+
+			local.pop_back();
+		}
+	}
+
+private:
+	std::mutex _mutex;
+	std::vector<FrameBuffer*> _frames[CLASS_COUNT];
+};
+
+inline FramePtr FrameBuffer::Allocate(std::size_t capacity)
+{
+	return FramePtr(FramePool::Instance().Acquire(capacity));
+}
+
+inline FramePtr FrameBuffer::Create(std::size_t body_size)
+{
+	if (body_size > MAX_EXTENDED_BODY_SIZE) return nullptr;
+
+	std::size_t capacity = body_size <= MAX_FRAME_BODY_SIZE ? EXTENDED_HEADER_SIZE + body_size : EXTENDED_HEADER_SIZE + CHUNK_SIZE;
+
+	auto frame = Allocate(capacity);
+	frame->SetBodySize(body_size);
+
+	return frame;
+}
+
+inline void intrusive_ptr_add_ref(FrameBuffer* frame)
+{
+	frame->_ref_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void intrusive_ptr_release(FrameBuffer* frame)
+{
+	while (frame && frame->_ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		auto next = frame->_next.detach(); //分块链逐个归还，不递归
+
+		FramePool::Instance().Release(frame);
+		frame = next;
+	}
+}
+
+}
@@ -0,0 +1,512 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <functional>
+
+#include <boost/asio.hpp>
+
+#include "MessageBuffer.h"
+#include "ReceiveBufferPool.h"
+#include "FrameBuffer.h"
+#include "FrameCompressor.h"
+#include "FrameBatcher.h"
+#include "LinkReplay.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 网络数据包编解码
+ *
+ * 数据格式：2字节包长(网络字节序) + 包体(Protobuff序列化数据)，握手协商后支持扩展包头(见FrameBuffer)
+ *
+ * 1.每次接收的数据直接写入缓存尾部，TCP粘包(一次收到多个包)和半包(一个包分多次收到)均由此处理;
+ *
+ * 2.只解析完整的数据包，直接从接收缓存解析协议，不再复制到临时缓存;
+ *
+ * 3.未接收完的数据保留在缓存中，等待下次接收;
+ *
+ * 4.控制数据包(握手、续传、确认)在此处理，不回调给上层，重连后重发的重复数据包在此跳过;
+ *
+ * 5.压缩数据包在此解压，批量数据包在此解开，上层收到的均为单个原始包体;
+ *
+ * 6.接收缓存从内存池获取，从小缓存开始按需扩容，连续多次小数据量接收后缩回，可以在空闲时归还(见Release).
+ *
+ * */
+
+enum FRAME_DECODE_RESULT
+{
+	FRAME_DECODE_SUCCESS = 0, //解析成功
+	FRAME_DECODE_PARSE_ERROR = 1, //存在解析失败的数据包，已经跳过
+	FRAME_DECODE_STOPPED = 2, //处理回调中止解析，比如连接已经关闭
+};
+
+class FrameCodec
+{
+public:
+	static const std::size_t FRAME_HEADER_SIZE = FrameBuffer::FRAME_HEADER_SIZE; //包头长度
+	static const std::size_t EXTENDED_HEADER_SIZE = FrameBuffer::EXTENDED_HEADER_SIZE; //扩展包头长度
+
+	static const std::size_t DEFAULT_INITIAL_SIZE = 512; //接收缓存初始大小
+	static const int32_t SHRINK_RECEIVE_COUNT = 16; //连续多少次小数据量接收后缩回
+
+	explicit FrameCodec(std::size_t initial_size = DEFAULT_INITIAL_SIZE) : _buffer(0) { SetInitialSize(initial_size); }
+
+	~FrameCodec() 
+	{ 
+		Retire();
+		Release(true); 
+	}
+
+	FrameCodec(const FrameCodec&) = delete;
+	FrameCodec& operator = (const FrameCodec&) = delete;
+
+	void SetInitialSize(std::size_t initial_size) { _initial_size = std::max(initial_size, ReceiveBufferPool::GetMinCapacity()); }
+
+	//
+	//接收数据包包体上限，超过的数据包丢弃：默认为扩展包头上限，玩家连接只允许较小的上限
+	//
+	void SetReceiveLimit(std::size_t limit) { _receive_limit = limit < FrameBuffer::MAX_EXTENDED_BODY_SIZE ? limit : FrameBuffer::MAX_EXTENDED_BODY_SIZE; }
+	std::size_t GetReceiveLimit() const { return _receive_limit; }
+
+	//
+	//本端支持的连接能力
+	//
+	void SetLocalCapabilities(uint32_t capabilities) { _local_capabilities = capabilities; }
+	uint32_t GetLocalCapabilities() const { return _local_capabilities; }
+
+	//
+	//收到对端握手数据包时回调，参数为双方能力交集
+	//
+	void SetHandshakeHandler(std::function<void(uint32_t)> handler) { _handshake_handler = handler; }
+
+	uint32_t GetCapabilities() const { return _capabilities; }
+	bool IsExtended() const { return _capabilities & FRAME_CAPABILITY_EXTENDED; }
+	bool IsCompressed() const { return _capabilities & FRAME_CAPABILITY_COMPRESS; }
+	bool IsBatched() const { return _capabilities & FRAME_CAPABILITY_BATCH; }
+	bool IsReplay() const { return _capabilities & FRAME_CAPABILITY_REPLAY; }
+	bool IsSessionResume() const { return _capabilities & FRAME_CAPABILITY_RESUME; }
+
+	//
+	//接收端：收到续传数据包之后，每次解析完成时回调已处理序号，用于回复确认
+	//
+	void SetSequenceHandler(std::function<void(uint64_t)> handler) { _sequence_handler = handler; }
+
+	//
+	//发起端：收到对端确认时回调
+	//
+	void SetAckHandler(std::function<void(uint64_t)> handler) { _ack_handler = handler; }
+
+	//
+	//玩家连接：收到续传数据包时回调，参数为续传标识和序号(见SessionResume)
+	//
+	void SetResumeHandler(std::function<void(const ResumeToken&, uint64_t)> handler) { _resume_handler = handler; }
+
+	//
+	//接收前调用，保证缓存有足够空间容纳当前未接收完的数据包
+	//
+	boost::asio::mutable_buffers_1 PrepareBuffer()
+	{
+		_buffer.Normalize();
+
+		std::size_t buffer_size = _buffer.GetBufferSize();
+
+		if (buffer_size == 0) 
+		{
+			Replace(std::max(_initial_size, _required_size));
+		}
+		else if (buffer_size < _required_size) 
+		{
+			Replace(_required_size); //大数据包一次扩容到位
+		}
+		else if (_buffer.GetRemainingSpace() == 0) 
+		{
+			Replace(ReceiveBufferPool::GetNextCapacity(buffer_size));
+		}
+		else if (_small_receive_count >= SHRINK_RECEIVE_COUNT && buffer_size > _initial_size && _buffer.GetActiveSize() == 0)
+		{
+			Replace(_initial_size); //突发大数据包之后恢复小缓存
+
+			ReceiveBufferPoolInstance.GetStatistics().shrink_count += 1;
+		}
+
+		return boost::asio::buffer(_buffer.GetWritePointer(), _buffer.GetRemainingSpace());
+	}
+
+	//接收完成
+	void Commit(std::size_t bytes_transferred) 
+	{ 
+		_buffer.WriteCompleted(bytes_transferred); 
+
+		if (bytes_transferred * 4 < _buffer.GetBufferSize()) ++_small_receive_count;
+		else _small_receive_count = 0;
+	}
+
+	//
+	//没有未接收完的数据时归还接收缓存，下次接收时重新获取
+	//
+	//force：连接销毁时无条件归还
+	//
+	bool Release(bool force = false)
+	{
+		if (_buffer.GetBufferSize() == 0) return true;
+		if (!force && _buffer.GetActiveSize() > 0) return false;
+
+		ReceiveBufferPoolInstance.Release(_buffer.Move());
+		ReceiveBufferPoolInstance.GetStatistics().shrink_count += 1;
+
+		_buffer = MessageBuffer(0);
+		_small_receive_count = 0;
+
+		return true;
+	}
+
+	std::size_t GetBufferSize() const { return _buffer.GetBufferSize(); }
+
+	//连接关闭或者重连时清理残留数据
+	void Reset()
+	{
+		_buffer.Reset();
+		_small_receive_count = 0;
+		_required_size = 0;
+		_discard_size = 0;
+		_capabilities = 0; //重新握手
+		Retire();
+		_link_id = _receive_sequence = _duplicate_sequence = _acked_sequence = 0;
+	}
+
+	std::size_t GetPendingSize() const { return _buffer.GetActiveSize(); }
+
+	uint64_t GetDecodedCount() const { return _decoded_count; } //已解析的数据包数量(批量数据包按其中的数据包计数)
+
+	//
+	//解析缓存中所有完整的数据包
+	//
+	//MESSAGE：包体协议类型，比如Asset::Meta或者Asset::InnerMeta
+	//
+	//HANDLER：bool(const MESSAGE&)，返回false则中止解析
+	//
+	template<class MESSAGE, class HANDLER>
+	FRAME_DECODE_RESULT Decode(HANDLER&& handler)
+	{
+		MESSAGE message;
+		return DecodeRaw([&message, &handler](const uint8_t* body, std::size_t body_size) {
+			if (!message.ParseFromArray(body, body_size)) return FRAME_DECODE_PARSE_ERROR;
+			if (!handler(message)) return FRAME_DECODE_STOPPED;
+			return FRAME_DECODE_SUCCESS;
+		});
+	}
+
+	//
+	//未握手的旧版本对端发送的数据不带包头：缓存中的数据整体作为一个包体(原有格式，不处理粘包和半包)
+	//
+	template<class MESSAGE, class HANDLER>
+	FRAME_DECODE_RESULT DecodeUnframed(HANDLER&& handler)
+	{
+		std::size_t size = _buffer.GetActiveSize();
+		if (size == 0) return FRAME_DECODE_SUCCESS;
+
+		MESSAGE message;
+		bool parsed = message.ParseFromArray(_buffer.GetReadPointer(), size);
+
+		_buffer.ReadCompleted(size);
+		if (!parsed) return FRAME_DECODE_PARSE_ERROR;
+
+		++_decoded_count;
+		return handler(message) ? FRAME_DECODE_SUCCESS : FRAME_DECODE_STOPPED;
+	}
+
+	//
+	//不进行协议解析，直接回调包体数据
+	//
+	//HANDLER：FRAME_DECODE_RESULT(const uint8_t* body, std::size_t body_size)
+	//
+	template<class HANDLER>
+	FRAME_DECODE_RESULT DecodeRaw(HANDLER&& handler)
+	{
+		FRAME_DECODE_RESULT decode_result = FRAME_DECODE_SUCCESS;
+
+		while (true)
+		{
+			if (_discard_size > 0) //丢弃超过限制的数据包
+			{
+				std::size_t discard_size = std::min(_discard_size, _buffer.GetActiveSize());
+
+				_buffer.ReadCompleted(discard_size);
+				_discard_size -= discard_size;
+
+				if (_discard_size > 0) break;
+			}
+
+			if (_buffer.GetActiveSize() < FRAME_HEADER_SIZE) break;
+
+			const uint8_t* header = _buffer.GetReadPointer();
+			std::size_t header_size = FRAME_HEADER_SIZE;
+			std::size_t body_size = (header[0] << 8) | header[1];
+			uint32_t flags = 0;
+
+			if ((IsExtended() || IsCompressed() || IsBatched()) && body_size == FrameBuffer::EXTENDED_HEADER_MARK) //扩展包头
+			{
+				if (_buffer.GetActiveSize() < EXTENDED_HEADER_SIZE) 
+				{
+					_required_size = EXTENDED_HEADER_SIZE;
+					break;
+				}
+
+				header_size = EXTENDED_HEADER_SIZE;
+				uint32_t length = (uint32_t(header[2]) << 24) | (header[3] << 16) | (header[4] << 8) | header[5];
+
+				flags = length & FrameBuffer::FLAGS_MASK;
+				body_size = length & ~FrameBuffer::FLAGS_MASK;
+
+				bool negotiated = (!(flags & FrameBuffer::COMPRESSED_FLAG) || IsCompressed()) && (!(flags & FrameBuffer::BATCHED_FLAG) || IsBatched());
+
+				if (body_size > _receive_limit || !negotiated) 
+				{
+					ERROR("接收数据包超过最大限制或者未协商，包长:{} 标识:{}", body_size, flags);
+
+					_buffer.ReadCompleted(header_size);
+					_discard_size = body_size;
+					_required_size = 0;
+
+					if (_resumed) ++_receive_sequence; //丢弃的数据包同样计数
+
+					decode_result = FRAME_DECODE_PARSE_ERROR;
+					continue;
+				}
+			}
+
+			std::size_t frame_size = header_size + body_size;
+
+			if (_buffer.GetActiveSize() < frame_size) //半包
+			{
+				_required_size = frame_size;
+				break;
+			}
+
+			_required_size = 0;
+			_buffer.ReadCompleted(frame_size); //先移动读位置，回调中可能重置缓存
+
+			const uint8_t* body = header + header_size;
+
+			if (_resumed && (flags || !FrameBuffer::IsControlFrame(body, body_size))) 
+			{
+				if (++_receive_sequence <= _duplicate_sequence) continue; //重发的数据包之前已经处理
+			}
+
+			if (flags & FrameBuffer::COMPRESSED_FLAG)
+			{
+				if (!_decompressor.Decompress(body, body_size, _receive_limit)) //解压后同样不超过接收上限
+				{
+					ERROR("接收数据包解压失败，包长:{}", body_size);
+
+					decode_result = FRAME_DECODE_PARSE_ERROR;
+					continue;
+				}
+
+				body = _decompressor.Data();
+				body_size = _decompressor.Size();
+			}
+
+			if (!flags && FrameBuffer::IsControlFrame(body, body_size)) 
+			{
+				OnControl(body, body_size);
+				continue;
+			}
+
+			if (!(flags & FrameBuffer::BATCHED_FLAG)) ++_decoded_count;
+
+			auto result = (flags & FrameBuffer::BATCHED_FLAG) ? DecodeBatch(body, body_size, handler) : handler(body, body_size);
+			if (FRAME_DECODE_STOPPED == result) 
+			{
+				OnSequence();
+				return result;
+			}
+			if (FRAME_DECODE_PARSE_ERROR == result) decode_result = result;
+		}
+
+		_decompressor.Shrink();
+		OnSequence();
+
+		return decode_result;
+	}
+
+private:
+	//
+	//换用指定大小的缓存，保留未解析的数据
+	//
+	void Replace(std::size_t size)
+	{
+		auto storage = ReceiveBufferPoolInstance.Acquire(size);
+
+		std::size_t active_size = _buffer.GetActiveSize();
+		if (active_size > 0) memcpy(storage.data(), _buffer.GetReadPointer(), active_size);
+
+		if (_buffer.GetBufferSize() < storage.size()) ReceiveBufferPoolInstance.GetStatistics().grow_count += 1;
+		ReceiveBufferPoolInstance.Release(_buffer.Move());
+
+		_buffer = MessageBuffer(std::move(storage));
+		_buffer.WriteCompleted(active_size);
+
+		_small_receive_count = 0;
+	}
+
+	//
+	//批量包体：依次为 0x0A + 长度(varint) + 包体
+	//
+	template<class HANDLER>
+	FRAME_DECODE_RESULT DecodeBatch(const uint8_t* data, std::size_t size, HANDLER& handler)
+	{
+		FRAME_DECODE_RESULT decode_result = FRAME_DECODE_SUCCESS;
+		const uint8_t* end = data + size;
+
+		while (data < end)
+		{
+			if (*data++ != FrameBatcher::BATCH_ENTRY_TAG) return FRAME_DECODE_PARSE_ERROR;
+
+			uint32_t body_size = 0;
+			for (int32_t shift = 0; ; shift += 7)
+			{
+				if (data == end || shift > 28) return FRAME_DECODE_PARSE_ERROR;
+
+				uint8_t byte = *data++;
+				body_size |= uint32_t(byte & 0x7f) << shift;
+				if (!(byte & 0x80)) break;
+			}
+
+			if (std::size_t(end - data) < body_size) return FRAME_DECODE_PARSE_ERROR;
+
+			++_decoded_count;
+
+			auto result = handler(data, body_size);
+			if (FRAME_DECODE_STOPPED == result) return result;
+			if (FRAME_DECODE_PARSE_ERROR == result) decode_result = result;
+
+			data += body_size;
+		}
+
+		return decode_result;
+	}
+
+	void OnControl(const uint8_t* body, std::size_t body_size)
+	{
+		switch (FrameBuffer::GetControlType(body))
+		{
+			case FrameBuffer::CONTROL_FRAME_VERSION:
+			{
+				OnHandshake(body);
+			}
+			break;
+
+			case FrameBuffer::CONTROL_FRAME_RESUME:
+			{
+				if (body_size < FrameBuffer::RESUME_FRAME_SIZE) break;
+
+				if (IsReplay()) 
+				{
+					OnResume(FrameBuffer::ReadUint64(body + 4), FrameBuffer::ReadUint64(body + 12));
+				}
+				else if (IsSessionResume() && _resume_handler) //玩家连接断线续传
+				{
+					ResumeToken token;
+					token.id = FrameBuffer::ReadUint64(body + 4);
+					if (body_size >= FrameBuffer::SESSION_RESUME_FRAME_SIZE) token.secret = FrameBuffer::ReadUint64(body + 20); //没有密钥时续传失败
+
+					_resume_handler(token, FrameBuffer::ReadUint64(body + 12));
+				}
+			}
+			break;
+
+			case FrameBuffer::CONTROL_FRAME_ACK:
+			{
+				if (body_size < FrameBuffer::ACK_FRAME_SIZE || !_ack_handler) break;
+				_ack_handler(FrameBuffer::ReadUint64(body + 4));
+			}
+			break;
+
+			default: //未知控制数据包，忽略
+			{
+			}
+			break;
+		}
+	}
+
+	//
+	//发起端重连：之前已经处理的数据包不再处理
+	//
+	void OnResume(uint64_t link_id, uint64_t next_sequence)
+	{
+		Retire(); //同一连接再次续传
+
+		uint64_t processed = ReplayRegistryInstance.Attach(link_id);
+
+		if (processed > 0 && next_sequence > processed + 1) 
+		{
+			WARN("连接:{} 续传序号:{} 已处理序号:{}，发起端重发缓存超过上限，丢失数据包:{}", link_id, next_sequence, processed, next_sequence - processed - 1);
+		}
+		else if (processed >= next_sequence)
+		{
+			LOG(INFO, "连接:{} 续传序号:{} 已处理序号:{}，跳过重复数据包:{}", link_id, next_sequence, processed, processed - next_sequence + 1);
+		}
+
+		_resumed = true;
+		_link_id = link_id;
+		_receive_sequence = next_sequence > 0 ? next_sequence - 1 : 0;
+		_duplicate_sequence = processed;
+		_acked_sequence = 0;
+	}
+
+	//解析完成，记录已处理序号并回复确认
+	void OnSequence()
+	{
+		if (!_resumed || _receive_sequence == _acked_sequence) return;
+
+		_acked_sequence = _receive_sequence;
+		ReplayRegistryInstance.Update(_link_id, _receive_sequence);
+
+		if (_sequence_handler) _sequence_handler(_receive_sequence);
+	}
+
+	//不再使用续传的连接标识
+	void Retire()
+	{
+		if (!_resumed) return;
+
+		_resumed = false;
+		ReplayRegistryInstance.Detach(_link_id);
+	}
+
+	void OnHandshake(const uint8_t* body)
+	{
+		_capabilities = FrameBuffer::ParseHandshake(body) & _local_capabilities; //之后的数据包按协商结果解析
+
+		if (_handshake_handler) _handshake_handler(_capabilities);
+	}
+
+private:
+	MessageBuffer _buffer; //接收缓存，来自ReceiveBufferPool
+	std::size_t _initial_size = DEFAULT_INITIAL_SIZE;
+	int32_t _small_receive_count = 0; //连续小数据量接收次数
+	std::size_t _required_size = 0; //当前半包需要的缓存大小
+	std::size_t _discard_size = 0; //待丢弃的数据长度
+	std::size_t _receive_limit = FrameBuffer::MAX_EXTENDED_BODY_SIZE; //接收包体上限
+	uint32_t _local_capabilities = 0;
+	uint32_t _capabilities = 0; //协商结果
+	std::function<void(uint32_t)> _handshake_handler;
+	FrameDecompressor _decompressor;
+	uint64_t _decoded_count = 0;
+
+	//断线重发(接收端)
+	bool _resumed = false; //已经收到续传数据包，开始计数
+	uint64_t _link_id = 0;
+	uint64_t _receive_sequence = 0; //最近收到的数据包序号
+	uint64_t _duplicate_sequence = 0; //不超过此序号的数据包已经处理过
+	uint64_t _acked_sequence = 0; //最近确认的序号
+	std::function<void(uint64_t)> _sequence_handler;
+	std::function<void(uint64_t)> _ack_handler;
+	std::function<void(const ResumeToken&, uint64_t)> _resume_handler; //玩家连接断线续传
+};
+
+}
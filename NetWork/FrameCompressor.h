@@ -0,0 +1,297 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+
+#include <zlib.h>
+
+#include "FrameBuffer.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 数据包压缩
+ *
+ * 1.握手协商后才发送压缩数据包，压缩数据包使用扩展包头，包长最高位为压缩标识(见FrameBuffer);
+ *
+ * 2.压缩包体：4字节原始包体长度(网络字节序) + zlib数据，每个数据包单独压缩，丢弃或者合并数据包不影响其他数据包;
+ *
+ * 3.按协议类型选择是否压缩，且只压缩超过阈值的数据包，心跳等高频小协议不经过压缩;
+ *
+ * 4.压缩和解压上下文每个连接一个，首次使用时创建，之后重置复用.
+ *
+ * */
+
+//单个协议类型的压缩统计
+struct CompressStatistics
+{
+	std::atomic<int64_t> count; //压缩次数
+	std::atomic<int64_t> raw_bytes; //压缩前包体字节数
+	std::atomic<int64_t> sent_bytes; //实际发送包体字节数
+	std::atomic<int64_t> skipped_count; //压缩后没有变小，按原始数据发送的次数
+	std::atomic<int64_t> cost_ns; //压缩耗时(纳秒)
+
+	CompressStatistics() : count(0), raw_bytes(0), sent_bytes(0), skipped_count(0), cost_ns(0) { }
+
+	int64_t GetSavedBytes() const { return raw_bytes - sent_bytes; }
+	int64_t GetCostPerMessage() const { return count ? cost_ns / count : 0; } //平均每次压缩耗时(纳秒)
+};
+
+//
+//压缩策略：哪些协议类型压缩，压缩阈值及级别
+//
+//配置项：CompressTypes(协议类型列表，逗号分隔)/CompressThreshold/CompressLevel
+//
+class CompressPolicy
+{
+public:
+	static const int32_t MAX_TYPE_COUNT = 2048; //协议类型上限
+
+	static CompressPolicy& Instance()
+	{
+		static CompressPolicy _instance;
+		return _instance;
+	}
+
+	//default_types：未配置CompressTypes时压缩的协议类型
+	void Load(const std::vector<int32_t>& default_types)
+	{
+		_threshold = ConfigInstance.GetInt("CompressThreshold", 1024);
+		_level = ConfigInstance.GetInt("CompressLevel", Z_BEST_SPEED);
+
+		std::vector<int32_t> types;
+
+		std::stringstream stream(ConfigInstance.GetString("CompressTypes", ""));
+		for (std::string type; std::getline(stream, type, ','); )
+		{
+			if (!type.empty()) types.push_back(std::atoi(type.c_str()));
+		}
+
+		for (auto& enabled : _enabled) enabled = false;
+		for (auto type_t : types.empty() ? default_types : types) Enable(type_t);
+	}
+
+	void Enable(int32_t type_t, bool enabled = true)
+	{
+		if (type_t <= 0 || type_t >= MAX_TYPE_COUNT) return;
+		_enabled[type_t] = enabled;
+	}
+
+	bool IsEnabled(int32_t type_t) const { return type_t > 0 && type_t < MAX_TYPE_COUNT && _enabled[type_t]; }
+
+	bool ShouldCompress(int32_t type_t, std::size_t body_size) const { return body_size >= _threshold && IsEnabled(type_t); }
+
+	std::size_t GetThreshold() const { return _threshold; }
+	int32_t GetLevel() const { return _level; }
+
+	void Record(int32_t type_t, std::size_t raw_bytes, std::size_t sent_bytes, int64_t cost_ns)
+	{
+		if (type_t <= 0 || type_t >= MAX_TYPE_COUNT) return;
+
+		auto& statistics = _statistics[type_t];
+		statistics.count += 1;
+		statistics.raw_bytes += raw_bytes;
+		statistics.sent_bytes += sent_bytes;
+		statistics.cost_ns += cost_ns;
+		if (raw_bytes == sent_bytes) statistics.skipped_count += 1;
+	}
+
+	const CompressStatistics& GetStatistics(int32_t type_t) const { return _statistics[type_t > 0 && type_t < MAX_TYPE_COUNT ? type_t : 0]; }
+
+	//按协议类型输出压缩收益和耗时
+	void Report() const
+	{
+		for (int32_t type_t = 1; type_t < MAX_TYPE_COUNT; ++type_t)
+		{
+			const auto& statistics = _statistics[type_t];
+			if (statistics.count == 0) continue;
+
+			LOG(INFO, "数据包压缩统计，协议类型:{} 次数:{} 未压缩次数:{} 压缩前字节:{} 发送字节:{} 节省字节:{} 平均耗时(纳秒):{}",
+					type_t, statistics.count, statistics.skipped_count, statistics.raw_bytes, statistics.sent_bytes,
+					statistics.GetSavedBytes(), statistics.GetCostPerMessage());
+		}
+	}
+
+private:
+	std::atomic<bool> _enabled[MAX_TYPE_COUNT] = {};
+	std::atomic<std::size_t> _threshold{1024};
+	std::atomic<int32_t> _level{Z_BEST_SPEED};
+	CompressStatistics _statistics[MAX_TYPE_COUNT];
+};
+
+#define CompressPolicyInstance CompressPolicy::Instance()
+
+//
+//发送压缩，每个连接一个
+//
+class FrameCompressor
+{
+public:
+	FrameCompressor() { }
+
+	~FrameCompressor()
+	{
+		if (_initialized) deflateEnd(&_stream);
+	}
+
+	FrameCompressor(const FrameCompressor&) = delete;
+	FrameCompressor& operator = (const FrameCompressor&) = delete;
+
+	//
+	//压缩数据包，压缩后没有变小或者失败时返回原数据包
+	//
+	FramePtr Compress(const FramePtr& frame, int32_t type_t)
+	{
+		if (!frame || frame->IsCompressed()) return frame;
+
+		auto start_time = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (!Initialize()) return frame;
+
+		std::size_t raw_size = frame->BodySize();
+		_buffer.resize(FrameBuffer::COMPRESS_HEADER_SIZE + deflateBound(&_stream, raw_size));
+
+		_stream.next_out = &_buffer[FrameBuffer::COMPRESS_HEADER_SIZE];
+		_stream.avail_out = _buffer.size() - FrameBuffer::COMPRESS_HEADER_SIZE;
+
+		int status = Z_OK;
+
+		for (auto chunk = frame; chunk && status == Z_OK; chunk = chunk->Next()) //分块数据包依次压缩
+		{
+			std::size_t header_size = chunk == frame ? chunk->HeaderSize() : 0;
+
+			_stream.next_in = const_cast<Bytef*>(chunk->Data() + header_size);
+			_stream.avail_in = chunk->Size() - header_size;
+
+			status = deflate(&_stream, chunk->Next() ? Z_NO_FLUSH : Z_FINISH);
+		}
+
+		std::size_t compressed_size = _stream.total_out;
+		deflateReset(&_stream);
+
+		FramePtr compressed;
+
+		if (status == Z_STREAM_END && FrameBuffer::COMPRESS_HEADER_SIZE + compressed_size < raw_size)
+		{
+			for (std::size_t i = 0; i < FrameBuffer::COMPRESS_HEADER_SIZE; ++i) _buffer[i] = (raw_size >> (24 - i * 8)) & 0xff;
+
+			compressed = FrameBuffer::CreateWithFlags(_buffer.data(), FrameBuffer::COMPRESS_HEADER_SIZE + compressed_size, 
+					frame->GetFlags() | FrameBuffer::COMPRESSED_FLAG); //批量数据包压缩后保留批量标识
+		}
+
+		if (_buffer.capacity() > MAX_CACHED_BUFFER) std::vector<uint8_t>().swap(_buffer); //偶发的大数据包不长期占用内存
+
+		auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+		CompressPolicyInstance.Record(type_t, raw_size, compressed ? compressed->BodySize() : raw_size, cost);
+
+		return compressed ? compressed : frame;
+	}
+
+private:
+	bool Initialize()
+	{
+		if (_initialized) return true;
+
+		memset(&_stream, 0, sizeof(_stream));
+
+		if (deflateInit(&_stream, CompressPolicyInstance.GetLevel()) != Z_OK)
+		{
+			ERROR("压缩初始化失败:{}", _stream.msg ? _stream.msg : "");
+			return false;
+		}
+
+		_initialized = true;
+		return true;
+	}
+
+private:
+	static const std::size_t MAX_CACHED_BUFFER = 256 * 1024;
+
+	std::mutex _mutex; //多个线程可能同时向同一连接发送
+	z_stream _stream;
+	bool _initialized = false;
+	std::vector<uint8_t> _buffer; //压缩输出缓存
+};
+
+//
+//接收解压，每个连接一个
+//
+class FrameDecompressor
+{
+public:
+	FrameDecompressor() { }
+
+	~FrameDecompressor()
+	{
+		if (_initialized) inflateEnd(&_stream);
+	}
+
+	FrameDecompressor(const FrameDecompressor&) = delete;
+	FrameDecompressor& operator = (const FrameDecompressor&) = delete;
+
+	//
+	//解压包体，原始长度超过限制或者数据不完整时失败
+	//
+	bool Decompress(const uint8_t* body, std::size_t body_size, std::size_t max_size)
+	{
+		if (body_size < FrameBuffer::COMPRESS_HEADER_SIZE) return false;
+
+		std::size_t raw_size = (uint32_t(body[0]) << 24) | (body[1] << 16) | (body[2] << 8) | body[3];
+		if (raw_size > max_size) return false; //防止解压后过大
+
+		if (!Initialize()) return false;
+
+		_buffer.resize(raw_size);
+
+		_stream.next_in = const_cast<Bytef*>(body + FrameBuffer::COMPRESS_HEADER_SIZE);
+		_stream.avail_in = body_size - FrameBuffer::COMPRESS_HEADER_SIZE;
+		_stream.next_out = _buffer.data();
+		_stream.avail_out = raw_size;
+
+		int status = inflate(&_stream, Z_FINISH);
+		bool success = status == Z_STREAM_END && _stream.total_out == raw_size;
+
+		inflateReset(&_stream);
+		return success;
+	}
+
+	const uint8_t* Data() const { return _buffer.data(); }
+	std::size_t Size() const { return _buffer.size(); }
+
+	void Shrink() { if (_buffer.capacity() > MAX_CACHED_BUFFER) std::vector<uint8_t>().swap(_buffer); }
+
+private:
+	bool Initialize()
+	{
+		if (_initialized) return true;
+
+		memset(&_stream, 0, sizeof(_stream));
+
+		if (inflateInit(&_stream) != Z_OK)
+		{
+			ERROR("解压初始化失败:{}", _stream.msg ? _stream.msg : "");
+			return false;
+		}
+
+		_initialized = true;
+		return true;
+	}
+
+private:
+	static const std::size_t MAX_CACHED_BUFFER = 256 * 1024;
+
+	z_stream _stream;
+	bool _initialized = false;
+	std::vector<uint8_t> _buffer; //解压输出缓存
+};
+
+}
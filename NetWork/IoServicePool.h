@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+#include <boost/asio.hpp>
+
+#include "ThreadAffinity.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 主线程池(监听、服务器之间的连接、定时器)
+ *
+ * 1.shared(默认)：所有线程共同处理一个io_service，处理函数可能在任意线程执行;
+ *
+ * 2.per_thread：每个线程一个io_service，连接创建时选择一个(轮流分配)，之后所有处理函数都在该线程执行，不再跨线程迁移;
+ *
+ * 3.线程可以绑定CPU(IoThreadAffinity)，网络线程见NetworkThreadAffinity.
+ *
+ * 配置项：IoServiceMode(shared/per_thread) IoThreadCount IoThreadAffinity
+ *
+ * */
+
+class IoServicePool
+{
+public:
+	IoServicePool() = default;
+	~IoServicePool() { Stop(); }
+
+	IoServicePool(const IoServicePool&) = delete;
+	IoServicePool& operator = (const IoServicePool&) = delete;
+
+	//
+	//按配置创建io_service，启动线程之前调用
+	//
+	void Load(int32_t default_thread_count)
+	{
+		_thread_count = std::max(ConfigInstance.GetInt("IoThreadCount", default_thread_count), 1);
+		_per_thread = ConfigInstance.GetString("IoServiceMode", "shared") == "per_thread";
+
+		int32_t service_count = _per_thread ? _thread_count : 1;
+
+		for (int32_t i = 0; i < service_count; ++i)
+		{
+			_io_services.emplace_back(new boost::asio::io_service(_per_thread ? 1 : _thread_count)); //并发线程数量提示
+			_works.emplace_back(new boost::asio::io_service::work(*_io_services.back()));
+		}
+	}
+
+	void Start()
+	{
+		if (_io_services.empty()) Load(1);
+
+		auto cpus = ThreadAffinity::Parse(ConfigInstance.GetString("IoThreadAffinity", ""), _thread_count);
+
+		for (int32_t i = 0; i < _thread_count; ++i)
+		{
+			auto& io_service = *_io_services[_per_thread ? i : 0];
+			int32_t cpu = cpus.empty() ? -1 : cpus[i];
+
+			_threads.emplace_back(new std::thread([&io_service, cpu, i]() {
+				if (cpu >= 0) ThreadAffinity::Bind(cpu, "主线程池线程" + std::to_string(i));
+				io_service.run(); //IO <-> Multi Threads
+			}));
+		}
+
+		LOG(INFO, "主线程池启动，模式:{} 线程数量:{}", _per_thread ? "per_thread" : "shared", _thread_count);
+	}
+
+	void Stop()
+	{
+		for (auto& io_service : _io_services) io_service->stop();
+
+		Wait();
+	}
+
+	//直到所有线程退出
+	void Wait()
+	{
+		for (auto& thread : _threads)
+		{
+			if (thread->joinable()) thread->join();
+		}
+
+		_threads.clear();
+	}
+
+	//
+	//新连接使用的io_service，per_thread模式下轮流分配，连接的整个生命周期都在该线程
+	//
+	boost::asio::io_service& GetIoService()
+	{
+		if (_io_services.empty()) Load(1);
+
+		std::size_t index = _next++ % _io_services.size();
+		return *_io_services[index];
+	}
+
+	boost::asio::io_service& GetIoService(std::size_t index) { return *_io_services[index % _io_services.size()]; }
+
+	std::size_t Size() const { return _io_services.size(); }
+	bool IsPerThread() const { return _per_thread; }
+
+private:
+	std::vector<std::unique_ptr<boost::asio::io_service>> _io_services;
+	std::vector<std::unique_ptr<boost::asio::io_service::work>> _works;
+	std::vector<std::unique_ptr<std::thread>> _threads;
+	std::atomic<std::size_t> _next{0};
+	int32_t _thread_count = 1;
+	bool _per_thread = false;
+};
+
+}
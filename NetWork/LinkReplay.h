@@ -0,0 +1,238 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <utility>
+#include <unordered_set>
+#include <unordered_map>
+
+#include "MXLog.h"
+#include "FrameBuffer.h"
+
+namespace Adoter
+{
+
+/*
+ * 服务器之间连接断线重发
+ *
+ * 1.发起连接的一端(ClientSocket)为每个入队的数据包分配序号，保留到对端确认为止，重连后从最早未确认的数据包开始按顺序重发;
+ *
+ * 2.序号不写入数据包，双方按数据包计数：握手协商后发起端发送续传数据包(连接标识+下一个数据包序号)，之后每个非控制数据包序号加一;
+ *
+ * 3.接收端按连接标识记录已经处理的最大序号，重发中已经处理过的数据包直接跳过，并定期回复确认序号;
+ *
+ * 4.重发缓存有字节上限，超过上限时丢弃最早的数据包(记录丢弃数量);
+ *
+ * 5.接收端的连接标识在没有连接使用后保留一段时间等待重连，由网络线程定时删除(发起端进程重启后使用新的连接标识);
+ *
+ * 6.接收端只对服务器之间的连接开启：只接收服务器连接的端口，或者对端地址在ServerLinkAddresses中，玩家连接不能续传其他连接.
+ *
+ * 配置项：LinkReplayExpire(接收端连接标识保留时长，秒) ServerLinkAddresses(服务器地址列表，逗号分隔)
+ *
+ * */
+
+//服务器之间连接健康状态，路由时跳过断开的连接
+enum LINK_STATE
+{
+	LINK_STATE_CONNECTING = 1, //首次连接中
+	LINK_STATE_UP = 2, //正常
+	LINK_STATE_DEGRADED = 3, //发送队列拥塞，或者刚断开正在重连(数据包缓存，重连后重发)
+	LINK_STATE_DOWN = 4, //断开超过一定时长
+};
+
+//
+//发起端：已入队尚未确认的数据包
+//
+class ReplayBuffer
+{
+public:
+	static const std::size_t DEFAULT_MAX_BYTES = 32 * 1024 * 1024;
+
+	void SetMaxBytes(std::size_t max_bytes) { _max_bytes = max_bytes > 0 ? max_bytes : DEFAULT_MAX_BYTES; }
+
+	//
+	//记录数据包，返回分配的序号
+	//
+	uint64_t Record(const FramePtr& frame)
+	{
+		uint64_t sequence = _next_sequence++;
+
+		_frames.emplace_back(sequence, frame);
+		_bytes += frame->BodySize();
+
+		while (_bytes > _max_bytes && _frames.size() > 1) //超过上限，丢弃最早的数据包
+		{
+			_bytes -= _frames.front().second->BodySize();
+			_frames.pop_front();
+
+			++_dropped_count;
+		}
+
+		return sequence;
+	}
+
+	//对端确认已经处理到sequence
+	void Acknowledge(uint64_t sequence)
+	{
+		while (!_frames.empty() && _frames.front().first <= sequence)
+		{
+			_bytes -= _frames.front().second->BodySize();
+			_frames.pop_front();
+		}
+	}
+
+	//最早未确认的数据包序号，没有时为下一个数据包序号
+	uint64_t GetFirstSequence() const { return _frames.empty() ? _next_sequence : _frames.front().first; }
+	uint64_t GetNextSequence() const { return _next_sequence; }
+
+	const std::deque<std::pair<uint64_t, FramePtr>>& GetFrames() const { return _frames; }
+
+	std::size_t Size() const { return _frames.size(); }
+	std::size_t Bytes() const { return _bytes; }
+	int64_t GetDroppedCount() const { return _dropped_count; }
+
+	//对端不支持重发时清理，序号继续递增
+	void Clear()
+	{
+		_frames.clear();
+		_bytes = 0;
+	}
+
+private:
+	std::deque<std::pair<uint64_t/*序号*/, FramePtr>> _frames;
+	std::size_t _bytes = 0;
+	std::size_t _max_bytes = DEFAULT_MAX_BYTES;
+	uint64_t _next_sequence = 1;
+	int64_t _dropped_count = 0;
+};
+
+//
+//接收端：每个发起端连接已经处理的最大序号，重连后按此跳过重复数据包
+//
+class ReplayRegistry
+{
+	struct Link
+	{
+		uint64_t processed = 0; //已处理序号
+		int32_t connections = 0; //正在使用的连接数量(旧连接尚未关闭时可能大于1)
+		std::chrono::steady_clock::time_point detached; //最近一个连接关闭的时间
+	};
+public:
+	static const int32_t DEFAULT_EXPIRE = 600; //没有连接使用后保留时长(秒)
+	static const int32_t EXPIRE_INTERVAL = 60; //删除超时连接标识的间隔(秒)，不超过保留时长
+
+	static ReplayRegistry& Instance()
+	{
+		static ReplayRegistry _instance;
+		return _instance;
+	}
+
+	//
+	//连接收到续传数据包，返回已处理序号
+	//
+	uint64_t Attach(uint64_t link_id)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto& link = _links[link_id];
+		++link.connections;
+
+		return link.processed;
+	}
+
+	//连接关闭或者重置
+	void Detach(uint64_t link_id)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _links.find(link_id);
+		if (it == _links.end()) return;
+
+		if (it->second.connections > 0) --it->second.connections;
+		it->second.detached = std::chrono::steady_clock::now();
+	}
+
+	uint64_t Get(uint64_t link_id)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _links.find(link_id);
+		if (it == _links.end()) return 0;
+
+		return it->second.processed;
+	}
+
+	void Update(uint64_t link_id, uint64_t sequence)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _links.find(link_id);
+		if (it == _links.end()) return; //已经超时删除
+
+		if (sequence > it->second.processed) it->second.processed = sequence; //旧连接尚未处理完时不回退
+	}
+
+	std::size_t Size()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _links.size();
+	}
+
+	//对端为服务器，接受的连接可以开启重发
+	bool IsServerAddress(const std::string& address) const { return _server_addresses.count(address) > 0; }
+
+	//
+	//网络线程定时调用：每隔一段时间删除没有连接使用且超时的连接标识，不在续传时遍历
+	//
+	void Expire()
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (now - _expire_time < _expire_interval) return;
+		_expire_time = now;
+
+		for (auto it = _links.begin(); it != _links.end(); )
+		{
+			if (it->second.connections > 0 || now - it->second.detached < _expire)
+			{
+				++it;
+				continue;
+			}
+
+			it = _links.erase(it);
+		}
+	}
+
+private:
+	ReplayRegistry()
+	{
+		_expire = std::chrono::seconds(ConfigInstance.GetInt("LinkReplayExpire", DEFAULT_EXPIRE));
+		_expire_interval = std::min(_expire, std::chrono::steady_clock::duration(std::chrono::seconds(int64_t(EXPIRE_INTERVAL))));
+		_expire_time = std::chrono::steady_clock::now();
+
+		std::stringstream stream(ConfigInstance.GetString("ServerLinkAddresses", ""));
+		for (std::string address; std::getline(stream, address, ','); )
+		{
+			if (!address.empty()) _server_addresses.insert(address);
+		}
+	}
+
+private:
+	std::mutex _mutex;
+	std::unordered_map<uint64_t/*连接标识*/, Link> _links;
+	std::chrono::steady_clock::duration _expire;
+	std::chrono::steady_clock::duration _expire_interval;
+	std::chrono::steady_clock::time_point _expire_time; //最近一次删除超时连接标识的时间
+	std::unordered_set<std::string> _server_addresses; //服务器地址
+};
+
+#define ReplayRegistryInstance ReplayRegistry::Instance()
+
+}
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <cstring>
+#include <utility>
 
 class MessageBuffer
 {
@@ -18,6 +19,8 @@ public:
         _storage.resize(initialSize);
     }
 
+    explicit MessageBuffer(std::vector<uint8_t>&& storage) : _wpos(0), _rpos(0), _storage(std::move(storage)) { }
+
     MessageBuffer(MessageBuffer const& right) : _wpos(right._wpos), _rpos(right._rpos), _storage(right._storage)
     {
     }
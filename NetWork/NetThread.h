@@ -3,150 +3,335 @@
 #include <memory>
 #include <atomic>
 #include <thread>
+#include <chrono>
+#include <unordered_map>
 
 #include <boost/asio.hpp>
 #include <boost/asio/deadline_timer.hpp>
 
 #include <spdlog/spdlog.h>
 
-namespace Adoter 
+#include "AsyncAcceptor.h"
+#include "LinkReplay.h"
+#include "ThreadAffinity.h"
+#include "TimingWheel.h"
+
+namespace Adoter
 {
 /*
  * 网络线程模型
  *
+ * 1.数据发送由入队时触发(投递到连接所在线程)，网络线程不再定时轮询所有连接;
+ *
+ * 2.连接放入时间轮(每秒一个刻度)，收到数据只更新活跃时间；到期时仍有收发的连接按活跃时间重新调度，只有真正空闲的连接才调用OnIdle;
+ *
+ * 3.可选每个网络线程独立监听同一端口(SO_REUSEPORT)，连接直接在本线程接收;
+ *
+ * 4.每个网络线程独立的io_service，连接在整个生命周期内只由所在线程处理，可选绑定CPU(NetworkThreadAffinity);
+ *
+ * 5.统计每个网络线程每秒收发的字节数和数据包数量，新连接分配到负载最低的线程(见ThreadLoad).
+ *
  * */
 
 using boost::asio::ip::tcp;
 
+//
+//网络线程负载：连接收发时累加，网络线程每秒计算一次速率
+//
+//负载分数 = 连接数 * PlacementConnectionWeight + 每秒数据包数量 * PlacementMessageWeight + 每秒KB数 * PlacementKBWeight
+//
+struct ThreadLoad
+{
+	std::atomic<int64_t> bytes{0}; //累计收发字节数
+	std::atomic<int64_t> messages{0}; //累计收发数据包数量
+
+	std::atomic<int64_t> bytes_per_second{0};
+	std::atomic<int64_t> messages_per_second{0};
+
+	void Add(std::size_t bytes_count, std::size_t message_count)
+	{
+		bytes.fetch_add(bytes_count, std::memory_order_relaxed);
+		messages.fetch_add(message_count, std::memory_order_relaxed);
+	}
+
+	//
+	//按距离上次计算的时长更新速率，和之前的速率平均，避免瞬时波动
+	//
+	void UpdateRate(double seconds)
+	{
+		if (seconds <= 0) return;
+
+		int64_t curr_bytes = bytes.load(std::memory_order_relaxed);
+		int64_t curr_messages = messages.load(std::memory_order_relaxed);
+
+		bytes_per_second = (bytes_per_second + int64_t((curr_bytes - _prev_bytes) / seconds)) / 2;
+		messages_per_second = (messages_per_second + int64_t((curr_messages - _prev_messages) / seconds)) / 2;
+
+		_prev_bytes = curr_bytes;
+		_prev_messages = curr_messages;
+	}
+
+	static int64_t GetScore(int32_t connections, int64_t bytes_per_second, int64_t messages_per_second)
+	{
+		static const int64_t connection_weight = ConfigInstance.GetInt("PlacementConnectionWeight", 100);
+		static const int64_t message_weight = ConfigInstance.GetInt("PlacementMessageWeight", 1);
+		static const int64_t kb_weight = ConfigInstance.GetInt("PlacementKBWeight", 1);
+
+		return connections * connection_weight + messages_per_second * message_weight + bytes_per_second / 1024 * kb_weight;
+	}
+
+private:
+	int64_t _prev_bytes = 0; //只在网络线程访问
+	int64_t _prev_messages = 0;
+};
+
 template<class SOCKET_TYPE>
 class NetworkThread
 {
-public:    
-	NetworkThread() : _connections(0), _stopped(false), _thread(nullptr), _accept_socket(_io_service), _update_timer(_io_service)    {    }
-	virtual ~NetworkThread()    
-	{        
-		Stop();        
-		
-		if (_thread) {            
+	typedef std::chrono::steady_clock Clock;
 
-			Wait();            
+	struct SocketEntry : public TimingWheel::Node
+	{
+		uint64_t socket_id; //线程内唯一，防止连接释放后地址复用
+		std::shared_ptr<SOCKET_TYPE> socket;
+	};
+public:
+	NetworkThread() : _connections(0), _stopped(false), _wheel(GetTick(Clock::now())), _thread(nullptr), _accept_socket(_io_service), _idle_timer(_io_service)
+	{
+		_idle_timeout = std::chrono::seconds(ConfigInstance.GetInt("IdleTimeout", 30)); //连接空闲时长
+	}
+
+	virtual ~NetworkThread()
+	{
+		Stop();
+
+		if (_thread) {
+
+			Wait();
 
-			if (_thread) _thread.reset();        
+			if (_thread) _thread.reset();
 		}
 	}
 
-	virtual void Stop() { 
+	virtual void Stop() {
 		_stopped = true;
+		if (_acceptor) _acceptor->Close();
 		_io_service.stop();
 	}
 
-	virtual bool Start() { 
-		
+	virtual bool Start() {
+
 		if (_thread) return false;
-		
+
 		_thread = std::make_shared<std::thread>(std::bind(&NetworkThread::Run, this));
-	
+
 		return true;
 	}
-	
-	virtual void Wait() { 
-		_thread->join();        
-		_thread.reset();        
+
+	virtual void Wait() {
+		_thread->join();
+		_thread.reset();
 	}
 
 	virtual int32_t GetConnectionCount() const { return _connections; }
 
+	const ThreadLoad& GetLoad() const { return _load; }
+	int64_t GetLoadScore() const { return ThreadLoad::GetScore(_connections, _load.bytes_per_second, _load.messages_per_second); }
+
+	//线程启动前设置，小于0不绑定
+	void SetAffinity(int32_t cpu, int32_t thread_index) 
+	{ 
+		_cpu = cpu; 
+		_thread_index = thread_index;
+	}
+
+	//
+	//连接加入网络线程，由网络线程自身完成加载
+	//
 	virtual void AddSocket(std::shared_ptr<SOCKET_TYPE> socket)
 	{
-		std::lock_guard<std::mutex> lock(_fresh_mutex);
+		if (!socket) return;
 
 		++_connections;
-		_fresh_list.push_back(socket);
-		SocketAdded(socket); //目前无用途
+		_io_service.post(std::bind(&NetworkThread<SOCKET_TYPE>::OnSocketAdded, this, socket));
 	}
 
 	tcp::socket* GetSocketForAccept() { return &_accept_socket; }
 
-	//把添加的SOCKET都加载进来
-	virtual void AddSockets()
+	//
+	//本线程独立监听(SO_REUSEPORT)，接收的连接直接属于本线程
+	//
+	bool StartAcceptor(const std::string& bind_ip, int32_t port, int32_t thread_index, AsyncAcceptor::AcceptCallback accept_callback)
 	{
-		std::lock_guard<std::mutex> lock(_fresh_mutex);
-
-		if (_fresh_list.empty()) return;
+		if (_acceptor) return false;
 
-		for (auto socket : _fresh_list)
+		try
 		{
-			if (socket && socket->IsOpen())
-			{
-				_socket_list.push_back(socket);
-			}
-			else
-			{
-				--_connections;
-				SocketRemoved(socket); //目前无用途
-			}
+			_acceptor.reset(new AsyncAcceptor(_io_service, bind_ip, port, true));
+		}
+		catch (const boost::system::system_error& error)
+		{
+			ERROR("网络线程监听失败，地址:{} 端口:{} 错误码:{}", bind_ip, port, error.what());
+			return false;
 		}
 
-		_fresh_list.clear();
+		_acceptor->SetSocketFactory([this, thread_index]() { return std::make_pair(&_accept_socket, thread_index); });
+		_io_service.post([this, accept_callback]() { _acceptor->AsyncAcceptWithCallback(accept_callback); });
+
+		return true;
 	}
 
 	virtual void Run()
 	{
-		_update_timer.expires_from_now(boost::posix_time::milliseconds(10));
-		_update_timer.async_wait(std::bind(&NetworkThread<SOCKET_TYPE>::Update, this));        
-		
+		if (_cpu >= 0) ThreadAffinity::Bind(_cpu, "网络线程" + std::to_string(_thread_index));
+
+		StartIdleTimer();
+
 		_io_service.run();
 
-		_socket_list.clear();        
-		_fresh_list.clear();
+		for (auto& entry : _sockets) 
+		{
+			_wheel.Cancel(entry.second.get());
+			entry.second->socket->SetCloseHandler(nullptr);
+		}
+
+		_sockets.clear();
 	}
-	
-	virtual void Update() //每10毫秒检查一次，删除不活跃的连接
+
+	//
+	//空闲检查：推进时间轮，只处理到期的连接
+	//
+	virtual void Update()
 	{
 		try
 		{
 			if (_stopped) return;
 
-			_update_timer.expires_from_now(boost::posix_time::milliseconds(10));
-			_update_timer.async_wait(std::bind(&NetworkThread<SOCKET_TYPE>::Update, this));        
-
-			AddSockets(); //删除不连接的SOCKET，同时更新新连接的SOCKET
-
-			_socket_list.erase(std::remove_if(_socket_list.begin(), _socket_list.end(), [this] (std::shared_ptr<SOCKET_TYPE> socket) {
-				if (!socket || !socket->Update())
-				{
-					if (socket && socket->IsOpen()) socket->Close();
-					SocketRemoved(socket);
-					--_connections;
-					return true;
-				}
-				return false;
-			}), _socket_list.end()); 
+			StartIdleTimer();
+
+			auto now = Clock::now();
+
+			_load.UpdateRate(std::chrono::duration<double>(now - _load_time).count());
+			_load_time = now;
+
+			_wheel.Advance(GetTick(now), [this, now](TimingWheel::Node* node) {
+				OnSocketExpired(static_cast<SocketEntry*>(node), now);
+			});
+
+			ReplayRegistryInstance.Expire(); //服务器之间连接的续传标识超时删除
 		}
 		catch (const boost::system::system_error& error)
 		{
 		}
 	}
 protected:
-	virtual void SocketAdded(std::shared_ptr<SOCKET_TYPE> socket) { 
+	virtual void SocketAdded(std::shared_ptr<SOCKET_TYPE> socket) {
 		if (!socket) return;
-	}    
-	virtual void SocketRemoved(std::shared_ptr<SOCKET_TYPE> socket) { 
+	}
+	virtual void SocketRemoved(std::shared_ptr<SOCKET_TYPE> socket) {
 		if (!socket) return;
 	}
 private:
-	std::vector<std::shared_ptr<SOCKET_TYPE>> _socket_list; //连接的SOCKET列表
-	std::atomic<int32_t> _connections;    
+	static uint64_t GetTick(Clock::time_point time_point) { return std::chrono::duration_cast<std::chrono::seconds>(time_point.time_since_epoch()).count(); }
+
+	//
+	//时间轮到期：期间收到过数据则按最近活跃时间重新调度，否则为空闲连接
+	//
+	void OnSocketExpired(SocketEntry* entry, Clock::time_point now)
+	{
+		auto socket = entry->socket;
+
+		if (!socket->IsClosed())
+		{
+			auto active_time = socket->GetActiveTime();
+
+			if (now - active_time < _idle_timeout)
+			{
+				_wheel.Schedule(entry, GetTick(active_time + _idle_timeout));
+				return;
+			}
+
+			socket->OnIdle(); //长时间没有收到数据
+		}
+
+		if (socket->IsClosed()) //空闲处理中可能关闭连接
+		{
+			RemoveSocket(entry->socket_id);
+			return;
+		}
+
+		_wheel.Schedule(entry, GetTick(now + _idle_timeout));
+	}
+
+	void StartIdleTimer()
+	{
+		_idle_timer.expires_from_now(boost::posix_time::seconds(1));
+		_idle_timer.async_wait(std::bind(&NetworkThread<SOCKET_TYPE>::Update, this));
+	}
+
+	void OnSocketAdded(std::shared_ptr<SOCKET_TYPE> socket)
+	{
+		if (!socket->IsOpen())
+		{
+			--_connections;
+			SocketRemoved(socket);
+			return;
+		}
+
+		auto socket_id = ++_socket_counter;
+
+		socket->SetThreadLoad(&_load);
+
+		//连接关闭时投递到网络线程进行删除
+		socket->SetCloseHandler([this, socket_id]() {
+			_io_service.post(std::bind(&NetworkThread<SOCKET_TYPE>::RemoveSocket, this, socket_id));
+		});
+
+		auto& entry = _sockets[socket_id];
+		entry.reset(new SocketEntry());
+		entry->socket_id = socket_id;
+		entry->socket = socket;
+
+		_wheel.Schedule(entry.get(), GetTick(Clock::now() + _idle_timeout));
+
+		SocketAdded(socket);
+
+		if (socket->IsClosed()) RemoveSocket(socket_id); //加入前已经关闭
+	}
+
+	void RemoveSocket(uint64_t socket_id)
+	{
+		auto it = _sockets.find(socket_id);
+		if (it == _sockets.end()) return; //已经删除
+
+		auto socket = it->second->socket;
+
+		_wheel.Cancel(it->second.get());
+		_sockets.erase(it);
+
+		if (socket->IsOpen()) socket->Close();
+
+		--_connections;
+		SocketRemoved(socket);
+	}
+private:
+	std::unordered_map<uint64_t, std::unique_ptr<SocketEntry>> _sockets; //本线程的连接
+	uint64_t _socket_counter = 0;
+	std::atomic<int32_t> _connections;
 	std::atomic<bool> _stopped;
-	
-	std::shared_ptr<std::thread> _thread;	
-	
-	std::mutex _fresh_mutex;
-	std::vector<std::shared_ptr<SOCKET_TYPE>> _fresh_list; //新连接的SOCKET列表
+	TimingWheel _wheel; //空闲检查，只在网络线程访问
+	Clock::duration _idle_timeout;
+	ThreadLoad _load; //本线程收发统计
+	Clock::time_point _load_time = Clock::now();
+
+	std::shared_ptr<std::thread> _thread;
+	int32_t _cpu = -1; //绑定的CPU
+	int32_t _thread_index = 0;
 
 	boost::asio::io_service _io_service;
 	tcp::socket _accept_socket;
-	boost::asio::deadline_timer _update_timer;
+	boost::asio::deadline_timer _idle_timer;
+	std::unique_ptr<AsyncAcceptor> _acceptor; //独立监听(SO_REUSEPORT)
 };
 
 }
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <unordered_map>
+
+#include "FrameBuffer.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 玩家发件箱(连接开启后生效)
+ *
+ * 1.一次世界刷新或者一次接收处理期间(OutboxScope)，本线程发往同一连接的数据包先缓存;
+ *
+ * 2.作用域结束时每个连接缓存的数据包一起入队：对端支持批量时合并为批量数据包，否则同一次发送(writev);
+ *
+ * 3.延迟敏感的协议类型(OutboxBypassTypes)和可丢弃的数据包直接入队，该连接之前缓存的数据包先入队，保证顺序.
+ *
+ * */
+
+//
+//发件箱的目标连接
+//
+class OutboxTarget
+{
+public:
+	virtual ~OutboxTarget() { }
+
+	//作用域结束时由缓存数据包的线程调用
+	virtual void FlushOutbox(std::vector<FramePtr>& frames) = 0;
+};
+
+//
+//直接发送的协议类型及合并统计
+//
+class OutboxPolicy
+{
+public:
+	static const int32_t MAX_TYPE_COUNT = 2048; //协议类型上限
+
+	static OutboxPolicy& Instance()
+	{
+		static OutboxPolicy _instance;
+		return _instance;
+	}
+
+	//default_types：未配置OutboxBypassTypes时直接发送的协议类型
+	void Load(const std::vector<int32_t>& default_types)
+	{
+		std::vector<int32_t> types;
+
+		std::stringstream stream(ConfigInstance.GetString("OutboxBypassTypes", ""));
+		for (std::string type; std::getline(stream, type, ','); )
+		{
+			if (!type.empty()) types.push_back(std::atoi(type.c_str()));
+		}
+
+		for (auto& bypass : _bypass) bypass = false;
+		for (auto type_t : types.empty() ? default_types : types) SetBypass(type_t);
+	}
+
+	void SetBypass(int32_t type_t, bool bypass = true)
+	{
+		if (type_t <= 0 || type_t >= MAX_TYPE_COUNT) return;
+		_bypass[type_t] = bypass;
+	}
+
+	bool IsBypass(int32_t type_t) const { return type_t > 0 && type_t < MAX_TYPE_COUNT && _bypass[type_t]; }
+
+	//一个连接一次合并：缓存的数据包数量，实际入队的数据包数量
+	void Record(std::size_t messages, std::size_t frames)
+	{
+		_flush_count.fetch_add(1, std::memory_order_relaxed);
+		_message_count.fetch_add(messages, std::memory_order_relaxed);
+		_frame_count.fetch_add(frames, std::memory_order_relaxed);
+	}
+
+	void Report()
+	{
+		int64_t flushes = _flush_count.exchange(0);
+		int64_t messages = _message_count.exchange(0);
+		int64_t frames = _frame_count.exchange(0);
+
+		if (flushes == 0) return;
+
+		LOG(INFO, "玩家发件箱统计，合并次数:{} 数据包数量:{} 实际发送数据包数量:{} 平均每次合并数量:{}",
+				flushes, messages, frames, frames ? double(messages) / frames : 0);
+	}
+
+private:
+	std::atomic<bool> _bypass[MAX_TYPE_COUNT] = {};
+	std::atomic<int64_t> _flush_count{0};
+	std::atomic<int64_t> _message_count{0};
+	std::atomic<int64_t> _frame_count{0};
+};
+
+#define OutboxPolicyInstance OutboxPolicy::Instance()
+
+//
+//线程内的发件箱，按连接首次缓存的顺序发送
+//
+class Outbox
+{
+	typedef std::pair<std::shared_ptr<OutboxTarget>, std::vector<FramePtr>> Entry;
+public:
+	static Outbox& Local()
+	{
+		static thread_local Outbox _outbox;
+		return _outbox;
+	}
+
+	bool IsOpen() const { return _depth > 0; }
+
+	void Open() { ++_depth; }
+
+	void Close()
+	{
+		if (_depth > 0 && --_depth == 0) FlushAll(); //嵌套时最外层结束才发送
+	}
+
+	void Defer(std::shared_ptr<OutboxTarget> target, const FramePtr& frame)
+	{
+		auto it = _index.find(target.get());
+		if (it == _index.end())
+		{
+			it = _index.emplace(target.get(), _entries.size()).first;
+			_entries.emplace_back(std::move(target), std::vector<FramePtr>());
+		}
+
+		_entries[it->second].second.push_back(frame);
+	}
+
+	//该连接缓存的数据包立即入队
+	void Flush(OutboxTarget* target)
+	{
+		auto it = _index.find(target);
+		if (it == _index.end()) return;
+
+		auto& frames = _entries[it->second].second;
+		if (frames.empty()) return;
+
+		target->FlushOutbox(frames);
+		frames.clear();
+	}
+
+	void FlushAll()
+	{
+		std::vector<Entry> entries;
+		entries.swap(_entries);
+		_index.clear();
+
+		for (auto& entry : entries)
+		{
+			if (!entry.second.empty()) entry.first->FlushOutbox(entry.second);
+		}
+	}
+
+private:
+	int32_t _depth = 0;
+	std::vector<Entry> _entries;
+	std::unordered_map<OutboxTarget*, std::size_t> _index;
+};
+
+//
+//作用域内本线程发往开启发件箱的连接的数据包一起发送
+//
+class OutboxScope
+{
+public:
+	OutboxScope() { Outbox::Local().Open(); }
+	~OutboxScope() { Outbox::Local().Close(); }
+
+	OutboxScope(const OutboxScope&) = delete;
+	OutboxScope& operator = (const OutboxScope&) = delete;
+};
+
+}
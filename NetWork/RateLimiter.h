@@ -0,0 +1,256 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 客户端限流(令牌桶)
+ *
+ * 1.每个连接一个总令牌桶，另外按协议类型配置单独的令牌桶(比如登录、战绩、回放等需要同步访问数据库的协议);
+ *
+ * 2.在解析协议内容之前检查，超出限制时按规则处理：丢弃、延迟(暂停接收该连接的数据，令牌恢复后继续)、断开连接;
+ *
+ * 3.规则格式："速率(每秒):容量:处理方式"，协议类型规则为"协议类型:速率:容量:处理方式"，逗号分隔;
+ *
+ *   配置项：RateLimitConnection(默认"100:200:delay") RateLimitTypes(未配置时使用默认规则);
+ *
+ * 4.按协议类型统计超出限制的次数，定期输出.
+ *
+ * */
+
+enum RATE_LIMIT_ACTION
+{
+	RATE_LIMIT_ACTION_PASS = 0, //通过
+	RATE_LIMIT_ACTION_DROP = 1, //丢弃
+	RATE_LIMIT_ACTION_DELAY = 2, //延迟处理
+	RATE_LIMIT_ACTION_DISCONNECT = 3, //断开连接
+	RATE_LIMIT_ACTION_COUNT = 4,
+};
+
+struct RateLimitRule
+{
+	int32_t type_t = 0; //协议类型，0为连接总限制
+	double rate = 0; //每秒令牌数量，小于等于0不限制
+	double burst = 0; //令牌桶容量
+	RATE_LIMIT_ACTION action = RATE_LIMIT_ACTION_DROP;
+};
+
+//
+//令牌桶，只在连接所在线程访问
+//
+struct TokenBucket
+{
+	double tokens = -1; //小于0表示尚未初始化(首次使用时为满)
+	int64_t update_time = 0; //微秒
+
+	//
+	//消耗一个令牌，不足时返回需要等待的时长(微秒)，否则返回0
+	//
+	int64_t Consume(const RateLimitRule& rule, int64_t now)
+	{
+		if (rule.rate <= 0) return 0;
+
+		if (tokens < 0)
+		{
+			tokens = rule.burst;
+		}
+		else if (now > update_time)
+		{
+			tokens = std::min(rule.burst, tokens + (now - update_time) * rule.rate / 1000000);
+		}
+
+		update_time = now;
+
+		if (tokens >= 1)
+		{
+			tokens -= 1;
+			return 0;
+		}
+
+		return std::max<int64_t>(1, int64_t((1 - tokens) * 1000000 / rule.rate));
+	}
+};
+
+class RateLimitPolicy
+{
+public:
+	static const int32_t MAX_TYPE_COUNT = 2048; //协议类型上限
+
+	RateLimitPolicy()
+	{
+		for (auto& index : _rule_index) index = -1;
+	}
+
+	static RateLimitPolicy& Instance()
+	{
+		static RateLimitPolicy _instance;
+		return _instance;
+	}
+
+	//default_rules：未配置RateLimitTypes时使用的协议类型规则
+	void Load(const std::string& default_connection, const std::string& default_rules)
+	{
+		_enabled = ConfigInstance.GetBool("RateLimit", true);
+
+		std::vector<RateLimitRule> rules;
+		Parse(ConfigInstance.GetString("RateLimitConnection", default_connection), false, rules);
+		_connection = rules.empty() ? RateLimitRule() : rules.front();
+
+		rules.clear();
+		Parse(ConfigInstance.GetString("RateLimitTypes", default_rules), true, rules);
+
+		for (auto& index : _rule_index) index = -1;
+		_rules.clear();
+
+		for (const auto& rule : rules)
+		{
+			if (rule.type_t <= 0 || rule.type_t >= MAX_TYPE_COUNT) continue;
+
+			_rule_index[rule.type_t] = _rules.size();
+			_rules.push_back(rule);
+		}
+	}
+
+	bool IsEnabled() const { return _enabled; }
+
+	const RateLimitRule& GetConnectionRule() const { return _connection; }
+	const std::vector<RateLimitRule>& GetRules() const { return _rules; }
+
+	//协议类型对应的规则序号，没有规则返回-1
+	int32_t GetRuleIndex(int32_t type_t) const { return type_t > 0 && type_t < MAX_TYPE_COUNT ? _rule_index[type_t] : -1; }
+
+	void Record(int32_t type_t, RATE_LIMIT_ACTION action)
+	{
+		_action_count[action].fetch_add(1, std::memory_order_relaxed);
+		if (type_t > 0 && type_t < MAX_TYPE_COUNT) _type_count[type_t].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	int64_t GetActionCount(RATE_LIMIT_ACTION action) const { return _action_count[action].load(std::memory_order_relaxed); }
+
+	//输出距上次输出以来超出限制的次数
+	void Report()
+	{
+		int64_t drop_count = _action_count[RATE_LIMIT_ACTION_DROP].exchange(0);
+		int64_t delay_count = _action_count[RATE_LIMIT_ACTION_DELAY].exchange(0);
+		int64_t disconnect_count = _action_count[RATE_LIMIT_ACTION_DISCONNECT].exchange(0);
+
+		if (drop_count + delay_count + disconnect_count == 0) return;
+
+		LOG(INFO, "客户端限流统计，丢弃:{} 延迟:{} 断开连接:{}", drop_count, delay_count, disconnect_count);
+
+		for (int32_t type_t = 1; type_t < MAX_TYPE_COUNT; ++type_t)
+		{
+			int64_t count = _type_count[type_t].exchange(0);
+			if (count > 0) LOG(INFO, "客户端限流统计，协议类型:{} 超出限制次数:{}", type_t, count);
+		}
+	}
+
+	static RATE_LIMIT_ACTION ParseAction(const std::string& action)
+	{
+		if (action == "delay") return RATE_LIMIT_ACTION_DELAY;
+		if (action == "disconnect") return RATE_LIMIT_ACTION_DISCONNECT;
+		return RATE_LIMIT_ACTION_DROP;
+	}
+
+private:
+	static void Parse(const std::string& config, bool with_type, std::vector<RateLimitRule>& rules)
+	{
+		std::stringstream stream(config);
+
+		for (std::string item; std::getline(stream, item, ','); )
+		{
+			if (item.empty()) continue;
+
+			std::vector<std::string> fields;
+			std::stringstream item_stream(item);
+			for (std::string field; std::getline(item_stream, field, ':'); ) fields.push_back(field);
+
+			std::size_t offset = with_type ? 1 : 0;
+			if (fields.size() < offset + 2)
+			{
+				WARN("限流规则配置错误:{}", item);
+				continue;
+			}
+
+			RateLimitRule rule;
+			if (with_type) rule.type_t = std::atoi(fields[0].c_str());
+			rule.rate = std::atof(fields[offset].c_str());
+			rule.burst = std::max(1.0, std::atof(fields[offset + 1].c_str()));
+			if (fields.size() > offset + 2) rule.action = ParseAction(fields[offset + 2]);
+
+			rules.push_back(rule);
+		}
+	}
+
+private:
+	bool _enabled = true;
+	RateLimitRule _connection;
+	std::vector<RateLimitRule> _rules;
+	int32_t _rule_index[MAX_TYPE_COUNT] = {};
+	std::atomic<int64_t> _action_count[RATE_LIMIT_ACTION_COUNT] = {};
+	std::atomic<int64_t> _type_count[MAX_TYPE_COUNT] = {};
+};
+
+#define RateLimitPolicyInstance RateLimitPolicy::Instance()
+
+//
+//单个连接的限流状态
+//
+class RateLimiter
+{
+public:
+	//
+	//检查一个数据包，返回处理方式；延迟时wait为需要等待的时长(微秒)
+	//
+	RATE_LIMIT_ACTION Check(int32_t type_t, int64_t now, int64_t& wait)
+	{
+		wait = 0;
+
+		const auto& policy = RateLimitPolicyInstance;
+		if (!policy.IsEnabled()) return RATE_LIMIT_ACTION_PASS;
+
+		const auto& connection_rule = policy.GetConnectionRule();
+
+		wait = _connection.Consume(connection_rule, now);
+		if (wait > 0) return OnLimited(type_t, connection_rule.action);
+
+		int32_t index = policy.GetRuleIndex(type_t);
+		if (index < 0) return RATE_LIMIT_ACTION_PASS;
+
+		const auto& rules = policy.GetRules();
+		if (index >= int32_t(rules.size())) return RATE_LIMIT_ACTION_PASS; //规则重新加载
+
+		if (_buckets.size() < rules.size()) _buckets.resize(rules.size());
+
+		wait = _buckets[index].Consume(rules[index], now);
+		if (wait > 0) 
+		{
+			if (connection_rule.rate > 0) _connection.tokens += 1; //未处理，退回连接令牌
+			return OnLimited(type_t, rules[index].action);
+		}
+
+		return RATE_LIMIT_ACTION_PASS;
+	}
+
+private:
+	RATE_LIMIT_ACTION OnLimited(int32_t type_t, RATE_LIMIT_ACTION action)
+	{
+		RateLimitPolicyInstance.Record(type_t, action);
+		return action;
+	}
+
+private:
+	TokenBucket _connection;
+	std::vector<TokenBucket> _buckets; //按规则序号
+};
+
+}
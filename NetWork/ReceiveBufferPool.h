@@ -0,0 +1,181 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace Adoter
+{
+
+/*
+ * 接收缓存内存池
+ *
+ * 1.接收缓存按容量分级，从小缓存开始，收到大数据包时换用更大一级，空闲后归还;
+ *
+ * 2.同FramePool，每个线程优先使用本线程缓存，不足或者超出时和全局缓存交换;
+ *
+ * 3.超过最大一级的缓存不缓存，用完直接释放.
+ *
+ * */
+
+//接收缓存统计，进程内所有连接
+struct ReceiveBufferStatistics
+{
+	std::atomic<int64_t> buffer_count; //连接正在使用的缓存数量
+	std::atomic<int64_t> buffer_bytes; //连接正在使用的缓存字节数
+	std::atomic<int64_t> grow_count; //扩容次数
+	std::atomic<int64_t> shrink_count; //缩容或者归还次数
+
+	ReceiveBufferStatistics() : buffer_count(0), buffer_bytes(0), grow_count(0), shrink_count(0) { }
+};
+
+class ReceiveBufferPool
+{
+public:
+	typedef std::vector<uint8_t> Buffer;
+
+	static const std::size_t CLASS_COUNT = 6;
+	static const std::size_t MAX_THREAD_CACHED_BYTES = 2 * 1024 * 1024; //每个线程每级最多缓存字节数
+	static const std::size_t MAX_GLOBAL_CACHED_BYTES = 16 * 1024 * 1024; //全局每级最多缓存字节数
+
+	static ReceiveBufferPool& Instance()
+	{
+		static ReceiveBufferPool _instance;
+		return _instance;
+	}
+
+	//
+	//获取不小于size的缓存
+	//
+	Buffer Acquire(std::size_t size)
+	{
+		Buffer buffer;
+
+		int32_t index = GetClassIndex(size);
+		if (index < 0)
+		{
+			buffer.resize(size); //超大缓存不缓存
+		}
+		else
+		{
+			auto& local = GetThreadCache().buffers[index];
+			if (local.empty())
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				auto& global = _buffers[index];
+				std::size_t count = std::min(global.size(), GetMaxCached(index, MAX_THREAD_CACHED_BYTES) / 2); //批量获取，减少加锁次数
+
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					local.push_back(std::move(global.back()));
+					global.pop_back();
+				}
+			}
+
+			if (local.empty())
+			{
+				buffer.resize(GetClassCapacity(index));
+			}
+			else
+			{
+				buffer = std::move(local.back());
+				local.pop_back();
+			}
+		}
+
+		_statistics.buffer_count += 1;
+		_statistics.buffer_bytes += buffer.size();
+
+		return buffer;
+	}
+
+	void Release(Buffer&& buffer)
+	{
+		if (buffer.empty()) return;
+
+		_statistics.buffer_count -= 1;
+		_statistics.buffer_bytes -= buffer.size();
+
+		int32_t index = GetClassIndex(buffer.size());
+		if (index < 0 || GetClassCapacity(index) != buffer.size())
+		{
+			Buffer().swap(buffer);
+			return;
+		}
+
+		auto& local = GetThreadCache().buffers[index];
+		local.push_back(std::move(buffer));
+
+		std::size_t max_cached = GetMaxCached(index, MAX_THREAD_CACHED_BYTES);
+		if (local.size() >= max_cached) Flush(index, local, max_cached / 2);
+	}
+
+	//下一级容量，超过最大一级时按1.5倍增长
+	static std::size_t GetNextCapacity(std::size_t size)
+	{
+		int32_t index = GetClassIndex(size + 1);
+		return index < 0 ? size * 3 / 2 : GetClassCapacity(index);
+	}
+
+	static std::size_t GetMinCapacity() { return GetClassCapacity(0); }
+
+	const ReceiveBufferStatistics& GetStatistics() const { return _statistics; }
+	ReceiveBufferStatistics& GetStatistics() { return _statistics; }
+
+private:
+	struct ThreadCache
+	{
+		std::vector<Buffer> buffers[CLASS_COUNT];
+
+		~ThreadCache() //线程退出归还全局
+		{
+			for (std::size_t i = 0; i < CLASS_COUNT; ++i) ReceiveBufferPool::Instance().Flush(i, buffers[i], buffers[i].size());
+		}
+	};
+
+	static ThreadCache& GetThreadCache()
+	{
+		static thread_local ThreadCache _cache;
+		return _cache;
+	}
+
+	static std::size_t GetClassCapacity(std::size_t index)
+	{
+		static const std::size_t capacities[CLASS_COUNT] = { 512, 2048, 8192, 32768, 65536, 262144 };
+		return capacities[index];
+	}
+
+	//容量越大缓存数量越少
+	static std::size_t GetMaxCached(std::size_t index, std::size_t max_bytes) { return std::max(max_bytes / GetClassCapacity(index), std::size_t(4)); }
+
+	static int32_t GetClassIndex(std::size_t size)
+	{
+		for (std::size_t i = 0; i < CLASS_COUNT; ++i)
+			if (size <= GetClassCapacity(i)) return i;
+		return -1;
+	}
+
+	void Flush(std::size_t index, std::vector<Buffer>& local, std::size_t count)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto& global = _buffers[index];
+		for (std::size_t i = 0; i < count && !local.empty(); ++i)
+		{
+			if (global.size() < GetMaxCached(index, MAX_GLOBAL_CACHED_BYTES)) global.push_back(std::move(local.back()));
+			local.pop_back();
+		}
+	}
+
+private:
+	std::mutex _mutex;
+	std::vector<Buffer> _buffers[CLASS_COUNT];
+	ReceiveBufferStatistics _statistics;
+};
+
+#define ReceiveBufferPoolInstance ReceiveBufferPool::Instance()
+
+}
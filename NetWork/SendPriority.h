@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+#include "FrameBuffer.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 发送优先级(玩家连接)
+ *
+ * 1.发送队列按优先级分为实时(对局操作)、普通、批量(战绩、回放、全服广播)三个队列，协议类型决定优先级;
+ *
+ * 2.每次合并发送前按权重从各队列取出数据包：实时队列先取，每个队列每轮最多取 权重*4K 字节，
+ *
+ *   额度不足的大数据包累积额度后发送，期间其他队列继续发送，批量数据不会长时间阻塞实时数据;
+ *
+ * 3.同一队列内保持入队顺序，对局内有先后依赖的协议应配置为同一优先级(默认全部为实时);
+ *
+ * 4.已经开始发送的数据包不能打断，另外限制内核中未发送的字节数(TCP_NOTSENT_LOWAT)，实时数据包最多等待一个数据包和该字节数;
+ *
+ *   数据包在TCP字节流中必须连续，扩展数据包(超过64K)的分块不能和其他数据包交错发送，实时数据包最多等待一个完整的批量数据包;
+ *
+ *   拆分大数据包需要客户端支持分片协议(新的能力标识及重组)，当前不支持，批量协议应控制单个数据包大小;
+ *
+ * 5.服务器之间的连接、开启断线续传的玩家连接按入队顺序发送(断线重发、续传按顺序计数，见LinkReplay、SessionResume).
+ *
+ * 配置项：SendPriority(默认开启) SendRealtimeTypes SendBulkTypes SendLaneWeights(默认"8:4:1") SendNotSentLowat(字节，0为不限制)
+ *
+ * */
+class SendPriorityPolicy
+{
+public:
+	static const int32_t MAX_TYPE_COUNT = 2048; //协议类型上限
+	static const int32_t DEFAULT_NOTSENT_LOWAT = 16384;
+
+	SendPriorityPolicy()
+	{
+		for (auto& priority : _priorities) priority = SEND_PRIORITY_NORMAL;
+	}
+
+	static SendPriorityPolicy& Instance()
+	{
+		static SendPriorityPolicy _instance;
+		return _instance;
+	}
+
+	//default_realtime、default_bulk：未配置SendRealtimeTypes、SendBulkTypes时的协议类型
+	void Load(const std::vector<int32_t>& default_realtime, const std::vector<int32_t>& default_bulk)
+	{
+		_enabled = ConfigInstance.GetBool("SendPriority", true);
+		_notsent_lowat = ConfigInstance.GetInt("SendNotSentLowat", DEFAULT_NOTSENT_LOWAT);
+
+		for (auto& priority : _priorities) priority = SEND_PRIORITY_NORMAL;
+
+		auto realtime = ParseList(ConfigInstance.GetString("SendRealtimeTypes", ""));
+		for (auto type_t : realtime.empty() ? default_realtime : realtime) SetPriority(type_t, SEND_PRIORITY_REALTIME);
+
+		auto bulk = ParseList(ConfigInstance.GetString("SendBulkTypes", ""));
+		for (auto type_t : bulk.empty() ? default_bulk : bulk) SetPriority(type_t, SEND_PRIORITY_BULK);
+
+		_weights = { 8, 4, 1 };
+
+		std::stringstream stream(ConfigInstance.GetString("SendLaneWeights", ""));
+		std::size_t index = 0;
+		for (std::string weight; std::getline(stream, weight, ':') && index < _weights.size(); ++index)
+		{
+			_weights[index] = std::max(1, std::atoi(weight.c_str())); //每个队列至少有额度，不会饿死
+		}
+	}
+
+	void SetPriority(int32_t type_t, SEND_PRIORITY priority)
+	{
+		if (type_t <= 0 || type_t >= MAX_TYPE_COUNT) return;
+		_priorities[type_t] = priority;
+	}
+
+	SEND_PRIORITY GetPriority(int32_t type_t) const
+	{
+		if (type_t <= 0 || type_t >= MAX_TYPE_COUNT) return SEND_PRIORITY_NORMAL;
+		return _priorities[type_t];
+	}
+
+	bool IsEnabled() const { return _enabled; }
+	const std::vector<int32_t>& GetWeights() const { return _weights; }
+	int32_t GetNotSentLowat() const { return _notsent_lowat; }
+
+private:
+	static std::vector<int32_t> ParseList(const std::string& config)
+	{
+		std::vector<int32_t> types;
+
+		std::stringstream stream(config);
+		for (std::string type; std::getline(stream, type, ','); )
+		{
+			if (!type.empty()) types.push_back(std::atoi(type.c_str()));
+		}
+
+		return types;
+	}
+
+private:
+	bool _enabled = true;
+	int32_t _notsent_lowat = DEFAULT_NOTSENT_LOWAT;
+	std::vector<int32_t> _weights = { 8, 4, 1 }; //按优先级
+	SEND_PRIORITY _priorities[MAX_TYPE_COUNT];
+};
+
+#define SendPriorityPolicyInstance SendPriorityPolicy::Instance()
+
+}
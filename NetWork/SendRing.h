@@ -0,0 +1,185 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <utility>
+
+#include "FrameBuffer.h"
+
+namespace Adoter
+{
+
+/*
+ * 发送环形队列(多生产者单消费者)
+ *
+ * 1.任意线程入队不加锁，只在多个线程同时竞争同一位置时重试;
+ *
+ * 2.只有连接所在的网络线程(持有发送锁)出队，转入发送队列;
+ *
+ * 3.容量固定，队列已满时入队失败：可以丢弃的数据包由调用方按拥塞丢弃处理，必须发送的数据包写入溢出队列(只有溢出队列的锁，不加发送锁);
+ *
+ * 4.溢出队列不为空时后续数据包均写入溢出队列，出队时先取环形队列再取溢出队列，保证同一线程入队的顺序.
+ *
+ * */
+
+class SendRing
+{
+	struct Cell
+	{
+		std::atomic<std::size_t> sequence; //生产者和消费者按此判断位置是否可用
+		FramePtr frame;
+		uint32_t tag;
+	};
+public:
+	static const std::size_t DEFAULT_CAPACITY = 256;
+
+	explicit SendRing(std::size_t capacity = DEFAULT_CAPACITY)
+	{
+		std::size_t size = 2;
+		while (size < capacity) size <<= 1; //容量取2的幂
+
+		_mask = size - 1;
+		_cells.reset(new Cell[size]);
+
+		for (std::size_t i = 0; i < size; ++i) _cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	SendRing(const SendRing&) = delete;
+	SendRing& operator = (const SendRing&) = delete;
+
+	//
+	//入队，任意线程调用，队列已满(或者溢出队列不为空)返回false
+	//
+	bool Push(const FramePtr& frame, uint32_t tag)
+	{
+		if (_spilled.load(std::memory_order_acquire)) return false; //溢出队列中有之前的数据包
+
+		std::size_t position = _tail.load(std::memory_order_relaxed);
+		Cell* cell = nullptr;
+
+		for (;;)
+		{
+			cell = &_cells[position & _mask];
+
+			std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = intptr_t(sequence) - intptr_t(position);
+
+			if (diff == 0)
+			{
+				if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+			}
+			else if (diff < 0) //消费者尚未取走
+			{
+				_full_count.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				position = _tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->frame = frame;
+		cell->tag = tag;
+		cell->sequence.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	//
+	//入队失败时写入溢出队列，任意线程调用
+	//
+	void Spill(const FramePtr& frame, uint32_t tag)
+	{
+		std::lock_guard<std::mutex> lock(_spill_lock);
+
+		_spill.emplace_back(frame, tag);
+		_spilled.store(true, std::memory_order_release);
+
+		_spill_count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//
+	//全部出队，同一时刻只能有一个消费者(持有发送锁)
+	//
+	//HANDLER：void(const FramePtr&, uint32_t)
+	//
+	template <typename HANDLER>
+	void Drain(HANDLER&& handler)
+	{
+		FramePtr frame;
+		uint32_t tag = 0;
+
+		while (Pop(frame, tag)) handler(frame, tag);
+
+		if (!_spilled.load(std::memory_order_acquire)) return;
+
+		std::deque<std::pair<FramePtr, uint32_t>> spill;
+
+		{
+			std::lock_guard<std::mutex> lock(_spill_lock); //溢出期间生产者不再写入环形队列
+
+			while (Pop(frame, tag)) handler(frame, tag); //溢出之前写入环形队列的数据包
+
+			spill.swap(_spill);
+			_spilled.store(false, std::memory_order_release);
+		}
+
+		for (auto& entry : spill) handler(entry.first, entry.second);
+	}
+
+	//
+	//出队，同一时刻只能有一个消费者(持有发送锁)
+	//
+	bool Pop(FramePtr& frame, uint32_t& tag)
+	{
+		Cell* cell = &_cells[_head & _mask];
+
+		if (cell->sequence.load(std::memory_order_acquire) != _head + 1) return false; //为空或者生产者尚未写完
+
+		frame = std::move(cell->frame);
+		tag = cell->tag;
+
+		cell->sequence.store(_head + _mask + 1, std::memory_order_release);
+		++_head;
+
+		return true;
+	}
+
+	//
+	//入队后调用，返回true表示需要投递出队任务
+	//
+	bool MarkPending() { return !_pending.exchange(true, std::memory_order_acq_rel); }
+
+	//出队任务开始时调用，之后入队的数据包重新投递
+	void ClearPending() { _pending.exchange(false, std::memory_order_acq_rel); }
+
+	void Clear()
+	{
+		Drain([](const FramePtr&, uint32_t) {});
+	}
+
+	std::size_t Capacity() const { return _mask + 1; }
+	int64_t GetFullCount() const { return _full_count.load(std::memory_order_relaxed); } //队列已满的次数
+	int64_t GetSpillCount() const { return _spill_count.load(std::memory_order_relaxed); } //写入溢出队列的数据包数量
+
+private:
+	std::unique_ptr<Cell[]> _cells;
+	std::size_t _mask = 0;
+	char _padding0[64]; //生产者和消费者的位置不在同一缓存行
+	std::atomic<std::size_t> _tail{0}; //生产者
+	char _padding1[64];
+	std::size_t _head = 0; //消费者
+	std::atomic<bool> _pending{false}; //已经投递出队任务
+	std::atomic<int64_t> _full_count{0};
+
+	std::mutex _spill_lock;
+	std::deque<std::pair<FramePtr, uint32_t>> _spill; //环形队列已满时写入
+	std::atomic<bool> _spilled{false}; //溢出队列不为空
+	std::atomic<int64_t> _spill_count{0};
+};
+
+}
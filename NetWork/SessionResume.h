@@ -0,0 +1,484 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "FrameBuffer.h"
+#include "LinkReplay.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 玩家连接断线续传
+ *
+ * 1.握手时双方声明支持续传，玩家进入游戏后服务器发送续传数据包(续传标识+下一个数据包序号)，之后每个非控制数据包序号加一(计数方式同LinkReplay);
+ *
+ * 2.入队的数据包保留在发送记录中，超过字节上限时丢弃最早的数据包；连接断开后发给该玩家的数据包继续记录，玩家保留SessionResumeSeconds秒;
+ *
+ * 3.客户端重连握手后发送续传数据包(续传标识+下一个需要的数据包序号)，记录中有该序号时回复相同的续传数据包，并从该序号开始按顺序重发，
+ *
+ *   不再加载玩家数据和全量同步；否则回复续传标识为0的续传数据包，客户端按断线重连登录;
+ *
+ * 4.续传连接按入队顺序发送(不按优先级)，数据包不能丢弃或者合并；超时未续传时按断开连接处理;
+ *
+ * 5.续传标识共128位(查找标识+密钥)，由系统安全随机数生成，只对生成时的玩家及账号有效；标识不存在和密钥错误的处理完全相同.
+ *
+ * 配置项：SessionResume(默认开启) SessionResumeSeconds(默认30) SessionResumeBytes(每个玩家的发送记录上限，默认256K)
+ *
+ * */
+
+//
+//系统安全随机数：getrandom(2)，内核不支持时读取/dev/urandom；失败返回false
+//
+inline bool SecureRandom(void* data, std::size_t size)
+{
+	auto bytes = static_cast<uint8_t*>(data);
+
+#ifdef SYS_getrandom
+	while (size > 0)
+	{
+		long count = ::syscall(SYS_getrandom, bytes, size, 0);
+
+		if (count < 0)
+		{
+			if (errno == EINTR) continue;
+			if (errno == ENOSYS) break;
+			return false;
+		}
+
+		bytes += count;
+		size -= count;
+	}
+
+	if (size == 0) return true;
+#endif
+
+	int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+
+	while (size > 0)
+	{
+		ssize_t count = ::read(fd, bytes, size);
+
+		if (count <= 0)
+		{
+			if (count < 0 && errno == EINTR) continue;
+			break;
+		}
+
+		bytes += count;
+		size -= count;
+	}
+
+	::close(fd);
+	return size == 0;
+}
+
+//
+//续传记录所属的连接
+//
+class ResumeTarget
+{
+public:
+	virtual ~ResumeTarget() { }
+
+	virtual void OnResumeForward(FramePtr frame) = 0; //已经被新连接续传，之后收到的数据包转给新连接
+
+	virtual void OnResumeReplaced() = 0; //已经被新连接续传，关闭旧连接
+
+	virtual void OnResumeExpired() = 0; //断开后超时未续传，在世界线程调用
+};
+
+//
+//续传时新连接接管的会话数据(账号、角色列表等)，所属连接生成后不再修改，新连接不读取旧连接的成员
+//
+class ResumeState
+{
+public:
+	virtual ~ResumeState() { }
+};
+
+//
+//玩家的发送记录，新旧连接共享；在所属连接的发送锁内访问
+//
+class SessionResume
+{
+public:
+	SessionResume(const ResumeToken& token, int64_t player_id, const std::string& account, uint32_t capabilities, std::size_t max_bytes) : 
+		_token(token), _player_id(player_id), _account(account), _capabilities(capabilities)
+	{
+		_buffer.SetMaxBytes(max_bytes);
+	}
+
+	const ResumeToken& GetToken() const { return _token; }
+	int64_t GetPlayerID() const { return _player_id; }
+	const std::string& GetAccount() const { return _account; } //生成续传标识时玩家所属账号
+	uint32_t GetCapabilities() const { return _capabilities; } //记录的数据包按此编码
+
+	uint64_t GetNextSequence()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _buffer.GetNextSequence();
+	}
+
+	std::shared_ptr<ResumeTarget> GetTarget()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _target.lock();
+	}
+
+	//所属连接更新会话数据
+	void SetState(std::shared_ptr<const ResumeState> state)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_state = state;
+	}
+
+	std::shared_ptr<const ResumeState> GetState()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _state;
+	}
+
+	void SetOwner(ResumeTarget* owner, std::weak_ptr<ResumeTarget> target)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_owner = owner;
+		_target = target;
+	}
+
+	//
+	//记录数据包；sender已经被新连接续传时返回false，forward为当前连接
+	//
+	bool Record(ResumeTarget* sender, const FramePtr& frame, std::shared_ptr<ResumeTarget>& forward)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (sender != _owner)
+		{
+			forward = _target.lock();
+			return false;
+		}
+
+		int64_t dropped_count = _buffer.GetDroppedCount();
+		_buffer.Record(frame);
+
+		if (_buffer.GetDroppedCount() > dropped_count && !_dropping)
+		{
+			_dropping = true; //每次断开只输出一次
+			WARN("玩家:{} 续传记录超过上限:{}，丢弃最早的数据包", _player_id, _buffer.Bytes());
+		}
+
+		return true;
+	}
+
+	//
+	//续传标识是否一致：不按字节提前返回，比较时长和密钥内容无关
+	//
+	bool Match(const ResumeToken& token) const
+	{
+		return ((_token.id ^ token.id) | (_token.secret ^ token.secret)) == 0;
+	}
+
+	//
+	//所属连接断开，等待续传；返回false时按断开连接处理
+	//
+	bool Park(ResumeTarget* owner, std::chrono::steady_clock::time_point expire_time)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_removed) return false;
+		if (owner != _owner) return true; //已经被新连接续传
+
+		_parked = true;
+		_dropping = false;
+		_expire_time = expire_time;
+
+		return true;
+	}
+
+	//
+	//新连接续传：记录中有next_sequence时成为所属连接，frames为需要重发的数据包，previous为旧连接
+	//
+	bool TakeOver(ResumeTarget* owner, std::weak_ptr<ResumeTarget> target, uint64_t next_sequence, std::vector<FramePtr>& frames, std::shared_ptr<ResumeTarget>& previous)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_removed) return false;
+
+		if (next_sequence < _buffer.GetFirstSequence() || next_sequence > _buffer.GetNextSequence())
+		{
+			WARN("玩家:{} 续传序号:{} 超出记录范围:[{}, {}]", _player_id, next_sequence, _buffer.GetFirstSequence(), _buffer.GetNextSequence());
+			return false;
+		}
+
+		_buffer.Acknowledge(next_sequence - 1); //客户端已经收到
+
+		for (const auto& entry : _buffer.GetFrames()) frames.push_back(entry.second);
+
+		previous = _target.lock();
+
+		_owner = owner;
+		_target = target;
+		_parked = false;
+		_dropping = false;
+
+		return true;
+	}
+
+	//
+	//断开后超时未续传，target为所属连接
+	//
+	bool Expire(std::chrono::steady_clock::time_point now, std::shared_ptr<ResumeTarget>& target)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_removed || !_parked || now < _expire_time) return false;
+
+		_removed = true;
+		_buffer.Clear();
+
+		target = _target.lock();
+		return true;
+	}
+
+	bool IsRemoved()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _removed;
+	}
+
+	//玩家退出或者重新登录，不再续传
+	void Remove()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_removed = true;
+		_buffer.Clear();
+	}
+
+private:
+	std::mutex _mutex;
+	const ResumeToken _token;
+	const int64_t _player_id = 0;
+	const std::string _account;
+	const uint32_t _capabilities = 0;
+	ReplayBuffer _buffer;
+	ResumeTarget* _owner = nullptr; //所属连接，只用于比较
+	std::weak_ptr<ResumeTarget> _target;
+	std::shared_ptr<const ResumeState> _state;
+	bool _parked = false; //所属连接已经断开
+	bool _removed = false;
+	bool _dropping = false;
+	std::chrono::steady_clock::time_point _expire_time;
+};
+
+//
+//续传标识对应的发送记录
+//
+class SessionResumeRegistry
+{
+public:
+	static const int32_t DEFAULT_SECONDS = 30;
+	static const std::size_t DEFAULT_MAX_BYTES = 256 * 1024;
+
+	static SessionResumeRegistry& Instance()
+	{
+		static SessionResumeRegistry _instance;
+		return _instance;
+	}
+
+	void Load()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_enabled = ConfigInstance.GetBool("SessionResume", true);
+		_seconds = std::max(1, ConfigInstance.GetInt("SessionResumeSeconds", DEFAULT_SECONDS));
+		_max_bytes = std::max(1, ConfigInstance.GetInt("SessionResumeBytes", DEFAULT_MAX_BYTES));
+	}
+
+	bool IsEnabled() const { return _enabled; }
+
+	//
+	//玩家进入游戏：分配续传标识，该玩家之前的记录作废；无法生成安全随机数时返回空(不开启续传)
+	//
+	std::shared_ptr<SessionResume> Create(int64_t player_id, const std::string& account, uint32_t capabilities, std::shared_ptr<ResumeTarget> owner)
+	{
+		std::shared_ptr<SessionResume> resume, replaced;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			ResumeToken token;
+
+			while (token.id == 0 || token.secret == 0 || _sessions.count(token.id)) //0表示拒绝续传
+			{
+				if (!SecureRandom(&token, sizeof(token)))
+				{
+					ERROR("玩家:{} 无法生成续传标识，不开启断线续传", player_id);
+					return nullptr;
+				}
+			}
+
+			resume = std::make_shared<SessionResume>(token, player_id, account, capabilities, _max_bytes);
+
+			auto it = _players.find(player_id);
+			if (it != _players.end())
+			{
+				auto session = _sessions.find(it->second);
+				if (session != _sessions.end())
+				{
+					replaced = session->second;
+					_sessions.erase(session);
+				}
+			}
+
+			_sessions[token.id] = resume;
+			_players[player_id] = token.id;
+		}
+
+		resume->SetOwner(owner.get(), owner);
+		if (replaced) replaced->Remove();
+
+		return resume;
+	}
+
+	//
+	//按续传标识查找：标识不存在和密钥错误均返回空，调用方无法区分
+	//
+	std::shared_ptr<SessionResume> Find(const ResumeToken& token)
+	{
+		if (token.id == 0) return nullptr;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _sessions.find(token.id);
+		if (it == _sessions.end() || !it->second->Match(token)) return nullptr;
+
+		return it->second;
+	}
+
+	//
+	//所属连接断开，返回false时按断开连接处理
+	//
+	bool Park(std::shared_ptr<SessionResume> resume, ResumeTarget* owner)
+	{
+		if (!resume) return false;
+
+		auto expire_time = std::chrono::steady_clock::now() + std::chrono::seconds(_seconds);
+		if (!resume->Park(owner, expire_time)) return false;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_parked.emplace_back(expire_time, resume); //等待时长相同，按断开顺序到期
+		++_parked_count;
+
+		return true;
+	}
+
+	void Remove(std::shared_ptr<SessionResume> resume)
+	{
+		if (!resume) return;
+
+		resume->Remove();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		Erase(resume);
+	}
+
+	void OnResumed(bool success)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (success) ++_resumed_count;
+		else ++_rejected_count;
+	}
+
+	//
+	//世界线程定期调用：断开超时未续传的连接按断开处理
+	//
+	void Update()
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		std::vector<std::shared_ptr<ResumeTarget>> expired;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			while (!_parked.empty() && _parked.front().first <= now)
+			{
+				auto resume = _parked.front().second.lock();
+				_parked.pop_front();
+
+				if (!resume) continue;
+
+				std::shared_ptr<ResumeTarget> target;
+				if (!resume->Expire(now, target)) continue; //期间已经续传或者再次断开的不处理
+
+				Erase(resume);
+				if (target) expired.push_back(target);
+
+				++_expired_count;
+			}
+		}
+
+		for (auto& target : expired) target->OnResumeExpired(); //不持有锁回调
+	}
+
+	void Report()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_parked_count + _resumed_count + _rejected_count + _expired_count == 0) return;
+
+		LOG(INFO, "断线续传统计，断开等待:{} 续传成功:{} 续传失败:{} 超时:{} 当前记录:{}",
+				_parked_count, _resumed_count, _rejected_count, _expired_count, _sessions.size());
+
+		_parked_count = _resumed_count = _rejected_count = _expired_count = 0;
+	}
+
+private:
+	void Erase(const std::shared_ptr<SessionResume>& resume)
+	{
+		auto it = _sessions.find(resume->GetToken().id);
+		if (it == _sessions.end() || it->second != resume) return;
+
+		_sessions.erase(it);
+
+		auto player = _players.find(resume->GetPlayerID());
+		if (player != _players.end() && player->second == resume->GetToken().id) _players.erase(player);
+	}
+
+private:
+	std::mutex _mutex;
+	bool _enabled = true;
+	int32_t _seconds = DEFAULT_SECONDS;
+	std::size_t _max_bytes = DEFAULT_MAX_BYTES;
+	std::unordered_map<uint64_t/*续传标识*/, std::shared_ptr<SessionResume>> _sessions;
+	std::unordered_map<int64_t/*玩家角色ID*/, uint64_t/*续传标识*/> _players;
+	std::deque<std::pair<std::chrono::steady_clock::time_point, std::weak_ptr<SessionResume>>> _parked;
+	int64_t _parked_count = 0;
+	int64_t _resumed_count = 0;
+	int64_t _rejected_count = 0;
+	int64_t _expired_count = 0;
+};
+
+#define SessionResumeRegistryInstance SessionResumeRegistry::Instance()
+
+}
@@ -0,0 +1,744 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include <boost/asio.hpp>
+
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 共享内存传输(同一台机器上的服务器之间的连接)
+ *
+ * 1.发起端(ClientSocket)连接前绑定本机地址，通过本机Unix域套接字把共享内存和eventfd交给对端，对端确认后该连接的数据均通过共享内存收发;
+ *
+ * 2.每个方向一个单生产者单消费者字节环形队列，数据格式和TCP字节流完全相同(握手、批量、压缩、重发均不变);
+ *
+ * 3.接收端队列为空时才等待eventfd，发送端只在对端等待时通知，持续收发时没有系统调用;
+ *
+ * 4.TCP连接保留，只用于检测对端断开(对端进程退出时内核关闭连接);
+ *
+ * 5.对端不在本机、未开启或者协商失败时使用TCP.
+ *
+ * 配置项：ShmTransport(默认关闭，双方都开启才生效) ShmRingSize(每个方向的队列大小)
+ *
+ * */
+
+//
+//共享内存布局：头部 + 发起端到接收端队列 + 接收端到发起端队列
+//
+struct ShmRingHeader
+{
+	alignas(64) std::atomic<uint64_t> head; //写入位置(只增)
+	alignas(64) std::atomic<uint64_t> tail; //读取位置(只增)
+	alignas(64) std::atomic<uint32_t> reader_waiting; //接收端等待数据
+	std::atomic<uint32_t> writer_waiting; //发送端等待空间
+};
+
+struct ShmLayout
+{
+	static const uint32_t MAGIC = 0x4D585348; //"MXSH"
+	static const std::size_t DATA_OFFSET = 4096;
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity; //每个方向的队列大小(2的幂)
+	ShmRingHeader rings[2]; //0:发起端->接收端 1:接收端->发起端
+
+	static std::size_t GetMapSize(std::size_t capacity) { return DATA_OFFSET + capacity * 2; }
+};
+
+//
+//共享内存字节流，接口和TCP套接字的非阻塞发送、异步接收一致
+//
+//发送：任意线程在连接的发送锁内调用；接收及等待：连接所在网络线程
+//
+class ShmStream : public std::enable_shared_from_this<ShmStream>
+{
+public:
+	typedef std::function<void(const boost::system::error_code&, std::size_t)> Handler;
+
+	static const std::size_t DEFAULT_RING_SIZE = 4 * 1024 * 1024;
+
+	template<typename Executor>
+	ShmStream(const Executor& executor, void* base, std::size_t map_size, bool initiator, int local_event, int peer_event) :
+		_event(executor, local_event), _peer_event(peer_event), _base(base), _map_size(map_size)
+	{
+		auto layout = static_cast<ShmLayout*>(base);
+		uint8_t* data = static_cast<uint8_t*>(base) + ShmLayout::DATA_OFFSET;
+
+		_capacity = layout->capacity;
+		_out = &layout->rings[initiator ? 0 : 1];
+		_in = &layout->rings[initiator ? 1 : 0];
+		_out_data = data + (initiator ? 0 : _capacity);
+		_in_data = data + (initiator ? _capacity : 0);
+	}
+
+	~ShmStream()
+	{
+		boost::system::error_code error;
+		_event.close(error);
+
+		::close(_peer_event);
+		::munmap(_base, _map_size);
+	}
+
+	ShmStream(const ShmStream&) = delete;
+	ShmStream& operator = (const ShmStream&) = delete;
+
+	//
+	//发起端：绑定本机地址(对端不在本机时失败)，把共享内存交给对端，对端确认后返回，失败返回空
+	//
+	static std::shared_ptr<ShmStream> Connect(boost::asio::io_service& io_service, boost::asio::ip::tcp::socket& socket,
+			const boost::asio::ip::tcp::endpoint& remote, std::size_t capacity)
+	{
+		boost::system::error_code error;
+
+		if (!socket.is_open()) socket.open(remote.protocol(), error);
+		if (!error) socket.bind(boost::asio::ip::tcp::endpoint(remote.address(), 0), error); //只有本机地址可以绑定
+		if (error) return nullptr;
+
+		auto local = socket.local_endpoint(error);
+		if (error) return nullptr;
+
+		int unix_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (unix_fd < 0) return nullptr;
+
+		sockaddr_un address;
+		socklen_t address_size = GetAddress(remote.port(), address);
+
+		if (::connect(unix_fd, reinterpret_cast<sockaddr*>(&address), address_size) != 0) //对端未开启
+		{
+			::close(unix_fd);
+			return nullptr;
+		}
+
+		capacity = GetCapacity(capacity);
+		std::size_t map_size = ShmLayout::GetMapSize(capacity);
+
+		int memory_fd = ::memfd_create("adoter-shm", MFD_CLOEXEC);
+		int events[2] = { ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) }; //0:唤醒发起端 1:唤醒接收端
+
+		void* base = MAP_FAILED;
+		if (memory_fd >= 0 && ::ftruncate(memory_fd, map_size) == 0) base = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+
+		bool success = base != MAP_FAILED && events[0] >= 0 && events[1] >= 0;
+
+		if (success)
+		{
+			auto layout = new (base) ShmLayout();
+			layout->magic = ShmLayout::MAGIC;
+			layout->version = 1;
+			layout->capacity = capacity;
+
+			for (auto& ring : layout->rings)
+			{
+				ring.head = ring.tail = 0;
+				ring.reader_waiting = ring.writer_waiting = 0;
+			}
+
+			Request request;
+			memset(&request, 0, sizeof(request));
+			request.magic = ShmLayout::MAGIC;
+			request.port = local.port();
+			strncpy(request.address, local.address().to_string().c_str(), sizeof(request.address) - 1);
+
+			int fds[3] = { memory_fd, events[0], events[1] };
+			success = SendFds(unix_fd, &request, sizeof(request), fds, 3) && WaitAccepted(unix_fd);
+		}
+
+		::close(unix_fd);
+		if (memory_fd >= 0) ::close(memory_fd); //映射保留
+
+		if (!success)
+		{
+			if (base != MAP_FAILED) ::munmap(base, map_size);
+			for (auto event : events) if (event >= 0) ::close(event);
+
+			WARN("服务器:{} 端口:{} 共享内存协商失败，使用TCP", remote.address().to_string(), remote.port());
+			return nullptr;
+		}
+
+		LOG(INFO, "服务器:{} 端口:{} 本地端口:{} 使用共享内存传输，队列大小:{}", remote.address().to_string(), remote.port(), local.port(), capacity);
+
+		return std::make_shared<ShmStream>(io_service.get_executor(), base, map_size, true, events[0], events[1]); //接收端持有eventfd副本
+	}
+
+	//
+	//写入尽可能多的数据，队列已满返回would_block
+	//
+	template<typename ConstBufferSequence>
+	std::size_t WriteSome(const ConstBufferSequence& buffers, boost::system::error_code& error)
+	{
+		error = boost::system::error_code();
+
+		if (_closed)
+		{
+			error = boost::asio::error::broken_pipe;
+			return 0;
+		}
+
+		uint64_t head = _out->head.load(std::memory_order_relaxed); //只有本端写入
+		uint64_t space = _capacity - (head - _out->tail.load(std::memory_order_acquire));
+
+		std::size_t written = 0;
+
+		for (const auto& buffer : buffers)
+		{
+			if (written == space) break;
+
+			std::size_t size = std::min<std::size_t>(boost::asio::buffer_size(buffer), space - written);
+			Copy(_out_data, head + written, boost::asio::buffer_cast<const uint8_t*>(buffer), size);
+
+			written += size;
+		}
+
+		if (written == 0)
+		{
+			error = boost::asio::error::would_block;
+			return 0;
+		}
+
+		_out->head.store(head + written, std::memory_order_seq_cst);
+		if (_out->reader_waiting.load(std::memory_order_seq_cst)) Notify(); //对端等待时才通知
+
+		return written;
+	}
+
+	//
+	//队列有空间时回调，可以在任意线程调用
+	//
+	void AsyncWaitWrite(Handler handler)
+	{
+		auto self = shared_from_this();
+		boost::asio::post(_event.get_executor(), [self, handler]() { self->WaitWrite(handler); });
+	}
+
+	//
+	//读取已经到达的数据，没有数据时等待，在网络线程调用
+	//
+	void AsyncReadSome(const boost::asio::mutable_buffers_1& buffer, Handler handler)
+	{
+		_read_buffer = *boost::asio::buffer_sequence_begin(buffer);
+		_read_handler = handler;
+
+		TryRead(true);
+	}
+
+	//
+	//关闭：等待中的回调返回operation_aborted，共享内存在销毁时释放
+	//
+	void Close()
+	{
+		if (_closed.exchange(true)) return;
+
+		auto self = shared_from_this();
+		boost::asio::post(_event.get_executor(), [self]() {
+			boost::system::error_code error;
+			self->_event.cancel(error);
+
+			self->Fail(boost::asio::error::operation_aborted);
+		});
+	}
+
+	bool IsClosed() const { return _closed; }
+
+private:
+	friend class ShmRegistry;
+
+	//协商请求：发起端地址和端口(对端据此找到TCP连接)
+	struct Request
+	{
+		uint32_t magic;
+		uint32_t port;
+		char address[64];
+	};
+
+	//按服务器监听端口命名的本机Unix域套接字(抽象命名空间，不产生文件)
+	static socklen_t GetAddress(int32_t port, sockaddr_un& address)
+	{
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+
+		std::string name = "adoter-shm-" + std::to_string(port);
+		memcpy(address.sun_path + 1, name.data(), name.size());
+
+		return offsetof(sockaddr_un, sun_path) + 1 + name.size();
+	}
+
+	static std::size_t GetCapacity(std::size_t capacity)
+	{
+		std::size_t size = 64 * 1024;
+		while (size < capacity && size < (std::size_t(1) << 30)) size <<= 1;
+		return size;
+	}
+
+	static bool SendFds(int unix_fd, const void* data, std::size_t size, const int* fds, int count)
+	{
+		iovec iov;
+		iov.iov_base = const_cast<void*>(data);
+		iov.iov_len = size;
+
+		char control[CMSG_SPACE(sizeof(int) * 3)];
+		memset(control, 0, sizeof(control));
+
+		msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+		cmsghdr* header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+		memcpy(CMSG_DATA(header), fds, sizeof(int) * count);
+
+		return ::sendmsg(unix_fd, &message, MSG_NOSIGNAL) == ssize_t(size);
+	}
+
+	static bool WaitAccepted(int unix_fd)
+	{
+		pollfd poll_fd;
+		poll_fd.fd = unix_fd;
+		poll_fd.events = POLLIN;
+
+		if (::poll(&poll_fd, 1, 200) != 1) return false; //本机对端，超时视为失败
+
+		char reply = 0;
+		return ::read(unix_fd, &reply, 1) == 1 && reply == 'Y';
+	}
+
+	void Copy(uint8_t* ring, uint64_t position, const uint8_t* data, std::size_t size)
+	{
+		std::size_t offset = position & (_capacity - 1);
+		std::size_t first = std::min(size, std::size_t(_capacity - offset));
+
+		memcpy(ring + offset, data, first);
+		memcpy(ring, data + first, size - first);
+	}
+
+	std::size_t Read()
+	{
+		uint64_t tail = _in->tail.load(std::memory_order_relaxed); //只有本端读取
+		uint64_t available = _in->head.load(std::memory_order_acquire) - tail;
+
+		std::size_t size = std::min<std::size_t>(available, boost::asio::buffer_size(_read_buffer));
+		if (size == 0) return 0;
+
+		std::size_t offset = tail & (_capacity - 1);
+		std::size_t first = std::min(size, std::size_t(_capacity - offset));
+
+		uint8_t* target = boost::asio::buffer_cast<uint8_t*>(_read_buffer);
+		memcpy(target, _in_data + offset, first);
+		memcpy(target + first, _in_data, size - first);
+
+		_in->tail.store(tail + size, std::memory_order_seq_cst);
+		if (_in->writer_waiting.load(std::memory_order_seq_cst)) Notify(); //对端等待空间
+
+		return size;
+	}
+
+	//
+	//deferred：从AsyncReadSome调用时投递回调，防止持续有数据时回调中再次读取导致递归
+	//
+	void TryRead(bool deferred = false)
+	{
+		if (!_read_handler) return;
+
+		if (_closed)
+		{
+			Complete(_read_handler, boost::asio::error::operation_aborted, 0, deferred);
+			return;
+		}
+
+		std::size_t size = Read();
+
+		if (size == 0)
+		{
+			_in->reader_waiting.store(1, std::memory_order_seq_cst);
+
+			if (_in->head.load(std::memory_order_seq_cst) == _in->tail.load(std::memory_order_relaxed)) //设置等待标识后再次检查，防止错过通知
+			{
+				Wait();
+				return;
+			}
+
+			_in->reader_waiting.store(0, std::memory_order_relaxed);
+			size = Read();
+		}
+
+		Complete(_read_handler, boost::system::error_code(), size, deferred);
+	}
+
+	void WaitWrite(Handler handler)
+	{
+		_write_handler = handler;
+		TryWrite();
+	}
+
+	void TryWrite()
+	{
+		if (!_write_handler) return;
+
+		if (_closed)
+		{
+			Complete(_write_handler, boost::asio::error::operation_aborted, 0);
+			return;
+		}
+
+		_out->writer_waiting.store(1, std::memory_order_seq_cst);
+
+		if (_out->head.load(std::memory_order_relaxed) - _out->tail.load(std::memory_order_seq_cst) == _capacity) //仍然已满
+		{
+			Wait();
+			return;
+		}
+
+		_out->writer_waiting.store(0, std::memory_order_relaxed);
+		Complete(_write_handler, boost::system::error_code(), 0);
+	}
+
+	//等待eventfd(数据到达或者队列有空间)，同一时刻最多一个
+	void Wait()
+	{
+		if (_waiting) return;
+		_waiting = true;
+
+		_event.async_wait(boost::asio::posix::stream_descriptor::wait_read, std::bind(&ShmStream::OnEvent, shared_from_this(), std::placeholders::_1));
+	}
+
+	void OnEvent(const boost::system::error_code& error)
+	{
+		_waiting = false;
+
+		if (error || _closed)
+		{
+			Fail(error ? error : boost::asio::error::operation_aborted);
+			return;
+		}
+
+		uint64_t count = 0;
+		if (::read(_event.native_handle(), &count, sizeof(count)) < 0) { } //清零计数
+
+		_in->reader_waiting.store(0, std::memory_order_relaxed);
+
+		TryRead();
+		TryWrite();
+	}
+
+	void Fail(const boost::system::error_code& error)
+	{
+		if (_read_handler) Complete(_read_handler, error, 0);
+		if (_write_handler) Complete(_write_handler, error, 0);
+	}
+
+	//先清空回调再调用，回调中可以再次等待
+	void Complete(Handler& slot, const boost::system::error_code& error, std::size_t size, bool deferred = false)
+	{
+		Handler handler;
+		handler.swap(slot);
+
+		if (deferred) boost::asio::post(_event.get_executor(), std::bind(handler, error, size));
+		else handler(error, size);
+	}
+
+	void Notify()
+	{
+		uint64_t one = 1;
+		if (::write(_peer_event, &one, sizeof(one)) < 0) { } //计数溢出时对端必然已经被唤醒
+	}
+
+private:
+	boost::asio::posix::stream_descriptor _event; //本端等待
+	int _peer_event = -1; //唤醒对端
+	void* _base = nullptr;
+	std::size_t _map_size = 0;
+	uint64_t _capacity = 0;
+	ShmRingHeader* _out = nullptr;
+	ShmRingHeader* _in = nullptr;
+	uint8_t* _out_data = nullptr;
+	uint8_t* _in_data = nullptr;
+	std::atomic<bool> _closed{false};
+	bool _waiting = false;
+	boost::asio::mutable_buffer _read_buffer;
+	Handler _read_handler;
+	Handler _write_handler;
+};
+
+//
+//接收端：监听本机Unix域套接字，保存发起端交来的共享内存，TCP连接建立后按对端地址取出
+//
+class ShmRegistry
+{
+	struct Pending
+	{
+		void* base = nullptr;
+		std::size_t map_size = 0;
+		int events[2] = { -1, -1 };
+		std::chrono::steady_clock::time_point time;
+	};
+
+	typedef boost::asio::local::stream_protocol::socket UnixSocket;
+	typedef boost::asio::local::stream_protocol::acceptor UnixAcceptor;
+public:
+	static const int32_t PENDING_TIMEOUT = 10; //发起端交来共享内存后未建立TCP连接，超时释放(秒)
+
+	static ShmRegistry& Instance()
+	{
+		static ShmRegistry _instance;
+		return _instance;
+	}
+
+	bool IsEnabled() const { return _enabled; }
+
+	//
+	//按服务器监听端口开启(每个监听端口一个)，在主线程接收
+	//
+	bool Listen(boost::asio::io_service& io_service, int32_t port)
+	{
+		if (!ConfigInstance.GetBool("ShmTransport", false)) return false;
+
+		sockaddr_un address;
+		socklen_t address_size = ShmStream::GetAddress(port, address);
+
+		UnixAcceptor* acceptor = nullptr;
+
+		try
+		{
+			boost::asio::local::stream_protocol::endpoint endpoint(std::string(address.sun_path, address_size - offsetof(sockaddr_un, sun_path)));
+			acceptor = new UnixAcceptor(io_service, endpoint);
+		}
+		catch (const boost::system::system_error& error)
+		{
+			ERROR("共享内存传输监听失败，端口:{} 错误码:{}", port, error.what());
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_acceptors.emplace_back(acceptor);
+		}
+
+		_enabled = true;
+		AsyncAccept(acceptor);
+
+		LOG(INFO, "共享内存传输开启，端口:{}", port);
+		return true;
+	}
+
+	//
+	//TCP连接建立时取出对端交来的共享内存，没有返回空
+	//
+	template<typename Executor>
+	std::shared_ptr<ShmStream> Take(const Executor& executor, const boost::asio::ip::tcp::endpoint& remote)
+	{
+		if (!_enabled) return nullptr;
+
+		Pending pending;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			auto it = _pendings.find(GetKey(remote.address().to_string(), remote.port()));
+			if (it == _pendings.end()) return nullptr;
+
+			pending = it->second;
+			_pendings.erase(it);
+		}
+
+		return std::make_shared<ShmStream>(executor, pending.base, pending.map_size, false, pending.events[1], pending.events[0]);
+	}
+
+private:
+	static std::string GetKey(const std::string& address, int32_t port) { return address + ":" + std::to_string(port); }
+
+	void AsyncAccept(UnixAcceptor* acceptor)
+	{
+		auto socket = std::make_shared<UnixSocket>(acceptor->get_executor());
+
+		acceptor->async_accept(*socket, [this, acceptor, socket](const boost::system::error_code& error) {
+			if (error == boost::asio::error::operation_aborted) return;
+
+			if (!error)
+			{
+				socket->async_wait(UnixSocket::wait_read, [this, socket](const boost::system::error_code& error) {
+					if (!error) OnRequest(*socket);
+				});
+			}
+
+			AsyncAccept(acceptor);
+		});
+	}
+
+	void OnRequest(UnixSocket& socket)
+	{
+		ucred credential;
+		socklen_t credential_size = sizeof(credential);
+
+		if (::getsockopt(socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &credential, &credential_size) != 0 || credential.uid != ::geteuid())
+		{
+			ERROR("共享内存传输请求拒绝，对端用户不同");
+			return; //未接收的文件描述符随套接字关闭
+		}
+
+		ShmStream::Request request;
+		memset(&request, 0, sizeof(request));
+
+		int fds[3] = { -1, -1, -1 };
+		int count = ReceiveFds(socket.native_handle(), &request, sizeof(request), fds);
+
+		Pending pending;
+		bool success = count == 3 && request.magic == ShmLayout::MAGIC;
+
+		if (success)
+		{
+			struct stat status;
+			success = ::fstat(fds[0], &status) == 0 && std::size_t(status.st_size) > ShmLayout::DATA_OFFSET;
+
+			if (success)
+			{
+				pending.map_size = status.st_size;
+				pending.base = ::mmap(nullptr, pending.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+
+				auto layout = static_cast<ShmLayout*>(pending.base);
+				success = pending.base != MAP_FAILED && layout->magic == ShmLayout::MAGIC && ShmLayout::GetMapSize(layout->capacity) == pending.map_size;
+
+				if (!success && pending.base != MAP_FAILED) ::munmap(pending.base, pending.map_size);
+			}
+		}
+
+		if (count > 0 && fds[0] >= 0) ::close(fds[0]); //映射保留
+
+		if (!success)
+		{
+			for (int i = 1; i < count; ++i) ::close(fds[i]);
+
+			ERROR("共享内存传输请求错误，文件描述符数量:{}", count);
+			return;
+		}
+
+		request.address[sizeof(request.address) - 1] = '\0';
+
+		pending.events[0] = fds[1];
+		pending.events[1] = fds[2];
+		pending.time = std::chrono::steady_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			Expire(pending.time);
+
+			auto key = GetKey(request.address, request.port);
+
+			auto it = _pendings.find(key);
+			if (it != _pendings.end()) Release(it->second); //同一端口重新协商
+
+			_pendings[key] = pending;
+		}
+
+		char reply = 'Y';
+		boost::system::error_code error;
+		boost::asio::write(socket, boost::asio::buffer(&reply, 1), error);
+
+		DEBUG("共享内存传输请求，地址:{} 端口:{} 大小:{}", request.address, request.port, pending.map_size);
+	}
+
+	//锁内调用
+	void Expire(std::chrono::steady_clock::time_point now)
+	{
+		for (auto it = _pendings.begin(); it != _pendings.end(); )
+		{
+			if (now - it->second.time < std::chrono::seconds(int64_t(PENDING_TIMEOUT))) //按值使用，静态常量没有类外定义
+			{
+				++it;
+				continue;
+			}
+
+			Release(it->second);
+			it = _pendings.erase(it);
+		}
+	}
+
+	static void Release(Pending& pending)
+	{
+		::munmap(pending.base, pending.map_size);
+		for (auto event : pending.events) ::close(event);
+	}
+
+	//
+	//接收请求及3个文件描述符，失败时关闭已经收到的全部文件描述符并返回0
+	//
+	static int ReceiveFds(int unix_fd, void* data, std::size_t size, int* fds)
+	{
+		iovec iov;
+		iov.iov_base = data;
+		iov.iov_len = size;
+
+		char control[CMSG_SPACE(sizeof(int) * 3)];
+
+		msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		ssize_t bytes = ::recvmsg(unix_fd, &message, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+		if (bytes < 0) return 0;
+
+		std::vector<int> received; //短读、截断时也可能带有文件描述符
+
+		for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+		{
+			if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) continue;
+
+			std::size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			std::size_t offset = received.size();
+
+			received.resize(offset + count);
+			memcpy(received.data() + offset, CMSG_DATA(header), sizeof(int) * count);
+		}
+
+		if (bytes != ssize_t(size) || (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) || received.size() != 3)
+		{
+			for (auto fd : received) ::close(fd);
+			return 0;
+		}
+
+		memcpy(fds, received.data(), sizeof(int) * 3);
+
+		return 3;
+	}
+
+private:
+	bool _enabled = false;
+	std::mutex _mutex;
+	std::unordered_map<std::string, Pending> _pendings; //发起端地址:端口
+	std::vector<std::unique_ptr<UnixAcceptor>> _acceptors;
+};
+
+#define ShmRegistryInstance ShmRegistry::Instance()
+
+}
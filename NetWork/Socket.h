@@ -8,24 +8,66 @@
 #include <queue>
 #include <unordered_map>
 #include <sstream>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include <netinet/tcp.h>
 
 #include <boost/asio.hpp>
 #include <spdlog/spdlog.h>
 
 #include "AsyncAcceptor.h"
 #include "NetThread.h"
+#include "FrameCodec.h"
+#include "WriteQueue.h"
+#include "SendRing.h"
+#include "Outbox.h"
+#include "SendPriority.h"
+#include "ShmTransport.h"
+#include "SessionResume.h"
+#include "BroadcastFrame.h"
 #include "MXLog.h"
 
 namespace Adoter
 {
 
 template<class T, class S = boost::asio::ip::tcp::socket>
-class Socket : public std::enable_shared_from_this<T>
+class Socket : public std::enable_shared_from_this<T>, public OutboxTarget, public ResumeTarget
 {
+public:
+	static const std::size_t DEFAULT_RECEIVE_LIMIT = 65536; //玩家发来的数据包上限，和原有包头一致
 public:
 	S _socket; 
 public:
-	explicit Socket(boost::asio::ip::tcp::socket&& socket) : _socket(std::move(socket)), _closed(false), _closing(false) { }
+	explicit Socket(boost::asio::ip::tcp::socket&& socket) : _socket(std::move(socket)), _closed(false), _closing(false), _flush_scheduled(false), _active_time(0), 
+		_batch_timer(_socket.get_executor()), _send_ring(ConfigInstance.GetInt("SendRingSize", SendRing::DEFAULT_CAPACITY))
+	{ 
+		Touch();
+		_write_queue.SetBatchBytes(ConfigInstance.GetInt("SendBatchBytes", WriteQueue::DEFAULT_BATCH_BYTES)); //单次合并发送上限
+		_write_queue.SetLimits(QueueLimits::Load("")); //发送队列水位
+
+		uint32_t capabilities = 0;
+		if (ConfigInstance.GetBool("ExtendedFrame", true)) capabilities |= FRAME_CAPABILITY_EXTENDED; //对端握手后支持超过64K的数据包
+		if (ConfigInstance.GetBool("FrameCompress", true)) capabilities |= FRAME_CAPABILITY_COMPRESS; //对端握手后支持压缩数据包
+		if (ConfigInstance.GetBool("MetaBatch", true)) capabilities |= FRAME_CAPABILITY_BATCH; //对端握手后支持批量数据包
+		_codec.SetLocalCapabilities(capabilities);
+
+		boost::system::error_code error;
+		auto remote = _socket.remote_endpoint(error);
+		if (!error && ReplayRegistryInstance.IsServerAddress(remote.address().to_string())) EnableLinkReplay(); //玩家连接不能续传服务器之间的连接
+
+		_batcher.SetBatchBytes(ConfigInstance.GetInt("BatchBytes", FrameBatcher::DEFAULT_BATCH_BYTES));
+		_batcher.SetBatchDelay(ConfigInstance.GetInt("BatchDelay", FrameBatcher::DEFAULT_BATCH_DELAY));
+		_codec.SetHandshakeHandler(std::bind(&Socket<T, S>::OnHandshake, this, std::placeholders::_1));
+		_codec.SetSequenceHandler(std::bind(&Socket<T, S>::SendAck, this, std::placeholders::_1));
+
+		_codec.SetInitialSize(ConfigInstance.GetInt("ReceiveBufferSize", FrameCodec::DEFAULT_INITIAL_SIZE)); //接收缓存初始大小，按需扩容
+		_codec.SetReceiveLimit(ConfigInstance.GetInt("ReceiveFrameLimit", DEFAULT_RECEIVE_LIMIT)); //对端可能是玩家，确认为服务器后放开(见EnableServerReceive)
+		_receive_on_readable = ConfigInstance.GetBool("ReceiveOnReadable", false); //空闲连接不占用接收缓存
+
+		if (ShmRegistryInstance.IsEnabled() && !error) _shm = ShmRegistryInstance.Take(_socket.get_executor(), remote); //本机对端连接前已经交来共享内存
+	}
 
 	virtual ~Socket()
 	{
@@ -42,7 +84,7 @@ public:
 		std::lock_guard<std::mutex> lock(_send_lock);
 
 		//发送可以放到消息队列里面处理
-		if (_is_writing_async || (_write_queue.empty() && !_closing)) return true;
+		if (_is_writing_async || (_write_queue.Empty() && !_closing)) return true;
 
 		for (; HandleQueue(); ) {}
 
@@ -60,15 +102,56 @@ public:
 		_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
 		_socket.close(error);
 
+		if (_shm) _shm->Close();
+
 		OnClose();
+
+		if (_close_handler) _close_handler(); //通知网络线程删除
 	}
-	virtual void DelayedClose() { _closing = true; } //发送队列为空时再进行关闭
+	virtual void DelayedClose() //发送队列为空时再进行关闭
+	{ 
+		_closing = true; 
+
+		std::lock_guard<std::mutex> lock(_send_lock);
+		TransferSendRing();
+		FlushBatch();
+		ScheduleFlush();
+	} 
 	virtual bool IsConnect() { return _socket.is_open(); }
 	virtual bool IsOpen() const { return !_closed && !_closing; }
+	virtual bool IsClosed() const { return _closed; }
+
+	//
+	//连接空闲(长时间未收到数据)时由网络线程调用
+	//
+	virtual void OnIdle() { }
+
+	void SetCloseHandler(std::function<void()> handler) { _close_handler = handler; }
+
+	//
+	//网络线程负载统计，由网络线程设置
+	//
+	void SetThreadLoad(ThreadLoad* load)
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+		_load = load;
+	}
+
+	void Touch() { _active_time = std::chrono::steady_clock::now().time_since_epoch().count(); } //最近收到数据时间
+	std::chrono::steady_clock::time_point GetActiveTime() const { return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(_active_time)); }
 
 	virtual void AsyncReceive()
 	{
-		_socket.async_read_some(boost::asio::buffer(_buffer), std::bind(&Socket<T, S>::OnReceive, this, std::placeholders::_1, std::placeholders::_2));
+		Touch();
+
+		if (_shm)
+		{
+			WatchStream();
+			_shm->AsyncReadSome(_codec.PrepareBuffer(), std::bind(&Socket<T, S>::OnReceive, this, std::placeholders::_1, std::placeholders::_2));
+			return;
+		}
+
+		_socket.async_read_some(_codec.PrepareBuffer(), std::bind(&Socket<T, S>::OnReceive, this, std::placeholders::_1, std::placeholders::_2));
 	}
 	virtual void OnReceive(const boost::system::error_code& error, const std::size_t bytes_transferred)
 	{
@@ -76,7 +159,72 @@ public:
 	}
 	virtual void AsyncReceiveWithCallback(void(T::*callback)(boost::system::error_code, std::size_t))
 	{
-		_socket.async_read_some(boost::asio::buffer(_buffer), std::bind(callback, this->shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+		Touch();
+
+		if (_shm) //共享内存传输
+		{
+			WatchStream();
+			_shm->AsyncReadSome(_codec.PrepareBuffer(), std::bind(&Socket<T, S>::OnReceived, this->shared_from_this(), 
+						callback, std::placeholders::_1, std::placeholders::_2));
+			return;
+		}
+
+		if (_receive_on_readable && _codec.Release()) //等待可读时不占用缓存，可读后再获取缓存接收
+		{
+			_socket.async_wait(boost::asio::socket_base::wait_read, std::bind(&Socket<T, S>::OnReadable, this->shared_from_this(), 
+						callback, std::placeholders::_1));
+			return;
+		}
+
+		_socket.async_read_some(_codec.PrepareBuffer(), std::bind(&Socket<T, S>::OnReceived, this->shared_from_this(), 
+					callback, std::placeholders::_1, std::placeholders::_2));
+	}
+
+	//
+	//共享内存传输时TCP连接不再收发数据，可读即为对端断开
+	//
+	void WatchStream()
+	{
+		if (_stream_watching) return;
+		_stream_watching = true;
+
+		_socket.async_wait(boost::asio::socket_base::wait_read, std::bind(&Socket<T, S>::OnStreamReadable, this->shared_from_this(), std::placeholders::_1));
+	}
+
+	void OnStreamReadable(const boost::system::error_code& error)
+	{
+		if (error == boost::asio::error::operation_aborted) return;
+		Close();
+	}
+
+	//
+	//接收完成：统计网络线程负载(接收字节数和解析的数据包数量)
+	//
+	void OnReceived(void(T::*callback)(boost::system::error_code, std::size_t), boost::system::error_code error, std::size_t bytes_transferred)
+	{
+		uint64_t decoded_count = _codec.GetDecodedCount();
+
+		(static_cast<T*>(this)->*callback)(error, bytes_transferred);
+
+		if (_load) _load->Add(bytes_transferred, _codec.GetDecodedCount() - decoded_count); //网络线程中设置和读取
+	}
+
+	void OnReadable(void(T::*callback)(boost::system::error_code, std::size_t), boost::system::error_code error)
+	{
+		std::size_t bytes_transferred = 0;
+
+		if (!error) 
+		{
+			bytes_transferred = _socket.read_some(_codec.PrepareBuffer(), error);
+
+			if (error == boost::asio::error::would_block || error == boost::asio::error::try_again) //其他线程或者信号导致的虚假唤醒
+			{
+				AsyncReceiveWithCallback(callback);
+				return;
+			}
+		}
+
+		OnReceived(callback, error, bytes_transferred);
 	}
 
 	//
@@ -100,6 +248,12 @@ public:
 		if (_is_writing_async) return false;
 		_is_writing_async = true;
 
+		if (_shm) //共享内存队列有空间时继续发送
+		{
+			_shm->AsyncWaitWrite(std::bind(&Socket<T, S>::WriteHandlerWrapper, this->shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+			return false;
+		}
+
 		_socket.async_write_some(boost::asio::null_buffers(), std::bind(&Socket<T, S>::WriteHandlerWrapper, 
 					this->shared_from_this(), std::placeholders::_1, std::placeholders::_2));
 		return false;
@@ -107,118 +261,699 @@ public:
 
 	void WriteHandlerWrapper(boost::system::error_code /*error*/, std::size_t /*bytes_transferred*/)
 	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+
 		_is_writing_async = false;
-		HandleQueue();
+		for (; HandleQueue(); ) {}
 	}
 
-	void EnterQueue(std::string&& meta)    
-	{        
-		std::lock_guard<std::mutex> lock(_send_lock);
+	//
+	//已经序列化好的数据，复制一次到数据包缓存
+	//
+	void EnterQueue(std::string&& meta)
+	{
+		auto frame = meta.empty() ? nullptr : FrameBuffer::Create(meta.data(), meta.size());
+		if (!frame) 
+		{
+			LOG(ERROR, "协议超过最大限制或者为空，当前发送协议大小:{}", meta.size());
+			return;
+		}
 
-		auto content = std::move(meta);
-		//
-		//数据包头
-		//
-		unsigned short body_size = content.size();
-		if (body_size == 0 || body_size >= MAX_DATA_SIZE) 
+		EnterQueue(std::move(frame));
+	}
+
+	//
+	//对端支持压缩时，按协议类型压缩超过阈值的数据包，否则返回原数据包
+	//
+	FramePtr CompressFrame(const FramePtr& frame, int32_t type_t)
+	{
+		if (!frame || !(_capabilities & FRAME_CAPABILITY_COMPRESS)) return frame;
+		if (!CompressPolicyInstance.ShouldCompress(type_t, frame->BodySize())) return frame;
+
+		return _compressor.Compress(frame, type_t);
+	}
+
+	//
+	//广播数据包：对端支持压缩时使用共用的压缩数据包(首次由当前连接压缩)，否则使用共用的原数据包
+	//
+	FramePtr CompressFrame(BroadcastFrame& broadcast)
+	{
+		const auto& frame = broadcast.Get();
+		if (!frame || !(_capabilities & FRAME_CAPABILITY_COMPRESS)) return frame;
+		if (!CompressPolicyInstance.ShouldCompress(broadcast.GetType(), frame->BodySize())) return frame;
+
+		return broadcast.GetCompressed(_compressor);
+	}
+
+	//
+	//数据包直接入队，不再复制
+	//
+	//tag：非关键数据包的合并标识(一般为协议类型)，发送队列拥塞时可以丢弃或者合并，0表示必须发送
+	//
+	//任意线程调用：写入发送环形队列(不加发送锁)，由网络线程转入发送队列
+	//
+	//环形队列已满说明网络线程积压：可以丢弃的数据包按拥塞丢弃，必须发送的数据包写入溢出队列
+	//
+	void EnterQueue(FramePtr frame, uint32_t tag = 0)
+	{
+		if (!frame) return;
+
+		if (_resume_replaced) //已经被新连接续传时直接转发，保持顺序
 		{
-			LOG(ERROR, "协议超过最大限制或者为空，当前发送协议大小:{}", body_size);
+			ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+			{
+				std::lock_guard<std::mutex> lock(_send_lock);
+
+				result = TransferSendRing(); //之前写入环形队列的数据包先转发
+				result = std::max(result, PushChecked(frame, tag));
+			}
+
+			if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
 			return;
 		}
 
-		unsigned char header[2] = { 0 };
+		if (!_send_ring.Push(frame, tag))
+		{
+			if (tag != 0 && !_session_resume_enabled) //续传按数据包计数，不能丢弃
+			{
+				_write_queue.RecordDropped();
+				OnBackpressure(ENQUEUE_RESULT_DROPPED);
+				return;
+			}
+
+			_send_ring.Spill(frame, tag);
+		}
+
+		if (_send_ring.MarkPending()) boost::asio::post(_socket.get_executor(), std::bind(&Socket<T, S>::OnSendRing, this->shared_from_this()));
+	}
 
-		header[0] = (body_size >> 8) & 0xff;
-		header[1] = body_size & 0xff;
+	//
+	//服务器之间的连接开启批量发送，握手协商后生效
+	//
+	void EnableBatch(bool enabled = true)
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
 
-		//
-		//包数据体
-		//
-		auto body = content.c_str(); 
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
 
-		//数据整理发送
-		char buffer[MAX_DATA_SIZE] = { 0 }; //发送数据缓存
-		for (int i = 0; i < 2; ++i) buffer[i] = header[i];
-		for (int i = 0; i < body_size; ++i) buffer[i + 2] = body[i];
+			_batcher.SetEnabled(enabled);
+			if (!enabled) result = FlushBatch();
+		}
 
-		auto string_send = std::string(buffer, body_size + 2);
-		_write_queue.push(string_send);
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
 	}
 
-	bool HandleQueue()
+	void ReportBatchStatistics(const std::string& link) { _batcher.Report(link); }
+
+	//
+	//服务器之间连接断线重发，跳过重复数据包：只接收服务器连接的端口在连接开始接收前调用
+	//
+	void EnableLinkReplay()
 	{
-		if (!_socket.is_open()) return false;
+		if (ConfigInstance.GetBool("LinkReplay", true)) _codec.SetLocalCapabilities(_codec.GetLocalCapabilities() | FRAME_CAPABILITY_REPLAY);
+	}
 
-		if (_write_queue.empty()) return false;
-		std::string& meta = _write_queue.front();  //其实是META数据
+	//
+	//确认对端为服务器后接收不再按玩家限制，在网络线程(接收处理中)调用
+	//
+	void EnableServerReceive() { _codec.SetReceiveLimit(FrameBuffer::MAX_EXTENDED_BODY_SIZE); }
 
-		std::size_t bytes_to_send = meta.size();
-		if (bytes_to_send <= 0 || bytes_to_send >= MAX_DATA_SIZE) return false;
+	//
+	//玩家连接按优先级发送，见SendPriorityPolicy；同时限制内核中未发送的字节数，否则积压在内核的批量数据仍会阻塞实时数据
+	//
+	//
+	//开启或者关闭优先级发送：只有开启优先级的连接限制内核未发送字节数(TCP_NOTSENT_LOWAT)，关闭时恢复本连接设置过的限制
+	//
+	//不拆分批量数据包，已经开始发送的数据包仍然会阻塞实时数据包(见SendPriority.h)
+	//
+	void EnableSendLanes(bool enabled = true)
+	{
+		const auto& policy = SendPriorityPolicyInstance;
+
+		int32_t lowat = enabled ? policy.GetNotSentLowat() : -1; //-1为系统默认(不限制)
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+			_write_queue.EnableLanes(enabled, policy.GetWeights());
+
+			if (enabled && lowat <= 0) return;
+			if (!enabled && !_notsent_lowat) return; //没有设置过，保持系统默认
+
+			_notsent_lowat = enabled;
+		}
 
 		boost::system::error_code error;
-		std::size_t bytes_sent = _socket.write_some(boost::asio::buffer(meta.c_str(), bytes_to_send), error);
+		_socket.set_option(boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_NOTSENT_LOWAT>(lowat), error);
+	}
 
-		if (error == boost::asio::error::would_block || error == boost::asio::error::try_again)
+	//玩家连接开启发件箱，见Outbox
+	void EnableOutbox(bool enabled = true) 
+	{ 
+		std::lock_guard<std::mutex> lock(_send_lock);
+
+		_outbox_enabled = enabled; 
+		_outbox_batcher.SetEnabled(enabled);
+	}
+
+	//
+	//本线程处于OutboxScope时缓存，作用域结束时一起入队；延迟敏感及可丢弃(tag不为0)的数据包直接入队
+	//
+	void EnterOutbox(FramePtr frame, int32_t type_t, uint32_t tag = 0)
+	{
+		if (!frame) return;
+
+		auto priority = SendPriorityPolicyInstance.GetPriority(type_t);
+		if (frame->GetPriority() != priority) frame->SetPriority(priority); //按协议类型确定发送优先级
+
+		auto& outbox = Outbox::Local();
+
+		if (_outbox_enabled && outbox.IsOpen())
 		{
-			ERROR("待发送数据长度:{} 实际发送数据长度:{} 错误码:{} 错误信息:{}", bytes_to_send, bytes_sent, error.value(), error.message());
-			return AsyncProcessQueue();
+			if (tag == 0 && !OutboxPolicyInstance.IsBypass(type_t))
+			{
+				outbox.Defer(this->shared_from_this(), frame);
+				return;
+			}
+
+			outbox.Flush(this); //之前缓存的数据包先入队
+		}
 
-			_write_queue.pop();
-			if (_closing && _write_queue.empty()) Close();
+		EnterQueue(std::move(frame), tag);
+	}
 
-			return false;
+	//
+	//发件箱缓存的数据包一起入队：对端支持批量时合并，否则在同一次发送中
+	//
+	virtual void FlushOutbox(std::vector<FramePtr>& frames) override
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+		std::size_t frame_count = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+			if (_closed && !_session_resume) return; //等待续传时继续记录
+
+			result = TransferSendRing(); //之前写入环形队列的数据包先入队
+
+			bool batch = frames.size() > 1 && (_capabilities & FRAME_CAPABILITY_BATCH);
+
+			for (const auto& frame : frames)
+			{
+				if (!batch || !_outbox_batcher.CanBatch(frame) || !IsSameLane(_outbox_batcher, frame))
+				{
+					if (!_outbox_batcher.Empty()) 
+					{
+						result = std::max(result, PushChecked(_outbox_batcher.Take(), 0));
+						++frame_count;
+					}
+
+					result = std::max(result, PushChecked(frame, 0));
+					++frame_count;
+				}
+				else if (_outbox_batcher.Append(frame)) //达到字节上限
+				{
+					result = std::max(result, PushChecked(_outbox_batcher.Take(), 0));
+					++frame_count;
+				}
+			}
+
+			if (!_outbox_batcher.Empty()) 
+			{
+				result = std::max(result, PushChecked(_outbox_batcher.Take(), 0));
+				++frame_count;
+			}
+		}
+
+		OutboxPolicyInstance.Record(frames.size(), frame_count);
+
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
+
+	//
+	//发送队列拥塞处理，在发送锁之外调用
+	//
+	//默认：丢弃和合并只做统计，超过上限断开连接
+	//
+	virtual void OnBackpressure(ENQUEUE_RESULT result)
+	{
+		if (ENQUEUE_RESULT_OVERFLOW != result) return;
+
+		auto status = GetQueueStatus();
+		ERROR("发送队列超过上限，断开连接，待发送数据包:{} 字节数:{} 丢弃:{} 合并:{}", status.messages, status.bytes, status.dropped, status.coalesced);
+
+		boost::asio::post(_socket.get_executor(), std::bind(&Socket<T, S>::Close, this->shared_from_this())); //在网络线程关闭
+	}
+
+	//
+	//按连接类型读取发送队列水位，未配置的使用当前值
+	//
+	void SetQueueLimits(const std::string& name, const QueueLimits& defaults)
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+		_write_queue.SetLimits(QueueLimits::Load(name, defaults));
+	}
+
+	void SetQueueLimits(const std::string& name)
+	{
+		SetQueueLimits(name, _write_queue.GetLimits());
+	}
+
+	QueueStatus GetQueueStatus()
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+		return _write_queue.GetStatus();
+	}
+
+	//
+	//连接健康状态(服务器之间的连接用于路由选择)：关闭为断开，发送队列拥塞为降级
+	//
+	LINK_STATE GetLinkState()
+	{
+		if (!IsOpen()) return LINK_STATE_DOWN;
+
+		std::lock_guard<std::mutex> lock(_send_lock);
+		return _write_queue.IsCongested() ? LINK_STATE_DEGRADED : LINK_STATE_UP;
+	}
+
+	//
+	//对端(客户端或者其他服务器)发起握手，回复本端能力，之后的数据包可以使用扩展包头
+	//
+	void OnHandshake(uint32_t capabilities)
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+
+			result = PushControl(FrameBuffer::BuildHandshake(_codec.GetLocalCapabilities())); //之前的数据包按握手前的格式发送
+			_capabilities = capabilities;
+			_handshaked = true;
+		}
+
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
+
+	//对端发起过握手(已经升级)，可以使用带包头的格式；未握手的对端按原有格式发送
+	bool IsHandshaked() const { return _handshaked; }
+
+	//
+	//回复发起端已处理序号，控制数据包不参与合并
+	//
+	void SendAck(uint64_t sequence)
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+
+			if (_closed) return;
+
+			result = PushControl(FrameBuffer::BuildAck(sequence));
+		}
+
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
+
+	//
+	//网络线程：发送环形队列中的数据包转入发送队列
+	//
+	void OnSendRing()
+	{
+		_send_ring.ClearPending(); //之后写入的数据包重新投递
+
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+
+			if (_closed && !_session_resume) //等待续传时继续记录
+			{
+				_send_ring.Clear();
+				return;
+			}
+
+			result = TransferSendRing();
 		}
-		/*
-		else if (error == boost::asio::error::broken_pipe)
+
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
+
+	//发送锁内调用，返回最严重的入队结果
+	ENQUEUE_RESULT TransferSendRing()
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
+		_send_ring.Drain([this, &result](const FramePtr& frame, uint32_t tag) {
+			result = std::max(result, PushChecked(frame, tag));
+		});
+
+		return result;
+	}
+
+	//
+	//发送锁内调用：控制数据包(握手、确认、续传)及续传重发的数据包入队，不记录续传、不合并、不丢弃
+	//
+	//之前入队(包括环形队列中)的数据包先入队，保持顺序
+	//
+	ENQUEUE_RESULT PushControl(const FramePtr& frame)
+	{
+		ENQUEUE_RESULT result = TransferSendRing();
+		result = std::max(result, FlushBatch());
+
+		ENQUEUE_RESULT pushed = _write_queue.Push(frame);
+		if (ENQUEUE_RESULT_SUCCESS == pushed) ScheduleFlush();
+
+		return std::max(result, pushed);
+	}
+
+	//发送锁内调用：对端不支持扩展包头时丢弃超过64K的数据包
+	ENQUEUE_RESULT PushChecked(const FramePtr& frame, uint32_t tag)
+	{
+		if (frame->IsExtended() && !(_capabilities & FRAME_CAPABILITY_EXTENDED))
+		{
+			LOG(ERROR, "协议超过最大限制，对端不支持扩展包头，当前发送协议大小:{}", frame->BodySize());
+			return ENQUEUE_RESULT_SUCCESS;
+		}
+
+		return PushFrame(frame, tag);
+	}
+
+	//
+	//发送锁内调用：可以合并的数据包加入当前批次，其他数据包直接入队
+	//
+	ENQUEUE_RESULT PushFrame(const FramePtr& frame, uint32_t tag)
+	{
+		if (_session_resume) //续传按数据包计数，数据包不能丢弃或者合并
+		{
+			if (!RecordResume(frame) || _closed) return ENQUEUE_RESULT_SUCCESS; //已经转给新连接，或者断开等待续传
+
+			tag = 0;
+		}
+
+		if ((_capabilities & FRAME_CAPABILITY_BATCH) && tag == 0 && !_session_resume && _batcher.CanBatch(frame))
+		{
+			if (!IsSameLane(_batcher, frame)) //之前的批次先入队
+			{
+				ENQUEUE_RESULT result = FlushBatch();
+				if (ENQUEUE_RESULT_OVERFLOW == result) return result;
+			}
+
+			if (_batcher.Append(frame)) return FlushBatch(); //达到字节上限
+
+			ScheduleBatch();
+			return ENQUEUE_RESULT_SUCCESS;
+		}
+
+		ENQUEUE_RESULT result = FlushBatch(); //之前合并的数据包先入队，保证发送顺序
+		if (ENQUEUE_RESULT_OVERFLOW == result) return result;
+
+		_batcher.OnUnbatched();
+
+		result = _write_queue.Push(frame, tag);
+		if (ENQUEUE_RESULT_SUCCESS == result) ScheduleFlush();
+
+		return result;
+	}
+
+	//
+	//发送锁内调用：入队的数据包记录到续传记录，返回false表示已经被新连接续传(数据包转给新连接)
+	//
+	bool RecordResume(const FramePtr& frame)
+	{
+		std::shared_ptr<ResumeTarget> forward;
+		if (_session_resume->Record(this, frame, forward)) return true;
+
+		if (forward) forward->OnResumeForward(frame); //新连接不会反向转发，没有死锁
+		return false;
+	}
+
+	//按优先级发送时，不同优先级的数据包不合并到同一批次(批量数据包按第一个数据包的优先级入队)
+	bool IsSameLane(const FrameBatcher& batcher, const FramePtr& frame) const
+	{
+		return !_write_queue.IsLanesEnabled() || batcher.Empty() || batcher.GetPriority() == frame->GetPriority();
+	}
+
+	//当前批次入队
+	ENQUEUE_RESULT FlushBatch()
+	{
+		auto batch = _batcher.Take();
+		if (!batch) return ENQUEUE_RESULT_SUCCESS;
+
+		ENQUEUE_RESULT result = _write_queue.Push(batch);
+		if (ENQUEUE_RESULT_SUCCESS == result) ScheduleFlush();
+
+		return result;
+	}
+
+	//等待时间到达后发送当前批次，同一时刻最多一个定时器
+	void ScheduleBatch()
+	{
+		if (_batch_scheduled) return;
+		_batch_scheduled = true;
+
+		_batch_timer.expires_from_now(boost::posix_time::microseconds(_batcher.GetBatchDelay()));
+		_batch_timer.async_wait(std::bind(&Socket<T, S>::OnBatchTimer, this->shared_from_this(), std::placeholders::_1));
+	}
+
+	void OnBatchTimer(const boost::system::error_code& error)
+	{
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
 		{
-			ERROR("网络连接已断开，待发送数据长度:{} 实际发送数据长度:{} 错误码:{} 错误信息:{}", bytes_to_send, bytes_sent, error.value(), error.message());
+			std::lock_guard<std::mutex> lock(_send_lock);
 
-			Close();
+			_batch_scheduled = false;
+			if (_closed) return;
 
+			result = FlushBatch();
+		}
+
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
+
+	//
+	//投递发送任务到连接所在网络线程，同一时刻最多投递一次，期间入队的数据一起发送
+	//
+	void ScheduleFlush()
+	{
+		if (_flush_scheduled || _is_writing_async) return;
+		_flush_scheduled = true;
+
+		boost::asio::post(_socket.get_executor(), std::bind(&Socket<T, S>::FlushQueue, this->shared_from_this()));
+	}
+
+	void FlushQueue()
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+
+		_flush_scheduled = false;
+		if (_closed || _is_writing_async) return;
+
+		for (; HandleQueue(); ) {}
+	}
+
+	//
+	//合并队列中的数据包进行发送，返回true表示需要继续发送
+	//
+	bool HandleQueue()
+	{
+		if (!_socket.is_open()) return false;
+
+		if (_write_queue.Empty()) 
+		{
+			if (_closing) Close();
 			return false;
 		}
-		*/
+
+		const auto& buffers = _write_queue.Gather(); 
+		std::size_t bytes_to_send = _write_queue.GatheredBytes();
+
+		boost::system::error_code error;
+		std::size_t bytes_sent = _shm ? _shm->WriteSome(buffers, error) : _socket.write_some(buffers, error);
+
+		if (error == boost::asio::error::would_block || error == boost::asio::error::try_again)
+		{
+			return AsyncProcessQueue(); //发送缓冲区已满，可写时继续发送
+		}
 		else if (bytes_sent == 0)
 		{
 			ERROR("待发送数据长度:{}实际发送数据长度:{}为0，错误码:{} 错误信息:{}", bytes_to_send, bytes_sent, error.value(), error.message());
 
-			_write_queue.pop();
-			if (_closing && _write_queue.empty()) Close();
+			_write_queue.PopFront();
+			if (_closing && _write_queue.Empty()) Close();
 
 			return false;
 		}
-		else if (bytes_sent < bytes_to_send) //一般不会出现这个情况，重新发送，记个ERROR
+			
+		auto messages = _write_queue.Consume(bytes_sent);
+		_write_queue.OnFlushed(bytes_sent, messages);
+		if (_load) _load->Add(bytes_sent, messages);
+
+		if (bytes_sent < bytes_to_send) return AsyncProcessQueue(); //部分发送，剩余数据等待可写时继续发送
+
+		if (_closing && _write_queue.Empty()) Close();
+
+		return !_write_queue.Empty();
+	}
+
+	const FlushStatistics& GetFlushStatistics() const { return _write_queue.GetStatistics(); }
+
+	//
+	//玩家连接开启断线续传：发送续传数据包(续传标识+下一个数据包序号)，之后入队的数据包开始记录
+	//
+	void AttachSessionResume(std::shared_ptr<SessionResume> resume)
+	{
+		EnableSendLanes(false); //续传按入队顺序计数
+
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+
 		{
-			LOG(ERROR, "待发送数据长度:{}少于实际发送数据长度:{} 错误码:{} 错误信息:{}", bytes_to_send, bytes_sent, error.value(), error.message());
+			std::lock_guard<std::mutex> lock(_send_lock);
 
-			meta = meta.substr(bytes_sent);
-			return AsyncProcessQueue();
+			if (_closed) return;
+
+			_session_resume_enabled = true; //之后环形队列已满时不再丢弃
+			result = PushControl(FrameBuffer::BuildResume(resume->GetToken(), resume->GetNextSequence())); //之前入队的数据包不计数
+			std::atomic_store(&_session_resume, resume);
 		}
-			
-		//DEBUG("待发送数据长度:{}实际发送数据长度:{}，错误码:{} 错误信息:{}", bytes_to_send, bytes_sent, error.value(), error.message());
 
-		_write_queue.pop();
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+	}
+
+	std::shared_ptr<SessionResume> GetSessionResume()
+	{
+		std::lock_guard<std::mutex> lock(_send_lock);
+		return _session_resume;
+	}
+
+	//
+	//客户端重连后续传：记录中有next_sequence时回复续传数据包，并从该序号开始重发
+	//
+	//失败时回复续传标识为0的续传数据包，客户端按断线重连登录
+	//
+	bool ResumeSession(std::shared_ptr<SessionResume> resume, uint64_t next_sequence)
+	{
+		if (resume)
+		{
+			const uint32_t format = FRAME_CAPABILITY_EXTENDED | FRAME_CAPABILITY_COMPRESS | FRAME_CAPABILITY_BATCH;
+			if (resume->GetCapabilities() & format & ~_capabilities) resume = nullptr; //记录的数据包按之前协商的格式编码
+		}
+
+		if (resume) EnableSendLanes(false);
+
+		std::vector<FramePtr> frames;
+		std::shared_ptr<ResumeTarget> previous;
+		ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+		bool resumed = false;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+
+			if (_closed) return false;
+
+			if (!resume || _session_resume || !resume->TakeOver(this, this->shared_from_this(), next_sequence, frames, previous))
+			{
+				result = PushControl(FrameBuffer::BuildResume(ResumeToken(), 0));
+			}
+			else
+			{
+				resumed = _session_resume_enabled = true;
+
+				result = PushControl(FrameBuffer::BuildResume(resume->GetToken(), next_sequence));
+				for (const auto& frame : frames) result = std::max(result, PushControl(frame)); //已经记录过，不再计数
+
+				std::atomic_store(&_session_resume, resume);
+			}
+		}
+
+		if (!resumed) //续传失败
+		{
+			if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+			return false;
+		}
+
+		if (previous && previous.get() != this) previous->OnResumeReplaced(); //客户端先于服务器发现断开时，旧连接尚未关闭
+		if (ENQUEUE_RESULT_SUCCESS != result) OnBackpressure(result);
+
+		return true;
+	}
+
+	//
+	//连接断开时调用：等待客户端续传，返回false时按断开连接处理
+	//
+	//关闭可能在发送锁内进行，以下不加发送锁
+	//
+	bool ParkSessionResume()
+	{
+		return SessionResumeRegistryInstance.Park(std::atomic_load(&_session_resume), this);
+	}
+
+	void StopSessionResume()
+	{
+		SessionResumeRegistryInstance.Remove(std::atomic_load(&_session_resume));
+	}
 
-		if (_closing && _write_queue.empty()) Close();
+	//断开后等待续传(或者已经被新连接续传)，发给玩家的数据包继续记录
+	bool IsResumable()
+	{
+		auto resume = std::atomic_load(&_session_resume);
+		return resume && !resume->IsRemoved();
+	}
+
+	virtual void OnResumeForward(FramePtr frame) override { EnterQueue(std::move(frame)); }
+
+	virtual void OnResumeReplaced() override
+	{
+		_resume_replaced = true;
+
+		{
+			std::lock_guard<std::mutex> lock(_send_lock);
+			TransferSendRing(); //环形队列中的数据包先转给新连接，保持顺序
+		}
 
-		return !_write_queue.empty();
+		boost::asio::post(_socket.get_executor(), std::bind(&Socket<T, S>::Close, this->shared_from_this())); //在网络线程关闭
 	}
 
+	virtual void OnResumeExpired() override { }
+
 protected:
 	virtual void OnClose() { 
 		_closed = true;
-		_write_queue = {};
-		_buffer = {};
+		_write_queue.Clear();
+		_batcher.Clear();
+		_codec.Reset();
 	}
 protected:
 	std::atomic<bool> _closed;    
 	std::atomic<bool> _closing;
 	std::mutex _send_lock;
 	bool _is_writing_async = false;
-	//接收缓存
-	std::array<unsigned char, MAX_DATA_SIZE> _buffer;
+	bool _flush_scheduled; //已经投递发送任务
+	std::atomic<uint32_t> _capabilities{0}; //握手协商结果，决定发送格式
+	std::atomic<bool> _handshaked{false}; //对端发起过握手
+	std::atomic<int64_t> _active_time; 
+	std::function<void()> _close_handler;
+	//接收缓存，处理粘包和半包
+	FrameCodec _codec;
+	FrameCompressor _compressor; //发送压缩上下文
+	FrameBatcher _batcher; //服务器之间批量发送
+	FrameBatcher _outbox_batcher; //发件箱合并
+	std::atomic<bool> _outbox_enabled{false};
+	std::shared_ptr<SessionResume> _session_resume; //玩家连接断线续传记录
+	std::atomic<bool> _resume_replaced{false}; //已经被新连接续传
+	std::atomic<bool> _session_resume_enabled{false}; //开启断线续传，其他线程入队时读取
+	boost::asio::deadline_timer _batch_timer;
+	bool _batch_scheduled = false;
+	ThreadLoad* _load = nullptr; //所在网络线程的负载统计
+	bool _receive_on_readable = false; //可读后再获取接收缓存
+	bool _notsent_lowat = false; //已经设置TCP_NOTSENT_LOWAT(只用于优先级发送)
+	std::shared_ptr<ShmStream> _shm; //本机对端的共享内存传输，为空时使用TCP
+	bool _stream_watching = false; //共享内存传输时检测TCP连接断开
 	//发送队列
-	std::queue<std::string> _write_queue;
+	WriteQueue _write_queue;
+	SendRing _send_ring; //其他线程写入，网络线程转入发送队列
 };
 
 template <class SOCKET_TYPE> //各种类型的SOCKET，比如Session-其本质也要继承至Socket
@@ -228,29 +963,100 @@ protected:
 	AsyncAcceptor* _acceptor; //接收连接
 	NetworkThread<SOCKET_TYPE>* _threads; //网络线程池，每个SOCKET有N个NetworkThread进行网络管理
 	int32_t _thread_count;
+	boost::asio::io_service* _io_service; //主线程，共用监听所在
+	std::string _bind_ip;
+	int32_t _port;
+	bool _reuse_port; //每个网络线程独立监听(SO_REUSEPORT)
+	bool _load_placement; //按负载分配连接
 protected:
-	SocketManager() : _acceptor(nullptr), _threads(nullptr), _thread_count(1) {	}
+	SocketManager() : _acceptor(nullptr), _threads(nullptr), _thread_count(1), _io_service(nullptr), _port(0), _reuse_port(false), _load_placement(true) {	}
 	
 	virtual NetworkThread<SOCKET_TYPE>* CreateThreads() const = 0;
-public:
-	virtual bool StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int port, int thread_count)
+
+	//
+	//开始接收连接
+	//
+	//默认由主线程统一接收，再分配到连接数最少的网络线程;
+	//
+	//配置ReusePortAccept开启后每个网络线程独立监听同一端口，由内核分配连接，失败时退回统一接收.
+	//
+	template<AsyncAcceptor::AcceptCallback accept_callback> 
+	bool StartAccept()
 	{
-		try
+		if (_reuse_port)
 		{
-			_acceptor = new AsyncAcceptor(io_service, bind_ip, port);
+			int32_t started = 0;
+
+			for (int32_t i = 0; i < _thread_count; ++i)
+			{
+				if (!_threads[i].StartAcceptor(_bind_ip, _port, i, accept_callback)) break;
+				++started;
+			}
+
+			if (started == _thread_count) return true;
+
+			if (started > 0) 
+			{
+				ERROR("网络线程独立监听部分失败，地址:{} 端口:{} 成功数量:{}", _bind_ip, _port, started);
+				return true;
+			}
+
+			WARN("网络线程独立监听失败，改为统一接收，地址:{} 端口:{}", _bind_ip, _port);
+			_reuse_port = false;
 		}
-		catch (const boost::system::system_error& error)
+
+		if (!_acceptor)
 		{
-			ERROR("服务器启动失败，地址:{} 端口:{} 错误码:{}", bind_ip, port, error.what());
-			return false;
+			try
+			{
+				_acceptor = new AsyncAcceptor(*_io_service, _bind_ip, _port);
+			}
+			catch (const boost::system::system_error& error)
+			{
+				ERROR("服务器启动失败，地址:{} 端口:{} 错误码:{}", _bind_ip, _port, error.what());
+				return false;
+			}
+		}
+
+		_acceptor->SetSocketFactory(std::bind(&SocketManager::GetSocketForAccept, this));    
+		_acceptor->AsyncAcceptWithCallback<accept_callback>();    
+
+		return true;
+	}
+public:
+	virtual bool StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int port, int thread_count)
+	{
+		_io_service = &io_service;
+		_bind_ip = bind_ip;
+		_port = port;
+		_reuse_port = ConfigInstance.GetBool("ReusePortAccept", false);
+		ShmRegistryInstance.Listen(io_service, port); //本机服务器之间的共享内存传输
+		_load_placement = ConfigInstance.GetBool("LoadAwarePlacement", true); //关闭时按连接数量分配
+
+		if (!_reuse_port)
+		{
+			try
+			{
+				_acceptor = new AsyncAcceptor(io_service, bind_ip, port);
+			}
+			catch (const boost::system::system_error& error)
+			{
+				ERROR("服务器启动失败，地址:{} 端口:{} 错误码:{}", bind_ip, port, error.what());
+				return false;
+			}
 		}
 
 		_thread_count = thread_count;
 		
 		_threads = CreateThreads(); //继承类所实现的Socket
 
+		auto cpus = ThreadAffinity::Parse(ConfigInstance.GetString("NetworkThreadAffinity", ""), _thread_count); //网络线程绑定CPU
+
 		for (int32_t i = 0; i < _thread_count; ++i)            
+		{
+			if (!cpus.empty()) _threads[i].SetAffinity(cpus[i], i);
 			_threads[i].Start();
+		}
 		
 		return true;
 	}
@@ -258,7 +1064,7 @@ public:
 	//释放资源、清理内存
 	virtual void StopNetwork()
 	{
-		_acceptor->Close();
+		if (_acceptor) _acceptor->Close();
 		for (int32_t i = 0; i < _thread_count; ++i)
 			_threads[i].Stop();
 
@@ -304,9 +1110,29 @@ public:
 		return min;    
 	}    
 	
+	//
+	//负载最低的网络线程：服务器之间的连接承载大量玩家数据，只按连接数量分配会导致单个线程过载
+	//
+	int32_t SelectThreadWithMinLoad() const
+	{
+		int32_t min = 0;
+		int64_t min_score = _threads[0].GetLoadScore();
+
+		for (int32_t i = 1; i < _thread_count; ++i)
+		{
+			int64_t score = _threads[i].GetLoadScore();
+			if (score >= min_score) continue;
+
+			min = i;
+			min_score = score;
+		}
+
+		return min;
+	}
+
 	std::pair<tcp::socket*, int32_t> GetSocketForAccept()    
 	{        
-		int32_t thread_index = SelectThreadWithMinConnections();        
+		int32_t thread_index = _load_placement ? SelectThreadWithMinLoad() : SelectThreadWithMinConnections();        
 		return std::make_pair(_threads[thread_index].GetSocketForAccept(), thread_index);    
 	}
 };
@@ -0,0 +1,76 @@
+#include <string>
+#include <cstring>
+
+#include <google/protobuf/wrappers.pb.h>
+
+#include "BroadcastFrame.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+static std::string GetBody(const FramePtr& frame)
+{
+	return std::string(reinterpret_cast<const char*>(frame->Body()), frame->BodySize());
+}
+
+//所有接收者共用同一个数据包，按协议类型设置优先级
+TEST(SharedFrame)
+{
+	SendPriorityPolicyInstance.Load({ 7 }, {});
+
+	google::protobuf::StringValue message;
+	message.set_value("broadcast");
+
+	BroadcastFrame broadcast(message, 7);
+
+	const auto& frame = broadcast.Get();
+	CHECK(frame);
+	CHECK(broadcast.Get().get() == frame.get());
+	CHECK(broadcast.Get(0).get() == frame.get());
+	CHECK(frame->GetPriority() == SEND_PRIORITY_REALTIME);
+
+	auto meta = FrameBuffer::BuildMeta(message, 7);
+	CHECK(GetBody(frame) == GetBody(meta));
+}
+
+//
+//追加玩家ID的数据包和直接序列化的结果相同
+//
+TEST(AppendPlayerID)
+{
+	google::protobuf::StringValue message;
+	message.set_value("player");
+
+	BroadcastFrame broadcast(message, 8);
+
+	for (int64_t player_id : { int64_t(1), int64_t(300), int64_t(1) << 40 })
+	{
+		auto frame = broadcast.Get(player_id);
+		CHECK(frame && frame.get() != broadcast.Get().get());
+		CHECK(GetBody(frame) == GetBody(FrameBuffer::BuildMeta(message, 8, player_id)));
+	}
+}
+
+//压缩结果只生成一次
+TEST(CompressOnce)
+{
+	google::protobuf::StringValue message;
+	message.set_value(std::string(4096, 'x'));
+
+	BroadcastFrame broadcast(message, 9);
+
+	FrameCompressor compressor;
+
+	const auto& compressed = broadcast.GetCompressed(compressor);
+	CHECK(compressed && compressed->IsCompressed());
+	CHECK(compressed->BodySize() < broadcast.Get()->BodySize());
+	CHECK(broadcast.GetCompressed(compressor).get() == compressed.get());
+
+	google::protobuf::StringValue small;
+	small.set_value("a");
+
+	BroadcastFrame uncompressed(small, 9);
+	CHECK(uncompressed.GetCompressed(compressor).get() == uncompressed.Get().get()); //没有变小时为原数据包
+}
+
+TEST_MAIN()
@@ -0,0 +1,183 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "FrameBatcher.h"
+#include "FrameCodec.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+//
+//接收端：协商指定能力后一次收到全部数据，记录解析出的包体
+//
+struct Receiver
+{
+	FrameCodec codec;
+	std::vector<std::string> bodies;
+	FRAME_DECODE_RESULT result = FRAME_DECODE_SUCCESS;
+
+	explicit Receiver(uint32_t capabilities)
+	{
+		codec.SetLocalCapabilities(capabilities);
+		Receive(FrameBuffer::BuildHandshake(capabilities));
+	}
+
+	void Receive(const FramePtr& frame)
+	{
+		std::string stream;
+		for (auto chunk = frame; chunk; chunk = chunk->Next()) stream.append(reinterpret_cast<const char*>(chunk->Data()), chunk->Size());
+
+		result = FRAME_DECODE_SUCCESS;
+
+		for (std::size_t position = 0; position < stream.size(); ) //每次最多接收缓存剩余空间
+		{
+			auto buffer = codec.PrepareBuffer();
+
+			std::size_t size = std::min(boost::asio::buffer_size(buffer), stream.size() - position);
+			memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data() + position, size);
+			codec.Commit(size);
+			position += size;
+
+			auto decode_result = codec.DecodeRaw([this](const uint8_t* body, std::size_t body_size) {
+				bodies.emplace_back(reinterpret_cast<const char*>(body), body_size);
+				return FRAME_DECODE_SUCCESS;
+			});
+			if (decode_result != FRAME_DECODE_SUCCESS) result = decode_result;
+		}
+	}
+};
+
+static FramePtr MakeFrame(const std::string& body) { return FrameBuffer::Create(body.data(), body.size()); }
+
+//只有一个数据包时原样发送，不加批量包头
+TEST(SingleFrameUnchanged)
+{
+	FrameBatcher batcher;
+	batcher.SetEnabled(true);
+
+	CHECK(batcher.Take() == nullptr);
+
+	auto frame = MakeFrame("single");
+	CHECK(!batcher.Append(frame));
+
+	auto taken = batcher.Take();
+	CHECK(taken.get() == frame.get());
+	CHECK(!taken->IsBatched());
+	CHECK(batcher.Empty() && batcher.Take() == nullptr);
+}
+
+//
+//批量包体和MetaBatch{ repeated bytes metas = 1; }的序列化结果一致，优先级取第一个数据包
+//
+TEST(PackAsMetaBatch)
+{
+	std::vector<std::string> bodies = { "a", "bb", std::string(300, 'c') }; //300字节的长度占2字节varint
+
+	FrameBatcher batcher;
+	batcher.SetEnabled(true);
+
+	for (std::size_t i = 0; i < bodies.size(); ++i)
+	{
+		auto frame = MakeFrame(bodies[i]);
+		frame->SetPriority(i == 0 ? SEND_PRIORITY_REALTIME : SEND_PRIORITY_BULK);
+		batcher.Append(frame);
+	}
+
+	auto batch = batcher.Take();
+	CHECK(batch->IsBatched());
+	CHECK(batch->HeaderSize() == FrameBuffer::EXTENDED_HEADER_SIZE);
+	CHECK(batch->GetPriority() == SEND_PRIORITY_REALTIME);
+
+	pb::io::CodedInputStream input(batch->Data() + batch->HeaderSize(), int(batch->BodySize()));
+
+	std::vector<std::string> metas;
+	for (uint32_t tag = input.ReadTag(); tag != 0; tag = input.ReadTag())
+	{
+		CHECK(tag == pb::internal::WireFormatLite::MakeTag(1, pb::internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+
+		std::string meta;
+		CHECK(pb::internal::WireFormatLite::ReadBytes(&input, &meta));
+		metas.push_back(meta);
+	}
+
+	CHECK(metas == bodies);
+	CHECK(batcher.GetStatistics().message_count == 3 && batcher.GetStatistics().frame_count == 1);
+}
+
+//字节上限和可以合并的数据包
+TEST(BatchBytesAndCanBatch)
+{
+	FrameBatcher batcher;
+
+	auto small = MakeFrame(std::string(40, 's'));
+	CHECK(!batcher.CanBatch(small)); //未开启
+
+	batcher.SetEnabled(true);
+	batcher.SetBatchBytes(100);
+	CHECK(batcher.CanBatch(small));
+
+	CHECK(!batcher.CanBatch(MakeFrame(std::string(100, 'l')))); //不小于上限
+	CHECK(!batcher.CanBatch(FrameBuffer::CreateWithFlags("x", 1, FrameBuffer::COMPRESSED_FLAG)));
+
+	std::string chunked(FrameBuffer::MAX_FRAME_BODY_SIZE + 1, 'e');
+	CHECK(!batcher.CanBatch(MakeFrame(chunked)));
+
+	CHECK(!batcher.Append(small)); //42字节
+	CHECK(!batcher.Append(small)); //84字节
+	CHECK(batcher.Append(small)); //达到上限，调用者立即发送
+	batcher.Clear();
+
+	batcher.SetBatchBytes(0);
+	CHECK(batcher.GetBatchBytes() == FrameBatcher::DEFAULT_BATCH_BYTES);
+
+	batcher.SetBatchBytes(1 << 20);
+	CHECK(batcher.GetBatchBytes() == FrameBuffer::MAX_FRAME_BODY_SIZE / 2);
+}
+
+//
+//接收端按顺序解开，上层收到单个包体；未协商批量时丢弃批量数据包，之后的数据包正常解析
+//
+TEST(UnpackThroughCodec)
+{
+	FrameBatcher batcher;
+	batcher.SetEnabled(true);
+
+	batcher.Append(MakeFrame("first"));
+	batcher.Append(MakeFrame(std::string(1000, 'm')));
+	batcher.Append(MakeFrame(""));
+	auto batch = batcher.Take();
+
+	Receiver batched(FRAME_CAPABILITY_BATCH);
+	batched.Receive(batch);
+	batched.Receive(MakeFrame("after"));
+
+	CHECK(batched.result == FRAME_DECODE_SUCCESS);
+	CHECK(batched.bodies.size() == 4);
+	CHECK(batched.bodies[0] == "first" && batched.bodies[1] == std::string(1000, 'm') && batched.bodies[2].empty() && batched.bodies[3] == "after");
+
+	Receiver legacy(FRAME_CAPABILITY_EXTENDED);
+	legacy.Receive(batch);
+
+	CHECK(legacy.result == FRAME_DECODE_PARSE_ERROR);
+	CHECK(legacy.bodies.empty());
+
+	legacy.Receive(MakeFrame("after"));
+	CHECK(legacy.result == FRAME_DECODE_SUCCESS);
+	CHECK(legacy.bodies.size() == 1 && legacy.bodies[0] == "after");
+}
+
+//批量包体中的长度超出包体时整个批量数据包无效
+TEST(TruncatedBatch)
+{
+	std::string body = "\x0A\x05" "abc";
+
+	Receiver receiver(FRAME_CAPABILITY_BATCH);
+	receiver.Receive(FrameBuffer::CreateWithFlags(body.data(), body.size(), FrameBuffer::BATCHED_FLAG));
+
+	CHECK(receiver.result == FRAME_DECODE_PARSE_ERROR);
+	CHECK(receiver.bodies.empty());
+}
+
+TEST_MAIN()
@@ -0,0 +1,167 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <google/protobuf/wrappers.pb.h>
+
+#include "FrameCodec.h"
+#include "WriteQueue.h"
+
+/*
+ * 数据包吞吐量测试
+ *
+ * 1.编码：协议序列化到数据包(FrameBuffer::Build)，包括超过64K的分块扩展数据包;
+ *
+ * 2.解码：按每次接收64K把连续的数据包交给FrameCodec解析出协议;
+ *
+ * 3.合并发送：发送队列Gather之后一次write_some(writev)写入本地连接，另一个线程接收丢弃.
+ *
+ * 用法：FrameBenchmark [每项数据包数量]，ctest只用少量数量运行，保证测试程序可以编译运行，不检查结果.
+ *
+ * */
+
+using namespace Adoter;
+
+typedef google::protobuf::StringValue Message;
+typedef std::chrono::steady_clock Clock;
+
+static const std::size_t RECEIVE_SIZE = 65536; //单次接收字节数
+static const std::size_t PUSH_COUNT = 256; //每轮入队后全部发送
+
+//输出每秒数据包数量和字节数
+static void Report(const char* name, std::size_t body_size, std::size_t count, std::size_t bytes, Clock::time_point start, const char* extra = "")
+{
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	if (seconds <= 0) seconds = 1e-9;
+
+	printf("%-8s 包体:%7zu 数量:%9zu 耗时:%8.2fms %10.0f个/秒 %9.1fMB/秒%s\n", name, body_size, count, seconds * 1000, count / seconds, bytes / seconds / (1024 * 1024), extra);
+}
+
+static Message MakeMessage(std::size_t body_size)
+{
+	Message message;
+	message.set_value(std::string(body_size, 'b'));
+	return message;
+}
+
+static std::size_t WireSize(const FramePtr& frame)
+{
+	std::size_t size = 0;
+	for (auto chunk = frame; chunk; chunk = chunk->Next()) size += chunk->Size();
+	return size;
+}
+
+static void EncodeBenchmark(std::size_t body_size, std::size_t count)
+{
+	auto message = MakeMessage(body_size);
+
+	std::size_t bytes = 0;
+	auto start = Clock::now();
+
+	for (std::size_t i = 0; i < count; ++i) bytes += WireSize(FrameBuffer::Build(message));
+
+	Report("编码", body_size, count, bytes, start);
+}
+
+static void DecodeBenchmark(std::size_t body_size, std::size_t count)
+{
+	std::string stream;
+
+	for (auto chunk = FrameBuffer::BuildHandshake(FRAME_CAPABILITY_EXTENDED); chunk; chunk = chunk->Next()) stream.append(reinterpret_cast<const char*>(chunk->Data()), chunk->Size());
+
+	auto frame = FrameBuffer::Build(MakeMessage(body_size)); //同一个数据包重复发送
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		for (auto chunk = frame; chunk; chunk = chunk->Next()) stream.append(reinterpret_cast<const char*>(chunk->Data()), chunk->Size());
+	}
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(FRAME_CAPABILITY_EXTENDED);
+
+	std::size_t decoded = 0;
+	auto handler = [&decoded](const Message&) { ++decoded; return true; };
+
+	auto start = Clock::now();
+
+	for (std::size_t position = 0; position < stream.size(); )
+	{
+		auto buffer = codec.PrepareBuffer();
+
+		std::size_t size = std::min(std::min(boost::asio::buffer_size(buffer), RECEIVE_SIZE), stream.size() - position);
+		memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data() + position, size);
+		codec.Commit(size);
+		position += size;
+
+		if (codec.Decode<Message>(handler) != FRAME_DECODE_SUCCESS) break;
+	}
+
+	Report("解码", body_size, decoded, stream.size(), start, decoded == count ? "" : " 解析失败");
+}
+
+static void GatherBenchmark(std::size_t body_size, std::size_t count)
+{
+	boost::asio::io_service io_service;
+	boost::asio::local::stream_protocol::socket writer(io_service), reader(io_service);
+	boost::asio::local::connect_pair(writer, reader);
+
+	std::thread drain([&reader]() {
+		std::vector<char> buffer(RECEIVE_SIZE);
+		boost::system::error_code error;
+		while (!error) reader.read_some(boost::asio::buffer(buffer), error);
+	});
+
+	auto frame = FrameBuffer::Build(MakeMessage(body_size));
+
+	WriteQueue queue;
+
+	std::size_t bytes = 0, calls = 0;
+	auto start = Clock::now();
+
+	for (std::size_t sent = 0; sent < count; )
+	{
+		for (std::size_t i = 0; i < PUSH_COUNT && sent < count; ++i, ++sent) queue.Push(frame);
+
+		while (!queue.Empty())
+		{
+			const auto& buffers = queue.Gather();
+
+			boost::system::error_code error;
+			std::size_t bytes_sent = writer.write_some(buffers, error);
+			if (error) break;
+
+			queue.Consume(bytes_sent);
+			bytes += bytes_sent;
+			++calls;
+		}
+	}
+
+	char extra[64];
+	snprintf(extra, sizeof(extra), " 平均每次发送%.1f个", calls ? double(count) / calls : 0.0);
+
+	Report("合并发送", body_size, count, bytes, start, extra);
+
+	writer.close();
+	drain.join();
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+	if (count == 0) count = 1;
+
+	for (std::size_t body_size : { 32, 512, 4096 }) EncodeBenchmark(body_size, count);
+	EncodeBenchmark(FrameBuffer::MAX_FRAME_BODY_SIZE * 4, count / 100 + 1); //分块扩展数据包
+
+	for (std::size_t body_size : { 32, 512, 4096 }) DecodeBenchmark(body_size, count);
+	DecodeBenchmark(FrameBuffer::MAX_FRAME_BODY_SIZE * 4, count / 100 + 1);
+
+	for (std::size_t body_size : { 32, 512, 4096 }) GatherBenchmark(body_size, count);
+
+	return 0;
+}
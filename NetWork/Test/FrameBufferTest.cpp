@@ -0,0 +1,101 @@
+#include <string>
+
+#include "P_Command.pb.h"
+#include "FrameBuffer.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+//包体(包括后续分块)
+static std::string Body(const FramePtr& frame)
+{
+	std::string body;
+
+	for (auto chunk = frame; chunk; chunk = chunk->Next())
+	{
+		std::size_t header_size = chunk == frame ? frame->HeaderSize() : 0;
+		body.append(reinterpret_cast<const char*>(chunk->Data()) + header_size, chunk->Size() - header_size);
+	}
+
+	return body;
+}
+
+static Asset::QueryTraffic MakeTraffic(std::size_t report_size)
+{
+	Asset::QueryTraffic message;
+	message.set_top(10);
+	message.set_server_id(1 << 20);
+	message.set_report(std::string(report_size, 'r'));
+	return message;
+}
+
+//
+//包体大小即序列化长度(ByteSizeLong)，并缓存在协议中，包括超过普通包头上限(分块)的协议
+//
+TEST(BodySizeMatchesSerialization)
+{
+	for (std::size_t report_size : { 0, 100, 200, 70000, 300000 })
+	{
+		auto message = MakeTraffic(report_size);
+
+		auto frame = FrameBuffer::Build(message);
+		CHECK(frame->BodySize() == message.SerializeAsString().size());
+		CHECK(frame->BodySize() == std::size_t(message.GetCachedSize())); //序列化时直接使用缓存的大小
+	}
+
+	Asset::Register empty;
+	CHECK(FrameBuffer::Build(empty)->BodySize() == 0);
+}
+
+//协议整体作为包体，和Protobuf序列化结果一致
+TEST(BuildMatchesSerialization)
+{
+	for (std::size_t report_size : { 10, 70000 })
+	{
+		auto message = MakeTraffic(report_size);
+
+		auto frame = FrameBuffer::Build(message);
+		CHECK(frame->IsExtended() == (report_size > FrameBuffer::MAX_FRAME_BODY_SIZE));
+		CHECK(frame->BodySize() == message.ByteSizeLong());
+		CHECK(Body(frame) == message.SerializeAsString());
+	}
+}
+
+//
+//直接序列化的InnerMeta和先组装InnerMeta再序列化的结果一致；会话ID为0时不写入
+//
+TEST(InnerMetaEnvelope)
+{
+	for (std::size_t report_size : { 10, 70000 })
+	{
+		auto message = MakeTraffic(report_size);
+
+		Asset::InnerMeta meta;
+		meta.set_type_t(Asset::INNER_TYPE_QUERY_TRAFFIC);
+		meta.set_session_id(123456789);
+		meta.set_stuff(message.SerializeAsString());
+
+		auto frame = FrameBuffer::BuildInnerMeta(message, Asset::INNER_TYPE_QUERY_TRAFFIC, 123456789);
+		CHECK(Body(frame) == meta.SerializeAsString());
+
+		Asset::InnerMeta parsed;
+		CHECK(parsed.ParseFromString(Body(FrameBuffer::BuildInnerMeta(message, Asset::INNER_TYPE_QUERY_TRAFFIC))));
+		CHECK(!parsed.has_session_id());
+		CHECK(parsed.stuff() == meta.stuff());
+	}
+}
+
+//修改协议后重新计算大小，不使用上次缓存的大小
+TEST(SizeRecomputedAfterChange)
+{
+	auto message = MakeTraffic(10);
+	FrameBuffer::Build(message);
+
+	message.set_report(std::string(500, 'x'));
+
+	auto frame = FrameBuffer::Build(message);
+	CHECK(frame->BodySize() == message.SerializeAsString().size());
+	CHECK(Body(frame) == message.SerializeAsString());
+}
+
+TEST_MAIN()
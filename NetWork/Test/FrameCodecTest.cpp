@@ -0,0 +1,292 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include <google/protobuf/wrappers.pb.h>
+
+#include "FrameCodec.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+//数据包(包括全部分块)按发送顺序写入字节流
+static void Append(const FramePtr& frame, std::string& stream)
+{
+	for (auto chunk = frame; chunk; chunk = chunk->Next()) stream.append(reinterpret_cast<const char*>(chunk->Data()), chunk->Size());
+}
+
+//
+//按随机长度分多次接收：每次接收可能包含多个数据包，也可能只有半个包头
+//
+static FRAME_DECODE_RESULT Receive(FrameCodec& codec, const std::string& stream, std::vector<std::string>& bodies, std::mt19937& random, std::size_t max_read)
+{
+	FRAME_DECODE_RESULT result = FRAME_DECODE_SUCCESS;
+
+	for (std::size_t position = 0; position < stream.size(); )
+	{
+		auto buffer = codec.PrepareBuffer();
+
+		std::size_t size = std::min(boost::asio::buffer_size(buffer), stream.size() - position);
+		size = std::min<std::size_t>(size, random() % max_read + 1);
+
+		memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data() + position, size);
+		codec.Commit(size);
+		position += size;
+
+		auto decode_result = codec.DecodeRaw([&bodies](const uint8_t* body, std::size_t body_size) {
+			bodies.emplace_back(reinterpret_cast<const char*>(body), body_size);
+			return FRAME_DECODE_SUCCESS;
+		});
+		if (decode_result != FRAME_DECODE_SUCCESS) result = decode_result;
+	}
+
+	return result;
+}
+
+TEST(PartialAndCoalescedReads)
+{
+	std::mt19937 random(1);
+
+	std::string stream;
+	std::vector<std::string> expected;
+
+	for (int32_t i = 0; i < 2000; ++i)
+	{
+		std::size_t size = random() % 3000 + (i % 50 == 0 ? 60000 : 0); //偶尔超过接收缓存大小
+		expected.emplace_back(size, char('a' + i % 26));
+
+		Append(FrameBuffer::Create(expected.back().data(), size), stream);
+	}
+
+	FrameCodec codec(256);
+	std::vector<std::string> bodies;
+
+	CHECK(Receive(codec, stream, bodies, random, 5000) == FRAME_DECODE_SUCCESS);
+	CHECK(bodies == expected);
+	CHECK(codec.GetPendingSize() == 0);
+	CHECK(codec.GetDecodedCount() == expected.size());
+}
+
+TEST(SingleByteReads)
+{
+	std::mt19937 random(2);
+
+	std::string stream;
+	std::vector<std::string> expected = { "", "x", std::string(300, 'y'), std::string(FrameBuffer::MAX_FRAME_BODY_SIZE, 'z') };
+
+	for (const auto& body : expected) Append(FrameBuffer::Create(body.data(), body.size()), stream);
+
+	FrameCodec codec;
+	std::vector<std::string> bodies;
+
+	CHECK(Receive(codec, stream, bodies, random, 1) == FRAME_DECODE_SUCCESS);
+	CHECK(bodies == expected);
+}
+
+TEST(StopInsideHandler)
+{
+	std::string stream;
+	for (int32_t i = 0; i < 3; ++i) Append(FrameBuffer::Create("abc", 3), stream);
+
+	FrameCodec codec;
+
+	auto buffer = codec.PrepareBuffer();
+	memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data(), stream.size());
+	codec.Commit(stream.size());
+
+	int32_t count = 0;
+	auto handler = [&count](const uint8_t*, std::size_t) {
+		++count;
+		return FRAME_DECODE_STOPPED; //比如回调中连接已经关闭
+	};
+
+	CHECK(codec.DecodeRaw(handler) == FRAME_DECODE_STOPPED);
+	CHECK(count == 1);
+	CHECK(codec.GetPendingSize() == 2 * (FrameBuffer::FRAME_HEADER_SIZE + 3)); //剩余数据包保留到下次解析
+
+	CHECK(codec.DecodeRaw(handler) == FRAME_DECODE_STOPPED);
+	CHECK(count == 2);
+}
+
+TEST(ControlFramesNotDelivered)
+{
+	std::string stream;
+	Append(FrameBuffer::BuildHandshake(FRAME_CAPABILITY_EXTENDED), stream);
+	Append(FrameBuffer::Create("abc", 3), stream);
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(FRAME_CAPABILITY_EXTENDED | FRAME_CAPABILITY_COMPRESS);
+
+	uint32_t handshake = 0;
+	codec.SetHandshakeHandler([&handshake](uint32_t capabilities) { handshake = capabilities; });
+
+	std::mt19937 random(3);
+	std::vector<std::string> bodies;
+
+	CHECK(Receive(codec, stream, bodies, random, 7) == FRAME_DECODE_SUCCESS);
+	CHECK(bodies.size() == 1 && bodies[0] == "abc");
+	CHECK(handshake == FRAME_CAPABILITY_EXTENDED); //双方能力交集
+	CHECK(codec.IsExtended() && !codec.IsCompressed());
+}
+
+//
+//扩展包头：握手协商后超过64K的数据包分块发送，接收端拼接为完整包体
+//
+TEST(ExtendedHeader)
+{
+	std::mt19937 random(4);
+
+	std::string stream;
+	Append(FrameBuffer::BuildHandshake(FRAME_CAPABILITY_EXTENDED), stream);
+
+	std::vector<std::string> expected;
+	std::vector<std::size_t> sizes = { 10, FrameBuffer::MAX_FRAME_BODY_SIZE, FrameBuffer::MAX_FRAME_BODY_SIZE + 1, 
+		FrameBuffer::CHUNK_SIZE * 5 + 3, 3 * 1024 * 1024, 20 };
+
+	for (auto size : sizes)
+	{
+		std::string body(size, 0);
+		for (auto& c : body) c = char(random());
+		expected.push_back(body);
+
+		auto frame = FrameBuffer::Create(body.data(), body.size());
+		CHECK(frame->IsExtended() == (size > FrameBuffer::MAX_FRAME_BODY_SIZE));
+		CHECK(frame->BodySize() == size);
+
+		if (frame->IsExtended())
+		{
+			CHECK(frame->HeaderSize() == FrameBuffer::EXTENDED_HEADER_SIZE);
+			CHECK(frame->Next()); //包体分块
+		}
+
+		Append(frame, stream);
+	}
+
+	FrameCodec codec(512);
+	codec.SetLocalCapabilities(FRAME_CAPABILITY_EXTENDED);
+
+	std::vector<std::string> bodies;
+
+	CHECK(Receive(codec, stream, bodies, random, 70000) == FRAME_DECODE_SUCCESS);
+	CHECK(bodies == expected);
+	CHECK(codec.GetPendingSize() == 0);
+}
+
+//超过最大限制的扩展数据包整个丢弃，之后的数据包正常解析
+TEST(ExtendedHeaderOverLimit)
+{
+	std::mt19937 random(5);
+
+	std::string stream;
+	Append(FrameBuffer::BuildHandshake(FRAME_CAPABILITY_EXTENDED), stream);
+
+	std::size_t size = FrameBuffer::MAX_EXTENDED_BODY_SIZE + 1;
+	CHECK(!FrameBuffer::Create(size));
+
+	const uint8_t header[] = { 0xff, 0xff, uint8_t(size >> 24), uint8_t(size >> 16), uint8_t(size >> 8), uint8_t(size) };
+	stream.append(reinterpret_cast<const char*>(header), sizeof(header));
+	stream.append(size, 'x');
+
+	Append(FrameBuffer::Create("abc", 3), stream);
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(FRAME_CAPABILITY_EXTENDED);
+
+	std::vector<std::string> bodies;
+
+	CHECK(Receive(codec, stream, bodies, random, 1 << 20) == FRAME_DECODE_PARSE_ERROR);
+	CHECK(bodies.size() == 1 && bodies[0] == "abc");
+	CHECK(codec.GetBufferSize() < size); //丢弃的数据不缓存
+}
+
+//玩家连接的接收上限：协商了扩展包头也不接收超过上限的数据包，放开后正常接收
+TEST(ReceiveLimit)
+{
+	std::mt19937 random(7);
+
+	std::string large(70000, 'l');
+
+	std::string stream;
+	Append(FrameBuffer::BuildHandshake(FRAME_CAPABILITY_EXTENDED), stream);
+	Append(FrameBuffer::Create(large.data(), large.size()), stream);
+	Append(FrameBuffer::Create("abc", 3), stream);
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(FRAME_CAPABILITY_EXTENDED);
+	codec.SetReceiveLimit(65536);
+
+	std::vector<std::string> bodies;
+
+	CHECK(Receive(codec, stream, bodies, random, 4096) == FRAME_DECODE_PARSE_ERROR);
+	CHECK(bodies.size() == 1 && bodies[0] == "abc");
+	CHECK(codec.GetBufferSize() < large.size()); //丢弃的数据不缓存
+
+	codec.SetReceiveLimit(FrameBuffer::MAX_EXTENDED_BODY_SIZE + 1);
+	CHECK(codec.GetReceiveLimit() == FrameBuffer::MAX_EXTENDED_BODY_SIZE);
+
+	stream.clear();
+	Append(FrameBuffer::Create(large.data(), large.size()), stream);
+
+	bodies.clear();
+
+	CHECK(Receive(codec, stream, bodies, random, 4096) == FRAME_DECODE_SUCCESS);
+	CHECK(bodies.size() == 1 && bodies[0] == large);
+}
+
+//未协商时0xFFFF为普通包长
+TEST(ExtendedHeaderNotNegotiated)
+{
+	std::string body(FrameBuffer::EXTENDED_HEADER_MARK, 'a');
+
+	std::string stream("\xff\xff", 2);
+	stream += body;
+
+	FrameCodec codec;
+
+	std::mt19937 random(6);
+	std::vector<std::string> bodies;
+
+	CHECK(Receive(codec, stream, bodies, random, 4096) == FRAME_DECODE_SUCCESS);
+	CHECK(bodies.size() == 1 && bodies[0] == body);
+}
+
+//未握手的旧版本对端：不带包头，每次接收的数据整体解析
+TEST(UnframedLegacy)
+{
+	google::protobuf::StringValue message;
+	message.set_value("legacy");
+
+	std::string body = message.SerializeAsString();
+
+	std::string stream;
+	Append(FrameBuffer::CreateUnframed(body.data(), body.size()), stream);
+	CHECK(stream == body);
+	CHECK(!FrameBuffer::CreateUnframed(body.data(), FrameBuffer::MAX_FRAME_BODY_SIZE + 1));
+
+	FrameCodec codec;
+
+	auto buffer = codec.PrepareBuffer();
+	memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data(), stream.size());
+	codec.Commit(stream.size());
+
+	std::vector<std::string> values;
+	auto handler = [&values](const google::protobuf::StringValue& value) {
+		values.push_back(value.value());
+		return true;
+	};
+
+	CHECK(codec.DecodeUnframed<google::protobuf::StringValue>(handler) == FRAME_DECODE_SUCCESS);
+	CHECK(values.size() == 1 && values[0] == "legacy");
+	CHECK(codec.GetPendingSize() == 0);
+
+	buffer = codec.PrepareBuffer();
+	memcpy(boost::asio::buffer_cast<void*>(buffer), "\xff", 1); //无法解析时丢弃本次接收的数据
+	codec.Commit(1);
+
+	CHECK(codec.DecodeUnframed<google::protobuf::StringValue>(handler) == FRAME_DECODE_PARSE_ERROR);
+	CHECK(values.size() == 1);
+	CHECK(codec.GetPendingSize() == 0);
+}
+
+TEST_MAIN()
@@ -0,0 +1,181 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "FrameCodec.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+static std::string Wire(const FramePtr& frame)
+{
+	std::string stream;
+	for (auto chunk = frame; chunk; chunk = chunk->Next()) stream.append(reinterpret_cast<const char*>(chunk->Data()), chunk->Size());
+	return stream;
+}
+
+//
+//压缩后的包体：4字节原始长度 + zlib数据
+//
+static std::string CompressedBody(const FramePtr& frame)
+{
+	return Wire(frame).substr(frame->HeaderSize());
+}
+
+//一次收到全部数据，解析出的包体依次返回
+static std::vector<std::string> Feed(FrameCodec& codec, const std::string& stream, FRAME_DECODE_RESULT& result)
+{
+	std::vector<std::string> bodies;
+
+	for (std::size_t position = 0; position < stream.size(); )
+	{
+		auto buffer = codec.PrepareBuffer();
+
+		std::size_t size = std::min(boost::asio::buffer_size(buffer), stream.size() - position);
+		memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data() + position, size);
+		codec.Commit(size);
+		position += size;
+
+		auto decode_result = codec.DecodeRaw([&bodies](const uint8_t* body, std::size_t body_size) {
+			bodies.emplace_back(reinterpret_cast<const char*>(body), body_size);
+			return FRAME_DECODE_SUCCESS;
+		});
+		if (decode_result != FRAME_DECODE_SUCCESS) result = decode_result;
+	}
+
+	return bodies;
+}
+
+//按协议类型和阈值压缩，其他数据包原样发送
+TEST(PolicyByTypeAndThreshold)
+{
+	CompressPolicyInstance.Load({ 9 });
+
+	CHECK(CompressPolicyInstance.IsEnabled(9));
+	CHECK(!CompressPolicyInstance.IsEnabled(10));
+	CHECK(!CompressPolicyInstance.IsEnabled(CompressPolicy::MAX_TYPE_COUNT));
+
+	CHECK(CompressPolicyInstance.ShouldCompress(9, CompressPolicyInstance.GetThreshold()));
+	CHECK(!CompressPolicyInstance.ShouldCompress(9, CompressPolicyInstance.GetThreshold() - 1));
+	CHECK(!CompressPolicyInstance.ShouldCompress(10, 1 << 20));
+}
+
+//没有变小的数据包按原数据包发送，并计入统计
+TEST(IncompressibleKeepsOriginal)
+{
+	std::mt19937 random(1);
+
+	std::string body(4096, '\0');
+	for (auto& c : body) c = char(random());
+
+	auto frame = FrameBuffer::Create(body.data(), body.size());
+
+	FrameCompressor compressor;
+	CHECK(compressor.Compress(frame, 11).get() == frame.get());
+
+	const auto& statistics = CompressPolicyInstance.GetStatistics(11);
+	CHECK(statistics.count == 1 && statistics.skipped_count == 1);
+	CHECK(statistics.GetSavedBytes() == 0);
+}
+
+//
+//协商压缩后解压为原始包体，包括分块的扩展数据包；只协商扩展包头时压缩数据包整个丢弃
+//
+TEST(NegotiatedRoundTrip)
+{
+	std::string small(3000, 's');
+	std::string large(FrameBuffer::MAX_FRAME_BODY_SIZE * 3, 'L'); //多个分块
+
+	FrameCompressor compressor;
+
+	std::string stream;
+	stream += Wire(FrameBuffer::BuildHandshake(FRAME_CAPABILITY_COMPRESS | FRAME_CAPABILITY_EXTENDED));
+
+	for (const auto& body : { small, large })
+	{
+		auto compressed = compressor.Compress(FrameBuffer::Create(body.data(), body.size()), 12);
+		CHECK(compressed->IsCompressed());
+		CHECK(compressed->BodySize() < body.size());
+
+		stream += Wire(compressed);
+	}
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(FRAME_CAPABILITY_COMPRESS | FRAME_CAPABILITY_EXTENDED);
+
+	FRAME_DECODE_RESULT result = FRAME_DECODE_SUCCESS;
+	auto bodies = Feed(codec, stream, result);
+
+	CHECK(result == FRAME_DECODE_SUCCESS);
+	CHECK(bodies.size() == 2 && bodies[0] == small && bodies[1] == large);
+
+	FrameCodec legacy;
+	legacy.SetLocalCapabilities(FRAME_CAPABILITY_EXTENDED); //本端不支持压缩
+
+	result = FRAME_DECODE_SUCCESS;
+	bodies = Feed(legacy, stream, result);
+
+	CHECK(result == FRAME_DECODE_PARSE_ERROR);
+	CHECK(bodies.empty());
+}
+
+//
+//解压后超过接收上限的数据包丢弃，不分配解压缓存；之后的数据包正常解析
+//
+TEST(DecompressLimit)
+{
+	std::string body(200000, 'z'); //压缩后远小于64K
+
+	FrameCompressor compressor;
+	auto compressed = compressor.Compress(FrameBuffer::Create(body.data(), body.size()), 13);
+	CHECK(compressed->IsCompressed() && compressed->BodySize() < 65536);
+
+	std::string stream = Wire(FrameBuffer::BuildHandshake(FRAME_CAPABILITY_COMPRESS)) + Wire(compressed) + Wire(FrameBuffer::Create("abc", 3));
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(FRAME_CAPABILITY_COMPRESS);
+	codec.SetReceiveLimit(65536); //玩家连接
+
+	FRAME_DECODE_RESULT result = FRAME_DECODE_SUCCESS;
+	auto bodies = Feed(codec, stream, result);
+
+	CHECK(result == FRAME_DECODE_PARSE_ERROR);
+	CHECK(bodies.size() == 1 && bodies[0] == "abc");
+
+	codec.Reset();
+	codec.SetReceiveLimit(body.size()); //服务器之间的连接
+
+	result = FRAME_DECODE_SUCCESS;
+	bodies = Feed(codec, stream, result);
+
+	CHECK(result == FRAME_DECODE_SUCCESS);
+	CHECK(bodies.size() == 2 && bodies[0] == body);
+}
+
+//原始长度和实际数据不一致(截断或者声明过大)时解压失败
+TEST(CorruptBody)
+{
+	std::string body(5000, 'c');
+
+	FrameCompressor compressor;
+	std::string compressed = CompressedBody(compressor.Compress(FrameBuffer::Create(body.data(), body.size()), 14));
+
+	FrameDecompressor decompressor;
+
+	auto data = reinterpret_cast<const uint8_t*>(compressed.data());
+	CHECK(decompressor.Decompress(data, compressed.size(), body.size()));
+	CHECK(std::string(reinterpret_cast<const char*>(decompressor.Data()), decompressor.Size()) == body);
+
+	CHECK(!decompressor.Decompress(data, compressed.size(), body.size() - 1)); //超过上限
+	CHECK(!decompressor.Decompress(data, compressed.size() / 2, body.size())); //截断
+	CHECK(!decompressor.Decompress(data, FrameBuffer::COMPRESS_HEADER_SIZE - 1, body.size()));
+
+	std::string inflated = compressed;
+	inflated[3] = char(inflated[3] + 1); //声明的原始长度多1
+	CHECK(!decompressor.Decompress(reinterpret_cast<const uint8_t*>(inflated.data()), inflated.size(), body.size() + 1));
+
+	CHECK(decompressor.Decompress(data, compressed.size(), body.size())); //失败后上下文可以继续使用
+}
+
+TEST_MAIN()
@@ -0,0 +1,108 @@
+#include <set>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstdlib>
+
+#include "IoServicePool.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+//超出CPU数量的配置跳过，数量不足时循环使用
+TEST(AffinityParse)
+{
+	int32_t cpu_count = std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+
+	CHECK(ThreadAffinity::Parse("", 4).empty());
+	CHECK(ThreadAffinity::Parse("0", 0).empty());
+	CHECK(ThreadAffinity::Parse("100000", 2).empty()); //全部无效时不绑定
+
+	CHECK(ThreadAffinity::Parse("0", 3) == std::vector<int32_t>({ 0, 0, 0 }));
+	CHECK(ThreadAffinity::Parse("0,,100000", 2) == std::vector<int32_t>({ 0, 0 }));
+
+	auto cpus = ThreadAffinity::Parse("auto", cpu_count + 1);
+	CHECK(int32_t(cpus.size()) == cpu_count + 1);
+	CHECK(cpus.front() == 0 && cpus.back() == 0);
+
+	if (cpu_count < 2) return;
+
+	CHECK(ThreadAffinity::Parse("0-1", 3) == std::vector<int32_t>({ 0, 1, 0 }));
+}
+
+//
+//per_thread：轮流分配io_service，同一个io_service的处理函数总在同一个线程执行
+//
+TEST(PerThread)
+{
+	setenv("IoServiceMode", "per_thread", 1);
+	setenv("IoThreadCount", "3", 1);
+
+	IoServicePool pool;
+	pool.Load(1);
+
+	unsetenv("IoServiceMode");
+	unsetenv("IoThreadCount");
+
+	CHECK(pool.IsPerThread() && pool.Size() == 3);
+
+	CHECK(&pool.GetIoService() == &pool.GetIoService(0));
+	CHECK(&pool.GetIoService() == &pool.GetIoService(1));
+	CHECK(&pool.GetIoService() == &pool.GetIoService(2));
+	CHECK(&pool.GetIoService() == &pool.GetIoService(0));
+
+	pool.Start();
+
+	std::mutex mutex;
+	std::vector<std::set<std::thread::id>> threads(pool.Size());
+	std::atomic<int32_t> remain{300};
+
+	for (int32_t i = 0; i < 300; ++i)
+	{
+		std::size_t index = i % pool.Size();
+		boost::asio::post(pool.GetIoService(index), [&, index]() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				threads[index].insert(std::this_thread::get_id());
+			}
+			--remain;
+		});
+	}
+
+	while (remain > 0) std::this_thread::yield();
+	pool.Stop();
+
+	std::set<std::thread::id> all;
+	for (const auto& ids : threads)
+	{
+		CHECK(ids.size() == 1);
+		all.insert(ids.begin(), ids.end());
+	}
+	CHECK(all.size() == 3); //各不相同
+}
+
+TEST(Shared)
+{
+	setenv("IoThreadCount", "2", 1);
+
+	IoServicePool pool;
+	pool.Load(1);
+
+	unsetenv("IoThreadCount");
+
+	CHECK(!pool.IsPerThread() && pool.Size() == 1);
+	CHECK(&pool.GetIoService() == &pool.GetIoService());
+
+	pool.Start();
+
+	std::atomic<int32_t> remain{100};
+	for (int32_t i = 0; i < 100; ++i) boost::asio::post(pool.GetIoService(), [&remain]() { --remain; });
+
+	while (remain > 0) std::this_thread::yield();
+	pool.Stop();
+
+	CHECK(remain == 0);
+}
+
+TEST_MAIN()
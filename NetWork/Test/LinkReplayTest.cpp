@@ -0,0 +1,194 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "FrameCodec.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+static FramePtr MakeFrame(std::size_t size, char c = 'a')
+{
+	std::string body(size, c);
+	return FrameBuffer::Create(body.data(), body.size());
+}
+
+static void Append(const FramePtr& frame, std::string& stream)
+{
+	for (auto chunk = frame; chunk; chunk = chunk->Next()) stream.append(reinterpret_cast<const char*>(chunk->Data()), chunk->Size());
+}
+
+//按接收缓存大小分次接收并解析
+static std::vector<std::string> Receive(FrameCodec& codec, const std::string& stream)
+{
+	std::vector<std::string> bodies;
+
+	for (std::size_t position = 0; position < stream.size(); )
+	{
+		auto buffer = codec.PrepareBuffer();
+		std::size_t size = std::min(boost::asio::buffer_size(buffer), stream.size() - position);
+
+		memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data() + position, size);
+		codec.Commit(size);
+		position += size;
+
+		codec.DecodeRaw([&bodies](const uint8_t* body, std::size_t body_size) {
+			bodies.emplace_back(reinterpret_cast<const char*>(body), body_size);
+			return FRAME_DECODE_SUCCESS;
+		});
+	}
+
+	return bodies;
+}
+
+TEST(ReplayBufferAcknowledge)
+{
+	ReplayBuffer buffer;
+
+	CHECK(buffer.GetFirstSequence() == 1 && buffer.GetNextSequence() == 1);
+
+	for (uint64_t i = 1; i <= 5; ++i) CHECK(buffer.Record(MakeFrame(10)) == i);
+	CHECK(buffer.Size() == 5 && buffer.Bytes() == 50);
+
+	buffer.Acknowledge(3);
+	CHECK(buffer.GetFirstSequence() == 4);
+	CHECK(buffer.Size() == 2 && buffer.Bytes() == 20);
+
+	buffer.Acknowledge(2); //确认序号不会回退
+	CHECK(buffer.GetFirstSequence() == 4);
+
+	buffer.Acknowledge(100);
+	CHECK(buffer.Size() == 0);
+	CHECK(buffer.GetFirstSequence() == 6); //没有记录时为下一个序号
+
+	buffer.Record(MakeFrame(10));
+	buffer.Clear();
+	CHECK(buffer.GetNextSequence() == 7); //清理后序号继续递增
+}
+
+//超过字节上限时丢弃最早的数据包，至少保留最近一个
+TEST(ReplayBufferLimit)
+{
+	ReplayBuffer buffer;
+	buffer.SetMaxBytes(35);
+
+	for (int32_t i = 0; i < 5; ++i) buffer.Record(MakeFrame(10));
+
+	CHECK(buffer.Size() == 3);
+	CHECK(buffer.GetFirstSequence() == 3);
+	CHECK(buffer.GetDroppedCount() == 2);
+
+	buffer.Record(MakeFrame(100));
+	CHECK(buffer.Size() == 1 && buffer.GetFirstSequence() == 6);
+}
+
+TEST(RegistryAttachUpdate)
+{
+	const uint64_t link_id = 1001;
+
+	CHECK(ReplayRegistryInstance.Attach(link_id) == 0);
+
+	ReplayRegistryInstance.Update(link_id, 10);
+	ReplayRegistryInstance.Update(link_id, 8); //旧连接尚未处理完时不回退
+	CHECK(ReplayRegistryInstance.Get(link_id) == 10);
+
+	ReplayRegistryInstance.Update(2002, 5); //不存在的连接标识不创建
+	CHECK(ReplayRegistryInstance.Get(2002) == 0);
+
+	CHECK(ReplayRegistryInstance.Attach(link_id) == 10); //新连接在旧连接关闭前续传
+	ReplayRegistryInstance.Detach(link_id);
+	ReplayRegistryInstance.Detach(link_id);
+
+	CHECK(ReplayRegistryInstance.Get(link_id) == 10); //保留等待重连
+}
+
+//
+//重连后发起端从最早未确认的数据包重发，接收端跳过已经处理的部分
+//
+TEST(ResumeSkipsDuplicates)
+{
+	const uint64_t link_id = 3003;
+	const uint32_t capabilities = FRAME_CAPABILITY_EXTENDED | FRAME_CAPABILITY_REPLAY;
+
+	std::vector<FramePtr> frames;
+	for (int32_t i = 0; i < 8; ++i) frames.push_back(MakeFrame(5, 'a' + i));
+
+	std::vector<uint64_t> acks;
+
+	{
+		FrameCodec codec;
+		codec.SetLocalCapabilities(capabilities);
+		codec.SetSequenceHandler([&acks](uint64_t sequence) { acks.push_back(sequence); });
+
+		std::string stream;
+		Append(FrameBuffer::BuildHandshake(capabilities), stream);
+		Append(FrameBuffer::BuildResume(link_id, 1), stream);
+		for (int32_t i = 0; i < 5; ++i) Append(frames[i], stream);
+
+		CHECK(Receive(codec, stream).size() == 5);
+	}
+
+	CHECK(!acks.empty() && acks.back() == 5);
+	CHECK(ReplayRegistryInstance.Get(link_id) == 5);
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(capabilities);
+
+	std::string stream;
+	Append(FrameBuffer::BuildHandshake(capabilities), stream);
+	Append(FrameBuffer::BuildResume(link_id, 3), stream); //发起端只收到确认2
+	for (int32_t i = 2; i < 8; ++i) Append(frames[i], stream);
+
+	auto bodies = Receive(codec, stream);
+
+	CHECK(bodies.size() == 3 && bodies[0] == std::string(5, 'f') && bodies[2] == std::string(5, 'h'));
+	CHECK(ReplayRegistryInstance.Get(link_id) == 8);
+}
+
+//没有连接使用且超时(测试中保留1秒)的连接标识删除
+TEST(RegistryExpire)
+{
+	const uint64_t link_id = 4004;
+
+	ReplayRegistryInstance.Attach(link_id);
+	ReplayRegistryInstance.Update(link_id, 3);
+	ReplayRegistryInstance.Attach(link_id + 1); //正在使用的连接标识不删除
+	ReplayRegistryInstance.Update(link_id + 1, 7);
+
+	ReplayRegistryInstance.Detach(link_id);
+	CHECK(ReplayRegistryInstance.Get(link_id) == 3);
+
+	ReplayRegistryInstance.Expire(); //刚断开的连接标识保留
+	CHECK(ReplayRegistryInstance.Get(link_id) == 3);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+	CHECK(ReplayRegistryInstance.Attach(link_id + 2) == 0); //续传时不再遍历删除
+	CHECK(ReplayRegistryInstance.Get(link_id) == 3);
+
+	ReplayRegistryInstance.Expire(); //由网络线程定时删除
+	CHECK(ReplayRegistryInstance.Get(link_id) == 0);
+	CHECK(ReplayRegistryInstance.Get(link_id + 1) == 7);
+	CHECK(ReplayRegistryInstance.Get(link_id + 2) == 0);
+	CHECK(ReplayRegistryInstance.Size() >= 2);
+}
+
+//只有配置的服务器地址可以开启重发
+TEST(ServerAddresses)
+{
+	CHECK(ReplayRegistryInstance.IsServerAddress("10.0.0.2"));
+	CHECK(ReplayRegistryInstance.IsServerAddress("10.0.0.3"));
+	CHECK(!ReplayRegistryInstance.IsServerAddress("10.0.0.4"));
+	CHECK(!ReplayRegistryInstance.IsServerAddress(""));
+}
+
+int main()
+{
+	setenv("LinkReplayExpire", "1", 1); //首次使用时读取配置
+	setenv("ServerLinkAddresses", "10.0.0.2,,10.0.0.3", 1);
+
+	return TestRunner::Instance().Run();
+}
@@ -0,0 +1,116 @@
+#include <memory>
+#include <vector>
+#include <cstdlib>
+
+#include "LoginAdmission.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+struct TestWaiter : LoginWaiter
+{
+	bool IsWaiting() const override { return waiting; }
+
+	void OnLoginAdmitted() override { admitted = true; }
+
+	void OnLoginQueue(std::size_t position, int64_t) override { positions.push_back(position); }
+
+	bool waiting = true;
+	bool admitted = false;
+	std::vector<std::size_t> positions;
+};
+
+//同时登录数量为2，排队上限为2
+static void Load()
+{
+	setenv("LoginQueueMax", "2", 1);
+	LoginAdmissionInstance.Load(2, { 3, 5 });
+	unsetenv("LoginQueueMax");
+}
+
+TEST(LoginTypes)
+{
+	Load();
+
+	CHECK(LoginAdmissionInstance.IsLogin(3) && LoginAdmissionInstance.IsLogin(5));
+	CHECK(!LoginAdmissionInstance.IsLogin(4));
+	CHECK(!LoginAdmissionInstance.IsLogin(0) && !LoginAdmissionInstance.IsLogin(LoginAdmission::MAX_TYPE_COUNT));
+
+	setenv("LoginAdmissionTypes", "4,,6", 1); //配置后不使用默认协议类型
+	LoginAdmissionInstance.Load(2, { 3, 5 });
+	unsetenv("LoginAdmissionTypes");
+
+	CHECK(!LoginAdmissionInstance.IsLogin(3));
+	CHECK(LoginAdmissionInstance.IsLogin(4) && LoginAdmissionInstance.IsLogin(6));
+
+	setenv("LoginAdmission", "0", 1);
+	LoginAdmissionInstance.Load(2, { 3, 5 });
+	unsetenv("LoginAdmission");
+
+	CHECK(!LoginAdmissionInstance.IsLogin(4));
+}
+
+//
+//超出同时登录数量时按顺序排队，登录结束后放行下一个，排队已满时拒绝
+//
+TEST(QueueAndRelease)
+{
+	Load();
+
+	auto a = std::make_shared<TestWaiter>();
+	auto b = std::make_shared<TestWaiter>();
+	auto c = std::make_shared<TestWaiter>();
+	auto d = std::make_shared<TestWaiter>();
+	auto e = std::make_shared<TestWaiter>();
+
+	CHECK(LoginAdmissionInstance.Acquire(a) == LOGIN_ADMISSION_RESULT_ADMITTED);
+	CHECK(LoginAdmissionInstance.Acquire(b) == LOGIN_ADMISSION_RESULT_ADMITTED);
+
+	CHECK(LoginAdmissionInstance.Acquire(c) == LOGIN_ADMISSION_RESULT_QUEUED);
+	CHECK(LoginAdmissionInstance.Acquire(d) == LOGIN_ADMISSION_RESULT_QUEUED);
+	CHECK(LoginAdmissionInstance.Acquire(e) == LOGIN_ADMISSION_RESULT_REJECTED);
+
+	CHECK(c->positions == std::vector<std::size_t>{ 1 });
+	CHECK(d->positions == std::vector<std::size_t>{ 2 });
+	CHECK(LoginAdmissionInstance.GetQueueSize() == 2);
+
+	LoginAdmissionInstance.Release();
+	CHECK(c->admitted && !d->admitted);
+
+	LoginAdmissionInstance.Release();
+	CHECK(d->admitted);
+	CHECK(LoginAdmissionInstance.GetQueueSize() == 0);
+
+	LoginAdmissionInstance.Release();
+	LoginAdmissionInstance.Release();
+}
+
+//连接关闭后不再等待，名额交给后面的连接
+TEST(SkipClosedWaiter)
+{
+	Load();
+
+	auto a = std::make_shared<TestWaiter>();
+	auto b = std::make_shared<TestWaiter>();
+	auto c = std::make_shared<TestWaiter>();
+	auto d = std::make_shared<TestWaiter>();
+
+	CHECK(LoginAdmissionInstance.Acquire(a) == LOGIN_ADMISSION_RESULT_ADMITTED);
+	CHECK(LoginAdmissionInstance.Acquire(b) == LOGIN_ADMISSION_RESULT_ADMITTED);
+	CHECK(LoginAdmissionInstance.Acquire(c) == LOGIN_ADMISSION_RESULT_QUEUED);
+	CHECK(LoginAdmissionInstance.Acquire(d) == LOGIN_ADMISSION_RESULT_QUEUED);
+
+	c->waiting = false;
+
+	LoginAdmissionInstance.Update(); //通知排队位置时移除已经关闭的连接
+	CHECK(LoginAdmissionInstance.GetQueueSize() == 1);
+	CHECK(d->positions.size() == 2 && d->positions.back() == 1);
+
+	LoginAdmissionInstance.Release();
+	CHECK(!c->admitted && d->admitted);
+
+	LoginAdmissionInstance.Release();
+	LoginAdmissionInstance.Release();
+}
+
+TEST_MAIN()
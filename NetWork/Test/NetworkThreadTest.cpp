@@ -0,0 +1,212 @@
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <functional>
+
+#include "Socket.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+//
+//网络线程和SocketManager只依赖连接的这几个接口
+//
+class TestSocket
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	TestSocket() : _active_time(Clock::now().time_since_epoch().count()) { }
+	explicit TestSocket(boost::asio::ip::tcp::socket&&) : TestSocket() { } //SocketManager接收连接时创建
+
+	void Start() { }
+
+	bool IsOpen() const { return !_closed; }
+	bool IsClosed() const { return _closed; }
+
+	void Close()
+	{
+		if (_closed.exchange(true)) return;
+
+		std::function<void()> handler;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			handler = _close_handler;
+		}
+		if (handler) handler();
+	}
+
+	void OnIdle()
+	{
+		++idle_count;
+		if (close_on_idle) Close();
+	}
+
+	void SetCloseHandler(std::function<void()> handler)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_close_handler = handler;
+	}
+
+	void SetThreadLoad(ThreadLoad* thread_load) { load = thread_load; }
+
+	void Touch() { _active_time = Clock::now().time_since_epoch().count(); }
+	Clock::time_point GetActiveTime() const { return Clock::time_point(Clock::duration(_active_time)); }
+
+	std::atomic<int32_t> idle_count{0};
+	std::atomic<ThreadLoad*> load{nullptr}; //所在网络线程的负载统计
+	bool close_on_idle = true;
+
+private:
+	std::mutex _mutex;
+	std::function<void()> _close_handler;
+	std::atomic<bool> _closed{false};
+	std::atomic<Clock::rep> _active_time;
+};
+
+class TestThread : public NetworkThread<TestSocket>
+{
+public:
+	std::atomic<int32_t> added{0};
+	std::atomic<int32_t> removed{0};
+
+protected:
+	void SocketAdded(std::shared_ptr<TestSocket>) override { ++added; }
+	void SocketRemoved(std::shared_ptr<TestSocket>) override { ++removed; }
+};
+
+//等待条件成立，超时返回false
+static bool WaitFor(std::function<bool()> condition, int32_t milliseconds)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+
+	while (!condition())
+	{
+		if (std::chrono::steady_clock::now() > deadline) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return true;
+}
+
+//
+//连接在网络线程中加入，关闭时投递到网络线程删除，不依赖定时轮询
+//
+TEST(AddAndClose)
+{
+	TestThread thread;
+	thread.Start();
+
+	auto socket = std::make_shared<TestSocket>();
+	thread.AddSocket(socket);
+
+	CHECK(thread.GetConnectionCount() == 1);
+	CHECK(WaitFor([&thread]() { return thread.added == 1; }, 1000));
+
+	socket->Close();
+
+	CHECK(WaitFor([&thread]() { return thread.removed == 1; }, 500)); //不等待空闲检查
+	CHECK(thread.GetConnectionCount() == 0);
+
+	auto closed = std::make_shared<TestSocket>(); //加入前已经关闭
+	closed->Close();
+	thread.AddSocket(closed);
+
+	CHECK(WaitFor([&thread]() { return thread.removed == 2; }, 1000));
+	CHECK(thread.added == 1 && thread.GetConnectionCount() == 0);
+
+	thread.Stop();
+	thread.Wait();
+}
+
+//
+//空闲检查：一直有数据的连接不调用OnIdle，空闲连接到期时调用
+//
+TEST(IdleCheck)
+{
+	setenv("IdleTimeout", "1", 1);
+	TestThread thread;
+	unsetenv("IdleTimeout");
+
+	thread.Start();
+
+	auto idle = std::make_shared<TestSocket>();
+	auto busy = std::make_shared<TestSocket>();
+	busy->close_on_idle = false;
+
+	thread.AddSocket(idle);
+	thread.AddSocket(busy);
+
+	bool removed = WaitFor([&thread, &busy]() {
+		busy->Touch();
+		return thread.removed == 1;
+	}, 5000);
+
+	CHECK(removed);
+	CHECK(idle->idle_count == 1 && idle->IsClosed());
+	CHECK(busy->idle_count == 0 && thread.GetConnectionCount() == 1);
+
+	thread.Stop();
+	thread.Wait();
+}
+
+//
+//直接创建网络线程，不监听端口
+//
+class TestManager : public SocketManager<TestSocket>
+{
+public:
+	explicit TestManager(int32_t thread_count)
+	{
+		_thread_count = thread_count;
+		_threads = CreateThreads();
+
+		for (int32_t i = 0; i < _thread_count; ++i) _threads[i].Start();
+	}
+
+	~TestManager() { StopNetwork(); }
+
+	NetworkThread<TestSocket>& GetThread(int32_t thread_index) { return _threads[thread_index]; }
+
+protected:
+	NetworkThread<TestSocket>* CreateThreads() const override { return new NetworkThread<TestSocket>[_thread_count]; }
+};
+
+//
+//按负载分配：连接数量和每秒收发量加权，只有一个连接但流量很大的线程不再分配新连接
+//
+TEST(LoadAwarePlacement)
+{
+	CHECK(ThreadLoad::GetScore(2, 4096, 5) == 2 * 100 + 5 + 4); //默认权重
+
+	TestManager manager(3);
+	CHECK(manager.SelectThreadWithMinLoad() == 0); //相同时取第一个
+
+	auto heavy = std::make_shared<TestSocket>();
+	heavy->close_on_idle = false;
+	manager.GetThread(0).AddSocket(heavy);
+
+	std::vector<std::shared_ptr<TestSocket>> sockets;
+	for (int32_t thread_index : { 1, 1, 1, 2, 2 })
+	{
+		sockets.push_back(std::make_shared<TestSocket>());
+		manager.GetThread(thread_index).AddSocket(sockets.back());
+	}
+
+	CHECK(manager.SelectThreadWithMinLoad() == 0); //没有流量时按连接数量
+	CHECK(manager.SelectThreadWithMinConnections() == 0);
+
+	CHECK(WaitFor([&heavy]() { return heavy->load != nullptr; }, 1000));
+	heavy->load.load()->Add(1 << 20, 100000);
+
+	CHECK(WaitFor([&manager]() { return manager.GetThread(0).GetLoad().messages_per_second > 0; }, 3000)); //每秒计算一次速率
+
+	CHECK(manager.GetThread(0).GetLoadScore() > manager.GetThread(1).GetLoadScore());
+	CHECK(manager.SelectThreadWithMinLoad() == 2);
+	CHECK(manager.SelectThreadWithMinConnections() == 0);
+}
+
+TEST_MAIN()
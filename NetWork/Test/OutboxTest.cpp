@@ -0,0 +1,123 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+
+#include "Outbox.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+static std::string g_flushed; //各连接按发送顺序记录：连接名 + 各数据包包体
+
+struct TestTarget : OutboxTarget
+{
+	explicit TestTarget(char name) : name(name) { }
+
+	void FlushOutbox(std::vector<FramePtr>& frames) override
+	{
+		g_flushed.push_back(name);
+		for (const auto& frame : frames) g_flushed.push_back(char(frame->Data()[FrameBuffer::FRAME_HEADER_SIZE]));
+		g_flushed.push_back(';');
+	}
+
+	char name;
+};
+
+static FramePtr MakeFrame(char c)
+{
+	return FrameBuffer::Create(&c, 1);
+}
+
+//
+//作用域内缓存，最外层作用域结束时按连接首次缓存的顺序发送
+//
+TEST(NestedScopes)
+{
+	g_flushed.clear();
+
+	auto a = std::make_shared<TestTarget>('A');
+	auto b = std::make_shared<TestTarget>('B');
+
+	CHECK(!Outbox::Local().IsOpen());
+
+	{
+		OutboxScope scope;
+		CHECK(Outbox::Local().IsOpen());
+
+		Outbox::Local().Defer(b, MakeFrame('1'));
+		Outbox::Local().Defer(a, MakeFrame('2'));
+
+		{
+			OutboxScope nested;
+			Outbox::Local().Defer(b, MakeFrame('3'));
+		}
+
+		CHECK(g_flushed.empty()); //嵌套作用域结束不发送
+		Outbox::Local().Defer(a, MakeFrame('4'));
+	}
+
+	CHECK(!Outbox::Local().IsOpen());
+	CHECK(g_flushed == "B13;A24;");
+}
+
+//直接发送的数据包之前，该连接缓存的数据包先入队
+TEST(FlushSingleTarget)
+{
+	g_flushed.clear();
+
+	auto a = std::make_shared<TestTarget>('A');
+	auto b = std::make_shared<TestTarget>('B');
+
+	{
+		OutboxScope scope;
+
+		Outbox::Local().Defer(a, MakeFrame('1'));
+		Outbox::Local().Defer(b, MakeFrame('2'));
+
+		Outbox::Local().Flush(a.get());
+		CHECK(g_flushed == "A1;");
+
+		Outbox::Local().Flush(a.get()); //没有缓存的数据包
+		CHECK(g_flushed == "A1;");
+
+		Outbox::Local().Defer(a, MakeFrame('3'));
+	}
+
+	CHECK(g_flushed == "A1;A3;B2;"); //按连接首次缓存的顺序
+}
+
+//每个线程独立的发件箱
+TEST(ThreadLocal)
+{
+	g_flushed.clear();
+
+	auto a = std::make_shared<TestTarget>('A');
+
+	OutboxScope scope;
+	Outbox::Local().Defer(a, MakeFrame('1'));
+
+	bool other_open = true;
+	std::thread([&other_open]() { other_open = Outbox::Local().IsOpen(); }).join();
+
+	CHECK(!other_open);
+	CHECK(g_flushed.empty());
+}
+
+TEST(BypassTypes)
+{
+	OutboxPolicyInstance.Load({ 5, 6 });
+	CHECK(OutboxPolicyInstance.IsBypass(5) && OutboxPolicyInstance.IsBypass(6));
+	CHECK(!OutboxPolicyInstance.IsBypass(7));
+	CHECK(!OutboxPolicyInstance.IsBypass(0) && !OutboxPolicyInstance.IsBypass(OutboxPolicy::MAX_TYPE_COUNT));
+
+	setenv("OutboxBypassTypes", "7,,9", 1); //配置后不使用默认协议类型
+	OutboxPolicyInstance.Load({ 5, 6 });
+	unsetenv("OutboxBypassTypes");
+
+	CHECK(!OutboxPolicyInstance.IsBypass(5));
+	CHECK(OutboxPolicyInstance.IsBypass(7) && OutboxPolicyInstance.IsBypass(9));
+}
+
+TEST_MAIN()
@@ -0,0 +1,73 @@
+#include <type_traits>
+
+#include <google/protobuf/wrappers.pb.h>
+
+#include "P_Command.pb.h"
+#include "ProtocolTraits.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+//具体协议在编译期选择特化版本，只有特化版本提供无参数的Type()
+template <typename T, typename = void>
+struct HasStaticType : std::false_type { };
+
+template <typename T>
+struct HasStaticType<T, decltype(void(ProtocolTraits<T>::Type()))> : std::true_type { };
+
+static_assert(HasStaticType<Asset::Register>::value, "Register has type_t");
+static_assert(HasStaticType<Asset::QueryTraffic>::value, "QueryTraffic has type_t");
+static_assert(!HasStaticType<google::protobuf::StringValue>::value, "StringValue has no type_t");
+static_assert(!HasStaticType<pb::Message>::value, "pb::Message resolves by descriptor");
+
+static_assert(std::is_same<EnableIfProtocol<Asset::Register, int>, int>::value, "protocol accepted");
+
+//
+//编译期和按描述符查找的结果一致
+//
+template <typename T>
+static bool SameType(int32_t expected)
+{
+	T message;
+	const pb::Message& base = message;
+
+	return ProtocolTraits<T>::Type() == expected && ProtocolType(message) == expected && ProtocolType(base) == expected;
+}
+
+TEST(CompileTimeType)
+{
+	CHECK(SameType<Asset::Register>(Asset::INNER_TYPE_REGISTER));
+	CHECK(SameType<Asset::Command>(Asset::INNER_TYPE_COMMAND));
+	CHECK(SameType<Asset::OpenRoom>(Asset::INNER_TYPE_OPEN_ROOM));
+	CHECK(SameType<Asset::SendMail>(Asset::INNER_TYPE_SEND_MAIL));
+	CHECK(SameType<Asset::SystemBroadcast>(Asset::INNER_TYPE_SYSTEM_BROADCAST));
+	CHECK(SameType<Asset::ActivityControl>(Asset::INNER_TYPE_ACTIVITY_CONTROL));
+	CHECK(SameType<Asset::QueryPlayer>(Asset::INNER_TYPE_QUERY_PLAYER));
+	CHECK(SameType<Asset::QueryTraffic>(Asset::INNER_TYPE_QUERY_TRAFFIC));
+}
+
+//协议类型来自默认值，不受实例中type_t的影响
+TEST(TypeFromDefaultInstance)
+{
+	Asset::Register message;
+	message.set_type_t(Asset::INNER_TYPE_COMMAND);
+
+	CHECK(ProtocolType(message) == Asset::INNER_TYPE_REGISTER);
+	CHECK(ProtocolType(static_cast<const pb::Message&>(message)) == Asset::INNER_TYPE_REGISTER);
+}
+
+//
+//按描述符查找：没有type_t变量的协议返回0，type_t没有默认值时为枚举第一个值
+//
+TEST(ReflectionFallback)
+{
+	google::protobuf::StringValue value;
+	CHECK(ProtocolType(value) == 0);
+	CHECK(ProtocolType(static_cast<const pb::Message&>(value)) == 0);
+
+	Asset::InnerMeta meta;
+	meta.set_type_t(Asset::INNER_TYPE_SEND_MAIL);
+	CHECK(ProtocolType(static_cast<const pb::Message&>(meta)) == Asset::INNER_TYPE_BEGIN);
+}
+
+TEST_MAIN()
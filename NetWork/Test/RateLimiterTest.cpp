@@ -0,0 +1,110 @@
+#include <cstdlib>
+
+#include "RateLimiter.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+static const int64_t SECOND = 1000000; //微秒
+
+static RateLimitRule MakeRule(double rate, double burst, RATE_LIMIT_ACTION action = RATE_LIMIT_ACTION_DROP)
+{
+	RateLimitRule rule;
+
+	rule.rate = rate;
+	rule.burst = burst;
+	rule.action = action;
+
+	return rule;
+}
+
+//首次使用时令牌桶为满，之后按速率恢复，不超过容量
+TEST(TokenBucketRefill)
+{
+	auto rule = MakeRule(10, 5);
+	TokenBucket bucket;
+
+	for (int32_t i = 0; i < 5; ++i) CHECK(bucket.Consume(rule, 0) == 0);
+	CHECK(bucket.Consume(rule, 0) == SECOND / 10); //等待一个令牌
+
+	CHECK(bucket.Consume(rule, SECOND / 10) == 0);
+	CHECK(bucket.Consume(rule, SECOND / 10) > 0);
+
+	CHECK(bucket.Consume(rule, 100 * SECOND) == 0); //长时间空闲后最多恢复到容量
+	for (int32_t i = 0; i < 4; ++i) CHECK(bucket.Consume(rule, 100 * SECOND) == 0);
+	CHECK(bucket.Consume(rule, 100 * SECOND) > 0);
+}
+
+TEST(TokenBucketUnlimited)
+{
+	auto rule = MakeRule(0, 1);
+	TokenBucket bucket;
+
+	for (int32_t i = 0; i < 1000; ++i) CHECK(bucket.Consume(rule, 0) == 0);
+}
+
+//无效规则(字段不足、协议类型超出范围)跳过
+TEST(PolicyParse)
+{
+	RateLimitPolicyInstance.Load("10:5:delay", "7:2:3:drop,abc,9:1:1:disconnect,0:1:1,5000:1:1,11:1:0");
+
+	const auto& connection = RateLimitPolicyInstance.GetConnectionRule();
+	CHECK(connection.rate == 10 && connection.burst == 5 && connection.action == RATE_LIMIT_ACTION_DELAY);
+
+	const auto& rules = RateLimitPolicyInstance.GetRules();
+	CHECK(rules.size() == 3);
+
+	CHECK(RateLimitPolicyInstance.GetRuleIndex(7) == 0);
+	CHECK(RateLimitPolicyInstance.GetRuleIndex(9) == 1);
+	CHECK(RateLimitPolicyInstance.GetRuleIndex(8) == -1);
+	CHECK(RateLimitPolicyInstance.GetRuleIndex(0) == -1);
+	CHECK(RateLimitPolicyInstance.GetRuleIndex(5000) == -1);
+
+	if (rules.size() < 3) return;
+
+	CHECK(rules[1].action == RATE_LIMIT_ACTION_DISCONNECT);
+	CHECK(rules[2].type_t == 11 && rules[2].burst == 1); //容量至少为1
+}
+
+//
+//协议类型超出限制时退回连接令牌，不影响其他协议
+//
+TEST(LimiterPerType)
+{
+	RateLimitPolicyInstance.Load("1:4:delay", "7:1:1:drop");
+
+	RateLimiter limiter;
+	int64_t wait = 0;
+
+	int64_t dropped = RateLimitPolicyInstance.GetActionCount(RATE_LIMIT_ACTION_DROP);
+	int64_t delayed = RateLimitPolicyInstance.GetActionCount(RATE_LIMIT_ACTION_DELAY);
+
+	CHECK(limiter.Check(7, 0, wait) == RATE_LIMIT_ACTION_PASS);
+	CHECK(limiter.Check(7, 0, wait) == RATE_LIMIT_ACTION_DROP);
+	CHECK(wait == SECOND);
+
+	for (int32_t i = 0; i < 3; ++i) CHECK(limiter.Check(1, 0, wait) == RATE_LIMIT_ACTION_PASS); //连接令牌剩余3个
+
+	CHECK(limiter.Check(1, 0, wait) == RATE_LIMIT_ACTION_DELAY);
+	CHECK(wait == SECOND);
+
+	CHECK(limiter.Check(7, 2 * SECOND, wait) == RATE_LIMIT_ACTION_PASS);
+
+	CHECK(RateLimitPolicyInstance.GetActionCount(RATE_LIMIT_ACTION_DROP) == dropped + 1);
+	CHECK(RateLimitPolicyInstance.GetActionCount(RATE_LIMIT_ACTION_DELAY) == delayed + 1);
+}
+
+TEST(LimiterDisabled)
+{
+	setenv("RateLimit", "0", 1);
+	RateLimitPolicyInstance.Load("1:1:disconnect", "");
+	unsetenv("RateLimit");
+
+	RateLimiter limiter;
+	int64_t wait = 0;
+
+	for (int32_t i = 0; i < 10; ++i) CHECK(limiter.Check(1, 0, wait) == RATE_LIMIT_ACTION_PASS);
+	CHECK(wait == 0);
+}
+
+TEST_MAIN()
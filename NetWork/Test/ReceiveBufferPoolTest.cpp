@@ -0,0 +1,109 @@
+#include <string>
+#include <cstring>
+
+#include "FrameCodec.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+//写入一次接收的数据并解析，返回解析出的数据包数量
+static std::size_t Receive(FrameCodec& codec, const std::string& data)
+{
+	auto buffer = codec.PrepareBuffer();
+
+	std::size_t size = std::min(boost::asio::buffer_size(buffer), data.size());
+	memcpy(boost::asio::buffer_cast<void*>(buffer), data.data(), size);
+	codec.Commit(size);
+
+	std::size_t count = 0;
+	codec.DecodeRaw([&count](const uint8_t*, std::size_t) {
+		++count;
+		return FRAME_DECODE_SUCCESS;
+	});
+
+	return count;
+}
+
+static std::string MakeStream(std::size_t body_size)
+{
+	std::string body(body_size, 'a');
+	auto frame = FrameBuffer::Create(body.data(), body.size());
+
+	return std::string(reinterpret_cast<const char*>(frame->Data()), frame->Size());
+}
+
+TEST(CapacityClasses)
+{
+	CHECK(ReceiveBufferPool::GetMinCapacity() == 512);
+	CHECK(ReceiveBufferPool::GetNextCapacity(512) == 2048);
+	CHECK(ReceiveBufferPool::GetNextCapacity(300) == 512);
+	CHECK(ReceiveBufferPool::GetNextCapacity(262144) == 262144 * 3 / 2); //超过最大一级
+
+	auto buffer = ReceiveBufferPoolInstance.Acquire(1000);
+	CHECK(buffer.size() == 2048);
+
+	auto data = buffer.data();
+	ReceiveBufferPoolInstance.Release(std::move(buffer));
+
+	auto reused = ReceiveBufferPoolInstance.Acquire(2048); //本线程缓存
+	CHECK(reused.data() == data);
+	ReceiveBufferPoolInstance.Release(std::move(reused));
+
+	auto large = ReceiveBufferPoolInstance.Acquire(300000);
+	CHECK(large.size() == 300000);
+	ReceiveBufferPoolInstance.Release(std::move(large));
+}
+
+//
+//从小缓存开始，大数据包一次扩容到位，连续多次小数据量接收后缩回初始大小
+//
+TEST(CodecGrowAndShrink)
+{
+	const auto& statistics = ReceiveBufferPoolInstance.GetStatistics();
+	int64_t buffer_count = statistics.buffer_count;
+
+	{
+		FrameCodec codec(512);
+
+		CHECK(Receive(codec, MakeStream(10)) == 1);
+		CHECK(codec.GetBufferSize() == 512);
+
+		std::string large = MakeStream(40000);
+		CHECK(Receive(codec, large.substr(0, 100)) == 0); //半包，包头已经收到
+		CHECK(Receive(codec, large.substr(100)) == 1); //按包长一次扩容到位
+		CHECK(codec.GetBufferSize() >= large.size());
+		CHECK(codec.GetPendingSize() == 0);
+
+		for (int32_t i = 0; i < FrameCodec::SHRINK_RECEIVE_COUNT; ++i) CHECK(Receive(codec, MakeStream(10)) == 1);
+
+		codec.PrepareBuffer();
+		CHECK(codec.GetBufferSize() == 512);
+
+		CHECK(statistics.buffer_count == buffer_count + 1);
+
+		CHECK(codec.Release()); //空闲时归还
+		CHECK(codec.GetBufferSize() == 0);
+		CHECK(statistics.buffer_count == buffer_count);
+
+		CHECK(Receive(codec, MakeStream(10)) == 1); //再次接收时重新获取
+	}
+
+	CHECK(statistics.buffer_count == buffer_count);
+}
+
+//有未接收完的数据时不归还
+TEST(ReleaseKeepsPartialFrame)
+{
+	FrameCodec codec;
+
+	std::string stream = MakeStream(100);
+	CHECK(Receive(codec, stream.substr(0, 50)) == 0);
+
+	CHECK(!codec.Release());
+	CHECK(codec.GetPendingSize() == 50);
+
+	CHECK(Receive(codec, stream.substr(50)) == 1);
+	CHECK(codec.Release());
+}
+
+TEST_MAIN()
@@ -0,0 +1,72 @@
+#include <memory>
+#include <vector>
+#include <unistd.h>
+
+#include "AsyncAcceptor.h"
+#include "TestUtil.h"
+
+static int32_t g_accepted[2] = { 0, 0 }; //按监听序号统计
+
+static void OnAccept(tcp::socket&& socket, int32_t thread_index)
+{
+	tcp::socket accepted(std::move(socket));
+	if (thread_index >= 0 && thread_index < 2) ++g_accepted[thread_index];
+}
+
+//
+//同一端口两个监听(SO_REUSEPORT)，连接由内核分配，各自在监听的线程接收
+//
+TEST(SharedPort)
+{
+	const int32_t port = 30000 + getpid() % 20000;
+	const int32_t connection_count = 64;
+
+	boost::asio::io_service io_service;
+	std::vector<std::unique_ptr<AsyncAcceptor>> acceptors;
+	std::vector<std::unique_ptr<tcp::socket>> sockets;
+
+	try
+	{
+		for (int32_t i = 0; i < 2; ++i)
+		{
+			acceptors.emplace_back(new AsyncAcceptor(io_service, "127.0.0.1", port, true));
+			sockets.emplace_back(new tcp::socket(io_service));
+
+			auto socket = sockets.back().get();
+			acceptors.back()->SetSocketFactory([socket, i]() { return std::make_pair(socket, i); });
+			acceptors.back()->AsyncAcceptWithCallback(OnAccept);
+		}
+	}
+	catch (const boost::system::system_error&)
+	{
+		CHECK(false); //端口被占用或者不支持SO_REUSEPORT
+		return;
+	}
+
+	bool exclusive = false; //未设置SO_REUSEPORT的监听不能共用
+	try
+	{
+		AsyncAcceptor acceptor(io_service, "127.0.0.1", port, false);
+	}
+	catch (const boost::system::system_error&)
+	{
+		exclusive = true;
+	}
+	CHECK(exclusive);
+
+	std::vector<std::unique_ptr<tcp::socket>> clients;
+	for (int32_t i = 0; i < connection_count; ++i)
+	{
+		clients.emplace_back(new tcp::socket(io_service));
+		clients.back()->connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+	}
+
+	while (g_accepted[0] + g_accepted[1] < connection_count) io_service.run_one();
+
+	CHECK(g_accepted[0] > 0 && g_accepted[1] > 0); //64个连接全部分到同一个监听的概率可以忽略
+
+	for (auto& acceptor : acceptors) acceptor->Close();
+	io_service.poll();
+}
+
+TEST_MAIN()
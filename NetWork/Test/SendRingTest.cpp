@@ -0,0 +1,117 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "SendRing.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+static const uint32_t PRODUCER_SHIFT = 24; //标识：生产者序号(高8位) + 该生产者的入队序号
+
+TEST(PushPop)
+{
+	SendRing ring(5);
+	CHECK(ring.Capacity() == 8); //容量取2的幂
+
+	auto frame = FrameBuffer::Create("abc", 3);
+
+	for (uint32_t i = 0; i < 8; ++i) CHECK(ring.Push(frame, i));
+	CHECK(!ring.Push(frame, 8)); //已满
+	CHECK(ring.GetFullCount() == 1);
+
+	FramePtr popped;
+	uint32_t tag = 0;
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		CHECK(ring.Pop(popped, tag));
+		CHECK(popped == frame && tag == i);
+	}
+	CHECK(!ring.Pop(popped, tag));
+	CHECK(ring.Push(frame, 9)); //取走后可以继续入队
+}
+
+//溢出队列不为空时后续数据包也写入溢出队列，出队顺序和入队顺序一致
+TEST(SpillKeepsOrder)
+{
+	SendRing ring(4);
+	auto frame = FrameBuffer::Create("abc", 3);
+
+	uint32_t next = 0;
+	for (; next < 4; ++next) CHECK(ring.Push(frame, next));
+
+	CHECK(!ring.Push(frame, next));
+	ring.Spill(frame, next++);
+
+	FramePtr popped;
+	uint32_t tag = 0;
+	CHECK(ring.Pop(popped, tag) && tag == 0); //环形队列有空位
+
+	CHECK(!ring.Push(frame, next)); //溢出队列中有之前的数据包
+	ring.Spill(frame, next++);
+	CHECK(ring.GetSpillCount() == 2);
+
+	std::vector<uint32_t> tags;
+	ring.Drain([&tags](const FramePtr&, uint32_t tag) { tags.push_back(tag); });
+
+	CHECK((tags == std::vector<uint32_t>{ 1, 2, 3, 4, 5 }));
+	CHECK(ring.Push(frame, next)); //溢出队列取完后恢复使用环形队列
+}
+
+//
+//多个生产者并发入队(满时写入溢出队列)，单个消费者持续出队：不丢失、不重复，每个生产者的数据包保持入队顺序
+//
+TEST(MultiProducerStress)
+{
+	const uint32_t producer_count = 8;
+	const uint32_t per_producer = 200000;
+
+	SendRing ring(64); //容量较小，经常写满
+	auto frame = FrameBuffer::Create("abc", 3);
+
+	std::atomic<uint32_t> finished(0);
+	std::vector<std::thread> producers;
+
+	for (uint32_t producer = 0; producer < producer_count; ++producer)
+	{
+		producers.emplace_back([&ring, &frame, &finished, producer, per_producer]() {
+			for (uint32_t i = 0; i < per_producer; ++i)
+			{
+				uint32_t tag = (producer << PRODUCER_SHIFT) | i;
+				if (!ring.Push(frame, tag)) ring.Spill(frame, tag);
+			}
+			++finished;
+		});
+	}
+
+	std::vector<uint32_t> expected(producer_count, 0);
+	uint64_t received = 0;
+	uint64_t disordered = 0;
+	uint64_t wrong_frame = 0;
+
+	auto handler = [&](const FramePtr& popped, uint32_t tag) {
+		uint32_t producer = tag >> PRODUCER_SHIFT;
+		uint32_t sequence = tag & ((1 << PRODUCER_SHIFT) - 1);
+
+		if (producer >= producer_count || sequence != expected[producer]) ++disordered;
+		else ++expected[producer];
+
+		if (popped != frame) ++wrong_frame;
+		++received;
+	};
+
+	while (finished.load() < producer_count) ring.Drain(handler);
+	ring.Drain(handler);
+
+	for (auto& producer : producers) producer.join();
+
+	CHECK(received == uint64_t(producer_count) * per_producer);
+	CHECK(disordered == 0);
+	CHECK(wrong_frame == 0);
+	for (auto count : expected) CHECK(count == per_producer);
+
+	CHECK(ring.GetSpillCount() > 0); //覆盖溢出队列
+}
+
+TEST_MAIN()
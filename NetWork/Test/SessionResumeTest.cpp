@@ -0,0 +1,193 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+
+#include "SessionResume.h"
+#include "FrameCodec.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+struct TestTarget : ResumeTarget
+{
+	int32_t forwarded = 0;
+	int32_t replaced = 0;
+	int32_t expired = 0;
+
+	void OnResumeForward(FramePtr) override { ++forwarded; }
+	void OnResumeReplaced() override { ++replaced; }
+	void OnResumeExpired() override { ++expired; }
+};
+
+static FramePtr MakeFrame(char c, std::size_t size = 10)
+{
+	std::string body(size, c);
+	return FrameBuffer::Create(body.data(), body.size());
+}
+
+TEST(SecureRandomToken)
+{
+	ResumeToken first, second;
+
+	CHECK(SecureRandom(&first, sizeof(first)));
+	CHECK(SecureRandom(&second, sizeof(second)));
+	CHECK(first.id != second.id || first.secret != second.secret);
+}
+
+//
+//标识不存在、密钥错误、全0均查找失败，调用方无法区分
+//
+TEST(FindByToken)
+{
+	auto owner = std::make_shared<TestTarget>();
+
+	auto resume = SessionResumeRegistryInstance.Create(1, "account", FRAME_CAPABILITY_RESUME, owner);
+	CHECK(resume);
+	if (!resume) return;
+
+	const auto& token = resume->GetToken();
+	CHECK(token.id != 0 && token.secret != 0);
+	CHECK(resume->GetAccount() == "account");
+
+	CHECK(SessionResumeRegistryInstance.Find(token) == resume);
+
+	ResumeToken forged = token;
+	forged.secret ^= 1;
+	CHECK(!SessionResumeRegistryInstance.Find(forged));
+
+	ResumeToken unknown = token;
+	unknown.id ^= 1;
+	CHECK(!SessionResumeRegistryInstance.Find(unknown));
+
+	CHECK(!SessionResumeRegistryInstance.Find(ResumeToken()));
+
+	SessionResumeRegistryInstance.Remove(resume);
+	CHECK(!SessionResumeRegistryInstance.Find(token));
+}
+
+//玩家重新进入游戏时之前的记录作废
+TEST(CreateReplacesPrevious)
+{
+	auto owner = std::make_shared<TestTarget>();
+
+	auto previous = SessionResumeRegistryInstance.Create(2, "account", 0, owner);
+	auto current = SessionResumeRegistryInstance.Create(2, "account", 0, owner);
+	CHECK(previous && current);
+	if (!previous || !current) return;
+
+	CHECK(previous->GetToken().id != current->GetToken().id);
+	CHECK(previous->IsRemoved());
+	CHECK(!SessionResumeRegistryInstance.Find(previous->GetToken()));
+	CHECK(SessionResumeRegistryInstance.Find(current->GetToken()) == current);
+
+	SessionResumeRegistryInstance.Remove(current);
+}
+
+//
+//续传序号在记录范围[最早的数据包, 下一个数据包]内才能续传，重发该序号之后的全部数据包
+//
+TEST(TakeOverRange)
+{
+	auto owner = std::make_shared<TestTarget>();
+	auto resumed = std::make_shared<TestTarget>();
+
+	ResumeToken token;
+	token.id = token.secret = 1;
+
+	SessionResume resume(token, 3, "account", 0, 25); //只能保留两个数据包
+	resume.SetOwner(owner.get(), owner);
+
+	std::shared_ptr<ResumeTarget> forward;
+	for (int32_t i = 0; i < 5; ++i) CHECK(resume.Record(owner.get(), MakeFrame('a' + i), forward));
+	CHECK(resume.GetNextSequence() == 6);
+
+	CHECK(resume.Park(owner.get(), std::chrono::steady_clock::now() + std::chrono::seconds(30)));
+
+	std::vector<FramePtr> frames;
+	std::shared_ptr<ResumeTarget> previous;
+
+	CHECK(!resume.TakeOver(resumed.get(), resumed, 3, frames, previous)); //已经超过上限丢弃
+	CHECK(!resume.TakeOver(resumed.get(), resumed, 7, frames, previous));
+	CHECK(frames.empty());
+
+	CHECK(resume.TakeOver(resumed.get(), resumed, 5, frames, previous));
+	CHECK(frames.size() == 1 && frames[0]->Data()[FrameBuffer::FRAME_HEADER_SIZE] == 'e');
+	CHECK(previous == owner);
+
+	//旧连接之后入队的数据包转给新连接
+	CHECK(!resume.Record(owner.get(), MakeFrame('x'), forward));
+	CHECK(forward == resumed);
+
+	CHECK(resume.Record(resumed.get(), MakeFrame('f'), forward));
+
+	frames.clear();
+	CHECK(resume.TakeOver(owner.get(), owner, 7, frames, previous)); //客户端已经全部收到
+	CHECK(frames.empty());
+}
+
+TEST(ParkExpire)
+{
+	auto owner = std::make_shared<TestTarget>();
+
+	ResumeToken token;
+	token.id = token.secret = 2;
+
+	SessionResume resume(token, 4, "account", 0, 1024);
+	resume.SetOwner(owner.get(), owner);
+
+	auto now = std::chrono::steady_clock::now();
+	std::shared_ptr<ResumeTarget> target;
+
+	CHECK(!resume.Expire(now, target)); //尚未断开
+
+	CHECK(resume.Park(owner.get(), now + std::chrono::seconds(30)));
+	CHECK(!resume.Expire(now, target));
+
+	CHECK(resume.Expire(now + std::chrono::seconds(31), target));
+	CHECK(target == owner);
+	CHECK(resume.IsRemoved());
+	CHECK(!resume.Park(owner.get(), now)); //已经删除，按断开连接处理
+}
+
+//玩家连接续传数据包：续传标识、序号、密钥依次解析
+TEST(ResumeFrameRoundTrip)
+{
+	const uint32_t capabilities = FRAME_CAPABILITY_EXTENDED | FRAME_CAPABILITY_RESUME;
+
+	ResumeToken token;
+	token.id = 0x0102030405060708ULL;
+	token.secret = 0xf0e0d0c0b0a09080ULL;
+
+	std::string stream;
+	for (auto frame : { FrameBuffer::BuildHandshake(capabilities), FrameBuffer::BuildResume(token, 42), FrameBuffer::BuildResume(token.id, 43) })
+	{
+		stream.append(reinterpret_cast<const char*>(frame->Data()), frame->Size());
+	}
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(capabilities);
+
+	std::vector<std::pair<ResumeToken, uint64_t>> resumes;
+	codec.SetResumeHandler([&resumes](const ResumeToken& token, uint64_t sequence) { resumes.emplace_back(token, sequence); });
+
+	auto buffer = codec.PrepareBuffer();
+	CHECK(boost::asio::buffer_size(buffer) >= stream.size());
+	memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data(), stream.size());
+	codec.Commit(stream.size());
+
+	int32_t delivered = 0;
+	codec.DecodeRaw([&delivered](const uint8_t*, std::size_t) {
+		++delivered;
+		return FRAME_DECODE_SUCCESS;
+	});
+
+	CHECK(delivered == 0);
+	CHECK(resumes.size() == 2);
+	if (resumes.size() != 2) return;
+
+	CHECK(resumes[0].first.id == token.id && resumes[0].first.secret == token.secret && resumes[0].second == 42);
+	CHECK(resumes[1].first.id == token.id && resumes[1].first.secret == 0 && resumes[1].second == 43); //没有密钥
+}
+
+TEST_MAIN()
@@ -0,0 +1,143 @@
+#include <string>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "ShmTransport.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+using boost::asio::ip::tcp;
+
+static boost::asio::io_service g_listen_service; //接收端监听，先于ShmRegistry构造，监听套接字释放时仍然有效
+static int32_t g_port = 30000 + getpid() % 20000; //抽象命名空间，只用于区分同时运行的测试
+
+//
+//发起端在本机绑定TCP地址后交出共享内存，接收端按发起端地址取出
+//
+static bool Negotiate(boost::asio::io_service& io_service, std::shared_ptr<ShmStream>& initiator, std::shared_ptr<ShmStream>& acceptor, tcp::socket& socket, std::size_t capacity)
+{
+	static bool listening = false;
+
+	if (!listening)
+	{
+		setenv("ShmTransport", "1", 1);
+		listening = ShmRegistryInstance.Listen(g_listen_service, g_port);
+		unsetenv("ShmTransport");
+
+		if (!listening) return false;
+	}
+
+	g_listen_service.restart();
+	std::thread thread([]() { g_listen_service.run(); }); //发起端等待确认时接收端处理请求
+
+	initiator = ShmStream::Connect(io_service, socket, tcp::endpoint(boost::asio::ip::address_v4::loopback(), g_port), capacity);
+
+	g_listen_service.stop();
+	thread.join();
+
+	if (!initiator) return false;
+
+	acceptor = ShmRegistryInstance.Take(io_service.get_executor(), socket.local_endpoint());
+	return acceptor != nullptr;
+}
+
+TEST(NegotiateOnce)
+{
+	boost::asio::io_service io_service;
+	std::shared_ptr<ShmStream> initiator, acceptor;
+	tcp::socket socket(io_service);
+
+	CHECK(Negotiate(io_service, initiator, acceptor, socket, 1));
+	CHECK(ShmRegistryInstance.IsEnabled());
+
+	CHECK(!ShmRegistryInstance.Take(io_service.get_executor(), socket.local_endpoint())); //只能取出一次
+
+	tcp::socket other(io_service);
+	CHECK(!ShmStream::Connect(io_service, other, tcp::endpoint(boost::asio::ip::address_v4::loopback(), g_port + 1), 1)); //对端未开启
+}
+
+//
+//数据量超过队列大小：队列已满时等待对端读取，跨越队列末尾后内容不变
+//
+TEST(StreamWrapAround)
+{
+	boost::asio::io_service io_service;
+	std::shared_ptr<ShmStream> initiator, acceptor;
+	tcp::socket socket(io_service);
+
+	CHECK(Negotiate(io_service, initiator, acceptor, socket, 64 * 1024));
+	if (!initiator || !acceptor) return;
+
+	std::string data(300000, '\0');
+	for (std::size_t i = 0; i < data.size(); ++i) data[i] = char(i * 7 + i / 251);
+
+	std::size_t sent = 0;
+	int32_t blocked = 0;
+
+	std::function<void()> write = [&]() {
+		while (sent < data.size())
+		{
+			boost::system::error_code error;
+			sent += initiator->WriteSome(boost::asio::buffer(&data[sent], data.size() - sent), error);
+
+			if (error == boost::asio::error::would_block)
+			{
+				++blocked;
+				initiator->AsyncWaitWrite([&](const boost::system::error_code& error, std::size_t) { if (!error) write(); });
+				return;
+			}
+			if (error) return;
+		}
+	};
+
+	std::string received;
+	char buffer[10000];
+
+	std::function<void(const boost::system::error_code&, std::size_t)> read = [&](const boost::system::error_code& error, std::size_t size) {
+		if (error) return;
+
+		received.append(buffer, size);
+		if (received.size() < data.size()) acceptor->AsyncReadSome(boost::asio::buffer(buffer), read);
+	};
+
+	acceptor->AsyncReadSome(boost::asio::buffer(buffer), read);
+	write();
+
+	io_service.run();
+
+	CHECK(blocked > 0);
+	CHECK(received == data);
+}
+
+//关闭后等待中的接收返回operation_aborted，发送返回broken_pipe
+TEST(Close)
+{
+	boost::asio::io_service io_service;
+	std::shared_ptr<ShmStream> initiator, acceptor;
+	tcp::socket socket(io_service);
+
+	CHECK(Negotiate(io_service, initiator, acceptor, socket, 1));
+	if (!initiator || !acceptor) return;
+
+	boost::system::error_code result;
+	char buffer[16];
+
+	initiator->AsyncReadSome(boost::asio::buffer(buffer), [&result](const boost::system::error_code& error, std::size_t) { result = error; });
+	io_service.poll();
+
+	initiator->Close();
+	io_service.run();
+
+	CHECK(result == boost::asio::error::operation_aborted);
+	CHECK(initiator->IsClosed());
+
+	boost::system::error_code error;
+	initiator->WriteSome(boost::asio::buffer(buffer), error);
+	CHECK(error == boost::asio::error::broken_pipe);
+}
+
+TEST_MAIN()
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <cstdlib>
+
+#include <fmt/format.h> //同spdlog中的fmt，统计报告直接使用
+
+/*
+ * 单元测试使用的日志和配置
+ *
+ * 1.NetWork头文件只依赖日志宏和ConfigInstance，测试时替换Include/MXLog.h，不依赖spdlog和服务器配置文件;
+ *
+ * 2.日志不输出(参数不求值)，配置项从环境变量读取，未设置时使用默认值.
+ *
+ * */
+
+#define MAX_DATA_SIZE 65536
+
+#define DEBUG(fmt, ...) { if (false) Adoter::IgnoreLog(fmt, ##__VA_ARGS__); }
+#define TRACE(fmt, ...) { if (false) Adoter::IgnoreLog(fmt, ##__VA_ARGS__); }
+#define ERROR(fmt, ...) { if (false) Adoter::IgnoreLog(fmt, ##__VA_ARGS__); }
+#define WARN(fmt, ...) { if (false) Adoter::IgnoreLog(fmt, ##__VA_ARGS__); }
+#define CRITICAL(fmt, ...) { if (false) Adoter::IgnoreLog(fmt, ##__VA_ARGS__); }
+#define LOG(level, fmt, ...) { if (false) Adoter::IgnoreLog(fmt, ##__VA_ARGS__); }
+
+namespace Adoter
+{
+
+//日志参数只用于编译检查，不求值
+template <typename... ARGS>
+inline void IgnoreLog(const char*, const ARGS&...) { }
+
+class ConfigManager
+{
+public:
+	static ConfigManager& Instance()
+	{
+		static ConfigManager _instance;
+		return _instance;
+	}
+
+	int GetInt(const std::string& key, int default_value) const
+	{
+		const char* value = getenv(key.c_str());
+		return value ? atoi(value) : default_value;
+	}
+
+	bool GetBool(const std::string& key, bool default_value) const
+	{
+		const char* value = getenv(key.c_str());
+		return value ? atoi(value) != 0 : default_value;
+	}
+
+	float GetFloat(const std::string& key, float default_value) const
+	{
+		const char* value = getenv(key.c_str());
+		return value ? float(atof(value)) : default_value;
+	}
+
+	std::string GetString(const std::string& key, const std::string& default_value) const
+	{
+		const char* value = getenv(key.c_str());
+		return value ? std::string(value) : default_value;
+	}
+};
+
+#define ConfigInstance ConfigManager::Instance()
+
+}
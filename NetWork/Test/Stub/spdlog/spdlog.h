@@ -0,0 +1,3 @@
+#pragma once
+
+//单元测试不依赖spdlog，日志见Stub/MXLog.h
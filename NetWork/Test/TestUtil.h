@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include <vector>
+#include <functional>
+
+/*
+ * 单元测试
+ *
+ * 1.每个测试文件一个可执行程序(见CMakeLists.txt)，TEST定义的用例按定义顺序执行;
+ *
+ * 2.CHECK失败时输出位置并记录，当前用例继续执行；存在失败的用例时进程返回1.
+ *
+ * */
+
+namespace Adoter
+{
+
+class TestRunner
+{
+	struct Case
+	{
+		const char* name;
+		std::function<void()> run;
+	};
+public:
+	static TestRunner& Instance()
+	{
+		static TestRunner _instance;
+		return _instance;
+	}
+
+	bool Add(const char* name, std::function<void()> run)
+	{
+		_cases.push_back({name, run});
+		return true;
+	}
+
+	void Fail(const char* file, int line, const char* expression)
+	{
+		fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+		++_failures;
+	}
+
+	int Run()
+	{
+		int failed_cases = 0;
+
+		for (const auto& test_case : _cases)
+		{
+			int failures = _failures;
+			test_case.run();
+
+			bool passed = failures == _failures;
+			if (!passed) ++failed_cases;
+
+			printf("[%s] %s\n", passed ? "  OK  " : "FAILED", test_case.name);
+		}
+
+		printf("%d/%zu passed\n", int(_cases.size()) - failed_cases, _cases.size());
+		return failed_cases == 0 ? 0 : 1;
+	}
+
+private:
+	std::vector<Case> _cases;
+	int _failures = 0;
+};
+
+}
+
+#define TEST(name) \
+	static void name(); \
+	static bool name##_registered __attribute__((unused)) = Adoter::TestRunner::Instance().Add(#name, name); \
+	static void name()
+
+#define CHECK(expression) { if (!(expression)) Adoter::TestRunner::Instance().Fail(__FILE__, __LINE__, #expression); }
+
+#define TEST_MAIN() int main() { return Adoter::TestRunner::Instance().Run(); }
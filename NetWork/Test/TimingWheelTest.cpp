@@ -0,0 +1,158 @@
+#include <random>
+#include <vector>
+
+#include "TimingWheel.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+struct TestNode : TimingWheel::Node
+{
+	uint64_t want = 0; //期望到期刻度，0为已经取消
+	int32_t fired = 0;
+	uint64_t fired_at = 0;
+};
+
+//高层槽位的节点逐层下放，在各层边界附近到期的节点均准确回调
+TEST(CascadeAcrossLevels)
+{
+	const uint64_t start = 12345;
+
+	TimingWheel wheel(start);
+
+	std::vector<uint64_t> delays;
+	for (int32_t level = 1; level <= TimingWheel::LEVEL_COUNT; ++level)
+	{
+		uint64_t boundary = uint64_t(1) << (TimingWheel::LEVEL_BITS * level);
+		for (uint64_t delay : { boundary - 1, boundary, boundary + 1 })
+		{
+			if (delay <= TimingWheel::MAX_DELAY) delays.push_back(delay);
+		}
+	}
+	delays.push_back(1);
+	delays.push_back(63);
+
+	std::vector<TestNode> nodes(delays.size());
+	for (std::size_t i = 0; i < nodes.size(); ++i)
+	{
+		nodes[i].want = start + delays[i];
+		wheel.Schedule(&nodes[i], nodes[i].want);
+	}
+
+	CHECK(wheel.Size() == nodes.size());
+
+	uint64_t now = start;
+	uint64_t last = start + TimingWheel::MAX_DELAY;
+
+	while (wheel.Size() > 0 && now < last)
+	{
+		now = std::min(last, now + 4096); //一次推进多个刻度
+		wheel.Advance(now, [&wheel](TimingWheel::Node* node) {
+			auto test_node = static_cast<TestNode*>(node);
+			++test_node->fired;
+			test_node->fired_at = wheel.GetCurrent();
+		});
+	}
+
+	for (const auto& node : nodes)
+	{
+		CHECK(node.fired == 1);
+		CHECK(node.fired_at == node.want);
+	}
+	CHECK(wheel.Size() == 0);
+}
+
+//
+//大量节点随机调度、取消和重新调度，每个节点只在最后一次调度的刻度回调一次
+//
+TEST(RandomScheduleCancel)
+{
+	const uint64_t start = 1000;
+
+	TimingWheel wheel(start);
+	std::mt19937_64 random(1);
+
+	std::vector<TestNode> nodes(100000);
+
+	for (std::size_t i = 0; i < nodes.size(); ++i)
+	{
+		uint64_t delay = 1 + random() % (i % 3 == 0 ? 100 : i % 3 == 1 ? 5000 : 400000);
+		nodes[i].want = start + delay;
+		wheel.Schedule(&nodes[i], nodes[i].want);
+	}
+
+	for (std::size_t i = 0; i < nodes.size(); i += 7)
+	{
+		wheel.Cancel(&nodes[i]);
+		nodes[i].want = 0;
+	}
+
+	for (std::size_t i = 1; i < nodes.size(); i += 11)
+	{
+		nodes[i].want = start + 1 + random() % 300000;
+		wheel.Schedule(&nodes[i], nodes[i].want);
+	}
+
+	uint64_t now = start;
+	std::size_t wrong_tick = 0;
+
+	while (wheel.Size() > 0)
+	{
+		now += 1 + random() % 3;
+		wheel.Advance(now, [&](TimingWheel::Node* node) {
+			auto test_node = static_cast<TestNode*>(node);
+			++test_node->fired;
+			if (test_node->want != wheel.GetCurrent()) ++wrong_tick;
+		});
+	}
+
+	CHECK(wrong_tick == 0);
+
+	std::size_t wrong_count = 0;
+	for (const auto& node : nodes)
+	{
+		if (node.fired != (node.want ? 1 : 0)) ++wrong_count;
+	}
+	CHECK(wrong_count == 0);
+}
+
+//回调中重新调度(比如仍有收发的连接按活跃时间顺延)
+TEST(RescheduleInCallback)
+{
+	TimingWheel wheel(0);
+
+	TestNode node;
+	wheel.Schedule(&node, 30);
+
+	std::vector<uint64_t> ticks;
+	wheel.Advance(200, [&](TimingWheel::Node* expired) {
+		ticks.push_back(wheel.GetCurrent());
+		if (ticks.size() < 3) wheel.Schedule(expired, wheel.GetCurrent() + 70);
+	});
+
+	CHECK((ticks == std::vector<uint64_t>{ 30, 100, 170 }));
+	CHECK(!node.IsLinked());
+}
+
+//过期时间不晚于当前刻度时在下一个刻度到期，超过范围按最大延迟
+TEST(ScheduleBounds)
+{
+	TimingWheel wheel(100);
+
+	TestNode past, far;
+	wheel.Schedule(&past, 50);
+	wheel.Schedule(&far, 100 + TimingWheel::MAX_DELAY * 2);
+
+	CHECK(past.expire == 101);
+	CHECK(far.expire == 100 + TimingWheel::MAX_DELAY);
+
+	wheel.Cancel(&far);
+	wheel.Cancel(&far); //重复取消
+	CHECK(wheel.Size() == 1);
+
+	int32_t fired = 0;
+	wheel.Advance(101, [&fired](TimingWheel::Node*) { ++fired; });
+	CHECK(fired == 1);
+}
+
+TEST_MAIN()
@@ -0,0 +1,110 @@
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+#include "TrafficStats.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+static const TrafficEntry* Find(const std::vector<TrafficEntry>& entries, TRAFFIC_CLASS traffic_class, TRAFFIC_DIRECTION direction, int32_t type_t)
+{
+	for (const auto& entry : entries)
+	{
+		if (entry.traffic_class == traffic_class && entry.direction == direction && entry.type_t == type_t) return &entry;
+	}
+	return nullptr;
+}
+
+TEST(ConnectionCounter)
+{
+	TrafficCounter counter;
+
+	counter.Add(TRAFFIC_DIRECTION_IN, 10);
+	counter.Add(TRAFFIC_DIRECTION_OUT, 20);
+	counter.Add(TRAFFIC_DIRECTION_OUT, 30);
+
+	CHECK(counter.GetMessages() == 3);
+	CHECK(counter.GetBytes() == 60);
+	CHECK(counter.bytes[TRAFFIC_DIRECTION_OUT] == 50);
+}
+
+//
+//各线程独立写入，合并时累加所有线程(包括已经退出的线程)
+//
+TEST(MergeThreads)
+{
+	const int32_t thread_count = 4;
+	const int32_t per_thread = 10000;
+
+	std::vector<std::thread> threads;
+	for (int32_t i = 0; i < thread_count; ++i)
+	{
+		threads.emplace_back([per_thread]() {
+			for (int32_t j = 0; j < per_thread; ++j)
+			{
+				TrafficStatsInstance.Record(TRAFFIC_CLASS_CLIENT, TRAFFIC_DIRECTION_IN, 101, 10, 5);
+				TrafficStatsInstance.Record(TRAFFIC_CLASS_CLIENT, TRAFFIC_DIRECTION_OUT, 102, 100);
+			}
+		});
+	}
+	for (auto& thread : threads) thread.join();
+
+	TrafficStatsInstance.Record(TRAFFIC_CLASS_GMT, TRAFFIC_DIRECTION_IN, -1, 7);
+	TrafficStatsInstance.Record(TRAFFIC_CLASS_GMT, TRAFFIC_DIRECTION_IN, TrafficStats::MAX_TYPE_COUNT + 5, 7);
+
+	auto entries = TrafficStatsInstance.Merge();
+
+	auto in = Find(entries, TRAFFIC_CLASS_CLIENT, TRAFFIC_DIRECTION_IN, 101);
+	CHECK(in && in->messages == thread_count * per_thread && in->bytes == in->messages * 10 && in->cost_ns == in->messages * 5);
+
+	auto out = Find(entries, TRAFFIC_CLASS_CLIENT, TRAFFIC_DIRECTION_OUT, 102);
+	CHECK(out && out->messages == thread_count * per_thread && out->cost_ns == 0);
+
+	auto overflow = Find(entries, TRAFFIC_CLASS_GMT, TRAFFIC_DIRECTION_IN, TrafficStats::MAX_TYPE_COUNT); //超出范围
+	CHECK(overflow && overflow->messages == 2);
+
+	for (std::size_t i = 1; i < entries.size(); ++i) CHECK(entries[i - 1].bytes >= entries[i].bytes); //按字节数排序
+}
+
+TEST(ReportTop)
+{
+	for (int32_t type_t = 1; type_t <= 5; ++type_t) TrafficStatsInstance.Record(TRAFFIC_CLASS_CENTER_SERVER, TRAFFIC_DIRECTION_OUT, type_t, type_t * 1000);
+
+	auto report = TrafficStatsInstance.Report(2);
+
+	CHECK(report.find("协议类型:5 ") != std::string::npos);
+	CHECK(report.find("协议类型:4 ") != std::string::npos);
+	CHECK(report.find("协议类型:3 ") == std::string::npos); //每种连接类型和方向最多2项
+}
+
+//每TrafficTimingSample个数据包计时一次，耗时按间隔放大
+TEST(TimingSample)
+{
+	setenv("TrafficTimingSample", "4", 1);
+	TrafficStatsInstance.Load();
+
+	std::vector<int32_t> samples;
+	for (int32_t i = 0; i < 8; ++i) samples.push_back(TrafficStatsInstance.ShouldTime());
+
+	CHECK(std::count(samples.begin(), samples.end(), 4) == 2);
+	CHECK(std::count(samples.begin(), samples.end(), 0) == 6);
+
+	setenv("TrafficTimingSample", "0", 1);
+	TrafficStatsInstance.Load();
+	unsetenv("TrafficTimingSample");
+
+	for (int32_t i = 0; i < 8; ++i) CHECK(TrafficStatsInstance.ShouldTime() == 0);
+
+	{
+		TrafficScope scope(TRAFFIC_CLASS_GAME_SERVER, 103, 64);
+	}
+
+	auto entries = TrafficStatsInstance.Merge();
+	auto entry = Find(entries, TRAFFIC_CLASS_GAME_SERVER, TRAFFIC_DIRECTION_IN, 103);
+	CHECK(entry && entry->messages == 1 && entry->bytes == 64 && entry->cost_ns == 0);
+}
+
+TEST_MAIN()
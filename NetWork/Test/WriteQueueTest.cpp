@@ -0,0 +1,328 @@
+#include <string>
+#include <vector>
+
+#include "WriteQueue.h"
+#include "FrameCodec.h"
+#include "TestUtil.h"
+
+using namespace Adoter;
+
+static const std::size_t BODY_SIZE = 10;
+static const std::size_t FRAME_SIZE = FrameBuffer::FRAME_HEADER_SIZE + BODY_SIZE;
+
+static FramePtr MakeFrame(char c, std::size_t size = BODY_SIZE, SEND_PRIORITY priority = SEND_PRIORITY_NORMAL)
+{
+	std::string body(size, c);
+
+	auto frame = FrameBuffer::Create(body.data(), body.size());
+	frame->SetPriority(priority);
+
+	return frame;
+}
+
+//按发送顺序取出所有数据包的第一个包体字节，每次最多发送batch_bytes
+static std::string Flush(WriteQueue& queue)
+{
+	std::string order;
+
+	while (!queue.Empty())
+	{
+		const auto& buffers = queue.Gather();
+		if (buffers.empty()) break;
+
+		for (const auto& buffer : buffers)
+		{
+			auto data = boost::asio::buffer_cast<const uint8_t*>(buffer);
+			if (boost::asio::buffer_size(buffer) > FrameBuffer::FRAME_HEADER_SIZE) order.push_back(char(data[FrameBuffer::FRAME_HEADER_SIZE]));
+		}
+
+		queue.Consume(queue.GatheredBytes());
+	}
+
+	return order;
+}
+
+static void Append(const FramePtr& frame, std::string& stream)
+{
+	for (auto chunk = frame; chunk; chunk = chunk->Next()) stream.append(reinterpret_cast<const char*>(chunk->Data()), chunk->Size());
+}
+
+static QueueLimits MakeLimits(BACKPRESSURE_POLICY policy)
+{
+	QueueLimits limits;
+
+	limits.high_bytes = FRAME_SIZE * 10;
+	limits.low_bytes = FRAME_SIZE * 4;
+	limits.high_messages = 1000;
+	limits.low_messages = 500;
+	limits.max_bytes = FRAME_SIZE * 15;
+	limits.policy = policy;
+
+	return limits;
+}
+
+TEST(GatherAndPartialSend)
+{
+	WriteQueue queue;
+	queue.SetBatchBytes(FRAME_SIZE * 2);
+
+	for (int32_t i = 0; i < 5; ++i) queue.Push(MakeFrame('a' + i));
+
+	CHECK(queue.Gather().size() == 2);
+	CHECK(queue.GatheredBytes() == FRAME_SIZE * 2);
+
+	CHECK(queue.Consume(FRAME_SIZE + 3) == 1); //第二个数据包发送了一部分
+	CHECK(queue.Bytes() == FRAME_SIZE * 4 - 3);
+
+	const auto& buffers = queue.Gather();
+	CHECK(boost::asio::buffer_size(buffers[0]) == FRAME_SIZE - 3);
+
+	CHECK(queue.Consume(queue.GatheredBytes()) == 2);
+	CHECK(queue.Size() == 2);
+	CHECK(Flush(queue) == "de");
+}
+
+//
+//超过高水位进入拥塞：非关键数据包丢弃，关键数据包继续入队直到上限；降到低水位以下退出拥塞
+//
+TEST(WatermarksDrop)
+{
+	WriteQueue queue;
+	queue.SetLimits(MakeLimits(BACKPRESSURE_POLICY_DROP));
+
+	for (int32_t i = 0; i < 10; ++i) CHECK(queue.Push(MakeFrame('a'), 1) == ENQUEUE_RESULT_SUCCESS);
+	CHECK(!queue.IsCongested());
+
+	CHECK(queue.Push(MakeFrame('b'), 1) == ENQUEUE_RESULT_DROPPED);
+	CHECK(queue.IsCongested());
+	CHECK(queue.GetStatus().dropped == 1);
+
+	CHECK(queue.Push(MakeFrame('c'), 0) == ENQUEUE_RESULT_SUCCESS); //关键数据包
+	CHECK(queue.Size() == 11);
+
+	std::size_t consumed = 0;
+	while (queue.Bytes() > FRAME_SIZE * 4)
+	{
+		queue.Gather();
+		CHECK(queue.IsCongested());
+		consumed += queue.Consume(FRAME_SIZE);
+	}
+
+	CHECK(consumed == 7);
+	CHECK(!queue.IsCongested()); //降到低水位
+	CHECK(queue.Push(MakeFrame('d'), 1) == ENQUEUE_RESULT_SUCCESS);
+}
+
+TEST(WatermarksMessages)
+{
+	auto limits = MakeLimits(BACKPRESSURE_POLICY_DROP);
+	limits.high_messages = 3;
+	limits.low_messages = 1;
+
+	WriteQueue queue;
+	queue.SetLimits(limits);
+
+	for (int32_t i = 0; i < 3; ++i) CHECK(queue.Push(MakeFrame('a'), 1) == ENQUEUE_RESULT_SUCCESS);
+	CHECK(queue.Push(MakeFrame('a'), 1) == ENQUEUE_RESULT_DROPPED);
+
+	queue.Gather();
+	queue.Consume(FRAME_SIZE);
+	CHECK(queue.IsCongested());
+
+	queue.Gather();
+	queue.Consume(FRAME_SIZE);
+	CHECK(!queue.IsCongested());
+}
+
+//关键数据包超过上限时需要断开连接，之后入队的数据包全部丢弃
+TEST(Overflow)
+{
+	WriteQueue queue;
+	queue.SetLimits(MakeLimits(BACKPRESSURE_POLICY_DROP));
+
+	ENQUEUE_RESULT result = ENQUEUE_RESULT_SUCCESS;
+	int32_t count = 0;
+
+	while (result == ENQUEUE_RESULT_SUCCESS && count < 100)
+	{
+		result = queue.Push(MakeFrame('a'), 0);
+		++count;
+	}
+
+	CHECK(result == ENQUEUE_RESULT_OVERFLOW);
+	CHECK(queue.IsOverflow());
+	CHECK(queue.Bytes() <= FRAME_SIZE * 15);
+	CHECK(queue.Push(MakeFrame('a'), 0) == ENQUEUE_RESULT_DROPPED);
+
+	queue.Clear();
+	CHECK(!queue.IsOverflow() && !queue.IsCongested() && queue.Empty());
+}
+
+TEST(Disconnect)
+{
+	WriteQueue queue;
+	queue.SetLimits(MakeLimits(BACKPRESSURE_POLICY_DISCONNECT));
+
+	for (int32_t i = 0; i < 10; ++i) queue.Push(MakeFrame('a'), 1);
+
+	CHECK(queue.Push(MakeFrame('a'), 0) == ENQUEUE_RESULT_OVERFLOW);
+	CHECK(queue.IsOverflow());
+}
+
+//拥塞时同类数据包替换队列中尚未发送的数据包，保持原有位置
+TEST(Coalesce)
+{
+	WriteQueue queue;
+	queue.SetLimits(MakeLimits(BACKPRESSURE_POLICY_COALESCE));
+
+	for (int32_t i = 0; i < 10; ++i) queue.Push(MakeFrame('a' + i), 100 + i);
+
+	CHECK(queue.Push(MakeFrame('X'), 103) == ENQUEUE_RESULT_COALESCED);
+	CHECK(queue.Push(MakeFrame('Y'), 999) == ENQUEUE_RESULT_DROPPED); //没有同类数据包
+	CHECK(queue.Size() == 10);
+	CHECK(queue.GetStatus().coalesced == 1);
+
+	queue.SetBatchBytes(FRAME_SIZE);
+	queue.Gather();
+	queue.Consume(3); //队首正在发送，不能替换
+
+	CHECK(queue.Push(MakeFrame('Z'), 100) == ENQUEUE_RESULT_DROPPED);
+	CHECK(Flush(queue) == "abcXefghij");
+}
+
+static const std::vector<int32_t> LANE_WEIGHTS = { 8, 4, 1 };
+
+//每轮额度足够时按优先级顺序发送
+TEST(LanesPriorityOrder)
+{
+	WriteQueue queue;
+	queue.EnableLanes(true, LANE_WEIGHTS);
+
+	queue.Push(MakeFrame('b', BODY_SIZE, SEND_PRIORITY_BULK));
+	queue.Push(MakeFrame('n', BODY_SIZE, SEND_PRIORITY_NORMAL));
+	queue.Push(MakeFrame('r', BODY_SIZE, SEND_PRIORITY_REALTIME));
+	queue.Push(MakeFrame('B', BODY_SIZE, SEND_PRIORITY_BULK));
+	queue.Push(MakeFrame('R', BODY_SIZE, SEND_PRIORITY_REALTIME));
+
+	CHECK(queue.Size() == 5);
+	CHECK(queue.Bytes() == FRAME_SIZE * 5);
+	CHECK(Flush(queue) == "rRnbB"); //同一优先级按入队顺序
+}
+
+//
+//各队列都有数据包时按权重分配发送字节，低优先级队列不会饿死
+//
+TEST(LanesDeficitRoundRobin)
+{
+	const std::size_t body_size = WriteQueue::LANE_QUANTUM - FrameBuffer::FRAME_HEADER_SIZE; //每个数据包刚好一个额度单位
+
+	WriteQueue queue;
+	queue.EnableLanes(true, LANE_WEIGHTS);
+	queue.SetBatchBytes(WriteQueue::LANE_QUANTUM * 4);
+
+	for (int32_t i = 0; i < 200; ++i)
+	{
+		queue.Push(MakeFrame('b', body_size, SEND_PRIORITY_BULK));
+		queue.Push(MakeFrame('n', body_size, SEND_PRIORITY_NORMAL));
+		queue.Push(MakeFrame('r', body_size, SEND_PRIORITY_REALTIME));
+	}
+
+	std::string order = Flush(queue);
+	CHECK(order.size() == 600);
+
+	std::string head = order.substr(0, 13 * 10); //实时队列为空之前，共10轮
+	std::size_t realtime = std::count(head.begin(), head.end(), 'r');
+	std::size_t normal = std::count(head.begin(), head.end(), 'n');
+	std::size_t bulk = std::count(head.begin(), head.end(), 'b');
+
+	CHECK(realtime == 80);
+	CHECK(normal == 40);
+	CHECK(bulk == 10);
+
+	CHECK(order.find_last_of('r') < order.find_last_of('n'));
+	CHECK(order.find_last_of('n') < order.find_last_of('b'));
+}
+
+//扩展数据包的分块连续发送，其他队列的数据包不会插入分块之间
+TEST(LanesExtendedFrameContiguous)
+{
+	std::string large(FrameBuffer::CHUNK_SIZE * 4 + 7, 'b');
+
+	WriteQueue queue;
+	queue.EnableLanes(true, LANE_WEIGHTS);
+	queue.SetBatchBytes(FrameBuffer::CHUNK_SIZE);
+
+	queue.Push(MakeFrame('b', large.size(), SEND_PRIORITY_BULK));
+	for (int32_t i = 0; i < 50; ++i) 
+	{
+		queue.Push(MakeFrame('r', 100, SEND_PRIORITY_REALTIME));
+		queue.Push(MakeFrame('n', 2000, SEND_PRIORITY_NORMAL));
+	}
+
+	std::string stream;
+	Append(FrameBuffer::BuildHandshake(FRAME_CAPABILITY_EXTENDED), stream);
+
+	while (!queue.Empty())
+	{
+		for (const auto& buffer : queue.Gather()) stream.append(boost::asio::buffer_cast<const char*>(buffer), boost::asio::buffer_size(buffer));
+		queue.Consume(queue.GatheredBytes());
+	}
+
+	FrameCodec codec;
+	codec.SetLocalCapabilities(FRAME_CAPABILITY_EXTENDED);
+
+	std::size_t count = 0;
+	bool matched = false;
+
+	for (std::size_t position = 0; position < stream.size(); )
+	{
+		auto buffer = codec.PrepareBuffer();
+		std::size_t size = std::min(boost::asio::buffer_size(buffer), stream.size() - position);
+
+		memcpy(boost::asio::buffer_cast<void*>(buffer), stream.data() + position, size);
+		codec.Commit(size);
+		position += size;
+
+		CHECK(codec.DecodeRaw([&](const uint8_t* body, std::size_t body_size) {
+			++count;
+			if (body_size == large.size()) matched = std::string(reinterpret_cast<const char*>(body), body_size) == large;
+			return FRAME_DECODE_SUCCESS;
+		}) == FRAME_DECODE_SUCCESS);
+	}
+
+	CHECK(count == 101);
+	CHECK(matched);
+}
+
+//关闭优先级时尚未取出的数据包按优先级全部进入发送顺序
+TEST(LanesDisable)
+{
+	WriteQueue queue;
+	queue.EnableLanes(true, LANE_WEIGHTS);
+
+	queue.Push(MakeFrame('b', BODY_SIZE, SEND_PRIORITY_BULK));
+	queue.Push(MakeFrame('n', BODY_SIZE, SEND_PRIORITY_NORMAL));
+	queue.Push(MakeFrame('r', BODY_SIZE, SEND_PRIORITY_REALTIME));
+
+	queue.EnableLanes(false, LANE_WEIGHTS);
+	CHECK(!queue.IsLanesEnabled());
+
+	queue.Push(MakeFrame('x', BODY_SIZE, SEND_PRIORITY_REALTIME));
+	CHECK(Flush(queue) == "rnbx");
+}
+
+//拥塞合并时优先替换尚未取出的同类数据包
+TEST(LanesCoalesce)
+{
+	WriteQueue queue;
+	queue.SetLimits(MakeLimits(BACKPRESSURE_POLICY_COALESCE));
+	queue.EnableLanes(true, LANE_WEIGHTS);
+
+	for (int32_t i = 0; i < 10; ++i) queue.Push(MakeFrame('a' + i, BODY_SIZE, SEND_PRIORITY_BULK), 100 + i);
+
+	CHECK(queue.Push(MakeFrame('X', BODY_SIZE, SEND_PRIORITY_BULK), 105) == ENQUEUE_RESULT_COALESCED);
+	CHECK(queue.Bytes() == FRAME_SIZE * 10);
+	CHECK(Flush(queue) == "abcdeXghij");
+}
+
+TEST_MAIN()
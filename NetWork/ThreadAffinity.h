@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+#include "MXLog.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Adoter
+{
+
+//
+//线程绑定CPU
+//
+//配置格式："0,2,4-7"按线程序号依次绑定列表中的CPU(数量不足时循环使用)，"auto"为依次绑定所有CPU，空为不绑定
+//
+class ThreadAffinity
+{
+public:
+	static std::vector<int32_t> Parse(const std::string& config, int32_t thread_count)
+	{
+		std::vector<int32_t> cpus;
+		if (config.empty() || thread_count <= 0) return cpus;
+
+		int32_t cpu_count = std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+
+		if (config == "auto")
+		{
+			for (int32_t i = 0; i < thread_count; ++i) cpus.push_back(i % cpu_count);
+			return cpus;
+		}
+
+		std::vector<int32_t> list;
+		std::stringstream stream(config);
+		std::string item;
+
+		while (std::getline(stream, item, ','))
+		{
+			if (item.empty()) continue;
+
+			auto pos = item.find('-');
+			int32_t first = std::atoi(item.substr(0, pos).c_str());
+			int32_t last = pos == std::string::npos ? first : std::atoi(item.substr(pos + 1).c_str());
+
+			for (int32_t cpu = first; cpu <= last; ++cpu)
+			{
+				if (cpu >= 0 && cpu < cpu_count) list.push_back(cpu);
+			}
+		}
+
+		if (list.empty())
+		{
+			WARN("线程绑定CPU配置错误:{}，CPU数量:{}，不绑定", config, cpu_count);
+			return cpus;
+		}
+
+		for (int32_t i = 0; i < thread_count; ++i) cpus.push_back(list[i % list.size()]);
+		return cpus;
+	}
+
+	//当前线程绑定到cpu
+	static bool Bind(int32_t cpu, const std::string& name)
+	{
+#ifdef __linux__
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(cpu, &cpu_set);
+
+		int32_t error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+		if (error)
+		{
+			WARN("{}绑定CPU:{} 失败，错误码:{}", name, cpu, error);
+			return false;
+		}
+
+		LOG(INFO, "{}绑定CPU:{}", name, cpu);
+		return true;
+#else
+		return false;
+#endif
+	}
+};
+
+}
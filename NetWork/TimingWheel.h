@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Adoter
+{
+
+/*
+ * 分层时间轮(单线程使用，由所在网络线程推进)
+ *
+ * 1.4层，每层64个槽位，第0层精度为1个刻度，共可表示64^4个刻度;
+ *
+ * 2.节点侵入式双向链表，加入、删除、重新调度均为O(1);
+ *
+ * 3.每推进一个刻度只处理当前槽位的到期节点，高层槽位轮转时把节点下放到低层.
+ *
+ * */
+
+class TimingWheel
+{
+public:
+	struct Node
+	{
+		Node* prev = nullptr;
+		Node* next = nullptr;
+		uint64_t expire = 0; //到期刻度
+
+		bool IsLinked() const { return prev != nullptr; }
+	};
+
+	static const int32_t LEVEL_BITS = 6;
+	static const int32_t LEVEL_SLOTS = 1 << LEVEL_BITS;
+	static const int32_t LEVEL_COUNT = 4;
+	static const uint64_t MAX_DELAY = (uint64_t(1) << (LEVEL_BITS * LEVEL_COUNT)) - 1;
+
+	explicit TimingWheel(uint64_t current = 0) : _current(current)
+	{
+		for (auto& level : _slots)
+		{
+			for (auto& slot : level) slot.prev = slot.next = &slot; //哨兵节点
+		}
+	}
+
+	TimingWheel(const TimingWheel&) = delete;
+	TimingWheel& operator = (const TimingWheel&) = delete;
+
+	//
+	//加入或者重新调度，不早于下一个刻度，超过范围按最大延迟
+	//
+	void Schedule(Node* node, uint64_t expire)
+	{
+		Cancel(node);
+
+		if (expire <= _current) expire = _current + 1;
+		if (expire - _current > MAX_DELAY) expire = _current + MAX_DELAY;
+
+		node->expire = expire;
+		Link(node);
+
+		++_size;
+	}
+
+	void Cancel(Node* node)
+	{
+		if (!node->IsLinked()) return;
+
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		node->prev = node->next = nullptr;
+
+		--_size;
+	}
+
+	//
+	//推进到now，到期节点从时间轮删除后回调(回调中可以重新调度或者释放节点)
+	//
+	template<typename Callback>
+	void Advance(uint64_t now, Callback&& expired)
+	{
+		while (_current < now)
+		{
+			++_current;
+
+			for (int32_t level = LEVEL_COUNT - 1; level > 0; --level) //高层槽位轮转，节点下放
+			{
+				if (_current & ((uint64_t(1) << (LEVEL_BITS * level)) - 1)) continue;
+
+				Node list;
+				Detach(_slots[level][(_current >> (LEVEL_BITS * level)) & (LEVEL_SLOTS - 1)], list);
+
+				while (list.next != &list)
+				{
+					Node* node = list.next;
+					Unlink(node);
+					Link(node);
+				}
+			}
+
+			Node list;
+			Detach(_slots[0][_current & (LEVEL_SLOTS - 1)], list);
+
+			while (list.next != &list)
+			{
+				Node* node = list.next;
+				Unlink(node);
+
+				--_size;
+				expired(node);
+			}
+		}
+	}
+
+	uint64_t GetCurrent() const { return _current; }
+	std::size_t Size() const { return _size; }
+
+private:
+	void Link(Node* node)
+	{
+		uint64_t delta = node->expire - _current;
+
+		int32_t level = 0;
+		while (level < LEVEL_COUNT - 1 && delta >= (uint64_t(1) << (LEVEL_BITS * (level + 1)))) ++level;
+
+		Node& slot = _slots[level][(node->expire >> (LEVEL_BITS * level)) & (LEVEL_SLOTS - 1)];
+
+		node->prev = slot.prev;
+		node->next = &slot;
+		slot.prev->next = node;
+		slot.prev = node;
+	}
+
+	static void Unlink(Node* node)
+	{
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		node->prev = node->next = nullptr;
+	}
+
+	//槽位中的所有节点转移到list(哨兵)
+	static void Detach(Node& slot, Node& list)
+	{
+		if (slot.next == &slot)
+		{
+			list.prev = list.next = &list;
+			return;
+		}
+
+		list.next = slot.next;
+		list.prev = slot.prev;
+		list.next->prev = &list;
+		list.prev->next = &list;
+
+		slot.prev = slot.next = &slot;
+	}
+
+private:
+	Node _slots[LEVEL_COUNT][LEVEL_SLOTS];
+	uint64_t _current = 0; //当前刻度
+	std::size_t _size = 0;
+};
+
+}
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <algorithm>
+
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 流量统计：按连接类型、方向、协议类型统计数据包数量、字节及处理耗时
+ *
+ * 1.每个线程独立的统计数据，只有本线程写入，不加锁也不使用原子加(单次统计约数纳秒);
+ *
+ * 2.输出时合并所有线程的统计数据(读取时不阻塞写入，数值可能略有延迟);
+ *
+ * 3.处理耗时抽样统计：每个线程每TrafficTimingSample个数据包计时一次，耗时按抽样间隔放大(读取时钟开销远大于计数);
+ *
+ * 4.统计数据只增不减，两次输出的差值即为该时间段的流量.
+ *
+ * */
+
+enum TRAFFIC_CLASS
+{
+	TRAFFIC_CLASS_CLIENT = 0, //玩家客户端
+	TRAFFIC_CLASS_GAME_SERVER = 1, //中心服务器<->游戏逻辑服务器(中心服务器一侧)
+	TRAFFIC_CLASS_CENTER_SERVER = 2, //游戏逻辑服务器<->中心服务器(逻辑服务器一侧)
+	TRAFFIC_CLASS_GMT = 3, //GMT服务器
+	TRAFFIC_CLASS_COUNT = 4,
+};
+
+enum TRAFFIC_DIRECTION
+{
+	TRAFFIC_DIRECTION_IN = 0, //接收
+	TRAFFIC_DIRECTION_OUT = 1, //发送
+	TRAFFIC_DIRECTION_COUNT = 2,
+};
+
+//
+//单个连接的流量(接收在网络线程，发送可能在任意线程)
+//
+struct TrafficCounter
+{
+	std::atomic<int64_t> messages[TRAFFIC_DIRECTION_COUNT];
+	std::atomic<int64_t> bytes[TRAFFIC_DIRECTION_COUNT];
+
+	TrafficCounter()
+	{
+		for (auto& value : messages) value.store(0, std::memory_order_relaxed);
+		for (auto& value : bytes) value.store(0, std::memory_order_relaxed);
+	}
+
+	void Add(TRAFFIC_DIRECTION direction, std::size_t size)
+	{
+		messages[direction].fetch_add(1, std::memory_order_relaxed);
+		bytes[direction].fetch_add(size, std::memory_order_relaxed);
+	}
+
+	int64_t GetMessages() const { return messages[TRAFFIC_DIRECTION_IN].load(std::memory_order_relaxed) + messages[TRAFFIC_DIRECTION_OUT].load(std::memory_order_relaxed); }
+	int64_t GetBytes() const { return bytes[TRAFFIC_DIRECTION_IN].load(std::memory_order_relaxed) + bytes[TRAFFIC_DIRECTION_OUT].load(std::memory_order_relaxed); }
+};
+
+//合并后的单项统计
+struct TrafficEntry
+{
+	TRAFFIC_CLASS traffic_class;
+	TRAFFIC_DIRECTION direction;
+	int32_t type_t; //协议类型，超出范围的统计在MAX_TYPE_COUNT
+	int64_t messages;
+	int64_t bytes;
+	int64_t cost_ns; //处理耗时(只统计接收)
+};
+
+class TrafficStats
+{
+	struct Cell
+	{
+		std::atomic<int64_t> messages{0};
+		std::atomic<int64_t> bytes{0};
+		std::atomic<int64_t> cost_ns{0};
+	};
+
+	//线程统计数据：按连接类型、方向首次使用时分配
+	struct Block
+	{
+		std::atomic<Cell*> rows[TRAFFIC_CLASS_COUNT][TRAFFIC_DIRECTION_COUNT];
+
+		Block()
+		{
+			for (auto& row : rows)
+				for (auto& cells : row) cells.store(nullptr, std::memory_order_relaxed);
+		}
+
+		~Block()
+		{
+			for (auto& row : rows)
+				for (auto& cells : row) delete [] cells.load(std::memory_order_relaxed);
+		}
+	};
+public:
+	static const int32_t MAX_TYPE_COUNT = 2048; //协议类型上限
+
+	static TrafficStats& Instance()
+	{
+		static TrafficStats _instance;
+		return _instance;
+	}
+
+	void Load()
+	{
+		_timing_sample = ConfigInstance.GetInt("TrafficTimingSample", 16); //小于等于0时不统计处理耗时
+	}
+
+	//
+	//本次是否计时，返回放大倍数(0为不计时)
+	//
+	int32_t ShouldTime()
+	{
+		static thread_local int32_t _count = 0;
+
+		int32_t sample = _timing_sample.load(std::memory_order_relaxed);
+		if (sample <= 0 || ++_count < sample) return 0;
+
+		_count = 0;
+		return sample;
+	}
+
+	//
+	//统计一个数据包，调用线程写入自己的统计数据
+	//
+	void Record(TRAFFIC_CLASS traffic_class, TRAFFIC_DIRECTION direction, int32_t type_t, std::size_t bytes, int64_t cost_ns = 0)
+	{
+		if (type_t < 0 || type_t >= MAX_TYPE_COUNT) type_t = MAX_TYPE_COUNT; //超出范围
+
+		auto& cell = GetRow(traffic_class, direction)[type_t];
+
+		Increase(cell.messages, 1);
+		Increase(cell.bytes, bytes);
+		if (cost_ns > 0) Increase(cell.cost_ns, cost_ns);
+	}
+
+	//
+	//合并所有线程的统计数据，按字节数从大到小排序
+	//
+	std::vector<TrafficEntry> Merge()
+	{
+		std::vector<TrafficEntry> entries;
+		std::vector<Cell*> rows;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		for (int32_t traffic_class = 0; traffic_class < TRAFFIC_CLASS_COUNT; ++traffic_class)
+		{
+			for (int32_t direction = 0; direction < TRAFFIC_DIRECTION_COUNT; ++direction)
+			{
+				rows.clear();
+
+				for (const auto& block : _blocks)
+				{
+					auto cells = block->rows[traffic_class][direction].load(std::memory_order_acquire);
+					if (cells) rows.push_back(cells);
+				}
+
+				if (rows.empty()) continue;
+
+				for (int32_t type_t = 0; type_t <= MAX_TYPE_COUNT; ++type_t)
+				{
+					TrafficEntry entry{ TRAFFIC_CLASS(traffic_class), TRAFFIC_DIRECTION(direction), type_t, 0, 0, 0 };
+
+					for (auto cells : rows)
+					{
+						entry.messages += cells[type_t].messages.load(std::memory_order_relaxed);
+						entry.bytes += cells[type_t].bytes.load(std::memory_order_relaxed);
+						entry.cost_ns += cells[type_t].cost_ns.load(std::memory_order_relaxed);
+					}
+
+					if (entry.messages > 0) entries.push_back(entry);
+				}
+			}
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const TrafficEntry& left, const TrafficEntry& right) {
+			return left.bytes > right.bytes;
+		});
+
+		return entries;
+	}
+
+	//
+	//文本报告，每种连接类型和方向最多输出top项
+	//
+	std::string Report(std::size_t top)
+	{
+		std::string report;
+		std::size_t counts[TRAFFIC_CLASS_COUNT][TRAFFIC_DIRECTION_COUNT] = {};
+
+		for (const auto& entry : Merge())
+		{
+			auto& count = counts[entry.traffic_class][entry.direction];
+			if (top > 0 && count >= top) continue;
+			++count;
+
+			report += fmt::format("连接类型:{} 方向:{} 协议类型:{} 数量:{} 字节:{} 处理耗时(微秒):{} 平均耗时(纳秒,抽样估算):{}\n",
+					GetClassName(entry.traffic_class), entry.direction == TRAFFIC_DIRECTION_IN ? "接收" : "发送",
+					entry.type_t, entry.messages, entry.bytes, entry.cost_ns / 1000, entry.cost_ns / entry.messages);
+		}
+
+		return report;
+	}
+
+	//输出到本地文件(追加)
+	static bool Dump(const std::string& file_name, const std::string& report)
+	{
+		if (file_name.empty()) return false;
+
+		std::ofstream file(file_name, std::ios::app);
+		if (!file)
+		{
+			WARN("流量统计文件:{} 打开失败", file_name);
+			return false;
+		}
+
+		auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		file << "==== " << now << " ====\n" << report;
+
+		return file.good();
+	}
+
+	static const char* GetClassName(TRAFFIC_CLASS traffic_class)
+	{
+		switch (traffic_class)
+		{
+			case TRAFFIC_CLASS_CLIENT: return "客户端";
+			case TRAFFIC_CLASS_GAME_SERVER: return "逻辑服务器";
+			case TRAFFIC_CLASS_CENTER_SERVER: return "中心服务器";
+			case TRAFFIC_CLASS_GMT: return "GMT服务器";
+			default: return "未知";
+		}
+	}
+
+private:
+	//只有本线程写入，读取+写入代替原子加
+	static void Increase(std::atomic<int64_t>& value, int64_t delta)
+	{
+		value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+	}
+
+	Cell* GetRow(TRAFFIC_CLASS traffic_class, TRAFFIC_DIRECTION direction)
+	{
+		static thread_local Block* _block = nullptr;
+
+		if (!_block)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			_blocks.emplace_back(new Block()); //线程退出后保留，统计数据不丢失
+			_block = _blocks.back().get();
+		}
+
+		auto& row = _block->rows[traffic_class][direction];
+
+		auto cells = row.load(std::memory_order_relaxed);
+		if (cells) return cells;
+
+		cells = new Cell[MAX_TYPE_COUNT + 1];
+		row.store(cells, std::memory_order_release);
+
+		return cells;
+	}
+
+private:
+	std::mutex _mutex;
+	std::vector<std::unique_ptr<Block>> _blocks;
+	std::atomic<int32_t> _timing_sample{16};
+};
+
+#define TrafficStatsInstance TrafficStats::Instance()
+
+//
+//统计接收数据包及处理耗时，离开作用域时记录
+//
+class TrafficScope
+{
+public:
+	TrafficScope(TRAFFIC_CLASS traffic_class, int32_t type_t, std::size_t bytes) :
+		_traffic_class(traffic_class), _type_t(type_t), _bytes(bytes), _sample(TrafficStatsInstance.ShouldTime())
+	{
+		if (_sample) _start = std::chrono::steady_clock::now();
+	}
+
+	~TrafficScope()
+	{
+		int64_t cost = 0;
+		if (_sample) cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count() * _sample;
+
+		TrafficStatsInstance.Record(_traffic_class, TRAFFIC_DIRECTION_IN, _type_t, _bytes, cost);
+	}
+
+	TrafficScope(const TrafficScope&) = delete;
+	TrafficScope& operator = (const TrafficScope&) = delete;
+
+private:
+	TRAFFIC_CLASS _traffic_class;
+	int32_t _type_t;
+	std::size_t _bytes;
+	int32_t _sample; //抽样计时的放大倍数
+	std::chrono::steady_clock::time_point _start;
+};
+
+}
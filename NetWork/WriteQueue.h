@@ -0,0 +1,505 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include <boost/asio.hpp>
+
+#include "FrameBuffer.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+/*
+ * 发送队列
+ *
+ * 1.发送时将队列中的数据包合并为一次发送(writev)，而不是每个数据包一次系统调用;
+ *
+ * 2.每次合并发送的字节数有上限，防止单次发送占用过长时间;
+ *
+ * 3.部分发送时只记录已发送的偏移，剩余数据下次继续发送;
+ *
+ * 4.队列中只保存数据包引用，入队和发送均不复制数据;
+ *
+ * 5.对端接收过慢时(队列超过高水位)，按策略丢弃或者合并非关键数据包，直到队列降到低水位以下;
+ *
+ * 6.开启优先级后(见SendPriorityPolicy)，数据包先按优先级放入各自的队列，合并发送前按权重取出，已取出的数据包按顺序发送.
+ *
+ * */
+
+//发送统计
+struct FlushStatistics
+{
+	std::atomic<int64_t> flush_count; //发送次数(系统调用次数)
+	std::atomic<int64_t> message_count; //发送的数据包数量
+	std::atomic<int64_t> bytes_count; //发送的字节数
+	std::atomic<int64_t> dropped_count; //队列拥塞时丢弃的数据包数量
+	std::atomic<int64_t> coalesced_count; //队列拥塞时合并的数据包数量
+
+	FlushStatistics() : flush_count(0), message_count(0), bytes_count(0), dropped_count(0), coalesced_count(0) { }
+
+	int64_t GetSavedSyscalls() const { return message_count - flush_count; } //合并发送节省的系统调用次数
+	int64_t GetBytesPerFlush() const { return flush_count ? bytes_count / flush_count : 0; } //平均每次发送字节数
+};
+
+//队列拥塞处理策略
+enum BACKPRESSURE_POLICY
+{
+	BACKPRESSURE_POLICY_DROP = 1, //丢弃非关键数据包
+	BACKPRESSURE_POLICY_COALESCE = 2, //非关键数据包替换队列中尚未发送的同类数据包，没有同类数据包则丢弃
+	BACKPRESSURE_POLICY_DISCONNECT = 3, //断开连接
+};
+
+//入队结果
+enum ENQUEUE_RESULT
+{
+	ENQUEUE_RESULT_SUCCESS = 0,
+	ENQUEUE_RESULT_DROPPED = 1, //拥塞丢弃
+	ENQUEUE_RESULT_COALESCED = 2, //拥塞合并
+	ENQUEUE_RESULT_OVERFLOW = 3, //超过上限，需要断开连接
+};
+
+//
+//水位配置，按连接类型读取
+//
+//配置项：连接类型 + SendHighBytes/SendLowBytes/SendHighMessages/SendLowMessages/SendMaxBytes/SendPolicy
+//
+struct QueueLimits
+{
+	std::size_t high_bytes = 1024 * 1024; //高水位(字节)
+	std::size_t low_bytes = 256 * 1024; //低水位(字节)
+	std::size_t high_messages = 4096; //高水位(数据包数量)
+	std::size_t low_messages = 1024; //低水位(数据包数量)
+	std::size_t max_bytes = 8 * 1024 * 1024; //上限，超过则断开连接，0表示不限制
+	BACKPRESSURE_POLICY policy = BACKPRESSURE_POLICY_DROP;
+
+	static QueueLimits Load(const std::string& name) { return Load(name, QueueLimits()); }
+
+	static QueueLimits Load(const std::string& name, const QueueLimits& defaults)
+	{
+		QueueLimits limits;
+
+		limits.high_bytes = ConfigInstance.GetInt(name + "SendHighBytes", defaults.high_bytes);
+		limits.low_bytes = ConfigInstance.GetInt(name + "SendLowBytes", defaults.low_bytes);
+		limits.high_messages = ConfigInstance.GetInt(name + "SendHighMessages", defaults.high_messages);
+		limits.low_messages = ConfigInstance.GetInt(name + "SendLowMessages", defaults.low_messages);
+		limits.max_bytes = ConfigInstance.GetInt(name + "SendMaxBytes", defaults.max_bytes);
+		limits.policy = (BACKPRESSURE_POLICY)ConfigInstance.GetInt(name + "SendPolicy", defaults.policy);
+
+		return limits;
+	}
+
+	//服务器之间的连接：承载所有玩家数据，水位更高
+	static QueueLimits ServerLink()
+	{
+		QueueLimits limits;
+
+		limits.high_bytes = 16 * 1024 * 1024;
+		limits.low_bytes = 4 * 1024 * 1024;
+		limits.high_messages = 65536;
+		limits.low_messages = 16384;
+		limits.max_bytes = 256 * 1024 * 1024;
+
+		return limits;
+	}
+};
+
+//单个连接的发送队列状态
+struct QueueStatus
+{
+	std::size_t messages = 0; //待发送数据包数量
+	std::size_t bytes = 0; //待发送字节数
+	int64_t dropped = 0;
+	int64_t coalesced = 0;
+	bool congested = false; //是否处于拥塞状态
+};
+
+class WriteQueue
+{
+	struct Entry
+	{
+		FramePtr chunk;
+		uint32_t tag; //合并标识，0为关键数据包
+	};
+
+	//按优先级等待的数据包(包括全部分块)
+	struct Pending
+	{
+		FramePtr frame;
+		uint32_t tag;
+		std::size_t bytes;
+	};
+public:
+	static const std::size_t MAX_GATHER_BUFFERS = 64; //单次发送最多合并的数据包数量，同Boost.Asio单次系统调用上限
+	static const std::size_t DEFAULT_BATCH_BYTES = 65536; //单次发送默认最大字节数
+	static const std::size_t LANE_QUANTUM = 4096; //优先级队列每轮额度单位(字节)
+
+	WriteQueue() { _buffers.reserve(MAX_GATHER_BUFFERS); }
+
+	//
+	//开启或者关闭优先级，weights为各优先级的权重；关闭时等待的数据包按优先级全部取出
+	//
+	void EnableLanes(bool enabled, const std::vector<int32_t>& weights)
+	{
+		for (std::size_t i = 0; i < SEND_PRIORITY_COUNT && i < weights.size(); ++i) _weights[i] = std::max(1, weights[i]);
+
+		if (!enabled) 
+		{
+			for (int32_t priority = 0; priority < SEND_PRIORITY_COUNT; ++priority)
+				while (!_lanes[priority].empty()) Commit(priority);
+		}
+
+		_lanes_enabled = enabled;
+	}
+
+	void SetBatchBytes(std::size_t batch_bytes) { _batch_bytes = batch_bytes > 0 ? batch_bytes : DEFAULT_BATCH_BYTES; }
+	void SetLimits(const QueueLimits& limits) { _limits = limits; }
+	const QueueLimits& GetLimits() const { return _limits; }
+
+	//
+	//数据包入队，扩展数据包的各个分块依次入队
+	//
+	//tag：非关键数据包的合并标识(比如协议类型)，队列拥塞时可以丢弃或者合并，0表示必须发送
+	//
+	ENQUEUE_RESULT Push(const FramePtr& frame, uint32_t tag = 0)
+	{
+		if (_overflow) //已经超过上限，等待断开连接
+		{
+			OnDropped();
+			return ENQUEUE_RESULT_DROPPED;
+		}
+
+		if (_congested || Bytes() >= _limits.high_bytes || _message_count >= _limits.high_messages)
+		{
+			_congested = true;
+
+			if (_limits.policy == BACKPRESSURE_POLICY_DISCONNECT) return Overflow();
+
+			if (tag != 0)
+			{
+				if (_limits.policy == BACKPRESSURE_POLICY_COALESCE && Replace(frame, tag))
+				{
+					OnCoalesced();
+					return ENQUEUE_RESULT_COALESCED;
+				}
+
+				OnDropped();
+				return ENQUEUE_RESULT_DROPPED;
+			}
+
+			if (_limits.max_bytes > 0 && Bytes() + frame->BodySize() > _limits.max_bytes) return Overflow();
+		}
+
+		if (frame->Next()) tag = 0; //分块数据包不参与合并
+
+		if (_lanes_enabled)
+		{
+			std::size_t bytes = 0;
+			for (auto chunk = frame; chunk; chunk = chunk->Next()) bytes += chunk->Size();
+
+			_lanes[frame->GetPriority()].push_back({frame, tag, bytes});
+			_bytes += bytes;
+			_pending_bytes += bytes;
+			++_pending_count;
+			++_message_count;
+			return ENQUEUE_RESULT_SUCCESS;
+		}
+
+		for (auto chunk = frame; chunk; chunk = chunk->Next())
+		{
+			_bytes += chunk->Size();
+			_frames.push_back({chunk, tag});
+		}
+
+		++_message_count;
+		return ENQUEUE_RESULT_SUCCESS;
+	}
+
+	//
+	//插入到队首，用于连接建立时的握手数据包(队首数据包从头发送)
+	//
+	void PushFront(const FramePtr& frame)
+	{
+		_front_offset = 0;
+		_bytes = _pending_bytes;
+
+		_frames.push_front({frame, 0});
+		for (const auto& entry : _frames) _bytes += entry.chunk->Size();
+
+		++_message_count;
+	}
+
+	bool Empty() const { return _frames.empty() && _pending_count == 0; }
+	std::size_t Size() const { return _message_count; }
+	std::size_t Bytes() const { return _bytes - _front_offset; }
+	bool IsCongested() const { return _congested; }
+	bool IsLanesEnabled() const { return _lanes_enabled; }
+	bool IsOverflow() const { return _overflow; }
+
+	QueueStatus GetStatus() const
+	{
+		QueueStatus status;
+
+		status.messages = _message_count;
+		status.bytes = Bytes();
+		status.dropped = _statistics.dropped_count;
+		status.coalesced = _statistics.coalesced_count;
+		status.congested = _congested;
+
+		return status;
+	}
+
+	void Clear()
+	{
+		_frames.clear();
+		_buffers.clear();
+		_bytes = _front_offset = _message_count = 0;
+
+		for (auto& lane : _lanes) lane.clear();
+		for (auto& deficit : _deficits) deficit = 0;
+		_lane = 0;
+		_lane_started = false;
+		_pending_bytes = _pending_count = 0;
+		_congested = _overflow = false;
+	}
+
+	//
+	//合并待发送数据，总字节数不超过上限(至少包含一个数据包)
+	//
+	const std::vector<boost::asio::const_buffer>& Gather()
+	{
+		_buffers.clear();
+		_gathered_bytes = 0;
+
+		if (_pending_count > 0) Refill();
+
+		for (auto it = _frames.begin(); it != _frames.end() && _buffers.size() < MAX_GATHER_BUFFERS; ++it)
+		{
+			std::size_t offset = _buffers.empty() ? _front_offset : 0;
+			std::size_t size = it->chunk->Size() - offset;
+
+			if (!_buffers.empty() && _gathered_bytes + size > _batch_bytes) break;
+
+			_buffers.push_back(boost::asio::buffer(it->chunk->Data() + offset, size));
+			_gathered_bytes += size;
+		}
+
+		return _buffers;
+	}
+
+	std::size_t GatheredBytes() const { return _gathered_bytes; }
+
+	//
+	//已经发送的字节数，移除发送完成的数据包，部分发送的记录偏移
+	//
+	//返回完整发送的数据包数量
+	//
+	std::size_t Consume(std::size_t bytes_sent)
+	{
+		std::size_t messages = 0;
+
+		while (bytes_sent > 0 && !_frames.empty())
+		{
+			std::size_t remain = _frames.front().chunk->Size() - _front_offset;
+
+			if (bytes_sent < remain)
+			{
+				_front_offset += bytes_sent;
+				break;
+			}
+
+			bytes_sent -= remain;
+			PopFront();
+
+			++messages;
+		}
+
+		return messages;
+	}
+
+	//丢弃队首数据包(包括部分发送的)
+	void PopFront()
+	{
+		if (_frames.empty()) return;
+
+		const auto& chunk = _frames.front().chunk;
+		if (!chunk->Next()) --_message_count; //数据包最后一个分块
+
+		_bytes -= chunk->Size();
+		_front_offset = 0;
+		_frames.pop_front();
+
+		if (_congested && Bytes() <= _limits.low_bytes && _message_count <= _limits.low_messages) _congested = false; //降到低水位以下
+	}
+
+	//
+	//记录一次发送
+	//
+	void OnFlushed(std::size_t bytes_sent, std::size_t messages)
+	{
+		_statistics.flush_count += 1;
+		_statistics.message_count += messages;
+		_statistics.bytes_count += bytes_sent;
+
+		auto& global = GlobalStatistics();
+		global.flush_count += 1;
+		global.message_count += messages;
+		global.bytes_count += bytes_sent;
+	}
+
+	const FlushStatistics& GetStatistics() const { return _statistics; }
+
+	//入队之前(发送环形队列已满)丢弃的数据包，统计为原子变量，不需要发送锁
+	void RecordDropped() { OnDropped(); }
+
+	static FlushStatistics& GlobalStatistics() //进程内所有连接的发送统计
+	{
+		static FlushStatistics _global_statistics;
+		return _global_statistics;
+	}
+
+private:
+	//
+	//按权重从各优先级队列取出数据包，直到待发送的数据达到单次发送上限
+	//
+	//各队列从实时队列开始轮流取出，轮到时增加 权重*LANE_QUANTUM 额度，额度足够时取出整个数据包；
+	//
+	//单次发送已满时记录当前队列，下次从该队列继续(不重新增加额度)，高优先级队列持续有数据时低优先级队列仍按权重发送；
+	//
+	//大数据包累积几轮额度后才取出，期间其他队列继续发送；队列为空时额度清零
+	//
+	//扩展数据包的全部分块一起取出：分块在字节流中必须连续，取出后其他队列的数据包排在整个数据包之后
+	//
+	void Refill()
+	{
+		while (_pending_count > 0 && Bytes() - _pending_bytes < _batch_bytes && _frames.size() < MAX_GATHER_BUFFERS)
+		{
+			auto& lane = _lanes[_lane];
+			auto& deficit = _deficits[_lane];
+
+			if (lane.empty()) 
+			{
+				deficit = 0;
+				NextLane();
+				continue;
+			}
+
+			if (!_lane_started) 
+			{
+				deficit += _weights[_lane] * LANE_QUANTUM;
+				_lane_started = true;
+			}
+
+			while (!lane.empty() && deficit >= lane.front().bytes && Bytes() - _pending_bytes < _batch_bytes)
+			{
+				deficit -= lane.front().bytes;
+				Commit(_lane);
+			}
+
+			if (lane.empty()) deficit = 0;
+			else if (deficit >= lane.front().bytes) break; //单次发送已满，额度未用完
+
+			NextLane();
+		}
+	}
+
+	void NextLane()
+	{
+		_lane = (_lane + 1) % SEND_PRIORITY_COUNT;
+		_lane_started = false;
+	}
+
+	//队首数据包加入发送顺序
+	void Commit(int32_t priority)
+	{
+		auto& lane = _lanes[priority];
+
+		const auto& pending = lane.front();
+		for (auto chunk = pending.frame; chunk; chunk = chunk->Next()) _frames.push_back({chunk, pending.tag});
+
+		_pending_bytes -= pending.bytes;
+		--_pending_count;
+
+		lane.pop_front();
+	}
+
+	//
+	//替换队列中尚未开始发送的同类数据包，保持原有发送顺序
+	//
+	bool Replace(const FramePtr& frame, uint32_t tag)
+	{
+		if (frame->Next()) return false;
+
+		auto& lane = _lanes[frame->GetPriority()]; //尚未取出的数据包较新，先查找
+		for (auto it = lane.rbegin(); it != lane.rend(); ++it)
+		{
+			if (it->tag != tag) continue;
+
+			_bytes = _bytes - it->bytes + frame->Size();
+			_pending_bytes = _pending_bytes - it->bytes + frame->Size();
+
+			it->frame = frame;
+			it->bytes = frame->Size();
+			return true;
+		}
+
+		for (auto it = _frames.rbegin(); it != _frames.rend(); ++it)
+		{
+			if (it->tag != tag) continue;
+			if (std::next(it) == _frames.rend() && _front_offset > 0) return false; //正在发送
+
+			_bytes = _bytes - it->chunk->Size() + frame->Size();
+			it->chunk = frame;
+			return true;
+		}
+
+		return false;
+	}
+
+	ENQUEUE_RESULT Overflow()
+	{
+		_overflow = true;
+
+		OnDropped();
+		return ENQUEUE_RESULT_OVERFLOW;
+	}
+
+	void OnDropped()
+	{
+		_statistics.dropped_count += 1;
+		GlobalStatistics().dropped_count += 1;
+	}
+
+	void OnCoalesced()
+	{
+		_statistics.coalesced_count += 1;
+		GlobalStatistics().coalesced_count += 1;
+	}
+
+private:
+	std::deque<Entry> _frames; //待发送数据包
+	std::vector<boost::asio::const_buffer> _buffers; //单次合并发送的缓存
+	std::size_t _batch_bytes = DEFAULT_BATCH_BYTES;
+	std::size_t _bytes = 0; //队列中数据总字节数
+	std::size_t _front_offset = 0; //队首数据包已发送字节数
+	std::size_t _gathered_bytes = 0;
+	std::size_t _message_count = 0; //队列中数据包数量(分块数据包计为一个)
+	bool _lanes_enabled = false; //按优先级发送
+	std::deque<Pending> _lanes[SEND_PRIORITY_COUNT]; //尚未取出的数据包
+	std::size_t _deficits[SEND_PRIORITY_COUNT] = {}; //各队列剩余额度(字节)
+	int32_t _lane = 0; //当前轮到的队列
+	bool _lane_started = false; //当前队列本轮已经增加额度
+	int32_t _weights[SEND_PRIORITY_COUNT] = { 8, 4, 1 };
+	std::size_t _pending_bytes = 0;
+	std::size_t _pending_count = 0;
+	bool _congested = false; //拥塞状态，超过高水位进入，低于低水位退出
+	bool _overflow = false; //超过上限，之后入队的数据包全部丢弃
+	QueueLimits _limits;
+	FlushStatistics _statistics;
+};
+
+}